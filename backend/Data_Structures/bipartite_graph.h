@@ -1,221 +1,458 @@
-#ifndef BIPARTITE_GRAPH_H
-#define BIPARTITE_GRAPH_H
-
-#include <unordered_map>
-#include <vector>
-#include <string>
-#include <algorithm>
-
-using namespace std;
-
-struct BipartiteEdge {
-      string to;
-    double weight; // Normalized play count
-
-    BipartiteEdge(const   string& t, double w) : to(t), weight(w) {}
-};
-
-class BipartiteGraph {
-private:
-    // User -> Artists adjacency
-      unordered_map<  string,   vector<BipartiteEdge>> user_to_artist;
-
-    // Artist -> Users adjacency
-      unordered_map<  string,   vector<BipartiteEdge>> artist_to_user;
-
-    // Max play counts for normalization
-      unordered_map<  string, int> max_plays_per_user;
-
-public:
-    
-    void addEdge(const   string& user_id, const   string& artist_id, int play_count) {
-        // Update max play count for user
-        if (max_plays_per_user.find(user_id) == max_plays_per_user.end()) {
-            max_plays_per_user[user_id] = play_count;
-        } else {
-            max_plays_per_user[user_id] = max(max_plays_per_user[user_id], play_count);
-        }
-
-        // Store raw play count (will normalize later)
-        user_to_artist[user_id].push_back(BipartiteEdge(artist_id, play_count));
-        artist_to_user[artist_id].push_back(BipartiteEdge(user_id, play_count));
-    }
-
-    void normalizeWeights() {
-        // Normalize user->artist edges
-        for (auto& it : user_to_artist) {
-            auto& user_id = it.first;
-            auto& edges = it.second;
-            double max_plays = static_cast<double>(max_plays_per_user[user_id]);
-            if (max_plays > 0) {
-                for (auto& edge : edges) {
-                    edge.weight = edge.weight / max_plays;
-                }
-            }
-        }
-
-        // Normalize artist->user edges
-        for (auto& it : artist_to_user) {
-            auto& artist_id = it.first;
-            auto& edges = it.second;
-            for (auto& edge : edges) {
-                double max_plays = static_cast<double>(max_plays_per_user[edge.to]);
-                if (max_plays > 0) {
-                    edge.weight = edge.weight / max_plays;
-                }
-            }
-        }
-    }
-
-    vector<pair<string, double>> getTopArtistsForUser(
-        const string& user_id,
-        int k
-    ) const {
-        auto it = user_to_artist.find(user_id);
-        if (it == user_to_artist.end()) {
-            return {};
-        }
-
-        vector<pair<string, double>> artists;
-        for (const auto& edge : it->second) {
-            artists.push_back({edge.to, edge.weight});
-        }
-
-        // Sort by weight descending
-        sort(artists.begin(), artists.end(),
-            [](const auto& a, const auto& b) {
-                return a.second > b.second;
-            });
-
-        // Return top K
-        if (artists.size() > static_cast<size_t>(k)) {
-            artists.resize(k);
-        }
-
-        return artists;
-    }
-
-    vector<pair<string, double>> getArtistsForUser(
-        const string& user_id
-    ) const {
-        auto it = user_to_artist.find(user_id);
-        if (it == user_to_artist.end()) {
-            return {};
-        }
-
-        vector<pair<string, double>> artists;
-        for (const auto& edge : it->second) {
-            artists.push_back({edge.to, edge.weight});
-        }
-
-        return artists;
-    }
-
-    vector<pair<string, double>> getUsersForArtist(
-        const string& artist_id
-    ) const {
-        auto it = artist_to_user.find(artist_id);
-        if (it == artist_to_user.end()) {
-            return {};
-        }
-
-        vector<pair<string, double>> users;
-        for (const auto& edge : it->second) {
-            users.push_back({edge.to, edge.weight});
-        }
-
-        // Sort by weight descending
-        sort(users.begin(), users.end(),
-            [](const auto& a, const auto& b) {
-                return a.second > b.second;
-            });
-
-        return users;
-    }
-
-    double getEdgeWeight(const string& user_id, const string& artist_id) const {
-        auto it = user_to_artist.find(user_id);
-        if (it == user_to_artist.end()) {
-            return 0.0;
-        }
-
-        for (const auto& edge : it->second) {
-            if (edge.to == artist_id) {
-                return edge.weight;
-            }
-        }
-
-        return 0.0;
-    }
-
-    vector<pair<string, double>> recommendFromTopArtists(
-        const string& user_id,
-        const unordered_map<string, vector<string>>& artist_songs,
-        int top_artists = 5
-    ) const {
-        auto top_artists_list = getTopArtistsForUser(user_id, top_artists);
-
-        unordered_map<string, double> song_scores;
-
-        // Collect songs from top artists, weighted by artist preference
-        for (const auto& it1 : top_artists_list) {
-            auto& artist_id = it1.first;
-            auto& weight = it1.second;
-            auto it = artist_songs.find(artist_id);
-            if (it != artist_songs.end()) {
-                for (const auto& song_id : it->second) {
-                    song_scores[song_id] += weight;
-                }
-            }
-        }
-
-        // Convert to vector and sort
-        vector<pair<string, double>> recommendations;
-        for (const auto& it : song_scores) {
-            auto& song_id = it.first;
-            auto& score = it.second;
-            recommendations.push_back({song_id, score});
-        }
-
-        sort(recommendations.begin(), recommendations.end(),
-            [](const auto& a, const auto& b) {
-                return a.second > b.second;
-            });
-
-        return recommendations;
-    }
-
-    int getUserCount() const {
-        return user_to_artist.size();
-    }
-
-    int getArtistCount() const {
-        return artist_to_user.size();
-    }
-
-    int getEdgeCount() const {
-        int count = 0;
-        for (const auto& it : user_to_artist) {
-            auto& user = it.first;
-            auto& edges = it.second;
-            count += edges.size();
-        }
-        return count;
-    }
-
-    bool hasUser(const   string& user_id) const {
-        return user_to_artist.find(user_id) != user_to_artist.end();
-    }
-
-    bool hasArtist(const   string& artist_id) const {
-        return artist_to_user.find(artist_id) != artist_to_user.end();
-    }
-
-    void clear() {
-        user_to_artist.clear();
-        artist_to_user.clear();
-        max_plays_per_user.clear();
-    }
-};
-
-#endif
+#ifndef BIPARTITE_GRAPH_H
+#define BIPARTITE_GRAPH_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include "../core/snapshot.h"
+
+using namespace std;
+
+struct BipartiteEdge {
+    uint32_t to; // Dense artist (or user) index
+    double weight; // Raw play count while building, normalized once frozen
+
+    BipartiteEdge(uint32_t t, double w) : to(t), weight(w) {}
+};
+
+/**
+ * User <-> artist bipartite graph
+ *
+ * Edges are collected with addEdge() and then frozen into CSR arrays:
+ * - user -> artists, pre-sorted by normalized weight descending
+ * - artist -> users, pre-sorted by normalized weight descending
+ * - artist -> songs, contiguous in the order given to freeze()
+ * Weights are play counts divided by the user's largest play count,
+ * computed once per user during freeze().
+ *
+ * Queries read the frozen arrays; adding an edge after freeze() moves the
+ * graph back to its build form until the next freeze().
+ */
+class BipartiteGraph {
+private:
+    // Build-side user -> (artist, raw play count), indexed by dense user id
+    vector<vector<BipartiteEdge>> pending;
+    size_t pending_artists = 0;
+
+    bool frozen = false;
+    int user_count = 0;
+    int artist_count = 0;
+
+    // User u's artists are [user_offsets[u], user_offsets[u + 1])
+    vector<uint32_t> user_offsets;
+    vector<uint32_t> user_artists;
+    vector<int> user_plays; // raw play counts, kept so the graph can thaw
+    vector<double> user_weights;
+
+    // Artist a's listeners are [artist_offsets[a], artist_offsets[a + 1])
+    vector<uint32_t> artist_offsets;
+    vector<uint32_t> artist_users;
+    vector<double> artist_weights;
+
+    // Artist a's songs are [song_offsets[a], song_offsets[a + 1])
+    vector<uint32_t> song_offsets;
+    vector<uint32_t> artist_song_ids;
+
+    // Higher weight first, ties to the lower id
+    static bool ranksAbove(const pair<uint32_t, double>& a, const pair<uint32_t, double>& b) {
+        if (a.second != b.second) return a.second > b.second;
+        return a.first < b.first;
+    }
+
+    void thaw() {
+        pending.assign(user_offsets.empty() ? 0 : user_offsets.size() - 1, {});
+        for (uint32_t u = 0; u < pending.size(); ++u) {
+            for (uint32_t i = user_offsets[u]; i < user_offsets[u + 1]; ++i) {
+                pending[u].push_back(BipartiteEdge(user_artists[i], user_plays[i]));
+            }
+        }
+        pending_artists = artist_offsets.empty() ? 0 : artist_offsets.size() - 1;
+        frozen = false;
+    }
+
+    static size_t rowSize(const vector<uint32_t>& offsets, uint32_t row) {
+        return row + 1 < offsets.size() ? offsets[row + 1] - offsets[row] : 0;
+    }
+
+public:
+
+    // Plays of the same user-artist pair are summed
+    void addEdge(uint32_t user_id, uint32_t artist_id, int play_count) {
+        if (frozen) thaw();
+        if (user_id >= pending.size()) {
+            pending.resize(user_id + 1);
+        }
+        pending_artists = max<size_t>(pending_artists, artist_id + 1);
+
+        for (auto& edge : pending[user_id]) {
+            if (edge.to == artist_id) {
+                edge.weight += play_count;
+                return;
+            }
+        }
+        pending[user_id].push_back(BipartiteEdge(artist_id, play_count));
+    }
+
+    /**
+     * Normalizes weights and lays out the CSR arrays. artist_songs[a] are
+     * artist a's songs, in the order ties between them should be broken;
+     * if empty, the songs of the previous freeze() are kept.
+     * Time Complexity: O(E log d + S) for E edges, max degree d, S songs
+     */
+    void freeze(const vector<vector<uint32_t>>& artist_songs = {}) {
+        if (frozen) thaw();
+        size_t num_users = pending.size();
+        size_t num_artists = max(pending_artists, artist_songs.size());
+
+        user_offsets.assign(num_users + 1, 0);
+        user_artists.clear();
+        user_plays.clear();
+        user_weights.clear();
+        user_count = 0;
+
+        vector<uint32_t> listeners(num_artists + 1, 0);
+        for (uint32_t u = 0; u < num_users; ++u) {
+            auto& edges = pending[u];
+            if (!edges.empty()) user_count++;
+
+            // Dividing by the user's max keeps this order, so sort raw plays
+            sort(edges.begin(), edges.end(), [](const BipartiteEdge& a, const BipartiteEdge& b) {
+                if (a.weight != b.weight) return a.weight > b.weight;
+                return a.to < b.to;
+            });
+            double max_plays = edges.empty() ? 0.0 : edges.front().weight;
+
+            for (const auto& edge : edges) {
+                user_artists.push_back(edge.to);
+                user_plays.push_back(static_cast<int>(edge.weight));
+                user_weights.push_back(max_plays > 0 ? edge.weight / max_plays : edge.weight);
+                listeners[edge.to + 1]++;
+            }
+            user_offsets[u + 1] = static_cast<uint32_t>(user_artists.size());
+        }
+
+        // Artist -> users from the normalized user rows
+        artist_count = 0;
+        for (size_t a = 0; a < num_artists; ++a) {
+            if (listeners[a + 1] > 0) artist_count++;
+            listeners[a + 1] += listeners[a];
+        }
+        artist_offsets = listeners;
+        artist_users.assign(user_artists.size(), 0);
+        artist_weights.assign(user_artists.size(), 0.0);
+        vector<uint32_t> cursor(listeners.begin(), listeners.end() - 1);
+        for (uint32_t u = 0; u < num_users; ++u) {
+            for (uint32_t i = user_offsets[u]; i < user_offsets[u + 1]; ++i) {
+                uint32_t pos = cursor[user_artists[i]]++;
+                artist_users[pos] = u;
+                artist_weights[pos] = user_weights[i];
+            }
+        }
+        vector<pair<uint32_t, double>> row;
+        for (size_t a = 0; a < num_artists; ++a) {
+            row.clear();
+            for (uint32_t i = artist_offsets[a]; i < artist_offsets[a + 1]; ++i) {
+                row.push_back({artist_users[i], artist_weights[i]});
+            }
+            sort(row.begin(), row.end(), ranksAbove);
+            for (size_t j = 0; j < row.size(); ++j) {
+                artist_users[artist_offsets[a] + j] = row[j].first;
+                artist_weights[artist_offsets[a] + j] = row[j].second;
+            }
+        }
+
+        if (!artist_songs.empty()) {
+            song_offsets.assign(artist_songs.size() + 1, 0);
+            artist_song_ids.clear();
+            for (size_t a = 0; a < artist_songs.size(); ++a) {
+                artist_song_ids.insert(artist_song_ids.end(), artist_songs[a].begin(), artist_songs[a].end());
+                song_offsets[a + 1] = static_cast<uint32_t>(artist_song_ids.size());
+            }
+        }
+
+        pending.clear();
+        pending.shrink_to_fit();
+        frozen = true;
+    }
+
+    bool isFrozen() const {
+        return frozen;
+    }
+
+    /**
+     * addEdge() for a frozen graph without thawing it: adds play_count to
+     * the pair, renormalizes the user's row by its new largest play count
+     * and repositions the user in each of its artists' rows.
+     * Time Complexity: O(d_u log d_u + sum of the d_u artists' degrees),
+     * plus one O(E) array shift if the pair is new
+     */
+    void addPlays(uint32_t user_id, uint32_t artist_id, int play_count) {
+        if (!frozen) {
+            addEdge(user_id, artist_id, play_count);
+            return;
+        }
+
+        auto grow = [](vector<uint32_t>& offsets, size_t rows) {
+            if (offsets.empty()) offsets.push_back(0);
+            while (offsets.size() < rows + 1) offsets.push_back(offsets.back());
+        };
+        grow(user_offsets, user_id + 1);
+        grow(artist_offsets, artist_id + 1);
+
+        uint32_t begin = user_offsets[user_id];
+        uint32_t end = user_offsets[user_id + 1];
+        uint32_t at = begin;
+        while (at < end && user_artists[at] != artist_id) ++at;
+
+        if (at == end) {
+            // New pair: open a slot at the end of both rows
+            if (begin == end) user_count++;
+            if (rowSize(artist_offsets, artist_id) == 0) artist_count++;
+            user_artists.insert(user_artists.begin() + end, artist_id);
+            user_plays.insert(user_plays.begin() + end, 0);
+            user_weights.insert(user_weights.begin() + end, 0.0);
+            for (size_t u = user_id + 1; u < user_offsets.size(); ++u) user_offsets[u]++;
+
+            uint32_t slot = artist_offsets[artist_id + 1];
+            artist_users.insert(artist_users.begin() + slot, user_id);
+            artist_weights.insert(artist_weights.begin() + slot, 0.0);
+            for (size_t a = artist_id + 1; a < artist_offsets.size(); ++a) artist_offsets[a]++;
+            end++;
+        }
+        user_plays[at] += play_count;
+
+        // Re-rank the user's row (plays desc, artist asc) and renormalize
+        vector<pair<uint32_t, int>> row;
+        for (uint32_t i = begin; i < end; ++i) row.push_back({user_artists[i], user_plays[i]});
+        sort(row.begin(), row.end(), [](const pair<uint32_t, int>& a, const pair<uint32_t, int>& b) {
+            if (a.second != b.second) return a.second > b.second;
+            return a.first < b.first;
+        });
+        double max_plays = row.front().second;
+        for (size_t j = 0; j < row.size(); ++j) {
+            user_artists[begin + j] = row[j].first;
+            user_plays[begin + j] = row[j].second;
+            user_weights[begin + j] = max_plays > 0 ? row[j].second / max_plays : row[j].second;
+        }
+
+        // Every weight of the user may have changed: move it within each
+        // artist's row (sorted by ranksAbove) to its new place
+        for (uint32_t i = begin; i < end; ++i) {
+            uint32_t a_begin = artist_offsets[user_artists[i]];
+            uint32_t a_end = artist_offsets[user_artists[i] + 1];
+            uint32_t pos = a_begin;
+            while (artist_users[pos] != user_id) ++pos;
+            pair<uint32_t, double> entry(user_id, user_weights[i]);
+            while (pos > a_begin && ranksAbove(entry, {artist_users[pos - 1], artist_weights[pos - 1]})) {
+                artist_users[pos] = artist_users[pos - 1];
+                artist_weights[pos] = artist_weights[pos - 1];
+                --pos;
+            }
+            while (pos + 1 < a_end && ranksAbove({artist_users[pos + 1], artist_weights[pos + 1]}, entry)) {
+                artist_users[pos] = artist_users[pos + 1];
+                artist_weights[pos] = artist_weights[pos + 1];
+                ++pos;
+            }
+            artist_users[pos] = entry.first;
+            artist_weights[pos] = entry.second;
+        }
+    }
+
+    vector<pair<uint32_t, double>> getTopArtistsForUser(
+        uint32_t user_id,
+        int k
+    ) const {
+        if (!hasUser(user_id) || k <= 0) {
+            return {};
+        }
+
+        // Rows are pre-sorted by weight descending
+        uint32_t begin = user_offsets[user_id];
+        uint32_t end = min<uint32_t>(user_offsets[user_id + 1], begin + k);
+        vector<pair<uint32_t, double>> artists;
+        artists.reserve(end - begin);
+        for (uint32_t i = begin; i < end; ++i) {
+            artists.push_back({user_artists[i], user_weights[i]});
+        }
+        return artists;
+    }
+
+    vector<pair<uint32_t, double>> getArtistsForUser(
+        uint32_t user_id
+    ) const {
+        return getTopArtistsForUser(user_id, static_cast<int>(rowSize(user_offsets, user_id)));
+    }
+
+    vector<pair<uint32_t, double>> getUsersForArtist(
+        uint32_t artist_id
+    ) const {
+        if (!hasArtist(artist_id)) {
+            return {};
+        }
+
+        vector<pair<uint32_t, double>> users;
+        for (uint32_t i = artist_offsets[artist_id]; i < artist_offsets[artist_id + 1]; ++i) {
+            users.push_back({artist_users[i], artist_weights[i]});
+        }
+        return users;
+    }
+
+    double getEdgeWeight(uint32_t user_id, uint32_t artist_id) const {
+        if (!hasUser(user_id)) {
+            return 0.0;
+        }
+
+        for (uint32_t i = user_offsets[user_id]; i < user_offsets[user_id + 1]; ++i) {
+            if (user_artists[i] == artist_id) {
+                return user_weights[i];
+            }
+        }
+
+        return 0.0;
+    }
+
+    /**
+     * Best max_results songs of the user's top artists, scored by artist
+     * weight. Every song belongs to one artist, so artists are visited in
+     * weight order and songs are emitted directly; songs of equal-weight
+     * artists are interleaved by tie_less. Songs failing keep(song) are
+     * skipped.
+     * Time Complexity: O(top_artists + visited songs), no hashing or full sort
+     */
+    template <typename Keep, typename TieLess>
+    vector<pair<uint32_t, double>> recommendFromTopArtists(
+        uint32_t user_id,
+        int top_artists,
+        size_t max_results,
+        Keep keep,
+        TieLess tie_less
+    ) const {
+        vector<pair<uint32_t, double>> recommendations;
+        if (!hasUser(user_id) || top_artists <= 0) return recommendations;
+
+        uint32_t begin = user_offsets[user_id];
+        uint32_t end = min<uint32_t>(user_offsets[user_id + 1], begin + top_artists);
+
+        for (uint32_t i = begin; i < end && recommendations.size() < max_results;) {
+            // Artists sharing this weight form one run of tied songs
+            uint32_t run_end = i;
+            size_t run_start = recommendations.size();
+            while (run_end < end && user_weights[run_end] == user_weights[i]) {
+                uint32_t artist = user_artists[run_end];
+                if (artist + 1 < song_offsets.size()) {
+                    for (uint32_t s = song_offsets[artist]; s < song_offsets[artist + 1]; ++s) {
+                        if (keep(artist_song_ids[s])) recommendations.push_back({artist_song_ids[s], user_weights[i]});
+                    }
+                }
+                ++run_end;
+            }
+            if (run_end - i > 1) {
+                sort(recommendations.begin() + run_start, recommendations.end(),
+                    [&](const auto& a, const auto& b) { return tie_less(a.first, b.first); });
+            }
+            i = run_end;
+        }
+
+        if (recommendations.size() > max_results) recommendations.resize(max_results);
+        return recommendations;
+    }
+
+    int getUserCount() const {
+        return user_count;
+    }
+
+    int getArtistCount() const {
+        return artist_count;
+    }
+
+    int getEdgeCount() const {
+        return static_cast<int>(user_artists.size());
+    }
+
+    // Bytes held by the build lists and CSR arrays
+    size_t memoryUsage() const {
+        size_t bytes = pending.capacity() * sizeof(vector<BipartiteEdge>) +
+                       (user_offsets.capacity() + user_artists.capacity() + artist_offsets.capacity() +
+                        artist_users.capacity() + song_offsets.capacity() + artist_song_ids.capacity()) * sizeof(uint32_t) +
+                       user_plays.capacity() * sizeof(int) +
+                       (user_weights.capacity() + artist_weights.capacity()) * sizeof(double);
+        for (const auto& edges : pending) bytes += edges.capacity() * sizeof(BipartiteEdge);
+        return bytes;
+    }
+
+    bool hasUser(uint32_t user_id) const {
+        return rowSize(user_offsets, user_id) > 0;
+    }
+
+    bool hasArtist(uint32_t artist_id) const {
+        return rowSize(artist_offsets, artist_id) > 0;
+    }
+
+    // Writes the frozen CSR layout; call after freeze()
+    void save(SnapshotWriter& out, const string& prefix) const {
+        int64_t counts[2] = {user_count, artist_count};
+        out.putValue(prefix + ".counts", counts);
+        out.putArray(prefix + ".user_offsets", user_offsets);
+        out.putArray(prefix + ".user_artists", user_artists);
+        out.putArray(prefix + ".user_plays", user_plays);
+        out.putArray(prefix + ".user_weights", user_weights);
+        out.putArray(prefix + ".artist_offsets", artist_offsets);
+        out.putArray(prefix + ".artist_users", artist_users);
+        out.putArray(prefix + ".artist_weights", artist_weights);
+        out.putArray(prefix + ".song_offsets", song_offsets);
+        out.putArray(prefix + ".artist_song_ids", artist_song_ids);
+    }
+
+    // Fails on offsets or ids out of range; songs must be below num_songs
+    bool load(const SnapshotReader& in, const string& prefix, size_t num_songs) {
+        clear();
+        int64_t counts[2] = {0, 0};
+        bool ok = in.getValue(prefix + ".counts", counts) &&
+            in.getArray(prefix + ".user_offsets", user_offsets) &&
+            in.getArray(prefix + ".user_artists", user_artists) &&
+            in.getArray(prefix + ".user_plays", user_plays) &&
+            in.getArray(prefix + ".user_weights", user_weights) &&
+            in.getArray(prefix + ".artist_offsets", artist_offsets) &&
+            in.getArray(prefix + ".artist_users", artist_users) &&
+            in.getArray(prefix + ".artist_weights", artist_weights) &&
+            in.getArray(prefix + ".song_offsets", song_offsets) &&
+            in.getArray(prefix + ".artist_song_ids", artist_song_ids);
+        size_t user_rows = user_offsets.empty() ? 0 : user_offsets.size() - 1;
+        size_t artist_rows = artist_offsets.empty() ? 0 : artist_offsets.size() - 1;
+        ok = ok && user_plays.size() == user_artists.size() && user_weights.size() == user_artists.size() &&
+            artist_weights.size() == artist_users.size() &&
+            snapshot::validOffsets(user_offsets, user_artists.size()) &&
+            snapshot::validOffsets(artist_offsets, artist_users.size()) &&
+            snapshot::validOffsets(song_offsets, artist_song_ids.size()) &&
+            snapshot::allBelow(user_artists, artist_rows) && snapshot::allBelow(artist_users, user_rows) &&
+            snapshot::allBelow(artist_song_ids, num_songs);
+        if (!ok) {
+            clear();
+            return false;
+        }
+        user_count = static_cast<int>(counts[0]);
+        artist_count = static_cast<int>(counts[1]);
+        frozen = true;
+        return true;
+    }
+
+    void clear() {
+        pending.clear();
+        pending_artists = 0;
+        frozen = false;
+        user_count = 0;
+        artist_count = 0;
+        user_offsets.clear();
+        user_artists.clear();
+        user_plays.clear();
+        user_weights.clear();
+        artist_offsets.clear();
+        artist_users.clear();
+        artist_weights.clear();
+        song_offsets.clear();
+        artist_song_ids.clear();
+    }
+};
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef BRUTE_FORCE_INDEX_H
+#define BRUTE_FORCE_INDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "nearest_neighbor_index.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define REC_SCAN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define REC_SCAN_SSE 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define REC_SCAN_NEON 1
+#endif
+
+using namespace std;
+
+/**
+ * Exact nearest-neighbor search by vectorized linear scan
+ *
+ * Features are float32 structure-of-arrays, padded to a multiple of the
+ * vector width with +inf so the tail needs no special case. Each block of
+ * lanes computes squared distances in registers, is compared against the
+ * current k-th best in one vector compare, and only surviving lanes touch
+ * the top-k list.
+ *
+ * Time Complexity: O(n * d) per query, no tree overhead, so it does not
+ * degrade as the feature dimension grows.
+ */
+class BruteForceIndex : public NearestNeighborIndex {
+private:
+#if defined(REC_SCAN_AVX2)
+    static constexpr size_t LANES = 8;
+#else
+    static constexpr size_t LANES = 4;
+#endif
+
+    int dimensions = 0;
+    size_t num_points = 0;
+    size_t padded = 0;
+    vector<float> coords; // coords[axis * padded + i]
+
+    // Top-k kept sorted ascending by distance in small flat arrays owned by
+    // the caller; k is small (tens), so insertion is a short shift over
+    // mostly-cached data
+    struct TopK {
+        float* dist;
+        uint32_t* ids;
+        size_t count = 0;
+        size_t k;
+
+        TopK(float* dist_storage, uint32_t* id_storage, size_t cap) : dist(dist_storage), ids(id_storage), k(cap) {}
+
+        float worst() const {
+            return count < k ? numeric_limits<float>::infinity() : dist[k - 1];
+        }
+
+        void offer(float d, uint32_t id) {
+            if (count == k && !(d < dist[k - 1])) return;
+            size_t pos = count < k ? count++ : k - 1;
+            while (pos > 0 && d < dist[pos - 1]) {
+                dist[pos] = dist[pos - 1];
+                ids[pos] = ids[pos - 1];
+                --pos;
+            }
+            dist[pos] = d;
+            ids[pos] = id;
+        }
+    };
+
+    void scan(const float* target, TopK& best) const {
+        alignas(32) float block[LANES];
+
+        for (size_t i = 0; i < padded; i += LANES) {
+#if defined(REC_SCAN_AVX2)
+            __m256 acc = _mm256_setzero_ps();
+            for (int d = 0; d < dimensions; ++d) {
+                __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(&coords[d * padded + i]),
+                                            _mm256_set1_ps(target[d]));
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(diff, diff));
+            }
+            int mask = _mm256_movemask_ps(_mm256_cmp_ps(acc, _mm256_set1_ps(best.worst()), _CMP_LT_OQ));
+            if (mask == 0) continue;
+            _mm256_store_ps(block, acc);
+#elif defined(REC_SCAN_SSE)
+            __m128 acc = _mm_setzero_ps();
+            for (int d = 0; d < dimensions; ++d) {
+                __m128 diff = _mm_sub_ps(_mm_loadu_ps(&coords[d * padded + i]), _mm_set1_ps(target[d]));
+                acc = _mm_add_ps(acc, _mm_mul_ps(diff, diff));
+            }
+            int mask = _mm_movemask_ps(_mm_cmplt_ps(acc, _mm_set1_ps(best.worst())));
+            if (mask == 0) continue;
+            _mm_store_ps(block, acc);
+#elif defined(REC_SCAN_NEON)
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            for (int d = 0; d < dimensions; ++d) {
+                float32x4_t diff = vsubq_f32(vld1q_f32(&coords[d * padded + i]), vdupq_n_f32(target[d]));
+                acc = vaddq_f32(acc, vmulq_f32(diff, diff));
+            }
+            if (vmaxvq_u32(vcltq_f32(acc, vdupq_n_f32(best.worst()))) == 0) continue;
+            vst1q_f32(block, acc);
+#else
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                float sum = 0.0f;
+                for (int d = 0; d < dimensions; ++d) {
+                    float diff = coords[d * padded + i + lane] - target[d];
+                    sum += diff * diff;
+                }
+                block[lane] = sum;
+            }
+#endif
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                if (i + lane < num_points) best.offer(block[lane], static_cast<uint32_t>(i + lane));
+            }
+        }
+    }
+
+public:
+    void build(const vector<Song>& songs) override {
+        num_points = songs.size();
+        dimensions = songs.empty() ? 0 : static_cast<int>(songs[0].getFeatureVector().size());
+        padded = (num_points + LANES - 1) / LANES * LANES;
+
+        coords.assign(padded * dimensions, numeric_limits<float>::infinity());
+        for (size_t i = 0; i < num_points; ++i) {
+            auto features = songs[i].getFeatureVector();
+            for (int d = 0; d < dimensions; ++d) {
+                coords[d * padded + i] = static_cast<float>(features[d]);
+            }
+        }
+    }
+
+    vector<pair<double, uint32_t>> findKNearest(
+        const vector<double>& target_features,
+        int k
+    ) const override {
+        vector<pair<double, uint32_t>> result;
+        if (k <= 0 || num_points == 0) return result;
+
+        vector<float> target(target_features.begin(), target_features.end());
+        target.resize(dimensions, 0.0f);
+
+        size_t kept = min(static_cast<size_t>(k), num_points);
+        vector<float> dist(kept);
+        vector<uint32_t> ids(kept);
+        TopK best(dist.data(), ids.data(), kept);
+        scan(target.data(), best);
+        visits.add(num_points);
+
+        result.reserve(best.count);
+        for (size_t i = 0; i < best.count; ++i) {
+            result.push_back({sqrt(static_cast<double>(best.dist[i])), best.ids[i]});
+        }
+        // Equal distances: order by id like the other backends
+        sort(result.begin(), result.end());
+        return result;
+    }
+
+    // One scan per query from the stored coordinates, scratch in arena.
+    // Ties stay in id order: the scan offers ids ascending and an equal
+    // distance never moves ahead of an earlier one.
+    void findSimilarSongsBatch(
+        const vector<uint32_t>& song_idxs,
+        int k,
+        Arena& arena,
+        vector<uint32_t>& neighbors,
+        vector<uint32_t>& offsets
+    ) const override {
+        neighbors.clear();
+        offsets.assign(song_idxs.size() + 1, 0);
+        if (k <= 0 || num_points == 0) return;
+
+        size_t kept = min(static_cast<size_t>(k) + 1, num_points);
+        ArenaVector<float> target(dimensions, 0.0f, ArenaAllocator<float>(arena));
+        ArenaVector<float> dist(kept, 0.0f, ArenaAllocator<float>(arena));
+        ArenaVector<uint32_t> ids(kept, 0, ArenaAllocator<uint32_t>(arena));
+        for (size_t q = 0; q < song_idxs.size(); ++q) {
+            uint32_t idx = song_idxs[q];
+            for (int d = 0; d < dimensions; ++d) target[d] = idx < num_points ? coords[d * padded + idx] : 0.0f;
+
+            TopK best(dist.data(), ids.data(), kept);
+            scan(target.data(), best);
+            visits.add(num_points);
+
+            for (size_t i = 0; i < best.count && neighbors.size() - offsets[q] < static_cast<size_t>(k); ++i) {
+                if (best.ids[i] != idx) neighbors.push_back(best.ids[i]);
+            }
+            offsets[q + 1] = static_cast<uint32_t>(neighbors.size());
+        }
+    }
+
+    vector<double> getFeatures(uint32_t song_idx) const override {
+        vector<double> point(dimensions, 0.0);
+        if (song_idx < num_points) {
+            for (int d = 0; d < dimensions; ++d) point[d] = coords[d * padded + song_idx];
+        }
+        return point;
+    }
+
+    size_t size() const override {
+        return num_points;
+    }
+
+    const char* name() const override {
+        return "brute-force";
+    }
+
+    size_t memoryUsage() const override {
+        return coords.capacity() * sizeof(float);
+    }
+
+    void save(SnapshotWriter& out, const string& prefix) const override {
+        int64_t shape[3] = {dimensions, static_cast<int64_t>(num_points), static_cast<int64_t>(padded)};
+        out.putValue(prefix + ".shape", shape);
+        out.putArray(prefix + ".coords", coords);
+    }
+
+    bool load(const SnapshotReader& in, const string& prefix) override {
+        int64_t shape[3] = {0, 0, 0};
+        bool ok = in.getValue(prefix + ".shape", shape) && in.getArray(prefix + ".coords", coords);
+        // The scan assumes this build's lane padding
+        if (!ok || shape[0] < 0 || shape[1] < 0 || shape[2] % static_cast<int64_t>(LANES) != 0 || shape[2] < shape[1] ||
+            coords.size() != static_cast<size_t>(shape[0] * shape[2])) {
+            dimensions = 0;
+            num_points = padded = 0;
+            coords.clear();
+            return false;
+        }
+        dimensions = static_cast<int>(shape[0]);
+        num_points = static_cast<size_t>(shape[1]);
+        padded = static_cast<size_t>(shape[2]);
+        return true;
+    }
+};
+
+#endif // BRUTE_FORCE_INDEX_H
@@ -0,0 +1,199 @@
+#ifndef COMMUNITY_POPULARITY_H
+#define COMMUNITY_POPULARITY_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include "union_find.h"
+#include "../core/score_accumulator.h"
+#include "../core/snapshot.h"
+
+using namespace std;
+
+/**
+ * Per-community song popularity tables
+ *
+ * For every community root, the songs liked by its members with the number
+ * of members liking each, sorted by count descending (ties by tie_less).
+ * The community pillar walks a table front to back instead of re-counting
+ * every member's likes per request.
+ *
+ * Time Complexities:
+ * - Build: O(total likes + sum of t log t) for t distinct songs per community
+ * - Lookup: O(1)
+ * - addLike: O(t) (find + bubble up)
+ * - mergeCommunities: O(t log t) for t = t1 + t2
+ * - recount: O(likes of the members + t log t per new community)
+ */
+class CommunityPopularity {
+public:
+    struct Entry {
+        uint32_t song;
+        int count;
+    };
+
+private:
+    vector<vector<Entry>> tables; // indexed by community root
+    size_t num_songs = 0;         // only songs in [0, num_songs) are counted
+    function<bool(uint32_t, uint32_t)> tie_less;
+
+    bool ranksBefore(const Entry& a, const Entry& b) const {
+        if (a.count != b.count) return a.count > b.count;
+        return tie_less(a.song, b.song);
+    }
+
+    void sortTable(vector<Entry>& table) const {
+        sort(table.begin(), table.end(), [this](const Entry& a, const Entry& b) { return ranksBefore(a, b); });
+    }
+
+    // Fills the table of the community rooted at root
+    void count(const UnionFind& communities, const vector<vector<uint32_t>>& liked, uint32_t root,
+               ScoreAccumulator& counts) {
+        counts.reset();
+        communities.forEachMember(root, [&](uint32_t member) {
+            for (uint32_t sid : liked[member]) {
+                if (sid < num_songs) counts.add(sid, 1.0);
+            }
+        });
+
+        auto &table = tables[root];
+        table.reserve(counts.size());
+        for (uint32_t sid : counts.touchedIds()) {
+            table.push_back({sid, static_cast<int>(counts.score(sid))});
+        }
+        sortTable(table);
+    }
+
+public:
+    CommunityPopularity() : tie_less(less<uint32_t>()) {}
+
+    /**
+     * Counts every community's likes; liked[u] are user u's liked songs.
+     * Songs outside [0, song_count) are ignored.
+     */
+    void build(
+        const UnionFind& communities,
+        const vector<vector<uint32_t>>& liked,
+        size_t song_count,
+        function<bool(uint32_t, uint32_t)> tie_order
+    ) {
+        num_songs = song_count;
+        tie_less = move(tie_order);
+        tables.assign(liked.size(), {});
+
+        ScoreAccumulator counts;
+        counts.resize(num_songs);
+        for (uint32_t uid = 0; uid < liked.size(); ++uid) {
+            if (communities.getCommunity(uid) == uid) count(communities, liked, uid, counts); // roots only
+        }
+    }
+
+    /**
+     * The communities over members were re-formed (see UnionFind::split):
+     * drops their old tables and counts the new ones.
+     */
+    void recount(const UnionFind& communities, const vector<vector<uint32_t>>& liked, const vector<uint32_t>& members) {
+        ScoreAccumulator counts;
+        counts.resize(num_songs);
+        for (uint32_t member : members) {
+            if (member < tables.size()) tables[member] = vector<Entry>();
+        }
+        for (uint32_t member : members) {
+            if (communities.getCommunity(member) != member) continue;
+            if (member >= tables.size()) tables.resize(member + 1);
+            count(communities, liked, member, counts);
+        }
+    }
+
+    // Ranked songs of the community rooted at root (empty if none)
+    const vector<Entry>& getTable(uint32_t root) const {
+        static const vector<Entry> empty;
+        return root < tables.size() ? tables[root] : empty;
+    }
+
+    // A member of root's community liked song; keeps the table sorted
+    void addLike(uint32_t root, uint32_t song) {
+        if (song >= num_songs) return;
+        if (root >= tables.size()) tables.resize(root + 1);
+        auto &table = tables[root];
+
+        size_t pos = 0;
+        while (pos < table.size() && table[pos].song != song) ++pos;
+        if (pos == table.size()) table.push_back({song, 0});
+        table[pos].count++;
+
+        // Count only grew: move it towards the front
+        while (pos > 0 && ranksBefore(table[pos], table[pos - 1])) {
+            swap(table[pos], table[pos - 1]);
+            --pos;
+        }
+    }
+
+    // Communities rooted at a and b were united under new_root
+    void mergeCommunities(uint32_t a, uint32_t b, uint32_t new_root) {
+        uint32_t other = new_root == a ? b : a;
+        size_t needed = max(a, b) + 1;
+        if (tables.size() < needed) tables.resize(needed);
+
+        // Align both tables by song, add counts of shared songs, re-rank
+        vector<Entry> merged(tables[a]);
+        merged.insert(merged.end(), tables[b].begin(), tables[b].end());
+        sort(merged.begin(), merged.end(), [](const Entry& x, const Entry& y) { return x.song < y.song; });
+        size_t out = 0;
+        for (size_t i = 0; i < merged.size(); ++i) {
+            if (out > 0 && merged[out - 1].song == merged[i].song) merged[out - 1].count += merged[i].count;
+            else merged[out++] = merged[i];
+        }
+        merged.resize(out);
+        sortTable(merged);
+
+        tables[new_root] = move(merged);
+        tables[other] = vector<Entry>();
+    }
+
+    // Ranking order for ties; a loaded snapshot keeps its saved order
+    // until the next addLike / merge needs it
+    void setTieOrder(function<bool(uint32_t, uint32_t)> tie_order) {
+        tie_less = move(tie_order);
+    }
+
+    void clear() {
+        tables.clear();
+        num_songs = 0;
+    }
+
+    // Bytes held by the tables
+    size_t memoryUsage() const {
+        size_t bytes = tables.capacity() * sizeof(vector<Entry>);
+        for (const auto& table : tables) bytes += table.capacity() * sizeof(Entry);
+        return bytes;
+    }
+
+    void save(SnapshotWriter& out, const string& prefix) const {
+        out.putValue(prefix + ".num_songs", static_cast<uint64_t>(num_songs));
+        out.putLists(prefix + ".tables", tables);
+    }
+
+    // Fails on tables for more than num_users roots, or on songs at or
+    // above song_count
+    bool load(const SnapshotReader& in, const string& prefix, size_t song_count, size_t num_users) {
+        clear();
+        uint64_t songs = 0;
+        bool ok = in.getValue(prefix + ".num_songs", songs) && in.getLists(prefix + ".tables", tables) &&
+                  songs <= song_count && tables.size() <= num_users;
+        for (size_t root = 0; ok && root < tables.size(); ++root) {
+            for (const Entry& entry : tables[root]) {
+                if (entry.song >= songs || entry.count <= 0) ok = false;
+            }
+        }
+        if (!ok) {
+            clear();
+            return false;
+        }
+        num_songs = static_cast<size_t>(songs);
+        return true;
+    }
+};
+
+#endif // COMMUNITY_POPULARITY_H
@@ -0,0 +1,509 @@
+#ifndef COMPACT_TRIE_H
+#define COMPACT_TRIE_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <chrono>
+#include "tries.h"
+#include "../core/snapshot.h"
+
+/**
+ * Frozen, read-optimized search index built from a Trie
+ *
+ * Path-compressed radix tree: chains of single-child, non-word nodes are
+ * merged into one node with a multi-character label. All nodes live in one
+ * array, the children of a node are contiguous and sorted by first label
+ * character, labels and values are slices of two character pools, and the
+ * cached top-K completions are value ids in one shared array.
+ *
+ * Time Complexities:
+ * - Build: O(N + W log W) for N trie nodes, W words
+ * - Prefix Search: O(m log fanout + k), k <= K served from the cache
+ * - incrementFrequency: O(m + depth * K)
+ * - Fuzzy Prefix Search: O(visited nodes * m), pruned to nodes within the
+ *   edit bound and cut off by the latency budget
+ *
+ * New words cannot be added; rebuild from a Trie instead. The index can be
+ * saved to and loaded from a snapshot file (native byte order) so search
+ * nodes start without rebuilding.
+ */
+class CompactTrie {
+private:
+    static constexpr uint32_t NO_VALUE = UINT32_MAX;
+
+    struct Node {
+        uint32_t label_offset;  // into labels
+        uint32_t first_child;   // children are [first_child, first_child + child_count)
+        uint32_t value_id;      // NO_VALUE unless a word ends here
+        uint32_t top_offset;    // cached completions are top_ids[top_offset, + top_count)
+        uint16_t label_length;
+        uint16_t child_count;
+        uint32_t top_count;
+    };
+
+    std::vector<Node> nodes;             // nodes[0] is the root (empty label)
+    std::vector<char> labels;            // concatenated lowercase edge labels
+    std::vector<uint32_t> value_offsets; // value v is values[value_offsets[v], value_offsets[v + 1])
+    std::vector<char> values;            // concatenated display strings
+    std::vector<int> frequencies;        // per value id
+    std::vector<uint32_t> top_ids;       // per-node ranked value ids
+    uint32_t cache_size = 0;
+
+    std::string_view valueOf(uint32_t v) const {
+        return std::string_view(values.data() + value_offsets[v], value_offsets[v + 1] - value_offsets[v]);
+    }
+
+    bool ranksBefore(uint32_t a, uint32_t b) const {
+        if (frequencies[a] != frequencies[b]) return frequencies[a] > frequencies[b];
+        return valueOf(a) < valueOf(b);
+    }
+
+    // Whether loaded arrays only point inside each other: labels, values
+    // and cached ids in range, and children after their parent (no cycles)
+    bool consistent() const {
+        size_t num_values = frequencies.size();
+        if (!snapshot::validOffsets(value_offsets, values.size()) || !snapshot::allBelow(top_ids, num_values)) {
+            return false;
+        }
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            const Node& node = nodes[i];
+            bool ok = static_cast<size_t>(node.label_offset) + node.label_length <= labels.size() &&
+                      (node.value_id == NO_VALUE || node.value_id < num_values) &&
+                      static_cast<size_t>(node.top_offset) + node.top_count <= top_ids.size() &&
+                      (i == 0 || node.label_length > 0) &&
+                      (node.child_count == 0 ||
+                       (node.first_child > i && static_cast<size_t>(node.first_child) + node.child_count <= nodes.size()));
+            if (!ok) return false;
+        }
+        return true;
+    }
+
+    static std::string toLower(const std::string& word) {
+        std::string lower_word;
+        lower_word.reserve(word.size());
+        for (char ch : word) {
+            lower_word.push_back(std::tolower(ch));
+        }
+        return lower_word;
+    }
+
+    // Child of node whose label starts with ch, or NO_VALUE
+    uint32_t findChild(const Node& node, char ch) const {
+        uint32_t lo = node.first_child, hi = node.first_child + node.child_count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            unsigned char first = static_cast<unsigned char>(labels[nodes[mid].label_offset]);
+            if (first < static_cast<unsigned char>(ch)) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo < node.first_child + node.child_count && labels[nodes[lo].label_offset] == ch) return lo;
+        return NO_VALUE;
+    }
+
+    /**
+     * Walks the (lowercase) key from the root. Returns the node whose
+     * subtree holds exactly the words starting with key, or NO_VALUE.
+     * ends_at_node tells whether key ends on a node boundary; path
+     * receives the visited nodes when given.
+     */
+    uint32_t locate(const std::string& key, bool& ends_at_node, std::vector<uint32_t>* path = nullptr) const {
+        ends_at_node = true;
+        if (nodes.empty()) return NO_VALUE;
+
+        uint32_t current = 0;
+        if (path) path->push_back(current);
+        size_t i = 0;
+        while (i < key.size()) {
+            uint32_t child = findChild(nodes[current], key[i]);
+            if (child == NO_VALUE) return NO_VALUE;
+
+            const Node& next = nodes[child];
+            size_t matched = 0;
+            while (matched < next.label_length && i + matched < key.size()) {
+                if (labels[next.label_offset + matched] != key[i + matched]) return NO_VALUE;
+                ++matched;
+            }
+            current = child;
+            if (path) path->push_back(current);
+            i += matched;
+            if (matched < next.label_length) {
+                ends_at_node = false; // key ends inside this label
+                break;
+            }
+        }
+        return current;
+    }
+
+    void collectValues(uint32_t node, std::vector<uint32_t>& out) const {
+        if (nodes[node].value_id != NO_VALUE) out.push_back(nodes[node].value_id);
+        for (uint32_t c = 0; c < nodes[node].child_count; ++c) {
+            collectValues(nodes[node].first_child + c, out);
+        }
+    }
+
+    // State of one fuzzy search; rows holds one DP row per label character
+    struct FuzzySearch {
+        std::string query;
+        int max_edits;
+        size_t wanted;
+        std::chrono::steady_clock::time_point deadline;
+        bool timed_out = false;
+        size_t visited = 0;
+        std::vector<int> rows;                         // (depth + 1) x (m + 1)
+        std::vector<std::pair<int, uint32_t>> matches; // (edits, value id)
+    };
+
+    void emitMatches(uint32_t node, int edits, FuzzySearch& fs) const {
+        std::vector<uint32_t> words;
+        if (fs.wanted <= cache_size) {
+            const Node& n = nodes[node];
+            words.assign(top_ids.begin() + n.top_offset, top_ids.begin() + n.top_offset + n.top_count);
+        } else {
+            collectValues(node, words);
+        }
+        for (uint32_t v : words) fs.matches.push_back({edits, v});
+    }
+
+    /**
+     * Bounded Levenshtein traversal. Cell j of a DP row is the edit distance
+     * between query[0, j) and the path so far; the last cell is the distance
+     * from the whole query to this prefix of the path, so every word below
+     * matches with that many edits. Row minima never decrease downwards, so
+     * a subtree is skipped once the row cannot beat the edits already
+     * matched on the path. matched_edits starts at max_edits + 1.
+     */
+    void fuzzyVisit(uint32_t node, int matched_edits, FuzzySearch& fs) const {
+        if ((++fs.visited & 255) == 0 && std::chrono::steady_clock::now() >= fs.deadline) {
+            fs.timed_out = true;
+        }
+        if (fs.timed_out) return;
+
+        const size_t width = fs.query.size() + 1;
+        const size_t entry_size = fs.rows.size(); // ends with the parent's last row
+        const Node& n = nodes[node];
+
+        int best_end = matched_edits;
+        int row_min = *std::min_element(fs.rows.end() - width, fs.rows.end());
+        for (uint16_t c = 0; c < n.label_length; ++c) {
+            char ch = labels[n.label_offset + c];
+            size_t prev_offset = fs.rows.size() - width;
+            fs.rows.resize(fs.rows.size() + width);
+            const int* prev = &fs.rows[prev_offset];
+            int* row = &fs.rows[prev_offset + width];
+
+            row[0] = prev[0] + 1;
+            row_min = row[0];
+            for (size_t j = 1; j < width; ++j) {
+                int substitute = prev[j - 1] + (fs.query[j - 1] != ch ? 1 : 0);
+                row[j] = std::min(std::min(prev[j], row[j - 1]) + 1, substitute);
+                row_min = std::min(row_min, row[j]);
+            }
+            best_end = std::min(best_end, row[width - 1]);
+            if (row_min >= best_end) break; // rest of the label cannot do better
+        }
+
+        if (best_end < matched_edits) {
+            emitMatches(node, best_end, fs);
+            matched_edits = best_end;
+        }
+
+        if (row_min < matched_edits) {
+            for (uint32_t c = 0; c < n.child_count; ++c) {
+                fuzzyVisit(n.first_child + c, matched_edits, fs);
+            }
+        }
+        fs.rows.resize(entry_size);
+    }
+
+public:
+    CompactTrie() {}
+
+    explicit CompactTrie(const Trie& trie) {
+        build(trie);
+    }
+
+    /**
+     * Freezes a Trie, keeping its per-node cached completions
+     * Time Complexity: O(N + W log W)
+     */
+    void build(const Trie& trie) {
+        clear();
+        cache_size = static_cast<uint32_t>(trie.getCacheSize());
+
+        // Pending compact node and the trie node its subtree starts at
+        struct Pending {
+            uint32_t index;
+            const TrieNode* source;
+        };
+        std::unordered_map<const TrieNode*, uint32_t> value_of;
+        std::vector<Pending> queue;
+        std::vector<std::pair<char, const TrieNode*>> children;
+
+        nodes.push_back(Node{0, 0, NO_VALUE, 0, 0, 0, 0});
+        queue.push_back({0, trie.getRoot()});
+        value_offsets.push_back(0);
+
+        // Breadth-first so each node's children are appended contiguously
+        for (size_t head = 0; head < queue.size(); ++head) {
+            uint32_t index = queue[head].index;
+            const TrieNode* src = queue[head].source;
+
+            if (src->is_end_of_word) {
+                uint32_t v = static_cast<uint32_t>(frequencies.size());
+                values.insert(values.end(), src->value.begin(), src->value.end());
+                value_offsets.push_back(static_cast<uint32_t>(values.size()));
+                frequencies.push_back(src->frequency);
+                value_of[src] = v;
+                nodes[index].value_id = v;
+            }
+
+            children.clear();
+            for (const auto& it : src->children) children.push_back({it.first, it.second.get()});
+            std::sort(children.begin(), children.end(),
+                [](const auto& a, const auto& b) {
+                    return static_cast<unsigned char>(a.first) < static_cast<unsigned char>(b.first);
+                });
+
+            nodes[index].first_child = static_cast<uint32_t>(nodes.size());
+            nodes[index].child_count = static_cast<uint16_t>(children.size());
+            for (const auto& child : children) {
+                Node node{static_cast<uint32_t>(labels.size()), 0, NO_VALUE, 0, 0, 0, 0};
+                labels.push_back(child.first);
+
+                // Merge the single-child chain below into this node's label
+                const TrieNode* end = child.second;
+                while (!end->is_end_of_word && end->children.size() == 1 && node.label_length < UINT16_MAX - 1) {
+                    labels.push_back(end->children.begin()->first);
+                    end = end->children.begin()->second.get();
+                    node.label_length++;
+                }
+                node.label_length++;
+
+                queue.push_back({static_cast<uint32_t>(nodes.size()), end});
+                nodes.push_back(node);
+            }
+        }
+
+        // Second pass: every word now has an id, translate cached lists
+        for (const auto& pending : queue) {
+            Node& node = nodes[pending.index];
+            node.top_offset = static_cast<uint32_t>(top_ids.size());
+            for (const TrieNode* word : pending.source->top_completions) top_ids.push_back(value_of[word]);
+            node.top_count = static_cast<uint32_t>(top_ids.size()) - node.top_offset;
+        }
+
+        nodes.shrink_to_fit();
+        labels.shrink_to_fit();
+        values.shrink_to_fit();
+        top_ids.shrink_to_fit();
+    }
+
+    /**
+     * Best words with given prefix, ranked by frequency then alphabetically
+     * Time Complexity: O(m log fanout + k)
+     */
+    std::vector<std::string> autocomplete(const std::string& prefix, int max_results = 10) const {
+        if (max_results <= 0) return {};
+
+        bool ends_at_node;
+        uint32_t node = locate(toLower(prefix), ends_at_node);
+        if (node == NO_VALUE) return {};
+
+        std::vector<uint32_t> ranked;
+        if (static_cast<size_t>(max_results) <= cache_size) {
+            const Node& n = nodes[node];
+            ranked.assign(top_ids.begin() + n.top_offset, top_ids.begin() + n.top_offset + n.top_count);
+        } else {
+            collectValues(node, ranked);
+            std::sort(ranked.begin(), ranked.end(), [this](uint32_t a, uint32_t b) { return ranksBefore(a, b); });
+        }
+
+        std::vector<std::string> suggestions;
+        for (size_t i = 0; i < ranked.size() && i < static_cast<size_t>(max_results); ++i) {
+            suggestions.emplace_back(valueOf(ranked[i]));
+        }
+        return suggestions;
+    }
+
+    /**
+     * Typo-tolerant autocomplete: words having a prefix within max_edits
+     * (Levenshtein) of the query. Ranked by edits, then frequency, then
+     * alphabetically, so max_edits == 0 matches autocomplete(). Stops after
+     * budget_us microseconds (0 = no limit) and returns the matches found so
+     * far; timed_out, if given, tells whether that happened.
+     * Time Complexity: O(visited nodes * m)
+     */
+    std::vector<std::string> fuzzyAutocomplete(
+        const std::string& prefix,
+        int max_results = 10,
+        int max_edits = 1,
+        long budget_us = 0,
+        bool* timed_out = nullptr
+    ) const {
+        if (timed_out) *timed_out = false;
+        if (max_results <= 0 || nodes.empty()) return {};
+
+        FuzzySearch fs;
+        fs.query = toLower(prefix);
+        fs.max_edits = std::max(0, max_edits);
+        fs.wanted = static_cast<size_t>(max_results);
+        fs.deadline = budget_us > 0
+            ? std::chrono::steady_clock::now() + std::chrono::microseconds(budget_us)
+            : std::chrono::steady_clock::time_point::max();
+
+        // Row for the empty path: query[0, j) needs j deletions
+        for (size_t j = 0; j <= fs.query.size(); ++j) fs.rows.push_back(static_cast<int>(j));
+        fuzzyVisit(0, fs.max_edits + 1, fs);
+        if (timed_out) *timed_out = fs.timed_out;
+
+        // Keep each word's fewest edits, then rank
+        auto& matches = fs.matches;
+        std::sort(matches.begin(), matches.end(),
+            [](const auto& a, const auto& b) {
+                return a.second != b.second ? a.second < b.second : a.first < b.first;
+            });
+        matches.erase(std::unique(matches.begin(), matches.end(),
+            [](const auto& a, const auto& b) { return a.second == b.second; }), matches.end());
+
+        size_t count = std::min(matches.size(), fs.wanted);
+        auto better = [this](const auto& a, const auto& b) {
+            if (a.first != b.first) return a.first < b.first;
+            return ranksBefore(a.second, b.second);
+        };
+        std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), better);
+
+        std::vector<std::string> suggestions;
+        suggestions.reserve(count);
+        for (size_t i = 0; i < count; ++i) suggestions.emplace_back(valueOf(matches[i].second));
+        return suggestions;
+    }
+
+    /**
+     * Exact word match
+     * Time Complexity: O(m log fanout)
+     */
+    bool search(const std::string& word) const {
+        bool ends_at_node;
+        uint32_t node = locate(toLower(word), ends_at_node);
+        return node != NO_VALUE && ends_at_node && nodes[node].value_id != NO_VALUE;
+    }
+
+    /**
+     * Increments a word's frequency and moves it up in the cached
+     * completions of every prefix. Other words keep their frequency, so
+     * the caches stay exact.
+     * Time Complexity: O(m + depth * K)
+     */
+    void incrementFrequency(const std::string& word) {
+        std::vector<uint32_t> path;
+        bool ends_at_node;
+        uint32_t node = locate(toLower(word), ends_at_node, &path);
+        if (node == NO_VALUE || !ends_at_node || nodes[node].value_id == NO_VALUE) return;
+
+        uint32_t v = nodes[node].value_id;
+        frequencies[v]++;
+
+        for (uint32_t p : path) {
+            const Node& n = nodes[p];
+            if (n.top_count == 0) continue;
+            uint32_t* first = top_ids.data() + n.top_offset;
+            uint32_t* last = first + n.top_count;
+
+            uint32_t* it = std::find(first, last, v);
+            if (it == last) {
+                // A cache holding fewer than K words already lists its whole subtree
+                if (!ranksBefore(v, *(last - 1))) continue;
+                it = last - 1;
+                *it = v;
+            }
+            while (it != first && ranksBefore(*it, *(it - 1))) {
+                std::iter_swap(it, it - 1);
+                --it;
+            }
+        }
+    }
+
+    // Writes the index's arrays as snapshot sections under prefix
+    void save(SnapshotWriter& out, const std::string& prefix) const {
+        out.putValue(prefix + ".cache_size", cache_size);
+        out.putArray(prefix + ".nodes", nodes);
+        out.putArray(prefix + ".labels", labels);
+        out.putArray(prefix + ".value_offsets", value_offsets);
+        out.putArray(prefix + ".values", values);
+        out.putArray(prefix + ".frequencies", frequencies);
+        out.putArray(prefix + ".top_ids", top_ids);
+    }
+
+    // Replaces the index with one written by save(); unchanged on failure
+    bool load(const SnapshotReader& in, const std::string& prefix) {
+        CompactTrie loaded;
+        if (!in.getValue(prefix + ".cache_size", loaded.cache_size) ||
+            !in.getArray(prefix + ".nodes", loaded.nodes) ||
+            !in.getArray(prefix + ".labels", loaded.labels) ||
+            !in.getArray(prefix + ".value_offsets", loaded.value_offsets) ||
+            !in.getArray(prefix + ".values", loaded.values) ||
+            !in.getArray(prefix + ".frequencies", loaded.frequencies) ||
+            !in.getArray(prefix + ".top_ids", loaded.top_ids)) {
+            return false;
+        }
+        if (loaded.value_offsets.size() != loaded.frequencies.size() + 1 || !loaded.consistent()) return false;
+
+        *this = std::move(loaded);
+        return true;
+    }
+
+    /**
+     * Writes the index to its own snapshot file
+     * Time Complexity: O(size of index)
+     */
+    bool save(const std::string& filepath) const {
+        SnapshotWriter out;
+        save(out, "trie");
+        return out.writeFile(filepath);
+    }
+
+    /**
+     * Replaces the index with one written by save(filepath)
+     * Time Complexity: O(size of index)
+     */
+    bool load(const std::string& filepath) {
+        SnapshotReader in(filepath);
+        return in.isValid() && load(in, "trie");
+    }
+
+    // Number of words indexed
+    size_t size() const {
+        return frequencies.size();
+    }
+
+    size_t getNodeCount() const {
+        return nodes.size();
+    }
+
+    // Bytes held by the index arrays
+    size_t memoryUsage() const {
+        return nodes.capacity() * sizeof(Node) + labels.capacity() +
+               value_offsets.capacity() * sizeof(uint32_t) + values.capacity() +
+               frequencies.capacity() * sizeof(int) + top_ids.capacity() * sizeof(uint32_t);
+    }
+
+    bool isEmpty() const {
+        return frequencies.empty();
+    }
+
+    void clear() {
+        nodes.clear();
+        labels.clear();
+        value_offsets.clear();
+        values.clear();
+        frequencies.clear();
+        top_ids.clear();
+        cache_size = 0;
+    }
+};
+
+#endif // COMPACT_TRIE_H
@@ -0,0 +1,188 @@
+#ifndef EXCLUSION_FILTER_H
+#define EXCLUSION_FILTER_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Per-user set of catalog songs that must not be recommended
+ *
+ * Two layouts, picked at build time by the memory they would take:
+ * - Dense: one bitset of num_songs bits per user. excludes() is a single
+ *   bit test.
+ * - Bloom: per-user blocked Bloom filter (any key touches one 64-bit
+ *   word, two bits, ~16 bits per excluded song) in front of the user's
+ *   sorted exclusion list. Songs the filter rejects, nearly all
+ *   candidates, cost one word load; only filter hits are confirmed by
+ *   binary search, so answers stay exact.
+ *
+ * Only songs in [0, num_songs) are tracked; excludes() is false outside
+ * that range and for users never added.
+ *
+ * Time Complexities:
+ * - build: O(users * num_songs / 64) dense, O(total exclusions) Bloom
+ * - excludes: O(1) (Bloom filter hits: O(log e) for e exclusions)
+ * - add: O(1) dense, O(e) Bloom (sorted insert)
+ */
+class ExclusionFilter {
+public:
+    // Dense bitsets are used while users * num_songs bits fit in this
+    static constexpr size_t DEFAULT_DENSE_BUDGET = 64u << 20;
+
+private:
+    static constexpr size_t BITS_PER_ENTRY = 16;
+
+    size_t num_songs = 0;
+    size_t num_users = 0;
+    bool dense = true;
+
+    // Dense layout: words_per_user words per user, row-major
+    size_t words_per_user = 0;
+    vector<uint64_t> bits;
+
+    // Bloom layout: per-user filter words (power-of-two count) and the
+    // exact sorted list they summarize
+    vector<vector<uint64_t>> blooms;
+    vector<vector<uint32_t>> excluded;
+
+    static uint64_t hash(uint32_t song) {
+        uint64_t h = (song + 1) * 0x9E3779B97F4A7C15ull;
+        return h ^ (h >> 29);
+    }
+
+    // The word and two-bit mask of song in a filter of `words` words
+    static void probe(uint32_t song, size_t words, size_t& word, uint64_t& mask) {
+        uint64_t h = hash(song);
+        word = static_cast<size_t>(h >> 32) & (words - 1);
+        mask = (uint64_t(1) << (h & 63)) | (uint64_t(1) << ((h >> 6) & 63));
+    }
+
+    static size_t bloomWords(size_t entries) {
+        size_t words = 1;
+        while (words * 64 < entries * BITS_PER_ENTRY) words *= 2;
+        return words;
+    }
+
+    void rebuildBloom(uint32_t user) {
+        const auto &list = excluded[user];
+        auto &filter = blooms[user];
+        filter.assign(list.empty() ? 0 : bloomWords(list.size()), 0);
+        for (uint32_t song : list) {
+            size_t word;
+            uint64_t mask;
+            probe(song, filter.size(), word, mask);
+            filter[word] |= mask;
+        }
+    }
+
+    void addUsers(size_t users) {
+        if (users <= num_users) return;
+        num_users = users;
+        if (dense) {
+            bits.resize(num_users * words_per_user, 0);
+        } else {
+            blooms.resize(num_users);
+            excluded.resize(num_users);
+        }
+    }
+
+public:
+    /**
+     * Builds from lists[u], the songs to exclude for user u (any order,
+     * duplicates allowed). dense_budget_bytes caps the dense layout.
+     */
+    void build(const vector<vector<uint32_t>>& lists, size_t song_count,
+               size_t dense_budget_bytes = DEFAULT_DENSE_BUDGET) {
+        clear();
+        num_songs = song_count;
+        words_per_user = (num_songs + 63) / 64;
+        dense = lists.size() * words_per_user * sizeof(uint64_t) <= dense_budget_bytes;
+        addUsers(lists.size());
+
+        for (uint32_t user = 0; user < lists.size(); ++user) {
+            if (dense) {
+                uint64_t* row = bits.data() + user * words_per_user;
+                for (uint32_t song : lists[user]) {
+                    if (song < num_songs) row[song >> 6] |= uint64_t(1) << (song & 63);
+                }
+                continue;
+            }
+            auto &list = excluded[user];
+            for (uint32_t song : lists[user]) {
+                if (song < num_songs) list.push_back(song);
+            }
+            sort(list.begin(), list.end());
+            list.erase(unique(list.begin(), list.end()), list.end());
+            rebuildBloom(user);
+        }
+    }
+
+    bool excludes(uint32_t user, uint32_t song) const {
+        if (user >= num_users || song >= num_songs) return false;
+        if (dense) {
+            return (bits[user * words_per_user + (song >> 6)] >> (song & 63)) & 1;
+        }
+        const auto &filter = blooms[user];
+        if (filter.empty()) return false;
+        size_t word;
+        uint64_t mask;
+        probe(song, filter.size(), word, mask);
+        if ((filter[word] & mask) != mask) return false;
+        const auto &list = excluded[user];
+        return binary_search(list.begin(), list.end(), song);
+    }
+
+    // Excludes song for user from now on (users may be new)
+    void add(uint32_t user, uint32_t song) {
+        if (song >= num_songs) return;
+        addUsers(static_cast<size_t>(user) + 1);
+        if (dense) {
+            bits[user * words_per_user + (song >> 6)] |= uint64_t(1) << (song & 63);
+            return;
+        }
+        auto &list = excluded[user];
+        auto pos = lower_bound(list.begin(), list.end(), song);
+        if (pos != list.end() && *pos == song) return;
+        list.insert(pos, song);
+
+        // Resize the filter by doubling so its false-positive rate holds
+        auto &filter = blooms[user];
+        if (filter.size() < bloomWords(list.size())) {
+            rebuildBloom(user);
+            return;
+        }
+        size_t word;
+        uint64_t mask;
+        probe(song, filter.size(), word, mask);
+        filter[word] |= mask;
+    }
+
+    bool isDense() const {
+        return dense;
+    }
+
+    void clear() {
+        num_songs = 0;
+        num_users = 0;
+        dense = true;
+        words_per_user = 0;
+        bits.clear();
+        blooms.clear();
+        excluded.clear();
+    }
+
+    // Bytes held by the bitsets / filters and lists
+    size_t memoryUsage() const {
+        size_t bytes = bits.capacity() * sizeof(uint64_t) +
+                       blooms.capacity() * sizeof(vector<uint64_t>) +
+                       excluded.capacity() * sizeof(vector<uint32_t>);
+        for (const auto &filter : blooms) bytes += filter.capacity() * sizeof(uint64_t);
+        for (const auto &list : excluded) bytes += list.capacity() * sizeof(uint32_t);
+        return bytes;
+    }
+};
+
+#endif // EXCLUSION_FILTER_H
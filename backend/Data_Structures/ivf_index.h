@@ -0,0 +1,274 @@
+#ifndef IVF_INDEX_H
+#define IVF_INDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+#include "nearest_neighbor_index.h"
+
+using namespace std;
+
+/**
+ * Approximate nearest-neighbor search with an inverted-file (IVF) index
+ *
+ * Build clusters the feature vectors with k-means into nlist cells and
+ * stores each cell's points contiguously. A query ranks the centroids and
+ * scans only the nprobe closest cells, so cost is O(nlist * d + n * nprobe
+ * / nlist * d) instead of O(n * d). Recall is tuned with nprobe
+ * (nprobe == nlist is exact).
+ *
+ * Intended for high-dimensional features (e.g. embeddings) where tree
+ * pruning stops working; for the 4-D audio features the exact backends
+ * are already fast.
+ */
+class IvfIndex : public NearestNeighborIndex {
+private:
+    int dimensions = 0;
+    size_t num_points = 0;
+    size_t requested_lists = 0; // 0 = sqrt(n) at build time
+    size_t nlist = 0;
+    size_t nprobe = 4;
+    int kmeans_iterations = 10;
+
+    vector<float> centroids;      // nlist x dimensions, row-major
+    vector<uint32_t> list_offsets; // cell c holds [list_offsets[c], list_offsets[c + 1])
+    vector<uint32_t> list_ids;    // song index per cell entry
+    vector<float> list_coords;    // row-major features, same order as list_ids
+    vector<uint32_t> position_of; // entry position of each song index
+
+    static float squaredDistance(const float* a, const float* b, int dims) {
+        float sum = 0.0f;
+        for (int d = 0; d < dims; ++d) {
+            float diff = a[d] - b[d];
+            sum += diff * diff;
+        }
+        return sum;
+    }
+
+    uint32_t nearestCentroid(const float* point) const {
+        uint32_t best = 0;
+        float best_dist = numeric_limits<float>::infinity();
+        for (uint32_t c = 0; c < nlist; ++c) {
+            float dist = squaredDistance(point, &centroids[c * dimensions], dimensions);
+            if (dist < best_dist) {
+                best_dist = dist;
+                best = c;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * k nearest entries of the nprobe cells closest to target, written to
+     * best sorted by (distance^2, id); cells is nlist entries of scratch.
+     * Returns the number found.
+     */
+    size_t probe(const float* target, size_t k, pair<float, uint32_t>* cells, pair<float, uint32_t>* best) const {
+        // Rank cells by centroid distance
+        for (uint32_t c = 0; c < nlist; ++c) {
+            cells[c] = {squaredDistance(target, &centroids[c * dimensions], dimensions), c};
+        }
+        size_t probes = min(nprobe, nlist);
+        partial_sort(cells, cells + probes, cells + nlist);
+
+        // Bounded max-heap over the probed cells
+        size_t found = 0;
+        uint64_t scanned = 0;
+        for (size_t p = 0; p < probes; ++p) {
+            uint32_t c = cells[p].second;
+            scanned += list_offsets[c + 1] - list_offsets[c];
+            for (uint32_t pos = list_offsets[c]; pos < list_offsets[c + 1]; ++pos) {
+                float dist = squaredDistance(target, &list_coords[pos * dimensions], dimensions);
+                if (found < k) {
+                    best[found++] = {dist, list_ids[pos]};
+                    push_heap(best, best + found);
+                } else if (dist < best[0].first) {
+                    pop_heap(best, best + found);
+                    best[found - 1] = {dist, list_ids[pos]};
+                    push_heap(best, best + found);
+                }
+            }
+        }
+
+        visits.add(nlist + scanned);
+        sort(best, best + found);
+        return found;
+    }
+
+public:
+    explicit IvfIndex(size_t lists = 0, size_t probes = 4) : requested_lists(lists), nprobe(max<size_t>(1, probes)) {}
+
+    void setNumProbes(size_t probes) {
+        nprobe = max<size_t>(1, probes);
+    }
+
+    size_t getNumLists() const {
+        return nlist;
+    }
+
+    void build(const vector<Song>& songs) override {
+        num_points = songs.size();
+        dimensions = songs.empty() ? 0 : static_cast<int>(songs[0].getFeatureVector().size());
+
+        vector<float> points(num_points * dimensions);
+        for (size_t i = 0; i < num_points; ++i) {
+            auto features = songs[i].getFeatureVector();
+            for (int d = 0; d < dimensions; ++d) points[i * dimensions + d] = static_cast<float>(features[d]);
+        }
+
+        nlist = requested_lists;
+        if (nlist == 0) nlist = static_cast<size_t>(sqrt(static_cast<double>(num_points)));
+        nlist = max<size_t>(1, min(nlist, max<size_t>(num_points, 1)));
+
+        // Deterministic seeding: evenly strided points
+        centroids.assign(nlist * dimensions, 0.0f);
+        for (size_t c = 0; c < nlist && num_points > 0; ++c) {
+            size_t src = c * num_points / nlist;
+            copy(&points[src * dimensions], &points[src * dimensions] + dimensions, &centroids[c * dimensions]);
+        }
+
+        // Lloyd iterations
+        vector<uint32_t> assignment(num_points, 0);
+        for (int iter = 0; iter < kmeans_iterations && num_points > 0; ++iter) {
+            for (size_t i = 0; i < num_points; ++i) assignment[i] = nearestCentroid(&points[i * dimensions]);
+
+            vector<double> sums(nlist * dimensions, 0.0);
+            vector<size_t> counts(nlist, 0);
+            for (size_t i = 0; i < num_points; ++i) {
+                counts[assignment[i]]++;
+                for (int d = 0; d < dimensions; ++d) sums[assignment[i] * dimensions + d] += points[i * dimensions + d];
+            }
+            for (size_t c = 0; c < nlist; ++c) {
+                if (counts[c] == 0) continue; // keep empty cells where they are
+                for (int d = 0; d < dimensions; ++d) {
+                    centroids[c * dimensions + d] = static_cast<float>(sums[c * dimensions + d] / counts[c]);
+                }
+            }
+        }
+        for (size_t i = 0; i < num_points; ++i) assignment[i] = nearestCentroid(&points[i * dimensions]);
+
+        // Lay each cell out contiguously
+        list_offsets.assign(nlist + 1, 0);
+        for (size_t i = 0; i < num_points; ++i) list_offsets[assignment[i] + 1]++;
+        for (size_t c = 0; c < nlist; ++c) list_offsets[c + 1] += list_offsets[c];
+
+        list_ids.assign(num_points, 0);
+        list_coords.assign(num_points * dimensions, 0.0f);
+        position_of.assign(num_points, 0);
+        vector<uint32_t> cursor(list_offsets.begin(), list_offsets.end() - 1);
+        for (size_t i = 0; i < num_points; ++i) {
+            uint32_t pos = cursor[assignment[i]]++;
+            list_ids[pos] = static_cast<uint32_t>(i);
+            position_of[i] = pos;
+            copy(&points[i * dimensions], &points[i * dimensions] + dimensions, &list_coords[pos * dimensions]);
+        }
+    }
+
+    vector<pair<double, uint32_t>> findKNearest(
+        const vector<double>& target_features,
+        int k
+    ) const override {
+        vector<pair<double, uint32_t>> result;
+        if (k <= 0 || num_points == 0) return result;
+
+        vector<float> target(target_features.begin(), target_features.end());
+        target.resize(dimensions, 0.0f);
+
+        vector<pair<float, uint32_t>> cells(nlist), best(k);
+        size_t found = probe(target.data(), static_cast<size_t>(k), cells.data(), best.data());
+
+        result.reserve(found);
+        for (size_t i = 0; i < found; ++i) result.push_back({sqrt(static_cast<double>(best[i].first)), best[i].second});
+        return result;
+    }
+
+    // Probes from each song's stored row in place, scratch in arena
+    void findSimilarSongsBatch(
+        const vector<uint32_t>& song_idxs,
+        int k,
+        Arena& arena,
+        vector<uint32_t>& neighbors,
+        vector<uint32_t>& offsets
+    ) const override {
+        neighbors.clear();
+        offsets.assign(song_idxs.size() + 1, 0);
+        if (k <= 0 || num_points == 0) return;
+
+        using Entry = pair<float, uint32_t>;
+        ArenaVector<float> origin(dimensions, 0.0f, ArenaAllocator<float>(arena));
+        ArenaVector<Entry> cells(nlist, ArenaAllocator<Entry>(arena));
+        ArenaVector<Entry> best(static_cast<size_t>(k) + 1, ArenaAllocator<Entry>(arena));
+        for (size_t q = 0; q < song_idxs.size(); ++q) {
+            uint32_t idx = song_idxs[q];
+            const float* target = idx < num_points ? &list_coords[position_of[idx] * dimensions] : origin.data();
+            size_t found = probe(target, best.size(), cells.data(), best.data());
+            appendSimilar(idx, k, best.data(), best.data() + found, neighbors);
+            offsets[q + 1] = static_cast<uint32_t>(neighbors.size());
+        }
+    }
+
+    vector<double> getFeatures(uint32_t song_idx) const override {
+        vector<double> point(dimensions, 0.0);
+        if (song_idx < num_points) {
+            const float* src = &list_coords[position_of[song_idx] * dimensions];
+            for (int d = 0; d < dimensions; ++d) point[d] = src[d];
+        }
+        return point;
+    }
+
+    size_t size() const override {
+        return num_points;
+    }
+
+    const char* name() const override {
+        return "ivf";
+    }
+
+    size_t memoryUsage() const override {
+        return (centroids.capacity() + list_coords.capacity()) * sizeof(float) +
+               (list_offsets.capacity() + list_ids.capacity() + position_of.capacity()) * sizeof(uint32_t);
+    }
+
+    void save(SnapshotWriter& out, const string& prefix) const override {
+        int64_t shape[4] = {dimensions, static_cast<int64_t>(num_points), static_cast<int64_t>(nlist),
+                            static_cast<int64_t>(nprobe)};
+        out.putValue(prefix + ".shape", shape);
+        out.putArray(prefix + ".centroids", centroids);
+        out.putArray(prefix + ".list_offsets", list_offsets);
+        out.putArray(prefix + ".list_ids", list_ids);
+        out.putArray(prefix + ".list_coords", list_coords);
+        out.putArray(prefix + ".position_of", position_of);
+    }
+
+    bool load(const SnapshotReader& in, const string& prefix) override {
+        int64_t shape[4] = {0, 0, 0, 0};
+        bool ok = in.getValue(prefix + ".shape", shape) && in.getArray(prefix + ".centroids", centroids) &&
+            in.getArray(prefix + ".list_offsets", list_offsets) && in.getArray(prefix + ".list_ids", list_ids) &&
+            in.getArray(prefix + ".list_coords", list_coords) && in.getArray(prefix + ".position_of", position_of);
+        ok = ok && shape[0] >= 0 && shape[1] >= 0 && shape[2] >= 0;
+        size_t dims = ok ? static_cast<size_t>(shape[0]) : 0, points = ok ? static_cast<size_t>(shape[1]) : 0;
+        size_t lists = ok ? static_cast<size_t>(shape[2]) : 0;
+        if (!ok || centroids.size() != lists * dims || list_offsets.size() != lists + 1 ||
+            list_ids.size() != points || list_coords.size() != points * dims || position_of.size() != points ||
+            !snapshot::validOffsets(list_offsets, points) || !snapshot::allBelow(list_ids, points) ||
+            !snapshot::allBelow(position_of, points)) {
+            dimensions = 0;
+            num_points = nlist = 0;
+            centroids.clear();
+            list_offsets.clear();
+            list_ids.clear();
+            list_coords.clear();
+            position_of.clear();
+            return false;
+        }
+        dimensions = static_cast<int>(dims);
+        num_points = points;
+        nlist = lists;
+        nprobe = max<size_t>(1, static_cast<size_t>(shape[3]));
+        return true;
+    }
+};
+
+#endif // IVF_INDEX_H
@@ -3,151 +3,288 @@
 
 #include <vector>
 #include <algorithm>
+#include <numeric>
 #include <cmath>
 #include <limits>
-#include <memory>
 #include "../core/entities.h"
+#include "../core/id_registry.h"
+#include "nearest_neighbor_index.h"
 
 using namespace std;
 
-struct KDNode {
-    vector<double> point;
-    string song_id;
-    shared_ptr<KDNode> left;
-    shared_ptr<KDNode> right;
-    int depth;
-
-    KDNode(const vector<double>& p, const string& id, int d)
-        : point(p), song_id(id), depth(d), left(nullptr), right(nullptr) {}
-};
-
-class KDTree {
+/**
+ * Flat K-D Tree over song feature vectors
+ *
+ * The tree is implicit: points are permuted in place so that the subtree
+ * over slots [lo, hi) has its splitting node at mid = lo + (hi - lo) / 2,
+ * left child [lo, mid) and right child [mid + 1, hi), split on axis
+ * depth % dimensions. No node objects or pointers exist.
+ *
+ * Features are stored as float32 structure-of-arrays, one contiguous
+ * column per dimension: [bpm..., energy..., danceability..., valence...].
+ *
+ * Time Complexities:
+ * - Build: O(n log n) using in-place nth_element per level
+ * - k-NN query: O(log n + k log k) average, iterative with an explicit stack
+ * - Batch k-NN: one shared traversal for N queries, see findKNearestBatch
+ */
+class KDTree : public NearestNeighborIndex {
 private:
-    shared_ptr<KDNode> root;
     int dimensions; // 4 dimensions: [bpm, energy, danceability, valence]
+    size_t num_points = 0;
 
-    shared_ptr<KDNode> buildTree(
-         vector< pair< vector<double>,  string>>& points,
-        int depth
-    ) {
-        if (points.empty()) return nullptr;
+    vector<float> coords;  // coords[axis * num_points + slot]
+    vector<uint32_t> ids;  // song index stored at each slot
+    vector<uint32_t> slot_of; // slot holding each song index
 
-        int axis = depth % dimensions;
+    // Pending subtree on the search stack; bound is the squared distance
+    // from the query to the splitting plane that separates it
+    struct Frame {
+        uint32_t lo;
+        uint32_t hi;
+        int depth;
+        float bound;
+    };
+
+    void buildRange(vector<uint32_t>& order, const vector<float>& points,
+                    uint32_t lo, uint32_t hi, int depth) {
+        while (hi > lo + 1) {
+            int axis = depth % dimensions;
+            uint32_t mid = lo + (hi - lo) / 2;
+
+            // Median on current axis, partitioned in place. Time: O(n)
+            nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi,
+                [&](uint32_t a, uint32_t b) {
+                    return points[a * dimensions + axis] < points[b * dimensions + axis];
+                });
+
+            buildRange(order, points, lo, mid, depth + 1);
+            lo = mid + 1;
+            depth++;
+        }
+    }
+
+    // Max-heap of (distance^2, id) with capacity k over caller storage,
+    // worst candidate at front
+    struct BoundedHeap {
+        pair<float, uint32_t>* items;
+        size_t count = 0;
+        size_t capacity;
 
-        // Sort points by current axis
-        // Time: O(n log n)
-        sort(points.begin(), points.end(),
-            [axis](const auto& a, const auto& b) {
-                return a.first[axis] < b.first[axis];
-            });
-
-        // Select median as pivot
-        size_t median = points.size() / 2;
-        auto node =  make_shared<KDNode>(
-            points[median].first,
-            points[median].second,
-            depth
-        );
-
-        // Recursively build left and right subtrees
-        vector<pair<vector<double>, string>> left_points(
-            points.begin(), points.begin() + median
-        );
-        vector<pair<vector<double>, string>> right_points(
-            points.begin() + median + 1, points.end()
-        );
-
-        node->left = buildTree(left_points, depth + 1);
-        node->right = buildTree(right_points, depth + 1);
-
-        return node;
-    }
-
-    double distance(const vector<double>& a, const vector<double>& b) const {
-        double sum = 0.0;
-        for (size_t i = 0; i < a.size(); ++i) {
-            double diff = a[i] - b[i];
+        BoundedHeap(pair<float, uint32_t>* storage, size_t k) : items(storage), capacity(k) {}
+
+        bool full() const { return count >= capacity; }
+        float worst() const { return items[0].first; }
+
+        void offer(float dist, uint32_t id) {
+            if (!full()) {
+                items[count++] = {dist, id};
+                push_heap(items, items + count);
+            } else if (dist < items[0].first) {
+                pop_heap(items, items + count);
+                items[count - 1] = {dist, id};
+                push_heap(items, items + count);
+            }
+        }
+
+        // Ascending by distance, then id; the heap is consumed
+        void sortResults() {
+            sort(items, items + count);
+        }
+    };
+
+    float squaredDistance(uint32_t slot, const float* target) const {
+        float sum = 0.0f;
+        for (int d = 0; d < dimensions; ++d) {
+            float diff = coords[d * num_points + slot] - target[d];
             sum += diff * diff;
         }
-        return sqrt(sum);
+        return sum;
     }
 
-    void knnSearch(
-        const shared_ptr<KDNode>& node,
-        const vector<double>& target,
-        int k,
-        vector<pair<double, string>>& best
-    ) const {
-        if (!node) return;
+    void knnSearch(const float* target, BoundedHeap& best, vector<Frame>& stack) const {
+        stack.clear();
+        stack.push_back({0, static_cast<uint32_t>(num_points), 0, 0.0f});
+        uint64_t visited = 0;
+
+        while (!stack.empty()) {
+            Frame frame = stack.back();
+            stack.pop_back();
 
-        double dist = distance(node->point, target);
+            // Check if we need to explore this subtree
+            if (frame.lo >= frame.hi) continue;
+            if (best.full() && frame.bound >= best.worst()) continue;
 
-        // Add current node to best list
-        if (best.size() < static_cast<size_t>(k)) {
-            best.push_back({dist, node->song_id});
-            push_heap(best.begin(), best.end());
-        } else if (dist < best.front().first) {
-            pop_heap(best.begin(), best.end());
-            best.pop_back();
-            best.push_back({dist, node->song_id});
-            push_heap(best.begin(), best.end());
+            uint32_t mid = frame.lo + (frame.hi - frame.lo) / 2;
+            best.offer(squaredDistance(mid, target), ids[mid]);
+            visited++;
+
+            int axis = frame.depth % dimensions;
+            float diff = target[axis] - coords[axis * num_points + mid];
+            Frame left = {frame.lo, mid, frame.depth + 1, 0.0f};
+            Frame right = {mid + 1, frame.hi, frame.depth + 1, 0.0f};
+
+            // Far side is pushed first so the near side is explored first
+            if (diff < 0) {
+                right.bound = diff * diff;
+                stack.push_back(right);
+                stack.push_back(left);
+            } else {
+                left.bound = diff * diff;
+                stack.push_back(left);
+                stack.push_back(right);
+            }
         }
+        visits.add(visited);
+    }
+
+    /**
+     * Shared traversal for a tile of queries. active[a_begin, a_end) holds
+     * the queries that still need subtree [lo, hi); query coordinates are
+     * SoA in qcoords[axis * num_queries + q]. Each node's distance is
+     * evaluated for the whole tile at once, then queries are split by which
+     * side is near: near-left queries descend left, then everyone that
+     * needs the right side goes right, then far-left stragglers go left.
+     * Every query therefore sees nodes in exactly its single-query order
+     * and gets identical results, while overlapping paths are walked once.
+     */
+    void batchSearch(uint32_t lo, uint32_t hi, int depth,
+                     ArenaVector<uint32_t>& active, size_t a_begin, size_t a_end,
+                     const float* qcoords, size_t num_queries,
+                     BoundedHeap* heaps, uint64_t& visited) const {
+        if (lo >= hi || a_begin == a_end) return;
+        visited += a_end - a_begin;
 
-        int axis = node->depth % dimensions;
-        double diff = target[axis] - node->point[axis];
+        uint32_t mid = lo + (hi - lo) / 2;
+        int axis = depth % dimensions;
+        float split = coords[axis * num_points + mid];
 
-        // Determine which subtree to explore first
-        auto first = diff < 0 ? node->left : node->right;
-        auto second = diff < 0 ? node->right : node->left;
+        for (size_t a = a_begin; a < a_end; ++a) {
+            uint32_t q = active[a];
+            float sum = 0.0f;
+            for (int d = 0; d < dimensions; ++d) {
+                float diff = coords[d * num_points + mid] - qcoords[d * num_queries + q];
+                sum += diff * diff;
+            }
+            heaps[q].offer(sum, ids[mid]);
+        }
 
-        knnSearch(first, target, k, best);
+        auto diffOf = [&](uint32_t q) { return qcoords[axis * num_queries + q] - split; };
+        auto needs = [&](uint32_t q) {
+            float diff = diffOf(q);
+            return !heaps[q].full() || diff * diff < heaps[q].worst();
+        };
+
+        // Near-left queries explore the left subtree first
+        size_t start = active.size();
+        for (size_t a = a_begin; a < a_end; ++a) {
+            if (diffOf(active[a]) < 0) active.push_back(active[a]);
+        }
+        batchSearch(lo, mid, depth + 1, active, start, active.size(), qcoords, num_queries, heaps, visited);
+        active.resize(start);
 
-        // Check if we need to explore the other subtree
-        if (best.size() < static_cast<size_t>(k) ||
-            abs(diff) < best.front().first) {
-            knnSearch(second, target, k, best);
+        // Right subtree: near-right queries always, near-left ones if still in range
+        for (size_t a = a_begin; a < a_end; ++a) {
+            uint32_t q = active[a];
+            if (diffOf(q) >= 0 || needs(q)) active.push_back(q);
         }
+        batchSearch(mid + 1, hi, depth + 1, active, start, active.size(), qcoords, num_queries, heaps, visited);
+        active.resize(start);
+
+        // Far left subtree for near-right queries still in range
+        for (size_t a = a_begin; a < a_end; ++a) {
+            uint32_t q = active[a];
+            if (diffOf(q) >= 0 && needs(q)) active.push_back(q);
+        }
+        batchSearch(lo, mid, depth + 1, active, start, active.size(), qcoords, num_queries, heaps, visited);
+        active.resize(start);
+    }
+
+    // k-NN of num_queries points (SoA qcoords) into heaps[0, num_queries),
+    // each over k entries of storage; scratch comes from arena
+    void searchBatch(const float* qcoords, size_t num_queries, size_t k, Arena& arena,
+                     pair<float, uint32_t>* storage, ArenaVector<BoundedHeap>& heaps) const {
+        heaps.reserve(num_queries);
+        for (size_t q = 0; q < num_queries; ++q) heaps.emplace_back(storage + q * k, k);
+
+        ArenaVector<uint32_t> active{ArenaAllocator<uint32_t>(arena)};
+        active.reserve(num_queries * 4);
+        for (size_t q = 0; q < num_queries; ++q) active.push_back(static_cast<uint32_t>(q));
+        uint64_t visited = 0;
+        batchSearch(0, static_cast<uint32_t>(num_points), 0, active, 0, num_queries,
+                    qcoords, num_queries, heaps.data(), visited);
+        visits.add(visited);
     }
 
 public:
-    KDTree(int dims = 4) : root(nullptr), dimensions(dims) {}
+    KDTree(int dims = 4) : dimensions(dims) {}
 
-    void build(const vector<Song>& songs) {
-        vector<pair<vector<double>, string>> points;
-        points.reserve(songs.size());
+    // Songs are indexed by their position in the vector
+    void build(const vector<Song>& songs) override {
+        num_points = songs.size();
+        if (!songs.empty()) dimensions = static_cast<int>(songs[0].getFeatureVector().size());
 
-        for (const auto& song : songs) {
-            points.push_back({song.getFeatureVector(), song.song_id});
+        // Row-major staging copy used only for partitioning
+        vector<float> points(num_points * dimensions);
+        for (size_t i = 0; i < num_points; ++i) {
+            auto features = songs[i].getFeatureVector();
+            for (int d = 0; d < dimensions; ++d) {
+                points[i * dimensions + d] = static_cast<float>(features[d]);
+            }
         }
 
-        root = buildTree(points, 0);
+        vector<uint32_t> order(num_points);
+        iota(order.begin(), order.end(), 0);
+        buildRange(order, points, 0, static_cast<uint32_t>(num_points), 0);
+
+        coords.assign(num_points * dimensions, 0.0f);
+        ids = order;
+        slot_of.assign(num_points, 0);
+        for (size_t slot = 0; slot < num_points; ++slot) {
+            slot_of[order[slot]] = static_cast<uint32_t>(slot);
+            for (int d = 0; d < dimensions; ++d) {
+                coords[d * num_points + slot] = points[order[slot] * dimensions + d];
+            }
+        }
     }
 
-     vector< pair<double,  string>> findKNearest(
+     vector< pair<double, uint32_t>> findKNearest(
         const  vector<double>& target_features,
         int k
-    ) const {
-         vector< pair<double,  string>> best;
-        knnSearch(root, target_features, k, best);
+    ) const override {
+         vector< pair<double, uint32_t>> result;
+        if (k <= 0 || num_points == 0) return result;
+
+        vector<float> target(target_features.begin(), target_features.end());
+        target.resize(dimensions, 0.0f);
+
+        vector<pair<float, uint32_t>> storage(min(static_cast<size_t>(k), num_points));
+        vector<Frame> stack;
+        BoundedHeap best(storage.data(), storage.size());
+        knnSearch(target.data(), best, stack);
 
         // Sort results by distance (ascending)
-         sort(best.begin(), best.end());
-        return best;
+        best.sortResults();
+        result.reserve(best.count);
+        for (size_t i = 0; i < best.count; ++i) {
+            result.push_back({sqrt(static_cast<double>(storage[i].first)), storage[i].second});
+        }
+        return result;
     }
 
-     vector< string> findSimilarSongs(
+     vector<uint32_t> findSimilarSongs(
+        uint32_t song_idx,
         const Song& song,
         int k,
-        const  string& exclude_song_id = ""
+        uint32_t exclude_song_idx = INVALID_ID
     ) const {
         auto features = song.getFeatureVector();
         auto nearest = findKNearest(features, k + 1);
 
-         vector< string> similar;
+         vector<uint32_t> similar;
         for (const auto& it : nearest) {
-            auto& dist = it.first;
-            auto& id = it.second;
-            if (id != song.song_id && id != exclude_song_id) {
+            auto id = it.second;
+            if (id != song_idx && id != exclude_song_idx) {
                 similar.push_back(id);
                 if (similar.size() >= static_cast<size_t>(k)) break;
             }
@@ -156,9 +293,129 @@ public:
         return similar;
     }
 
-    bool isEmpty() const {
-        return root == nullptr;
+    /**
+     * k nearest neighbors for each of N query points in one shared
+     * traversal. Result i matches findKNearest(queries[i], k).
+     */
+    vector<vector<pair<double, uint32_t>>> findKNearestBatch(
+        const vector<vector<double>>& queries,
+        int k
+    ) const override {
+        size_t num_queries = queries.size();
+        vector<vector<pair<double, uint32_t>>> results(num_queries);
+        if (k <= 0 || num_points == 0 || num_queries == 0) return results;
+
+        vector<float> qcoords(num_queries * dimensions, 0.0f);
+        for (size_t q = 0; q < num_queries; ++q) {
+            for (int d = 0; d < dimensions && d < static_cast<int>(queries[q].size()); ++d) {
+                qcoords[d * num_queries + q] = static_cast<float>(queries[q][d]);
+            }
+        }
+
+        size_t kept = min(static_cast<size_t>(k), num_points);
+        vector<pair<float, uint32_t>> storage(num_queries * kept);
+        Arena arena;
+        ArenaVector<BoundedHeap> heaps{ArenaAllocator<BoundedHeap>(arena)};
+        searchBatch(qcoords.data(), num_queries, kept, arena, storage.data(), heaps);
+
+        for (size_t q = 0; q < num_queries; ++q) {
+            heaps[q].sortResults();
+            results[q].reserve(heaps[q].count);
+            for (size_t i = 0; i < heaps[q].count; ++i) {
+                const auto& it = heaps[q].items[i];
+                results[q].push_back({sqrt(static_cast<double>(it.first)), it.second});
+            }
+        }
+        return results;
+    }
+
+    // Batch k-NN from the stored coordinates, all scratch in arena
+    void findSimilarSongsBatch(
+        const vector<uint32_t>& song_idxs,
+        int k,
+        Arena& arena,
+        vector<uint32_t>& neighbors,
+        vector<uint32_t>& offsets
+    ) const override {
+        size_t num_queries = song_idxs.size();
+        neighbors.clear();
+        offsets.assign(num_queries + 1, 0);
+        if (k <= 0 || num_points == 0 || num_queries == 0) return;
+
+        ArenaVector<float> qcoords(num_queries * dimensions, 0.0f, ArenaAllocator<float>(arena));
+        for (size_t q = 0; q < num_queries; ++q) {
+            if (song_idxs[q] >= num_points) continue; // origin, like getFeatures()
+            uint32_t slot = slot_of[song_idxs[q]];
+            for (int d = 0; d < dimensions; ++d) {
+                qcoords[d * num_queries + q] = coords[d * num_points + slot];
+            }
+        }
+
+        size_t kept = min(static_cast<size_t>(k) + 1, num_points);
+        ArenaVector<pair<float, uint32_t>> storage(num_queries * kept, ArenaAllocator<pair<float, uint32_t>>(arena));
+        ArenaVector<BoundedHeap> heaps{ArenaAllocator<BoundedHeap>(arena)};
+        searchBatch(qcoords.data(), num_queries, kept, arena, storage.data(), heaps);
+
+        for (size_t q = 0; q < num_queries; ++q) {
+            heaps[q].sortResults();
+            appendSimilar(song_idxs[q], k, heaps[q].items, heaps[q].items + heaps[q].count, neighbors);
+            offsets[q + 1] = static_cast<uint32_t>(neighbors.size());
+        }
+    }
+
+    // Stored (float32-rounded) features of an indexed song
+    vector<double> getFeatures(uint32_t song_idx) const override {
+        vector<double> point(dimensions, 0.0);
+        if (song_idx < num_points) {
+            for (int d = 0; d < dimensions; ++d) {
+                point[d] = coords[d * num_points + slot_of[song_idx]];
+            }
+        }
+        return point;
+    }
+
+    size_t size() const override {
+        return num_points;
+    }
+
+    const char* name() const override {
+        return "kd-tree";
+    }
+
+    size_t memoryUsage() const override {
+        return coords.capacity() * sizeof(float) + (ids.capacity() + slot_of.capacity()) * sizeof(uint32_t);
+    }
+
+    void save(SnapshotWriter& out, const string& prefix) const override {
+        int64_t shape[2] = {dimensions, static_cast<int64_t>(num_points)};
+        out.putValue(prefix + ".shape", shape);
+        out.putArray(prefix + ".coords", coords);
+        out.putArray(prefix + ".ids", ids);
+        out.putArray(prefix + ".slot_of", slot_of);
+    }
+
+    bool load(const SnapshotReader& in, const string& prefix) override {
+        int64_t shape[2] = {0, 0};
+        bool ok = in.getValue(prefix + ".shape", shape) && in.getArray(prefix + ".coords", coords) &&
+            in.getArray(prefix + ".ids", ids) && in.getArray(prefix + ".slot_of", slot_of);
+        size_t points = ok ? static_cast<size_t>(shape[1]) : 0;
+        if (!ok || shape[0] < 0 || shape[1] < 0 || ids.size() != points || slot_of.size() != points ||
+            coords.size() != points * static_cast<size_t>(shape[0]) ||
+            !snapshot::allBelow(ids, points) || !snapshot::allBelow(slot_of, points)) {
+            num_points = 0;
+            coords.clear();
+            ids.clear();
+            slot_of.clear();
+            return false;
+        }
+        dimensions = static_cast<int>(shape[0]);
+        num_points = points;
+        return true;
+    }
+
+    int getDimensions() const {
+        return dimensions;
     }
 };
 
-#endif 
+#endif
@@ -0,0 +1,123 @@
+#ifndef NEAREST_NEIGHBOR_INDEX_H
+#define NEAREST_NEIGHBOR_INDEX_H
+
+#include <vector>
+#include <string>
+#include "../core/arena.h"
+#include "../core/entities.h"
+#include "../core/snapshot.h"
+#include "../core/metrics.h"
+
+using namespace std;
+
+// Available content-pillar nearest-neighbor backends
+enum class NeighborBackend {
+    KD_TREE,     // exact, flat K-D tree (best for the 4-D audio features)
+    BRUTE_FORCE, // exact, SIMD linear scan (scales with dimensions, not depth)
+    IVF          // approximate, inverted-file index for high-dimensional features
+};
+
+/**
+ * Interface for nearest-neighbor search over song feature vectors
+ *
+ * Songs are indexed by their position in the vector passed to build().
+ * Distances are Euclidean over Song::getFeatureVector(); results are
+ * sorted by distance ascending.
+ */
+class NearestNeighborIndex {
+protected:
+    mutable metrics::Counter visits;
+
+    // Appends to out up to k ids of the (distance, id) range [first, last),
+    // sorted ascending, skipping the query song itself
+    template <typename It>
+    static void appendSimilar(uint32_t song_idx, int k, It first, It last, vector<uint32_t>& out) {
+        int found = 0;
+        for (It it = first; it != last && found < k; ++it) {
+            if (it->second == song_idx) continue;
+            out.push_back(it->second);
+            found++;
+        }
+    }
+
+public:
+    virtual ~NearestNeighborIndex() {}
+
+    virtual void build(const vector<Song>& songs) = 0;
+
+    virtual vector<pair<double, uint32_t>> findKNearest(
+        const vector<double>& target_features,
+        int k
+    ) const = 0;
+
+    // Stored feature vector of an indexed song
+    virtual vector<double> getFeatures(uint32_t song_idx) const = 0;
+
+    virtual size_t size() const = 0;
+
+    virtual const char* name() const = 0;
+
+    // Bytes held by the index arrays
+    virtual size_t memoryUsage() const = 0;
+
+    // Distance evaluations performed by queries (tree nodes, scanned
+    // points or centroids plus cell entries, depending on the backend)
+    uint64_t getVisitCount() const {
+        return visits.get();
+    }
+
+    void resetVisitCount() {
+        visits.reset();
+    }
+
+    // Built index as snapshot sections under prefix; load() replaces the
+    // index and returns false (leaving it empty) if sections are missing
+    virtual void save(SnapshotWriter& out, const string& prefix) const = 0;
+    virtual bool load(const SnapshotReader& in, const string& prefix) = 0;
+
+    // One result list per query; backends override with a fused pass
+    virtual vector<vector<pair<double, uint32_t>>> findKNearestBatch(
+        const vector<vector<double>>& queries,
+        int k
+    ) const {
+        vector<vector<pair<double, uint32_t>>> results;
+        results.reserve(queries.size());
+        for (const auto& q : queries) results.push_back(findKNearest(q, k));
+        return results;
+    }
+
+    /**
+     * k most similar songs to each indexed song, excluding the song itself,
+     * as flat lists: song_idxs[q]'s neighbors are neighbors[offsets[q],
+     * offsets[q + 1]). Backends override this to read their stored features
+     * in place with scratch from arena, so a call with warm buffers makes no
+     * heap allocations; this fallback goes through findKNearestBatch().
+     */
+    virtual void findSimilarSongsBatch(
+        const vector<uint32_t>& song_idxs,
+        int k,
+        Arena& arena,
+        vector<uint32_t>& neighbors,
+        vector<uint32_t>& offsets
+    ) const {
+        (void)arena;
+        vector<vector<double>> queries;
+        queries.reserve(song_idxs.size());
+        for (uint32_t idx : song_idxs) queries.push_back(getFeatures(idx));
+
+        auto nearest = findKNearestBatch(queries, k + 1);
+
+        neighbors.clear();
+        offsets.assign(1, 0);
+        for (size_t q = 0; q < song_idxs.size(); ++q) {
+            appendSimilar(song_idxs[q], k, nearest[q].begin(), nearest[q].end(), neighbors);
+            offsets.push_back(static_cast<uint32_t>(neighbors.size()));
+        }
+    }
+
+    bool isEmpty() const {
+        return size() == 0;
+    }
+};
+
+#endif // NEAREST_NEIGHBOR_INDEX_H
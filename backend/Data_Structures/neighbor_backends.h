@@ -0,0 +1,23 @@
+#ifndef NEIGHBOR_BACKENDS_H
+#define NEIGHBOR_BACKENDS_H
+
+#include <memory>
+#include "nearest_neighbor_index.h"
+#include "kdtree.h"
+#include "brute_force_index.h"
+#include "ivf_index.h"
+
+// Creates an empty content index for the chosen backend
+inline unique_ptr<NearestNeighborIndex> makeNeighborIndex(NeighborBackend backend) {
+    switch (backend) {
+        case NeighborBackend::BRUTE_FORCE:
+            return unique_ptr<NearestNeighborIndex>(new BruteForceIndex());
+        case NeighborBackend::IVF:
+            return unique_ptr<NearestNeighborIndex>(new IvfIndex());
+        case NeighborBackend::KD_TREE:
+        default:
+            return unique_ptr<NearestNeighborIndex>(new KDTree());
+    }
+}
+
+#endif // NEIGHBOR_BACKENDS_H
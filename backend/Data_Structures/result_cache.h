@@ -0,0 +1,219 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include "../core/metrics.h"
+
+using namespace std;
+
+/**
+ * Sharded, thread-safe LRU cache of per-user results
+ *
+ * Entries are keyed by (user, Params): Params is any value type with
+ * operator== describing how the result was computed (e.g. result count
+ * and weights). A user's entries all live in one shard, found through a
+ * per-user index, so invalidateUser() drops exactly that user's results.
+ *
+ * Each shard holds its own mutex, recency list and byte budget (the
+ * total budget split evenly); inserting past the budget evicts least
+ * recently used entries. Entries older than the TTL are dropped when
+ * next looked up. Values are stored immutable behind shared_ptr, so a
+ * hit only bumps a reference count under the shard lock and callers read
+ * (or copy) the result after releasing it.
+ *
+ * Time Complexities (e = cached entries of the user, usually 1):
+ * - get / put / invalidateUser: O(e) expected, plus evictions
+ */
+template <typename Params, typename Value>
+class ResultCache {
+private:
+    using Clock = chrono::steady_clock;
+
+    struct Entry {
+        uint32_t user;
+        Params params;
+        shared_ptr<const Value> value;
+        size_t bytes;
+        Clock::time_point stored;
+    };
+    using EntryList = list<Entry>;
+
+    struct Shard {
+        mutex lock;
+        EntryList lru; // most recent first
+        unordered_map<uint32_t, vector<typename EntryList::iterator>> by_user;
+        size_t bytes = 0;
+    };
+
+    // Per-entry bookkeeping beyond the value's heap memory: list node, index
+    // slot, and the shared value with its control block
+    static constexpr size_t ENTRY_OVERHEAD = sizeof(Entry) + 4 * sizeof(void*) + sizeof(Value) + 2 * sizeof(long);
+
+    vector<unique_ptr<Shard>> shards;
+    size_t shard_budget = 0;
+    chrono::milliseconds ttl{0};
+
+    metrics::Counter hits;
+    metrics::Counter misses;
+    metrics::Counter evictions;   // dropped for the byte budget
+    metrics::Counter expirations; // dropped for the TTL
+    metrics::Counter invalidations;
+
+    Shard& shardOf(uint32_t user) const {
+        return *shards[(user * 0x9E3779B1u >> 16) % shards.size()];
+    }
+
+    typename EntryList::iterator findEntry(Shard& shard, uint32_t user, const Params& params) {
+        auto it = shard.by_user.find(user);
+        if (it == shard.by_user.end()) return shard.lru.end();
+        for (auto entry : it->second) {
+            if (entry->params == params) return entry;
+        }
+        return shard.lru.end();
+    }
+
+    void erase(Shard& shard, typename EntryList::iterator entry) {
+        auto it = shard.by_user.find(entry->user);
+        auto &list = it->second;
+        for (size_t i = 0; i < list.size(); ++i) {
+            if (list[i] == entry) {
+                list[i] = list.back();
+                list.pop_back();
+                break;
+            }
+        }
+        if (list.empty()) shard.by_user.erase(it);
+        shard.bytes -= entry->bytes;
+        shard.lru.erase(entry);
+    }
+
+public:
+    /**
+     * budget_bytes: total memory for entries (0 disables the cache);
+     * ttl_ms: entry lifetime (0 = until evicted or invalidated)
+     */
+    explicit ResultCache(size_t budget_bytes = 0, int ttl_ms = 0, size_t num_shards = 16) {
+        configure(budget_bytes, ttl_ms, num_shards);
+    }
+
+    // Drops every entry and applies a new budget / TTL / shard count
+    void configure(size_t budget_bytes, int ttl_ms = 0, size_t num_shards = 16) {
+        if (num_shards == 0) num_shards = 1;
+        shards.clear();
+        for (size_t i = 0; i < num_shards; ++i) shards.emplace_back(new Shard());
+        shard_budget = budget_bytes / num_shards;
+        ttl = chrono::milliseconds(ttl_ms < 0 ? 0 : ttl_ms);
+    }
+
+    bool isEnabled() const {
+        return shard_budget > 0;
+    }
+
+    // Shared cached result; null on a miss. The value stays valid after
+    // the entry is evicted or invalidated.
+    shared_ptr<const Value> get(uint32_t user, const Params& params) {
+        if (!isEnabled()) return nullptr;
+        Shard &shard = shardOf(user);
+        lock_guard<mutex> guard(shard.lock);
+        auto entry = findEntry(shard, user, params);
+        if (entry == shard.lru.end()) {
+            misses.add();
+            return nullptr;
+        }
+        if (ttl.count() > 0 && Clock::now() - entry->stored >= ttl) {
+            erase(shard, entry);
+            expirations.add();
+            misses.add();
+            return nullptr;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+        hits.add();
+        return entry->value;
+    }
+
+    // value_bytes: heap memory owned by value, for the budget
+    void put(uint32_t user, const Params& params, Value value, size_t value_bytes) {
+        if (!isEnabled()) return;
+        size_t bytes = value_bytes + ENTRY_OVERHEAD;
+        if (bytes > shard_budget) return;
+
+        auto shared = make_shared<const Value>(move(value)); // allocated outside the lock
+        Shard &shard = shardOf(user);
+        lock_guard<mutex> guard(shard.lock);
+        auto existing = findEntry(shard, user, params);
+        if (existing != shard.lru.end()) erase(shard, existing);
+
+        shard.lru.push_front(Entry{user, params, move(shared), bytes, Clock::now()});
+        shard.by_user[user].push_back(shard.lru.begin());
+        shard.bytes += bytes;
+        while (shard.bytes > shard_budget) {
+            erase(shard, prev(shard.lru.end()));
+            evictions.add();
+        }
+    }
+
+    // Drops every cached result of user
+    void invalidateUser(uint32_t user) {
+        if (!isEnabled()) return;
+        Shard &shard = shardOf(user);
+        lock_guard<mutex> guard(shard.lock);
+        auto it = shard.by_user.find(user);
+        if (it == shard.by_user.end()) return;
+        invalidations.add(it->second.size());
+        for (auto entry : it->second) {
+            shard.bytes -= entry->bytes;
+            shard.lru.erase(entry);
+        }
+        shard.by_user.erase(it);
+    }
+
+    void clear() {
+        for (auto &shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            shard->lru.clear();
+            shard->by_user.clear();
+            shard->bytes = 0;
+        }
+    }
+
+    size_t size() const {
+        size_t entries = 0;
+        for (const auto &shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            entries += shard->lru.size();
+        }
+        return entries;
+    }
+
+    // Bytes charged against the budget
+    size_t memoryUsage() const {
+        size_t bytes = 0;
+        for (const auto &shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            bytes += shard->bytes;
+        }
+        return bytes;
+    }
+
+    uint64_t getHits() const { return hits.get(); }
+    uint64_t getMisses() const { return misses.get(); }
+    uint64_t getEvictions() const { return evictions.get(); }
+    uint64_t getExpirations() const { return expirations.get(); }
+    uint64_t getInvalidations() const { return invalidations.get(); }
+
+    void resetCounters() {
+        hits.reset();
+        misses.reset();
+        evictions.reset();
+        expirations.reset();
+        invalidations.reset();
+    }
+};
+
+#endif // RESULT_CACHE_H
@@ -13,12 +13,19 @@
  * Time Complexities:
  * - Insert: O(m) where m is length of word
  * - Search: O(m)
- * - Prefix Search: O(m + k) where k is number of results
- * - Delete: O(m)
+ * - Prefix Search: O(m + k) where k is number of results, served from the
+ *   per-node top-K cache when k <= K
+ * - Delete: O(m * K * fanout) to refresh cached completions on the path
  *
  * Space Complexity: O(ALPHABET_SIZE * m * n) where n is number of words
  *
  * Used for autocomplete search of songs and artists
+ *
+ * Every node caches the K best completions in its subtree (frequency
+ * descending, then value ascending), so a prefix query never visits the
+ * subtree. Frequencies only grow on insert / incrementFrequency, which lets
+ * those update the caches on the path in place; remove rebuilds them from
+ * the children's caches.
  */
 
 struct TrieNode {
@@ -26,6 +33,7 @@ struct TrieNode {
     bool is_end_of_word;
     std::string value; // Complete word/ID stored at leaf
     int frequency; // For ranking suggestions
+    std::vector<const TrieNode*> top_completions; // Best words in this subtree, ranked
 
     TrieNode() : is_end_of_word(false), frequency(0) {}
 };
@@ -33,6 +41,60 @@ struct TrieNode {
 class Trie {
 private:
     std::shared_ptr<TrieNode> root;
+    size_t cache_size; // K: completions cached per node
+
+    static bool ranksBefore(const TrieNode* a, const TrieNode* b) {
+        if (a->frequency != b->frequency) return a->frequency > b->frequency;
+        return a->value < b->value;
+    }
+
+    /**
+     * Moves word up in node's cache after its frequency grew (or it became
+     * a word). Other entries are unchanged, so this keeps the cache exact.
+     * Time Complexity: O(K)
+     */
+    void promote(TrieNode* node, const TrieNode* word) const {
+        auto& top = node->top_completions;
+        auto it = std::find(top.begin(), top.end(), word);
+        if (it == top.end()) {
+            if (top.size() >= cache_size) {
+                if (cache_size == 0 || !ranksBefore(word, top.back())) return;
+                top.pop_back();
+            }
+            top.push_back(word);
+            it = top.end() - 1;
+        }
+        while (it != top.begin() && ranksBefore(*it, *(it - 1))) {
+            std::iter_swap(it, it - 1);
+            --it;
+        }
+    }
+
+    /**
+     * Recomputes node's cache from its own word and its children's caches
+     * Time Complexity: O(K * fanout)
+     */
+    void rebuildCache(TrieNode* node) const {
+        std::vector<const TrieNode*> candidates;
+        if (node->is_end_of_word) candidates.push_back(node);
+        for (auto& it : node->children) {
+            const auto& child_top = it.second->top_completions;
+            candidates.insert(candidates.end(), child_top.begin(), child_top.end());
+        }
+        size_t keep = std::min(cache_size, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(), ranksBefore);
+        candidates.resize(keep);
+        node->top_completions = std::move(candidates);
+    }
+
+    static std::string toLower(const std::string& word) {
+        std::string lower_word;
+        lower_word.reserve(word.size());
+        for (char ch : word) {
+            lower_word.push_back(std::tolower(ch));
+        }
+        return lower_word;
+    }
 
     /**
      * Helper function to collect all words from a given node
@@ -75,6 +137,7 @@ private:
             node->is_end_of_word = false;
             node->value = "";
             node->frequency = 0;
+            rebuildCache(node.get());
             return node->children.empty();
         }
 
@@ -88,14 +151,15 @@ private:
 
         if (should_delete_child) {
             node->children.erase(it);
-            return !node->is_end_of_word && node->children.empty();
         }
+        rebuildCache(node.get());
 
-        return false;
+        return should_delete_child && !node->is_end_of_word && node->children.empty();
     }
 
 public:
-    Trie() : root(std::make_shared<TrieNode>()) {}
+    explicit Trie(size_t cached_completions = 10)
+        : root(std::make_shared<TrieNode>()), cache_size(cached_completions) {}
 
     /**
      * Inserts a word into the trie
@@ -103,23 +167,33 @@ public:
      */
     void insert(const std::string& word, const std::string& value = "", int frequency = 1) {
         auto current = root;
+        std::vector<TrieNode*> path = {root.get()};
 
         // Convert to lowercase for case-insensitive search
-        std::string lower_word;
-        for (char ch : word) {
-            lower_word.push_back(std::tolower(ch));
-        }
+        std::string lower_word = toLower(word);
 
         for (char ch : lower_word) {
-            if (current->children.find(ch) == current->children.end()) {
-                current->children[ch] = std::make_shared<TrieNode>();
+            auto& child = current->children[ch];
+            if (!child) {
+                child = std::make_shared<TrieNode>();
             }
-            current = current->children[ch];
+            current = child;
+            path.push_back(current.get());
         }
 
+        const std::string& new_value = value.empty() ? word : value;
+        bool reordered = current->is_end_of_word && (current->value != new_value || frequency < 0);
+
         current->is_end_of_word = true;
-        current->value = value.empty() ? word : value;
+        current->value = new_value;
         current->frequency += frequency;
+
+        // Renamed or demoted words can fall out of a cache: rebuild bottom-up
+        if (reordered) {
+            for (auto it = path.rbegin(); it != path.rend(); ++it) rebuildCache(*it);
+            return;
+        }
+        for (TrieNode* node : path) promote(node, current.get());
     }
 
     /**
@@ -129,10 +203,7 @@ public:
     bool search(const std::string& word) const {
         auto current = root;
 
-        std::string lower_word;
-        for (char ch : word) {
-            lower_word.push_back(std::tolower(ch));
-        }
+        std::string lower_word = toLower(word);
 
         for (char ch : lower_word) {
             auto it = current->children.find(ch);
@@ -152,10 +223,7 @@ public:
     bool startsWith(const std::string& prefix) const {
         auto current = root;
 
-        std::string lower_prefix;
-        for (char ch : prefix) {
-            lower_prefix.push_back(std::tolower(ch));
-        }
+        std::string lower_prefix = toLower(prefix);
 
         for (char ch : lower_prefix) {
             auto it = current->children.find(ch);
@@ -169,16 +237,15 @@ public:
     }
 
     /**
-     * Gets all words with given prefix (autocomplete)
-     * Time Complexity: O(m + k) where m=prefix length, k=number of results
+     * Gets the best words with given prefix (autocomplete), ranked by
+     * frequency then alphabetically
+     * Time Complexity: O(m + k) where m=prefix length, k=number of results;
+     * only requests for more than K results walk the subtree
      */
     std::vector<std::string> autocomplete(const std::string& prefix, int max_results = 10) const {
         auto current = root;
 
-        std::string lower_prefix;
-        for (char ch : prefix) {
-            lower_prefix.push_back(std::tolower(ch));
-        }
+        std::string lower_prefix = toLower(prefix);
 
         // Navigate to prefix node
         for (char ch : lower_prefix) {
@@ -189,6 +256,20 @@ public:
             current = it->second;
         }
 
+        if (max_results <= 0) return {};
+
+        // Served from the node's cache
+        if (static_cast<size_t>(max_results) <= cache_size) {
+            const auto& top = current->top_completions;
+            size_t count = std::min(top.size(), static_cast<size_t>(max_results));
+            std::vector<std::string> suggestions;
+            suggestions.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                suggestions.push_back(top[i]->value);
+            }
+            return suggestions;
+        }
+
         // Collect all words from this node
         std::vector<std::pair<std::string, int>> results;
         std::string temp = lower_prefix;
@@ -217,24 +298,19 @@ public:
      * Time Complexity: O(m) where m is word length
      */
     bool remove(const std::string& word) {
-        std::string lower_word;
-        for (char ch : word) {
-            lower_word.push_back(std::tolower(ch));
-        }
-        return deleteHelper(root, lower_word, 0);
+        return deleteHelper(root, toLower(word), 0);
     }
 
     /**
-     * Increments the frequency count for a word
-     * Time Complexity: O(m) where m is word length
+     * Increments the frequency count for a word and moves it up in the
+     * cached completions of every prefix
+     * Time Complexity: O(m * K) where m is word length
      */
     void incrementFrequency(const std::string& word) {
         auto current = root;
+        std::vector<TrieNode*> path = {root.get()};
 
-        std::string lower_word;
-        for (char ch : word) {
-            lower_word.push_back(std::tolower(ch));
-        }
+        std::string lower_word = toLower(word);
 
         for (char ch : lower_word) {
             auto it = current->children.find(ch);
@@ -242,10 +318,12 @@ public:
                 return; // Word not found
             }
             current = it->second;
+            path.push_back(current.get());
         }
 
         if (current->is_end_of_word) {
             current->frequency++;
+            for (TrieNode* node : path) promote(node, current.get());
         }
     }
 
@@ -257,6 +335,15 @@ public:
         root = std::make_shared<TrieNode>();
     }
 
+    // Read-only access for building a CompactTrie
+    const TrieNode* getRoot() const {
+        return root.get();
+    }
+
+    size_t getCacheSize() const {
+        return cache_size;
+    }
+
     /**
      * Checks if trie is empty
      * Time Complexity: O(1)
@@ -1,121 +1,263 @@
-#ifndef UNION_FIND_H
-#define UNION_FIND_H
-
-#include <unordered_map>
-#include <string>
-#include <vector>
-
-using namespace std;
-
-class UnionFind {
-private:
-    unordered_map<string, string> parent;
-    unordered_map<string, int> rank;
-    unordered_map<string, int> set_size;
-
-public:
-    string findConst(const string& user_id) const {
-        auto it = parent.find(user_id);
-        if (it == parent.end()) return string();
-        if (it->second == user_id) return it->second;
-        return findConst(it->second);
-    }
-
-    void makeSet(const string& user_id) {
-        if (parent.find(user_id) == parent.end()) {
-            parent[user_id] = user_id;
-            rank[user_id] = 0;
-            set_size[user_id] = 1;
-        }
-    }
-
-    string find(const string& user_id) {
-        if (parent.find(user_id) == parent.end()) {
-            makeSet(user_id);
-        }
-
-        // Path compression: make every node point directly to root
-        if (parent[user_id] != user_id) {
-            parent[user_id] = find(parent[user_id]);
-        }
-
-        return parent[user_id];
-    }
-
-    bool unionSets(const string& user1, const string& user2) {
-        string root1 = find(user1);
-        string root2 = find(user2);
-
-        // Already in same set
-        if (root1 == root2) {
-            return false;
-        }
-
-        // Union by rank: attach smaller tree under larger tree
-        if (rank[root1] < rank[root2]) {
-            parent[root1] = root2;
-            set_size[root2] += set_size[root1];
-        } else if (rank[root1] > rank[root2]) {
-            parent[root2] = root1;
-            set_size[root1] += set_size[root2];
-        } else {
-            parent[root2] = root1;
-            set_size[root1] += set_size[root2];
-            rank[root1]++;
-        }
-
-        return true;
-    }
-
-
-    bool connected(const string& user1, const string& user2) {
-        return find(user1) == find(user2);
-    }
-
-    string getCommunity(const string& user_id) {
-        return find(user_id);
-    }
-
-    int getCommunitySize(const string& user_id) {
-        string root = find(user_id);
-        return set_size[root];
-    }
-
-    vector<string> getCommunityMembers(const string& user_id) {
-        string target_root = find(user_id);
-        vector<string> members;
-
-        for (const auto& it : parent) {
-            auto & uid = it.first;
-            if (find(uid) == target_root) {
-                members.push_back(uid);
-            }
-        }
-
-        return members;
-    }
-
-    unordered_map<string, vector<string>> getAllCommunities() const{
-        unordered_map<string, vector<string>> communities;
-
-        for (const auto& p : parent) {
-        string root = findConst(p.first);
-        communities[root].push_back(p.first);
-        }
-
-        return communities;
-    }
-
-
-    int getNumberOfCommunities() const{
-        return getAllCommunities().size();
-    }
-
-    void clear() {
-        parent.clear();
-        rank.clear();
-        set_size.clear();
-    }
-};
-
-#endif
+#ifndef UNION_FIND_H
+#define UNION_FIND_H
+
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "../core/id_registry.h"
+#include "../core/snapshot.h"
+
+using namespace std;
+
+/**
+ * Union-Find (Disjoint Set) over dense user ids
+ *
+ * Besides parent/rank/size, every set keeps its members on a circular
+ * linked list (next_member), spliced in O(1) on union, so enumerating a
+ * community costs O(community size) and the number of communities is a
+ * counter.
+ *
+ * Time Complexities:
+ * - find / unionSets: O(α(n)) amortized
+ * - getCommunityMembers: O(community size)
+ * - getNumberOfCommunities: O(1)
+ * - split: O(community size)
+ */
+class UnionFind {
+private:
+    // Indexed by dense user id; INVALID_ID marks ids never added
+    vector<uint32_t> parent;
+    vector<int> rank;
+    vector<int> set_size;
+    vector<uint32_t> next_member; // next id in the same set, circular
+    int num_sets = 0;
+
+    bool contains(uint32_t user_id) const {
+        return user_id < parent.size() && parent[user_id] != INVALID_ID;
+    }
+
+public:
+    // Iterative, no compression (so usable from const queries)
+    uint32_t findConst(uint32_t user_id) const {
+        if (!contains(user_id)) return INVALID_ID;
+        while (parent[user_id] != user_id) user_id = parent[user_id];
+        return user_id;
+    }
+
+    void makeSet(uint32_t user_id) {
+        if (user_id >= parent.size()) {
+            parent.resize(user_id + 1, INVALID_ID);
+            rank.resize(user_id + 1, 0);
+            set_size.resize(user_id + 1, 0);
+            next_member.resize(user_id + 1, INVALID_ID);
+        }
+        if (parent[user_id] == INVALID_ID) {
+            parent[user_id] = user_id;
+            rank[user_id] = 0;
+            set_size[user_id] = 1;
+            next_member[user_id] = user_id;
+            num_sets++;
+        }
+    }
+
+    uint32_t find(uint32_t user_id) {
+        if (!contains(user_id)) {
+            makeSet(user_id);
+        }
+
+        uint32_t root = findConst(user_id);
+
+        // Path compression: make every node point directly to root
+        while (parent[user_id] != root) {
+            uint32_t next = parent[user_id];
+            parent[user_id] = root;
+            user_id = next;
+        }
+
+        return root;
+    }
+
+    bool unionSets(uint32_t user1, uint32_t user2) {
+        uint32_t root1 = find(user1);
+        uint32_t root2 = find(user2);
+
+        // Already in same set
+        if (root1 == root2) {
+            return false;
+        }
+
+        // Union by rank: attach smaller tree under larger tree
+        if (rank[root1] < rank[root2]) {
+            parent[root1] = root2;
+            set_size[root2] += set_size[root1];
+        } else if (rank[root1] > rank[root2]) {
+            parent[root2] = root1;
+            set_size[root1] += set_size[root2];
+        } else {
+            parent[root2] = root1;
+            set_size[root1] += set_size[root2];
+            rank[root1]++;
+        }
+
+        // Splice the two member circles into one
+        swap(next_member[root1], next_member[root2]);
+        num_sets--;
+
+        return true;
+    }
+
+    /**
+     * Turns every member of user_id's set back into a singleton and
+     * returns them, so the set can be re-united along the links that
+     * still hold (union-find cannot split a set otherwise).
+     *
+     * Time Complexity: O(set size)
+     */
+    vector<uint32_t> split(uint32_t user_id) {
+        vector<uint32_t> members = getCommunityMembers(user_id);
+        for (uint32_t member : members) {
+            parent[member] = member;
+            rank[member] = 0;
+            set_size[member] = 1;
+            next_member[member] = member;
+        }
+        num_sets += members.empty() ? 0 : static_cast<int>(members.size()) - 1;
+        return members;
+    }
+
+    // Read-only queries never compress paths, so they are safe to call
+    // concurrently once unions are done
+
+    bool connected(uint32_t user1, uint32_t user2) const {
+        return findConst(user1) == findConst(user2);
+    }
+
+    uint32_t getCommunity(uint32_t user_id) const {
+        return findConst(user_id);
+    }
+
+    int getCommunitySize(uint32_t user_id) const {
+        uint32_t root = findConst(user_id);
+        return root == INVALID_ID ? 0 : set_size[root];
+    }
+
+    // Calls fn(member) for every member of user_id's community, user_id first
+    template <typename Fn>
+    void forEachMember(uint32_t user_id, Fn fn) const {
+        if (!contains(user_id)) return;
+        uint32_t member = user_id;
+        do {
+            fn(member);
+            member = next_member[member];
+        } while (member != user_id);
+    }
+
+    // Members in circle order (not sorted)
+    vector<uint32_t> getCommunityMembers(uint32_t user_id) const {
+        vector<uint32_t> members;
+        if (!contains(user_id)) return members;
+        members.reserve(getCommunitySize(user_id));
+        forEachMember(user_id, [&](uint32_t member) { members.push_back(member); });
+        return members;
+    }
+
+    unordered_map<uint32_t, vector<uint32_t>> getAllCommunities() const{
+        unordered_map<uint32_t, vector<uint32_t>> communities;
+
+        for (uint32_t uid = 0; uid < parent.size(); ++uid) {
+        if (!contains(uid)) continue;
+        uint32_t root = findConst(uid);
+        communities[root].push_back(uid);
+        }
+
+        return communities;
+    }
+
+
+    int getNumberOfCommunities() const{
+        return num_sets;
+    }
+
+    void clear() {
+        parent.clear();
+        rank.clear();
+        set_size.clear();
+        next_member.clear();
+        num_sets = 0;
+    }
+
+    // Bytes held by the per-user arrays
+    size_t memoryUsage() const {
+        return (parent.capacity() + next_member.capacity()) * sizeof(uint32_t) +
+               (rank.capacity() + set_size.capacity()) * sizeof(int);
+    }
+
+    void save(SnapshotWriter& out, const string& prefix) const {
+        out.putArray(prefix + ".parent", parent);
+        out.putArray(prefix + ".rank", rank);
+        out.putArray(prefix + ".set_size", set_size);
+        out.putArray(prefix + ".next_member", next_member);
+        out.putValue(prefix + ".num_sets", static_cast<int64_t>(num_sets));
+    }
+
+    // Fails unless the arrays cover exactly num_users ids and form
+    // consistent sets
+    bool load(const SnapshotReader& in, const string& prefix, size_t num_users) {
+        clear();
+        int64_t sets = 0;
+        if (!in.getArray(prefix + ".parent", parent) || !in.getArray(prefix + ".rank", rank) ||
+            !in.getArray(prefix + ".set_size", set_size) || !in.getArray(prefix + ".next_member", next_member) ||
+            !in.getValue(prefix + ".num_sets", sets) || parent.size() != num_users ||
+            rank.size() != parent.size() || set_size.size() != parent.size() || next_member.size() != parent.size() ||
+            !consistent(sets)) {
+            clear();
+            return false;
+        }
+        num_sets = static_cast<int>(sets);
+        return true;
+    }
+
+private:
+    /**
+     * Whether loaded arrays form a forest of num sets (ranks rise towards
+     * each root, so parent links cannot cycle) whose member circles each
+     * hold exactly their set, with set_size matching.
+     */
+    bool consistent(int64_t num) const {
+        size_t n = parent.size();
+        vector<uint32_t> members(n, 0), preceding(n, 0);
+        int64_t roots = 0;
+        for (uint32_t u = 0; u < n; ++u) {
+            if (parent[u] == INVALID_ID) {
+                if (next_member[u] != INVALID_ID) return false;
+                continue;
+            }
+            uint32_t p = parent[u], next = next_member[u];
+            if (p >= n || parent[p] == INVALID_ID || (p != u && rank[p] <= rank[u]) || rank[u] < 0 ||
+                next >= n || parent[next] == INVALID_ID) {
+                return false;
+            }
+            if (p == u) roots++;
+            preceding[next]++;
+        }
+        for (uint32_t u = 0; u < n; ++u) {
+            if (parent[u] == INVALID_ID) continue;
+            uint32_t root = findConst(u);
+            if (preceding[u] != 1 || findConst(next_member[u]) != root) return false;
+            members[root]++;
+        }
+        for (uint32_t u = 0; u < n; ++u) {
+            if (!contains(u) || parent[u] != u) continue;
+            uint32_t length = 0, member = u;
+            do {
+                length++;
+                member = next_member[member];
+            } while (member != u && length <= n);
+            if (static_cast<int64_t>(length) != set_size[u] || members[u] != length) return false;
+        }
+        return roots == num;
+    }
+};
+
+#endif
@@ -1,189 +1,607 @@
-#ifndef WEIGHTED_GRAPH_H
-#define WEIGHTED_GRAPH_H
-
-#include <unordered_map>
-#include <vector>
-#include <queue>
-#include <string>
-#include <algorithm>
-#include <cmath>
-#include <set>
-
-using namespace std;
-
-struct Edge {
-    string to;
-    double weight;
-
-    Edge(const string& t, double w) : to(t), weight(w) {}
-
-    bool operator<(const Edge& other) const {
-        return weight < other.weight; // For min-heap
-    }
-};
-
-class WeightedGraph {
-private:
-    // Adjacency list representation
-    unordered_map<string, vector<Edge>> adj_list;
-
-public:
-    
-    void addVertex(const string& user_id) {
-        if (adj_list.find(user_id) == adj_list.end()) {
-            adj_list[user_id] = vector<Edge>();
-        }
-    }
-
-    void addEdge(const string& user1, const string& user2, double weight) {
-        addVertex(user1);
-        addVertex(user2);
-
-        adj_list[user1].push_back(Edge(user2, weight));
-        adj_list[user2].push_back(Edge(user1, weight));
-    }
-
-    double getEdgeWeight(const string& user1, const string& user2) const {
-        auto it = adj_list.find(user1);
-        if (it == adj_list.end()) return 0.0;
-
-        for (const auto& edge : it->second) {
-            if (edge.to == user2) {
-                return edge.weight;
-            }
-        }
-        return 0.0;
-    }
-
-    vector<pair<string, double>> getTopKSimilarUsers(
-        const string& user_id,
-        int k
-    ) const {
-        auto it = adj_list.find(user_id);
-        if (it == adj_list.end()) {
-            return {};
-        }
-
-        // Use priority queue to get top K (max-heap)
-        priority_queue<pair<double, string>> pq;
-
-        for (const auto& edge : it->second) {
-            pq.push({edge.weight, edge.to});
-        }
-
-        vector<pair<string, double>> result;
-        while (!pq.empty() && result.size() < static_cast<size_t>(k)) {
-            auto top = pq.top();
-            pq.pop();
-            result.push_back({top.second, top.first});
-        }
-
-        return result;
-    }
-
-    static double jaccardSimilarity(
-        const set<string>& set1,
-        const set<string>& set2
-    ) {
-        if (set1.empty() && set2.empty()) return 0.0;
-
-        // Count intersection
-        int intersection = 0;
-        for (const auto& item : set1) {
-            if (set2.find(item) != set2.end()) {
-                intersection++;
-            }
-        }
-
-        // Union size = size1 + size2 - intersection
-        int union_size = set1.size() + set2.size() - intersection;
-
-        return union_size > 0 ? static_cast<double>(intersection) / union_size : 0.0;
-    }
-
-    static double cosineSimilarity(
-        const unordered_map<string, int>& vec1,
-        const unordered_map<string, int>& vec2
-    ) {
-        if (vec1.empty() || vec2.empty()) return 0.0;
-
-        double dot_product = 0.0;
-        double norm1 = 0.0;
-        double norm2 = 0.0;
-
-        // Calculate dot product
-        for (const auto& it1 : vec1) {
-            auto& song_id = it1.first;
-            auto& count1 = it1.second;
-            auto it = vec2.find(song_id);
-            if (it != vec2.end()) {
-                dot_product += count1 * it->second;
-            }
-            norm1 += count1 * count1;
-        }
-
-        for (const auto& it : vec2) {
-            auto& song_id = it.first;
-            auto& count2 = it.second;
-            norm2 += count2 * count2;
-        }
-
-        if (norm1 == 0.0 || norm2 == 0.0) return 0.0;
-
-        return dot_product / (sqrt(norm1) * sqrt(norm2));
-    }
-
-    vector<pair<string, double>> getNeighbors(const string& user_id) const {
-        auto it = adj_list.find(user_id);
-        if (it == adj_list.end()) {
-            return {};
-        }
-
-        vector<pair<string, double>> neighbors;
-        for (const auto& edge : it->second) {
-            neighbors.push_back({edge.to, edge.weight});
-        }
-
-        // Sort by weight descending
-        sort(neighbors.begin(), neighbors.end(),
-            [](const auto& a, const auto& b) {
-                return a.second > b.second;
-            });
-
-        return neighbors;
-    }
-
-    int getVertexCount() const {
-        return adj_list.size();
-    }
-
-    int getEdgeCount() const {
-        int count = 0;
-        for (const auto& it : adj_list) {
-            auto& user = it.first;
-            auto& edges = it.second;
-            count += edges.size();
-        }
-        return count / 2; // Divide by 2 for undirected graph
-    }
-
-    bool hasVertex(const string& user_id) const {
-        return adj_list.find(user_id) != adj_list.end();
-    }
-
-    vector<string> getAllVertices() const {
-        vector<string> vertices;
-        for (const auto& it : adj_list) {
-            auto& user = it.first;
-            auto& score = it.second;
-            vertices.push_back(user);
-        }
-        return vertices;
-    }
-
-    void clear() {
-        adj_list.clear();
-    }
-};
-
-#endif
+#ifndef WEIGHTED_GRAPH_H
+#define WEIGHTED_GRAPH_H
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <cstdint>
+#include "../core/intersection_kernel.h"
+#include "../core/snapshot.h"
+
+using namespace std;
+
+struct Edge {
+    uint32_t to; // Dense user index
+    double weight;
+
+    Edge(uint32_t t, double w) : to(t), weight(w) {}
+
+    bool operator<(const Edge& other) const {
+        return weight < other.weight; // For min-heap
+    }
+};
+
+/**
+ * Read-only view of one vertex's neighbors in the frozen CSR graph,
+ * ordered by weight descending (ties: higher user id first).
+ * Valid until the graph is modified.
+ */
+struct NeighborList {
+    const uint32_t* ids;
+    const double* weights;
+    size_t count;
+
+    struct iterator {
+        const uint32_t* id;
+        const double* weight;
+
+        pair<uint32_t, double> operator*() const { return {*id, *weight}; }
+        iterator& operator++() { ++id; ++weight; return *this; }
+        bool operator!=(const iterator& other) const { return id != other.id; }
+    };
+
+    NeighborList() : ids(nullptr), weights(nullptr), count(0) {}
+    NeighborList(const uint32_t* i, const double* w, size_t n) : ids(i), weights(w), count(n) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint32_t id(size_t i) const { return ids[i]; }
+    double weight(size_t i) const { return weights[i]; }
+    iterator begin() const { return {ids, weights}; }
+    iterator end() const { return {ids + count, weights + count}; }
+};
+
+class WeightedGraph {
+private:
+    // Build-side adjacency list, indexed by dense user id
+    vector<vector<Edge>> adj_list;
+    vector<bool> present;
+    int vertex_count = 0;
+
+    // Keep at most this many neighbors per vertex (0 = keep all)
+    size_t max_neighbors = 0;
+    // Set once the cap dropped an edge from one row: u may then list v
+    // while v no longer lists u, and rows are not symmetric
+    bool asymmetric = false;
+
+    // Frozen compressed-sparse-row layout: the neighbors of u are the
+    // row_sizes[u] entries from row_offsets[u] in neighbor_ids /
+    // neighbor_weights, pre-sorted by weight descending. Row u has room
+    // for row_capacity[u] entries; replaceEdges rewrites a row in place
+    // while it fits and otherwise moves it to the end with twice the room.
+    // While packed, rows are back to back in id order with no slack and
+    // row_offsets[V] ends the last one, as in a snapshot.
+    bool frozen = false;
+    bool packed = true;
+    vector<uint32_t> row_offsets;
+    vector<uint32_t> row_sizes;
+    vector<uint32_t> row_capacity;
+    vector<uint32_t> neighbor_ids;
+    vector<double> neighbor_weights;
+    size_t live_entries = 0;
+
+    // Neighbor ranking: higher weight first, ties to the higher id
+    // (the order a max-heap of (weight, id) pops in)
+    static bool ranksAbove(const Edge& a, const Edge& b) {
+        if (a.weight != b.weight) return a.weight > b.weight;
+        return a.to > b.to;
+    }
+
+    // Bounded heap insert: with a cap, edges is a heap whose front is the
+    // weakest kept neighbor
+    void pushNeighbor(vector<Edge>& edges, const Edge& edge) {
+        if (max_neighbors == 0) {
+            edges.push_back(edge);
+        } else if (edges.size() < max_neighbors) {
+            edges.push_back(edge);
+            push_heap(edges.begin(), edges.end(), ranksAbove);
+        } else if (ranksAbove(edge, edges.front())) {
+            pop_heap(edges.begin(), edges.end(), ranksAbove);
+            edges.back() = edge;
+            push_heap(edges.begin(), edges.end(), ranksAbove);
+            asymmetric = true;
+        } else {
+            asymmetric = true;
+        }
+    }
+
+    // Whether row u lists v
+    bool hasEntry(uint32_t u, uint32_t v) const {
+        if (!frozen) {
+            if (u >= adj_list.size()) return false;
+            for (const auto& edge : adj_list[u]) {
+                if (edge.to == v) return true;
+            }
+            return false;
+        }
+        if (u >= row_sizes.size()) return false;
+        for (uint32_t i = row_offsets[u]; i < rowEnd(u); ++i) {
+            if (neighbor_ids[i] == v) return true;
+        }
+        return false;
+    }
+
+    uint32_t rowEnd(uint32_t u) const {
+        return row_offsets[u] + row_sizes[u];
+    }
+
+    // Adds an empty row for user_id to the frozen layout
+    void addVertexFrozen(uint32_t user_id) {
+        if (user_id >= present.size()) present.resize(user_id + 1, false);
+        if (row_offsets.empty()) row_offsets.push_back(0);
+        while (row_offsets.size() < present.size() + 1) row_offsets.push_back(row_offsets.back());
+        row_sizes.resize(present.size(), 0);
+        row_capacity.resize(present.size(), 0);
+        if (!present[user_id]) {
+            present[user_id] = true;
+            vertex_count++;
+        }
+    }
+
+    // Moves the CSR arrays back into adjacency lists so edges can be added
+    void thaw() {
+        adj_list.assign(present.size(), vector<Edge>());
+        for (uint32_t u = 0; u < row_sizes.size(); ++u) {
+            for (uint32_t i = row_offsets[u]; i < rowEnd(u); ++i) {
+                pushNeighbor(adj_list[u], Edge(neighbor_ids[i], neighbor_weights[i]));
+            }
+        }
+        clearFrozen();
+    }
+
+    void clearFrozen() {
+        row_offsets.clear();
+        row_sizes.clear();
+        row_capacity.clear();
+        neighbor_ids.clear();
+        neighbor_weights.clear();
+        live_entries = 0;
+        packed = true;
+        frozen = false;
+    }
+
+    // The rows back to back in id order, without slack
+    void packRows(vector<uint32_t>& offsets, vector<uint32_t>& ids, vector<double>& weights) const {
+        offsets.assign(row_sizes.size() + 1, 0);
+        ids.reserve(live_entries);
+        weights.reserve(live_entries);
+        for (uint32_t u = 0; u < row_sizes.size(); ++u) {
+            ids.insert(ids.end(), neighbor_ids.begin() + row_offsets[u], neighbor_ids.begin() + rowEnd(u));
+            weights.insert(weights.end(), neighbor_weights.begin() + row_offsets[u],
+                           neighbor_weights.begin() + rowEnd(u));
+            offsets[u + 1] = static_cast<uint32_t>(ids.size());
+        }
+    }
+
+    // Drops the slack and the space of moved rows
+    void compact() {
+        vector<uint32_t> offsets, ids;
+        vector<double> weights;
+        packRows(offsets, ids, weights);
+        row_offsets.swap(offsets);
+        neighbor_ids.swap(ids);
+        neighbor_weights.swap(weights);
+        row_capacity = row_sizes;
+        packed = true;
+    }
+
+    // Writes row u of the frozen layout, moving it to the end if it outgrew its room
+    void writeRow(uint32_t u, const vector<Edge>& row) {
+        if (row.size() > row_capacity[u]) {
+            size_t room = max(row.size(), 2 * static_cast<size_t>(row_capacity[u]));
+            row_offsets[u] = static_cast<uint32_t>(neighbor_ids.size());
+            row_capacity[u] = static_cast<uint32_t>(room);
+            neighbor_ids.resize(neighbor_ids.size() + room);
+            neighbor_weights.resize(neighbor_ids.size());
+            row_offsets.back() = static_cast<uint32_t>(neighbor_ids.size());
+            packed = false;
+        } else if (row.size() < row_sizes[u]) {
+            packed = false;
+        }
+        live_entries = live_entries - row_sizes[u] + row.size();
+        row_sizes[u] = static_cast<uint32_t>(row.size());
+        for (size_t i = 0; i < row.size(); ++i) {
+            neighbor_ids[row_offsets[u] + i] = row[i].to;
+            neighbor_weights[row_offsets[u] + i] = row[i].weight;
+        }
+    }
+
+    // Drops v from frozen row u, keeping the rest in order
+    void removeEntry(uint32_t u, uint32_t v) {
+        if (u >= row_sizes.size()) return;
+        uint32_t end = rowEnd(u);
+        for (uint32_t i = row_offsets[u]; i < end; ++i) {
+            if (neighbor_ids[i] != v) continue;
+            copy(neighbor_ids.begin() + i + 1, neighbor_ids.begin() + end, neighbor_ids.begin() + i);
+            copy(neighbor_weights.begin() + i + 1, neighbor_weights.begin() + end, neighbor_weights.begin() + i);
+            row_sizes[u]--;
+            live_entries--;
+            packed = false;
+            return;
+        }
+    }
+
+public:
+
+    /**
+     * Caps each vertex at its top-m neighbors by weight (0 = unlimited).
+     * Applies to edges added afterwards. The cap is per row, so under a
+     * cap the graph is directed: u keeps v among its top-m even if v,
+     * with stronger neighbors, dropped u.
+     */
+    void setMaxNeighbors(size_t m) {
+        max_neighbors = m;
+    }
+
+    size_t getMaxNeighbors() const {
+        return max_neighbors;
+    }
+    
+    void addVertex(uint32_t user_id) {
+        if (frozen) thaw();
+        if (user_id >= adj_list.size()) {
+            adj_list.resize(user_id + 1);
+            present.resize(user_id + 1, false);
+        }
+        if (!present[user_id]) {
+            present[user_id] = true;
+            vertex_count++;
+        }
+    }
+
+    void addEdge(uint32_t user1, uint32_t user2, double weight) {
+        addVertex(user1);
+        addVertex(user2);
+
+        pushNeighbor(adj_list[user1], Edge(user2, weight));
+        pushNeighbor(adj_list[user2], Edge(user1, weight));
+    }
+
+    /**
+     * Freezes the graph into CSR form with each row sorted by weight
+     * descending. Query methods read the frozen layout, so call this after
+     * the last addEdge; adding edges later thaws the graph again.
+     * Time Complexity: O(V + E log d) where d is max degree
+     */
+    void freeze() {
+        if (frozen) return;
+
+        size_t total = 0;
+        for (const auto& edges : adj_list) total += edges.size();
+
+        row_offsets.assign(adj_list.size() + 1, 0);
+        row_sizes.assign(adj_list.size(), 0);
+        neighbor_ids.clear();
+        neighbor_weights.clear();
+        neighbor_ids.reserve(total);
+        neighbor_weights.reserve(total);
+
+        for (uint32_t u = 0; u < adj_list.size(); ++u) {
+            auto& edges = adj_list[u];
+            sort(edges.begin(), edges.end(), ranksAbove);
+            for (const auto& edge : edges) {
+                neighbor_ids.push_back(edge.to);
+                neighbor_weights.push_back(edge.weight);
+            }
+            row_offsets[u + 1] = static_cast<uint32_t>(neighbor_ids.size());
+            row_sizes[u] = static_cast<uint32_t>(edges.size());
+        }
+        row_capacity = row_sizes;
+        live_entries = total;
+        packed = true;
+
+        vector<vector<Edge>>().swap(adj_list);
+        frozen = true;
+    }
+
+    bool isFrozen() const {
+        return frozen;
+    }
+
+    /**
+     * Replaces every edge of user with edges (neighbor, weight) in the
+     * frozen layout, rewriting only the rows of user and its old and new
+     * neighbors. Freezes first if needed. With a neighbor cap, an edge a
+     * row dropped earlier cannot come back when a kept one weakens, so
+     * capped rows are approximate until the next full rebuild.
+     * Time Complexity: O(sum of d log d over the touched rows) amortized;
+     * the O(V + E) compaction runs once moved rows and slack outgrow the
+     * live entries plus one per vertex
+     */
+    void replaceEdges(uint32_t user, const vector<pair<uint32_t, double>>& edges) {
+        if (!frozen) freeze();
+        addVertexFrozen(user);
+        for (const auto& e : edges) addVertexFrozen(e.first);
+
+        // New contents of every touched row
+        unordered_map<uint32_t, vector<Edge>> rows;
+        auto& own = rows[user];
+        for (const auto& e : edges) {
+            if (e.first != user) own.push_back(Edge(e.first, e.second));
+        }
+        auto touch = [&](uint32_t v) -> vector<Edge>& {
+            auto it = rows.find(v);
+            if (it != rows.end()) return it->second;
+            auto& row = rows[v];
+            for (uint32_t i = row_offsets[v]; i < rowEnd(v); ++i) {
+                if (neighbor_ids[i] != user) row.push_back(Edge(neighbor_ids[i], neighbor_weights[i]));
+            }
+            return row;
+        };
+        for (uint32_t i = row_offsets[user]; i < rowEnd(user); ++i) touch(neighbor_ids[i]);
+        for (const auto& e : own) touch(e.to).push_back(Edge(user, e.weight));
+
+        for (auto& entry : rows) {
+            auto& row = entry.second;
+            sort(row.begin(), row.end(), ranksAbove);
+            if (max_neighbors > 0 && row.size() > max_neighbors) {
+                row.erase(row.begin() + max_neighbors, row.end());
+                asymmetric = true;
+            }
+            writeRow(entry.first, row);
+        }
+        if (neighbor_ids.size() > 2 * live_entries + row_sizes.size()) compact();
+    }
+
+    /**
+     * Adds an edge user1 - user2 absent from the frozen layout in place,
+     * rewriting just the two rows. Freezes first if needed; under a cap,
+     * a row's weakest neighbor drops out as in replaceEdges().
+     * Time Complexity: O(d log d) for the two rows amortized
+     */
+    void insertEdge(uint32_t user1, uint32_t user2, double weight) {
+        if (!frozen) freeze();
+        addVertexFrozen(user1);
+        addVertexFrozen(user2);
+        for (uint32_t u : {user1, user2}) {
+            vector<Edge> row;
+            for (uint32_t i = row_offsets[u]; i < rowEnd(u); ++i) row.push_back(Edge(neighbor_ids[i], neighbor_weights[i]));
+            Edge added(u == user1 ? user2 : user1, weight);
+            row.insert(upper_bound(row.begin(), row.end(), added, ranksAbove), added);
+            if (max_neighbors > 0 && row.size() > max_neighbors) {
+                row.pop_back();
+                asymmetric = true;
+            }
+            writeRow(u, row);
+        }
+        if (neighbor_ids.size() > 2 * live_entries + row_sizes.size()) compact();
+    }
+
+    /**
+     * Removes the edge between user1 and user2, if any, from the frozen
+     * layout in place. Freezes first if needed.
+     * Time Complexity: O(d) for the two rows
+     */
+    void removeEdge(uint32_t user1, uint32_t user2) {
+        if (!frozen) freeze();
+        removeEntry(user1, user2);
+        removeEntry(user2, user1);
+        if (neighbor_ids.size() > 2 * live_entries + row_sizes.size()) compact();
+    }
+
+    double getEdgeWeight(uint32_t user1, uint32_t user2) const {
+        for (auto edge : getNeighbors(user1)) {
+            if (edge.first == user2) {
+                return edge.second;
+            }
+        }
+        return 0.0;
+    }
+
+    /**
+     * Top-k neighbors as a slice of the frozen row
+     * Time Complexity: O(1), no allocation
+     */
+    NeighborList getTopKSimilarUsers(
+        uint32_t user_id,
+        int k
+    ) const {
+        NeighborList all = getNeighbors(user_id);
+        size_t n = k < 0 ? 0 : min(all.size(), static_cast<size_t>(k));
+        return NeighborList(all.ids, all.weights, n);
+    }
+
+    static double jaccardSimilarity(
+        const set<uint32_t>& set1,
+        const set<uint32_t>& set2
+    ) {
+        if (set1.empty() && set2.empty()) return 0.0;
+
+        // Count intersection
+        int intersection = 0;
+        for (const auto& item : set1) {
+            if (set2.find(item) != set2.end()) {
+                intersection++;
+            }
+        }
+
+        // Union size = size1 + size2 - intersection
+        int union_size = set1.size() + set2.size() - intersection;
+
+        return union_size > 0 ? static_cast<double>(intersection) / union_size : 0.0;
+    }
+
+    // Same as above for sorted, duplicate-free id vectors (SIMD intersection)
+    static double jaccardSimilarity(
+        const vector<uint32_t>& set1,
+        const vector<uint32_t>& set2
+    ) {
+        if (set1.empty() && set2.empty()) return 0.0;
+
+        int intersection = static_cast<int>(intersection_kernel::count(
+            set1.data(), set1.size(), set2.data(), set2.size()));
+
+        int union_size = set1.size() + set2.size() - intersection;
+
+        return union_size > 0 ? static_cast<double>(intersection) / union_size : 0.0;
+    }
+
+    static double cosineSimilarity(
+        const unordered_map<uint32_t, int>& vec1,
+        const unordered_map<uint32_t, int>& vec2
+    ) {
+        if (vec1.empty() || vec2.empty()) return 0.0;
+
+        double dot_product = 0.0;
+        double norm1 = 0.0;
+        double norm2 = 0.0;
+
+        // Calculate dot product
+        for (const auto& it1 : vec1) {
+            auto& song_id = it1.first;
+            auto& count1 = it1.second;
+            auto it = vec2.find(song_id);
+            if (it != vec2.end()) {
+                dot_product += count1 * it->second;
+            }
+            norm1 += count1 * count1;
+        }
+
+        for (const auto& it : vec2) {
+            auto& count2 = it.second;
+            norm2 += count2 * count2;
+        }
+
+        if (norm1 == 0.0 || norm2 == 0.0) return 0.0;
+
+        return dot_product / (sqrt(norm1) * sqrt(norm2));
+    }
+
+    // All neighbors, sorted by weight descending
+    NeighborList getNeighbors(uint32_t user_id) const {
+        if (!frozen || !hasVertex(user_id) || user_id >= row_sizes.size()) {
+            return NeighborList();
+        }
+
+        uint32_t begin = row_offsets[user_id];
+        return NeighborList(neighbor_ids.data() + begin, neighbor_weights.data() + begin, row_sizes[user_id]);
+    }
+
+    int getVertexCount() const {
+        return vertex_count;
+    }
+
+    /**
+     * Linked user pairs. Uncapped, every edge is stored in both rows;
+     * once a cap made rows asymmetric, a pair listed by only one of its
+     * endpoints counts once too.
+     * Time Complexity: O(E), or O(E * m) under a cap of m
+     */
+    int getEdgeCount() const {
+        size_t entries = live_entries;
+        for (const auto& edges : adj_list) {
+            entries += edges.size();
+        }
+        if (!asymmetric) return static_cast<int>(entries / 2);
+
+        size_t one_sided = 0;
+        auto count = [&](uint32_t u, uint32_t v) {
+            if (!hasEntry(v, u)) one_sided++;
+        };
+        if (frozen) {
+            for (uint32_t u = 0; u < row_sizes.size(); ++u) {
+                for (uint32_t i = row_offsets[u]; i < rowEnd(u); ++i) count(u, neighbor_ids[i]);
+            }
+        } else {
+            for (uint32_t u = 0; u < adj_list.size(); ++u) {
+                for (const auto& edge : adj_list[u]) count(u, edge.to);
+            }
+        }
+        // Mutual pairs are stored twice, one-sided ones once
+        return static_cast<int>((entries - one_sided) / 2 + one_sided);
+    }
+
+    // Bytes held by the adjacency lists and CSR arrays
+    size_t memoryUsage() const {
+        size_t bytes = adj_list.capacity() * sizeof(vector<Edge>) + present.capacity() / 8 +
+                       (row_offsets.capacity() + row_sizes.capacity() + row_capacity.capacity()) * sizeof(uint32_t) +
+                       neighbor_ids.capacity() * sizeof(uint32_t) +
+                       neighbor_weights.capacity() * sizeof(double);
+        for (const auto& edges : adj_list) bytes += edges.capacity() * sizeof(Edge);
+        return bytes;
+    }
+
+    bool hasVertex(uint32_t user_id) const {
+        return user_id < present.size() && present[user_id];
+    }
+
+    vector<uint32_t> getAllVertices() const {
+        vector<uint32_t> vertices;
+        for (uint32_t u = 0; u < present.size(); ++u) {
+            if (present[u]) vertices.push_back(u);
+        }
+        return vertices;
+    }
+
+    void clear() {
+        adj_list.clear();
+        present.clear();
+        vertex_count = 0;
+        clearFrozen();
+        asymmetric = false;
+    }
+
+    // Writes the frozen CSR layout, packed; call after freeze()
+    void save(SnapshotWriter& out, const string& prefix) const {
+        vector<uint8_t> vertices(present.begin(), present.end());
+        out.putArrayCopy(prefix + ".present", vertices);
+        out.putValue(prefix + ".max_neighbors", static_cast<uint64_t>(max_neighbors));
+        if (packed) {
+            out.putArray(prefix + ".row_offsets", row_offsets);
+            out.putArray(prefix + ".neighbor_ids", neighbor_ids);
+            out.putArray(prefix + ".neighbor_weights", neighbor_weights);
+            return;
+        }
+        vector<uint32_t> offsets, ids;
+        vector<double> weights;
+        packRows(offsets, ids, weights);
+        out.putArrayCopy(prefix + ".row_offsets", offsets);
+        out.putArrayCopy(prefix + ".neighbor_ids", ids);
+        out.putArrayCopy(prefix + ".neighbor_weights", weights);
+    }
+
+    // Fails on offsets out of range or vertex ids at or above num_users
+    bool load(const SnapshotReader& in, const string& prefix, size_t num_users) {
+        clear();
+        vector<uint8_t> vertices;
+        uint64_t cap = 0;
+        if (!in.getArray(prefix + ".present", vertices) ||
+            !in.getValue(prefix + ".max_neighbors", cap) ||
+            !in.getArray(prefix + ".row_offsets", row_offsets) ||
+            !in.getArray(prefix + ".neighbor_ids", neighbor_ids) ||
+            !in.getArray(prefix + ".neighbor_weights", neighbor_weights) ||
+            vertices.size() > num_users || neighbor_ids.size() != neighbor_weights.size() ||
+            !snapshot::validOffsets(row_offsets, neighbor_ids.size()) ||
+            (!row_offsets.empty() && row_offsets.size() != vertices.size() + 1)) {
+            clear();
+            return false;
+        }
+        // Rows list present vertices other than their own
+        row_sizes.assign(row_offsets.empty() ? 0 : row_offsets.size() - 1, 0);
+        for (uint32_t u = 0; u < row_sizes.size(); ++u) {
+            bool ok = true;
+            for (uint32_t i = row_offsets[u]; ok && i < row_offsets[u + 1]; ++i) {
+                uint32_t v = neighbor_ids[i];
+                ok = v < vertices.size() && vertices[v] && v != u;
+            }
+            if (!ok) {
+                clear();
+                return false;
+            }
+            row_sizes[u] = row_offsets[u + 1] - row_offsets[u];
+        }
+        row_capacity = row_sizes;
+        live_entries = neighbor_ids.size();
+        present.assign(vertices.begin(), vertices.end());
+        vertex_count = static_cast<int>(count(present.begin(), present.end(), true));
+        max_neighbors = static_cast<size_t>(cap);
+        asymmetric = cap > 0; // unknown whether the cap dropped an edge
+        frozen = true;
+        return true;
+    }
+};
+
+#endif
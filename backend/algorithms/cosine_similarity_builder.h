@@ -0,0 +1,578 @@
+#ifndef COSINE_SIMILARITY_BUILDER_H
+#define COSINE_SIMILARITY_BUILDER_H
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "../core/thread_pool.h"
+#include "../core/snapshot.h"
+#include "user_similarity_builder.h"
+
+using namespace std;
+
+/**
+ * Play-count weighted cosine similarity as a sparse matrix product
+ *
+ * Users' play counts form a sparse user x song matrix R in CSR form with
+ * rows pre-normalized to unit length, plus its transpose (song -> players).
+ * Row u of R * R^T, the cosine of u with every user sharing a played
+ * song, is accumulated Gustavson-style: for each song of u, its column is
+ * scaled into a dense per-worker accumulator, so no pair is looked up in
+ * a hash map (WeightedGraph::cosineSimilarity does one per song).
+ *
+ * Rows are processed in blocks of BLOCK_ROWS, claimed by the pool's
+ * workers. Each row keeps its top_k neighbors plus every neighbor at or
+ * above keep_threshold (so communities see the unpruned links); the
+ * graph gets the union over both endpoints' rows.
+ *
+ * Time Complexity: O(sum over songs of players^2) multiply-adds, the
+ * same pairs the Jaccard build scores, plus O(U * top_k log(U * top_k))
+ * to merge the kept edges
+ *
+ * Edges are emitted in (u1 asc, u2 asc) order, and every norm and cosine
+ * sums its songs in ascending order, so serial and parallel builds are
+ * identical, and a row rescored from normalizedRow()s in the same order
+ * matches them bit for bit.
+ */
+class CosineSimilarityBuilder {
+public:
+    /**
+     * Which neighbors each row kept, for incremental rescoring: kept[u]
+     * ascending with their cosines in kept_weights[u] (the lowest is
+     * weakest[u]), and truncated[u] if u's row dropped any (they all rank
+     * below every kept one). The graph holds an edge kept by either row.
+     */
+    struct Retention {
+        size_t top_k = 0;       // the rule the rows were pruned with
+        double threshold = 0.0;
+        vector<vector<uint32_t>> kept;
+        vector<vector<double>> kept_weights;
+        vector<double> weakest;
+        vector<uint8_t> truncated;
+    };
+
+private:
+    static constexpr size_t BLOCK_ROWS = 256;
+
+    size_t num_users = 0;
+    size_t top_k;
+    double keep_threshold;
+
+    // R: row u holds (song, plays / |plays of u|) for songs [row_offsets[u], row_offsets[u + 1])
+    vector<uint32_t> row_offsets;
+    vector<uint32_t> row_songs;
+    vector<double> row_values;
+
+    // R^T: column s holds (user, value) sorted by user
+    vector<uint32_t> col_offsets;
+    vector<uint32_t> col_users;
+    vector<double> col_values;
+
+    // Dense accumulator over users, reset through its touched list
+    struct RowScratch {
+        vector<double> dot;
+        vector<uint32_t> touched;
+        vector<pair<uint32_t, double>> kept;
+    };
+
+    // Cosine of u with every co-player, pruned to the kept neighbors.
+    // Appends (min, max, weight) edges; returns the co-players scored.
+    size_t scoreRow(uint32_t u, RowScratch& scratch, vector<SimilarityEdge>& out, Retention* retention) const {
+        if (scratch.dot.size() < num_users) scratch.dot.assign(num_users, 0.0);
+        scratch.touched.clear();
+        for (uint32_t i = row_offsets[u]; i < row_offsets[u + 1]; ++i) {
+            uint32_t sid = row_songs[i];
+            double value = row_values[i];
+            for (uint32_t j = col_offsets[sid]; j < col_offsets[sid + 1]; ++j) {
+                uint32_t v = col_users[j];
+                if (v == u) continue;
+                if (scratch.dot[v] == 0.0) scratch.touched.push_back(v);
+                scratch.dot[v] += value * col_values[j];
+            }
+        }
+
+        auto &kept = scratch.kept;
+        kept.clear();
+        for (uint32_t v : scratch.touched) {
+            kept.push_back({v, scratch.dot[v]});
+            scratch.dot[v] = 0.0;
+        }
+        bool truncated = prune(kept, top_k, keep_threshold);
+        for (const auto &e : kept) {
+            out.emplace_back(min(u, e.first), max(u, e.first), e.second);
+        }
+        if (retention) retain(*retention, u, kept, truncated);
+        return scratch.touched.size();
+    }
+
+    void resetRetention(Retention* retention) const {
+        if (!retention) return;
+        retention->top_k = top_k;
+        retention->threshold = keep_threshold;
+        retention->kept.assign(num_users, {});
+        retention->kept_weights.assign(num_users, {});
+        retention->weakest.assign(num_users, 0.0);
+        retention->truncated.assign(num_users, 0);
+    }
+
+    // Sorts and deduplicates one set of rows' edges, then emits them
+    template <typename EmitFn>
+    static void emitSorted(vector<SimilarityEdge>& edges, EmitFn& emit) {
+        sort(edges.begin(), edges.end(), [](const SimilarityEdge& a, const SimilarityEdge& b) {
+            return a.u1 != b.u1 ? a.u1 < b.u1 : a.u2 < b.u2;
+        });
+        for (size_t i = 0; i < edges.size(); ++i) {
+            if (i > 0 && edges[i].u1 == edges[i - 1].u1 && edges[i].u2 == edges[i - 1].u2) continue;
+            emit(edges[i].u1, edges[i].u2, edges[i].weight);
+        }
+    }
+
+public:
+    // Neighbor ranking of WeightedGraph: higher weight first, ties to the higher id
+    static bool ranksAbove(const pair<uint32_t, double>& a, const pair<uint32_t, double>& b) {
+        if (a.second != b.second) return a.second > b.second;
+        return a.first > b.first;
+    }
+
+    /**
+     * The retention rule: keeps links at or above threshold plus the best
+     * others, up to top_k in all (0 = keep all), i.e. the top_k plus every
+     * strong link. Returns whether anything was dropped.
+     */
+    static bool prune(vector<pair<uint32_t, double>>& row, size_t top_k, double threshold) {
+        auto weak = partition(row.begin(), row.end(),
+            [threshold](const pair<uint32_t, double>& e) { return e.second >= threshold; });
+        size_t strong = static_cast<size_t>(weak - row.begin());
+        if (top_k == 0 || row.size() <= max(top_k, strong)) return false;
+        size_t weak_kept = top_k > strong ? top_k - strong : 0;
+        nth_element(weak, weak + weak_kept, row.end(), ranksAbove);
+        row.resize(strong + weak_kept);
+        return true;
+    }
+
+    // Records pruned row u (reordered by id) in retention
+    static void retain(Retention& retention, uint32_t u, vector<pair<uint32_t, double>>& row, bool truncated) {
+        sort(row.begin(), row.end());
+        auto &ids = retention.kept[u];
+        auto &weights = retention.kept_weights[u];
+        ids.clear();
+        weights.clear();
+        for (const auto &e : row) {
+            ids.push_back(e.first);
+            weights.push_back(e.second);
+        }
+        retention.weakest[u] = weights.empty() ? 0.0 : *min_element(weights.begin(), weights.end());
+        retention.truncated[u] = truncated;
+    }
+
+    // A user's row of R, (song, plays / norm) by ascending song for
+    // positive counts; returns the norm
+    static double normalizedRow(const unordered_map<uint32_t, int>& plays, vector<pair<uint32_t, double>>& out) {
+        vector<pair<uint32_t, int>> row;
+        for (const auto &p : plays) {
+            if (p.second > 0) row.push_back(p);
+        }
+        sort(row.begin(), row.end());
+        double norm = 0.0;
+        for (const auto &p : row) norm += static_cast<double>(p.second) * p.second;
+        norm = sqrt(norm);
+        out.clear();
+        for (const auto &p : row) out.push_back({p.first, p.second / norm});
+        return norm;
+    }
+
+    /**
+     * plays[u] maps song -> play count (songs < num_songs); counts that
+     * are not positive are ignored. top_k = 0 keeps every nonzero cosine.
+     */
+    CosineSimilarityBuilder(const vector<unordered_map<uint32_t, int>>& plays, size_t num_songs,
+                            size_t k = 0, double threshold = 1.0)
+        : num_users(plays.size()), top_k(k), keep_threshold(threshold) {
+        row_offsets.assign(num_users + 1, 0);
+        col_offsets.assign(num_songs + 1, 0);
+        vector<pair<uint32_t, double>> row;
+        for (uint32_t u = 0; u < num_users; ++u) {
+            normalizedRow(plays[u], row);
+            for (const auto &p : row) {
+                row_songs.push_back(p.first);
+                row_values.push_back(p.second);
+                col_offsets[p.first + 1]++;
+            }
+            row_offsets[u + 1] = static_cast<uint32_t>(row_songs.size());
+        }
+
+        for (size_t s = 0; s < num_songs; ++s) col_offsets[s + 1] += col_offsets[s];
+        col_users.resize(row_songs.size());
+        col_values.resize(row_songs.size());
+        vector<uint32_t> cursor(col_offsets.begin(), col_offsets.end() - 1);
+        for (uint32_t u = 0; u < num_users; ++u) {
+            for (uint32_t i = row_offsets[u]; i < row_offsets[u + 1]; ++i) {
+                uint32_t at = cursor[row_songs[i]]++;
+                col_users[at] = u;
+                col_values[at] = row_values[i];
+            }
+        }
+    }
+
+    uint32_t getUserCount() const {
+        return static_cast<uint32_t>(num_users);
+    }
+
+    // Nonzero entries of R
+    size_t getNonZeros() const {
+        return row_songs.size();
+    }
+
+    size_t memoryUsage() const {
+        return (row_offsets.size() + row_songs.size() + col_offsets.size() + col_users.size()) * sizeof(uint32_t)
+             + (row_values.size() + col_values.size()) * sizeof(double);
+    }
+
+    /**
+     * Serial build; emit(u1, u2, cosine) is called once per kept pair,
+     * u1 < u2, in ascending order. Returns the number of distinct pairs
+     * scored. Fills retention, if given.
+     */
+    template <typename EmitFn>
+    size_t build(EmitFn&& emit, Retention* retention = nullptr) const {
+        resetRetention(retention);
+        RowScratch scratch;
+        vector<SimilarityEdge> edges;
+        size_t scored = 0;
+        for (uint32_t u = 0; u < num_users; ++u) scored += scoreRow(u, scratch, edges, retention);
+        emitSorted(edges, emit);
+        return scored / 2;
+    }
+
+    // Parallel build over row blocks, same output as build()
+    template <typename EmitFn>
+    size_t buildParallel(ThreadPool& pool, EmitFn&& emit, Retention* retention = nullptr) const {
+        resetRetention(retention);
+        if (num_users == 0) return 0;
+        size_t num_blocks = (num_users + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        vector<vector<SimilarityEdge>> block_edges(num_blocks);
+        vector<size_t> block_scored(num_blocks, 0);
+        vector<RowScratch> scratch(pool.size());
+
+        pool.parallelFor(num_blocks, [&](size_t block, size_t slot) {
+            uint32_t begin = static_cast<uint32_t>(block * BLOCK_ROWS);
+            uint32_t end = static_cast<uint32_t>(min(num_users, (block + 1) * BLOCK_ROWS));
+            for (uint32_t u = begin; u < end; ++u) {
+                block_scored[block] += scoreRow(u, scratch[slot], block_edges[block], retention);
+            }
+        });
+
+        size_t scored = 0, total = 0;
+        for (size_t block = 0; block < num_blocks; ++block) {
+            scored += block_scored[block];
+            total += block_edges[block].size();
+        }
+        vector<SimilarityEdge> edges;
+        edges.reserve(total);
+        for (auto &block : block_edges) {
+            edges.insert(edges.end(), block.begin(), block.end());
+            vector<SimilarityEdge>().swap(block);
+        }
+        emitSorted(edges, emit);
+        return scored / 2;
+    }
+};
+
+/**
+ * Incremental state of a COSINE graph, the counterpart of MinHashIndex
+ *
+ * Holds R (rows[u]: (song, plays / norm) by ascending song) and R^T
+ * (columns[s]: (user, value) by ascending user) in editable form, and
+ * which links every row kept in the build (Retention). The graph holds
+ * each link kept by either endpoint's row.
+ *
+ * update() re-normalizes one user's row and applies the build's
+ * retention rule (CosineSimilarityBuilder::prune) to it and to every
+ * co-player row whose link to the user changed, reporting the resulting
+ * graph changes without reading the graph. Cosines sum their products
+ * in the same order as the build, so the graph stays what a rebuild
+ * would produce, bit for bit.
+ *
+ * Time Complexity of update(): O(P log P) for the P products of the
+ * user's row, plus O(k log k) per co-player keeping it or reaching its
+ * top-k, plus a row rescore for each co-player whose dropped links may
+ * move up
+ */
+class CosineIndex {
+public:
+    using Link = pair<uint32_t, double>;
+
+    // What one update() changed in the graph
+    struct Update {
+        vector<uint32_t> candidates;               // co-players before or after, ascending
+        vector<Link> row;                          // the user's new edges, ascending
+        vector<pair<uint32_t, uint32_t>> unlinked; // other edges (u1 < u2) no row keeps any more
+        vector<SimilarityEdge> linked;             // other edges a row now keeps
+    };
+
+private:
+    struct SnapshotOptions {
+        uint64_t top_k;
+        double threshold;
+    };
+
+    CosineSimilarityBuilder::Retention retention;
+    vector<vector<Link>> rows;
+    vector<vector<Link>> columns;
+
+    void index(const vector<unordered_map<uint32_t, int>>& plays, size_t num_songs) {
+        rows.assign(plays.size(), {});
+        columns.assign(num_songs, {});
+        for (uint32_t u = 0; u < plays.size(); ++u) {
+            CosineSimilarityBuilder::normalizedRow(plays[u], rows[u]);
+            for (const auto &e : rows[u]) columns[e.first].push_back({u, e.second});
+        }
+    }
+
+    void grow(size_t num_users) {
+        if (rows.size() >= num_users) return;
+        rows.resize(num_users);
+        retention.kept.resize(num_users);
+        retention.kept_weights.resize(num_users);
+        retention.weakest.resize(num_users, 0.0);
+        retention.truncated.resize(num_users, 0);
+    }
+
+    bool keeps(uint32_t u, uint32_t v) const {
+        const auto &ids = retention.kept[u];
+        return binary_search(ids.begin(), ids.end(), v);
+    }
+
+    double keptWeight(uint32_t u, uint32_t v) const {
+        const auto &ids = retention.kept[u];
+        return retention.kept_weights[u][lower_bound(ids.begin(), ids.end(), v) - ids.begin()];
+    }
+
+    // Every nonzero cosine of u, by ascending id. Each pair's products
+    // are summed in u's song order, as the build accumulates them.
+    void scoreRow(uint32_t u, vector<Link>& out) const {
+        vector<Link> products;
+        for (const auto &e : rows[u]) {
+            for (const auto &p : columns[e.first]) {
+                if (p.first != u) products.push_back({p.first, e.second * p.second});
+            }
+        }
+        stable_sort(products.begin(), products.end(),
+            [](const Link& a, const Link& b) { return a.first < b.first; });
+        out.clear();
+        for (const auto &p : products) {
+            if (!out.empty() && out.back().first == p.first) out.back().second += p.second;
+            else out.push_back(p);
+        }
+    }
+
+    // Records v's new kept links; appends (v, w) for every w != u that v
+    // started or stopped keeping
+    void keep(uint32_t v, vector<Link>& next, bool truncated, uint32_t u, vector<pair<uint32_t, uint32_t>>& toggled) {
+        vector<uint32_t> before = retention.kept[v];
+        CosineSimilarityBuilder::retain(retention, v, next, truncated);
+        const auto &after = retention.kept[v];
+        vector<uint32_t> changed;
+        set_symmetric_difference(before.begin(), before.end(), after.begin(), after.end(), back_inserter(changed));
+        for (uint32_t w : changed) {
+            if (w != u) toggled.push_back({v, w});
+        }
+    }
+
+    // Applies the retention rule to the rows of u's co-players, whose
+    // link to u now weighs what u's row says
+    void retainCoPlayers(uint32_t u, const vector<uint32_t>& candidates, const vector<Link>& row,
+                         vector<pair<uint32_t, uint32_t>>& toggled) {
+        auto ranksAbove = CosineSimilarityBuilder::ranksAbove;
+        size_t k = retention.top_k;
+        double threshold = retention.threshold;
+        vector<Link> known, next;
+        size_t e = 0;
+        for (uint32_t v : candidates) {
+            while (e < row.size() && row[e].first < v) ++e;
+            double weight = e < row.size() && row[e].first == v ? row[e].second : 0.0;
+            const auto &ids = retention.kept[v];
+            auto &weights = retention.kept_weights[v];
+            bool truncated = retention.truncated[v] != 0;
+            auto pos = lower_bound(ids.begin(), ids.end(), u);
+            bool had = pos != ids.end() && *pos == u;
+            if (!had && (weight == 0.0 || (truncated && weight < threshold && weight < retention.weakest[v]))) continue;
+
+            Link weakest = {0, 0.0};
+            for (size_t i = 0; i < ids.size(); ++i) {
+                Link link = {ids[i], weights[i]};
+                if (i == 0 || ranksAbove(weakest, link)) weakest = link;
+            }
+            // A kept u stays if strong, or if the row dropped links and u
+            // still ranks at or above the weakest kept one; below that, a
+            // weak u gets no place in a row that dropped links. (A weak u
+            // in a row that dropped nothing may now be over the top-k.)
+            Link updated = {u, weight};
+            bool stays = weight > 0.0 && (weight >= threshold || (truncated && !ranksAbove(weakest, updated)));
+            if (had && stays) {
+                weights[pos - ids.begin()] = weight;
+                retention.weakest[v] = *min_element(weights.begin(), weights.end());
+                continue;
+            }
+            if (!had && truncated && weight < threshold && ranksAbove(weakest, updated)) continue;
+
+            // v's kept links, u at its new weight
+            known.clear();
+            for (size_t i = 0; i < ids.size(); ++i) {
+                if (ids[i] != u) known.push_back({ids[i], weights[i]});
+            }
+            if (weight > 0.0) known.push_back(updated);
+            next = known;
+            bool dropped = CosineSimilarityBuilder::prune(next, k, threshold);
+
+            // A truncated row's new top-k must rank at or above its old
+            // weakest link, or a dropped one could take a place: then the
+            // row is rescored in full
+            bool decided = !truncated;
+            if (truncated && known.size() >= k && !next.empty()) {
+                Link lowest = *max_element(next.begin(), next.end(), ranksAbove);
+                decided = lowest.second >= threshold || !ranksAbove(weakest, lowest);
+            }
+            if (!decided) {
+                scoreRow(v, next);
+                dropped = CosineSimilarityBuilder::prune(next, k, threshold);
+            }
+            keep(v, next, (decided && truncated) || dropped, u, toggled);
+        }
+    }
+
+public:
+    CosineIndex() = default;
+
+    /**
+     * plays[u] maps song -> play count (songs < num_songs), as given to
+     * the CosineSimilarityBuilder whose build filled kept
+     */
+    CosineIndex(const vector<unordered_map<uint32_t, int>>& plays, size_t num_songs,
+                CosineSimilarityBuilder::Retention kept)
+        : retention(move(kept)) {
+        index(plays, num_songs);
+        grow(plays.size());
+    }
+
+    /**
+     * Sets u's play counts (users and songs first seen live are added)
+     * and rescores u's row and the rows linked to it; out receives the
+     * graph changes. Links of rows other than u's that change are all
+     * below the threshold, since strong links are always kept.
+     */
+    void update(uint32_t u, const unordered_map<uint32_t, int>& plays, Update& out) {
+        grow(u + 1);
+        auto &candidates = out.candidates;
+        candidates.clear();
+        auto unplay = [&](uint32_t sid) {
+            auto &column = columns[sid];
+            auto at = lower_bound(column.begin(), column.end(), Link{u, 0.0},
+                [](const Link& a, const Link& b) { return a.first < b.first; });
+            column.erase(at);
+        };
+        for (const auto &e : rows[u]) {
+            for (const auto &p : columns[e.first]) candidates.push_back(p.first);
+            unplay(e.first);
+        }
+        CosineSimilarityBuilder::normalizedRow(plays, rows[u]);
+        for (const auto &e : rows[u]) {
+            if (e.first >= columns.size()) columns.resize(e.first + 1);
+            auto &column = columns[e.first];
+            auto at = lower_bound(column.begin(), column.end(), Link{u, 0.0},
+                [](const Link& a, const Link& b) { return a.first < b.first; });
+            for (auto p = column.begin(); p != column.end(); ++p) candidates.push_back(p->first);
+            column.insert(at, {u, e.second});
+        }
+        sort(candidates.begin(), candidates.end());
+        candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+        auto self = lower_bound(candidates.begin(), candidates.end(), u);
+        if (self != candidates.end() && *self == u) candidates.erase(self);
+
+        auto &row = out.row;
+        scoreRow(u, row);
+        vector<pair<uint32_t, uint32_t>> toggled;
+        retainCoPlayers(u, candidates, row, toggled);
+        vector<Link> next = row;
+        bool dropped = CosineSimilarityBuilder::prune(next, retention.top_k, retention.threshold);
+        CosineSimilarityBuilder::retain(retention, u, next, dropped);
+        row.erase(remove_if(row.begin(), row.end(), [&](const Link& l) {
+            return !keeps(u, l.first) && !keeps(l.first, u);
+        }), row.end());
+
+        // An edge changes where one side toggled and the other does not keep it
+        out.unlinked.clear();
+        out.linked.clear();
+        sort(toggled.begin(), toggled.end());
+        for (const auto &t : toggled) {
+            uint32_t a = t.first, b = t.second;
+            bool both = binary_search(toggled.begin(), toggled.end(), make_pair(b, a));
+            if (both && b < a) continue; // seen from b's side
+            bool keeps_a = keeps(a, b), keeps_b = keeps(b, a);
+            bool was = !keeps_a || (both ? !keeps_b : keeps_b);
+            bool now = keeps_a || keeps_b;
+            if (was && !now) out.unlinked.push_back({min(a, b), max(a, b)});
+            if (!was && now) out.linked.emplace_back(min(a, b), max(a, b), keeps_a ? keptWeight(a, b) : keptWeight(b, a));
+        }
+    }
+
+    size_t memoryUsage() const {
+        size_t bytes = (rows.capacity() + columns.capacity()) * sizeof(vector<Link>) +
+                       retention.kept.capacity() * sizeof(vector<uint32_t>) +
+                       retention.kept_weights.capacity() * sizeof(vector<double>) +
+                       retention.weakest.capacity() * sizeof(double) + retention.truncated.capacity();
+        for (const auto &l : rows) bytes += l.capacity() * sizeof(Link);
+        for (const auto &l : columns) bytes += l.capacity() * sizeof(Link);
+        for (const auto &l : retention.kept) bytes += l.capacity() * sizeof(uint32_t);
+        for (const auto &l : retention.kept_weights) bytes += l.capacity() * sizeof(double);
+        return bytes;
+    }
+
+    // Saves the retention; R is rebuilt from the play counts on load
+    void save(SnapshotWriter& out, const string& prefix) const {
+        SnapshotOptions options = {retention.top_k, retention.threshold};
+        out.putValue(prefix + ".options", options);
+        out.putLists(prefix + ".kept", retention.kept);
+        out.putLists(prefix + ".kept_weights", retention.kept_weights);
+        out.putArray(prefix + ".truncated", retention.truncated);
+    }
+
+    /**
+     * Restores what save() wrote for the users of plays. Returns false if
+     * a section is missing or inconsistent: kept lists not ascending,
+     * naming unknown users or sized unlike their weights.
+     */
+    bool load(const SnapshotReader& in, const string& prefix,
+              const vector<unordered_map<uint32_t, int>>& plays, size_t num_songs) {
+        SnapshotOptions options;
+        auto &r = retention;
+        size_t num_users = plays.size();
+        bool ok = in.getValue(prefix + ".options", options) && in.getLists(prefix + ".kept", r.kept) &&
+                  in.getLists(prefix + ".kept_weights", r.kept_weights) && in.getArray(prefix + ".truncated", r.truncated) &&
+                  r.kept.size() == num_users && r.kept_weights.size() == num_users && r.truncated.size() == num_users;
+        for (size_t u = 0; ok && u < num_users; ++u) {
+            const auto &ids = r.kept[u];
+            ok = ids.size() == r.kept_weights[u].size();
+            for (size_t i = 0; ok && i < ids.size(); ++i) {
+                ok = ids[i] < num_users && ids[i] != u && (i == 0 || ids[i - 1] < ids[i]);
+            }
+        }
+        if (!ok) {
+            *this = CosineIndex();
+            return false;
+        }
+        r.top_k = static_cast<size_t>(options.top_k);
+        r.threshold = options.threshold;
+        r.weakest.assign(num_users, 0.0);
+        for (size_t u = 0; u < num_users; ++u) {
+            const auto &weights = r.kept_weights[u];
+            if (!weights.empty()) r.weakest[u] = *min_element(weights.begin(), weights.end());
+        }
+        index(plays, num_songs);
+        return true;
+    }
+};
+
+#endif // COSINE_SIMILARITY_BUILDER_H
@@ -0,0 +1,602 @@
+#ifndef MINHASH_SIMILARITY_BUILDER_H
+#define MINHASH_SIMILARITY_BUILDER_H
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include "../Data_Structures/weighted_graph.h"
+#include "../core/thread_pool.h"
+#include "../core/snapshot.h"
+#include "user_similarity_builder.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define REC_MINHASH_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define REC_MINHASH_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define REC_MINHASH_NEON 1
+#endif
+
+using namespace std;
+
+/**
+ * MinHash/LSH tuning. A pair with Jaccard similarity J becomes a candidate
+ * with probability 1 - (1 - J^rows)^bands: more bands raise recall, more
+ * rows per band cut low-similarity candidates (and build time).
+ */
+struct MinHashOptions {
+    int bands = 32;
+    int rows_per_band = 2;
+    bool verify = true;         // exact Jaccard per candidate; false = signature estimate
+    size_t max_bucket_size = 0; // skip band buckets larger than this (0 = no cap)
+    uint64_t seed = 0x5eed;
+};
+
+/**
+ * The bands * rows_per_band hash functions of a MinHash signature, shared
+ * by the full build and the live index so both sign users identically
+ */
+class MinHasher {
+private:
+    size_t num_hashes;
+    int rows_per_band;
+
+    // Hash i of song key k is mix(mult[i] * k + add[i]), all in 32 bits;
+    // padded to whole HASH_BLOCKs
+    vector<uint32_t> mult;
+    vector<uint32_t> add;
+
+    static uint64_t splitmix(uint64_t& state) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    static uint32_t mixKey(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        return x ^ (x >> 16);
+    }
+
+    static constexpr size_t HASH_BLOCK = 8; // hashes per kernel call
+
+#if defined(REC_MINHASH_SSE2)
+    // 32-bit lane multiply (SSE2 only multiplies even lanes to 64 bits)
+    static __m128i mulLo(__m128i a, __m128i b) {
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    // Running minimum of 4 hashes; values are biased by 2^31 so the
+    // signed compare orders them unsigned
+    static __m128i minStep(__m128i current, __m128i m, __m128i a, __m128i key) {
+        __m128i h = _mm_add_epi32(mulLo(m, key), a);
+        h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+        h = _mm_xor_si128(h, _mm_set1_epi32(static_cast<int>(0x80000000U)));
+        __m128i lower = _mm_cmplt_epi32(h, current);
+        return _mm_or_si128(_mm_and_si128(lower, h), _mm_andnot_si128(lower, current));
+    }
+#endif
+
+    /**
+     * out[i] = min over keys of mix(m[i] * key + a[i]) for HASH_BLOCK
+     * hashes. The block stays in registers while every key of the user
+     * streams through it.
+     */
+    static void minHashBlock(const uint32_t* keys, size_t n, const uint32_t* m, const uint32_t* a, uint32_t* out) {
+#if defined(REC_MINHASH_AVX2)
+        __m256i vm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m));
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+        __m256i best = _mm256_set1_epi32(-1);
+        for (size_t k = 0; k < n; ++k) {
+            __m256i h = _mm256_add_epi32(_mm256_mullo_epi32(vm, _mm256_set1_epi32(static_cast<int>(keys[k]))), va);
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+            best = _mm256_min_epu32(best, h);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), best);
+#elif defined(REC_MINHASH_SSE2)
+        __m128i m0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m));
+        __m128i m1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m + 4));
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 4));
+        __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000U));
+        __m128i best0 = _mm_set1_epi32(0x7fffffff), best1 = best0; // biased UINT32_MAX
+        for (size_t k = 0; k < n; ++k) {
+            __m128i key = _mm_set1_epi32(static_cast<int>(keys[k]));
+            best0 = minStep(best0, m0, a0, key);
+            best1 = minStep(best1, m1, a1, key);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_xor_si128(best0, bias));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_xor_si128(best1, bias));
+#elif defined(REC_MINHASH_NEON)
+        uint32x4_t m0 = vld1q_u32(m), m1 = vld1q_u32(m + 4);
+        uint32x4_t a0 = vld1q_u32(a), a1 = vld1q_u32(a + 4);
+        uint32x4_t best0 = vdupq_n_u32(numeric_limits<uint32_t>::max()), best1 = best0;
+        for (size_t k = 0; k < n; ++k) {
+            uint32x4_t h0 = vmlaq_n_u32(a0, m0, keys[k]);
+            uint32x4_t h1 = vmlaq_n_u32(a1, m1, keys[k]);
+            best0 = vminq_u32(best0, veorq_u32(h0, vshrq_n_u32(h0, 15)));
+            best1 = vminq_u32(best1, veorq_u32(h1, vshrq_n_u32(h1, 15)));
+        }
+        vst1q_u32(out, best0);
+        vst1q_u32(out + 4, best1);
+#else
+        for (size_t i = 0; i < HASH_BLOCK; ++i) {
+            uint32_t best = numeric_limits<uint32_t>::max();
+            for (size_t k = 0; k < n; ++k) {
+                uint32_t h = m[i] * keys[k] + a[i];
+                h ^= h >> 15;
+                best = h < best ? h : best;
+            }
+            out[i] = best;
+        }
+#endif
+    }
+
+public:
+    // options with bands and rows_per_band clamped to at least 1
+    static MinHashOptions normalized(MinHashOptions options) {
+        if (options.bands < 1) options.bands = 1;
+        if (options.rows_per_band < 1) options.rows_per_band = 1;
+        return options;
+    }
+
+    // options must be normalized()
+    explicit MinHasher(const MinHashOptions& options)
+        : num_hashes(static_cast<size_t>(options.bands) * options.rows_per_band),
+          rows_per_band(options.rows_per_band) {
+        uint64_t state = options.seed;
+        size_t padded = (num_hashes + HASH_BLOCK - 1) / HASH_BLOCK * HASH_BLOCK;
+        for (size_t i = 0; i < padded; ++i) {
+            mult.push_back(static_cast<uint32_t>(splitmix(state)) | 1U);
+            add.push_back(static_cast<uint32_t>(splitmix(state)));
+        }
+    }
+
+    size_t size() const {
+        return num_hashes;
+    }
+
+    // Writes the num_hashes min-hashes of songs to sig; scratch holds
+    // the song keys, then the padded signature
+    void sign(const vector<uint32_t>& songs, vector<uint32_t>& scratch, uint32_t* sig) const {
+        size_t padded = mult.size();
+        scratch.resize(songs.size() + padded);
+        for (size_t k = 0; k < songs.size(); ++k) scratch[k] = mixKey(songs[k]);
+        uint32_t* out = scratch.data() + songs.size();
+        for (size_t block = 0; block < padded; block += HASH_BLOCK) {
+            minHashBlock(scratch.data(), songs.size(), &mult[block], &add[block], out + block);
+        }
+        copy(out, out + num_hashes, sig);
+    }
+
+    // Bucket key of one band of signature sig
+    uint64_t bandKey(const uint32_t* sig, int band) const {
+        const uint32_t* row = sig + static_cast<size_t>(band) * rows_per_band;
+        uint64_t key = 0xcbf29ce484222325ULL;
+        for (int r = 0; r < rows_per_band; ++r) {
+            key = (key ^ row[r]) * 0x100000001b3ULL;
+            key ^= key >> 29;
+        }
+        return key;
+    }
+
+    // Fraction of positions where signatures a and b agree
+    double estimate(const uint32_t* a, const uint32_t* b) const {
+        size_t agree = 0;
+        for (size_t i = 0; i < num_hashes; ++i) agree += a[i] == b[i];
+        return static_cast<double>(agree) / num_hashes;
+    }
+
+};
+
+/**
+ * Approximate Jaccard similarity build over users' liked songs
+ *
+ * Each user gets a signature of bands * rows_per_band min-hashes of their
+ * liked song ids; two signatures agree at a position with probability
+ * equal to the users' Jaccard similarity. Signatures are cut into bands,
+ * and users whose rows are identical in some band share that band's
+ * bucket. Only users sharing a bucket are candidates, so a song liked by
+ * millions no longer makes every pair of its likers a candidate, the way
+ * it does for the inverted index of UserSimilarityBuilder.
+ *
+ * Time Complexity: O(sum of likes * hashes + bands * U log U) for
+ * signatures and buckets, plus O(candidates * set size) to verify
+ *
+ * Pairs below the LSH curve are missed, so the graph is a subset of the
+ * exact one (verify) or carries estimated weights (!verify). Rows are
+ * emitted in (u1 asc, u2 asc) order, so like UserSimilarityBuilder the
+ * parallel and serial builds are identical.
+ */
+class MinHashSimilarityBuilder {
+private:
+    const vector<vector<uint32_t>>& liked; // sorted, duplicate-free per user
+    MinHashOptions options;
+    MinHasher hasher;
+    size_t num_hashes = 0;
+    vector<uint32_t> signatures; // user-major, num_hashes per user
+
+    // Per band, users grouped by band key (CSR); bucket_of[band * U + u]
+    // is u's bucket in that band, or NO_BUCKET (no likes, or capped)
+    static constexpr uint32_t NO_BUCKET = numeric_limits<uint32_t>::max();
+    vector<vector<uint32_t>> bucket_offsets;
+    vector<vector<uint32_t>> bucket_members; // ascending within a bucket
+    vector<uint32_t> bucket_of;
+
+    void computeSignature(uint32_t u, vector<uint32_t>& scratch) {
+        hasher.sign(liked[u], scratch, &signatures[static_cast<size_t>(u) * num_hashes]);
+    }
+
+    uint64_t bandKey(uint32_t u, int band) const {
+        return hasher.bandKey(&signatures[static_cast<size_t>(u) * num_hashes], band);
+    }
+
+    void buildBand(int band) {
+        uint32_t num_users = static_cast<uint32_t>(liked.size());
+        vector<pair<uint64_t, uint32_t>> keyed;
+        keyed.reserve(num_users);
+        for (uint32_t u = 0; u < num_users; ++u) {
+            if (!liked[u].empty()) keyed.emplace_back(bandKey(u, band), u);
+        }
+        sort(keyed.begin(), keyed.end());
+
+        auto &offsets = bucket_offsets[band];
+        auto &members = bucket_members[band];
+        uint32_t* of = &bucket_of[static_cast<size_t>(band) * num_users];
+        offsets.assign(1, 0);
+        for (size_t i = 0; i < keyed.size();) {
+            size_t j = i;
+            while (j < keyed.size() && keyed[j].first == keyed[i].first) ++j;
+            // Singletons yield no pairs; oversized buckets are skipped
+            bool keep = j - i > 1 && (options.max_bucket_size == 0 || j - i <= options.max_bucket_size);
+            if (keep) {
+                uint32_t bucket = static_cast<uint32_t>(offsets.size() - 1);
+                for (size_t k = i; k < j; ++k) {
+                    members.push_back(keyed[k].second);
+                    of[keyed[k].second] = bucket;
+                }
+                offsets.push_back(static_cast<uint32_t>(members.size()));
+            }
+            i = j;
+        }
+    }
+
+    double estimate(uint32_t u, uint32_t v) const {
+        return hasher.estimate(&signatures[static_cast<size_t>(u) * num_hashes],
+                               &signatures[static_cast<size_t>(v) * num_hashes]);
+    }
+
+public:
+    using RowScratch = UserSimilarityBuilder::RowScratch;
+
+    // Computes signatures and bands, on pool's workers if given
+    MinHashSimilarityBuilder(const vector<vector<uint32_t>>& liked_songs, const MinHashOptions& opts,
+                             ThreadPool* pool = nullptr)
+        : liked(liked_songs), options(MinHasher::normalized(opts)), hasher(options) {
+        num_hashes = hasher.size();
+
+        uint32_t num_users = static_cast<uint32_t>(liked.size());
+        signatures.resize(static_cast<size_t>(num_users) * num_hashes);
+        bucket_offsets.resize(options.bands);
+        bucket_members.resize(options.bands);
+        bucket_of.assign(static_cast<size_t>(options.bands) * num_users, NO_BUCKET);
+
+        if (pool && num_users > 0) {
+            size_t chunks = min<size_t>(num_users, pool->size() * 8);
+            pool->parallelFor(chunks, [&](size_t chunk, size_t) {
+                vector<uint32_t> scratch;
+                uint32_t begin = static_cast<uint32_t>(chunk * num_users / chunks);
+                uint32_t end = static_cast<uint32_t>((chunk + 1) * num_users / chunks);
+                for (uint32_t u = begin; u < end; ++u) computeSignature(u, scratch);
+            });
+            pool->parallelFor(static_cast<size_t>(options.bands), [&](size_t band, size_t) {
+                buildBand(static_cast<int>(band));
+            });
+        } else {
+            vector<uint32_t> scratch;
+            for (uint32_t u = 0; u < num_users; ++u) computeSignature(u, scratch);
+            for (int band = 0; band < options.bands; ++band) buildBand(band);
+        }
+    }
+
+    uint32_t getUserCount() const {
+        return static_cast<uint32_t>(liked.size());
+    }
+
+    const MinHashOptions& getOptions() const {
+        return options;
+    }
+
+    const MinHasher& getHasher() const {
+        return hasher;
+    }
+
+    // User-major signatures, getHasher().size() per user (zeros for users without likes)
+    const vector<uint32_t>& getSignatures() const {
+        return signatures;
+    }
+
+    /**
+     * Scores every candidate (u, v) with v > u, appending edges with
+     * similarity > 0 in ascending v order. Returns the number of
+     * candidates scored.
+     */
+    size_t scoreRow(uint32_t u, RowScratch& scratch, vector<SimilarityEdge>& out) const {
+        if (scratch.stamp.size() < liked.size()) scratch.stamp.assign(liked.size(), 0);
+        scratch.candidates.clear();
+
+        size_t num_users = liked.size();
+        for (int band = 0; band < options.bands; ++band) {
+            uint32_t bucket = bucket_of[static_cast<size_t>(band) * num_users + u];
+            if (bucket == NO_BUCKET) continue;
+            const auto &members = bucket_members[band];
+            auto first = members.begin() + bucket_offsets[band][bucket];
+            auto last = members.begin() + bucket_offsets[band][bucket + 1];
+            for (auto it = upper_bound(first, last, u); it != last; ++it) {
+                if (scratch.stamp[*it] != u + 1) {
+                    scratch.stamp[*it] = u + 1;
+                    scratch.candidates.push_back(*it);
+                }
+            }
+        }
+
+        sort(scratch.candidates.begin(), scratch.candidates.end());
+        for (uint32_t v : scratch.candidates) {
+            double similarity = options.verify ? WeightedGraph::jaccardSimilarity(liked[u], liked[v]) : estimate(u, v);
+            if (similarity > 0.0) out.emplace_back(u, v, similarity);
+        }
+        return scratch.candidates.size();
+    }
+
+    // Serial build, same contract as UserSimilarityBuilder::build
+    template <typename EmitFn>
+    size_t build(EmitFn&& emit) const {
+        RowScratch scratch;
+        vector<SimilarityEdge> row;
+        size_t scored = 0;
+        for (uint32_t u = 0; u < liked.size(); ++u) {
+            row.clear();
+            scored += scoreRow(u, scratch, row);
+            for (const auto& e : row) emit(e.u1, e.u2, e.weight);
+        }
+        return scored;
+    }
+
+    // Parallel build, same contract as UserSimilarityBuilder::buildParallel
+    template <typename EmitFn>
+    size_t buildParallel(ThreadPool& pool, EmitFn&& emit) const {
+        size_t num_users = liked.size();
+        if (num_users == 0) return 0;
+
+        size_t num_shards = min(num_users, pool.size() * 8);
+        vector<vector<SimilarityEdge>> shard_edges(num_shards);
+        vector<size_t> shard_scored(num_shards, 0);
+        vector<RowScratch> scratch(pool.size());
+
+        pool.parallelFor(num_shards, [&](size_t shard, size_t slot) {
+            uint32_t begin = static_cast<uint32_t>(shard * num_users / num_shards);
+            uint32_t end = static_cast<uint32_t>((shard + 1) * num_users / num_shards);
+            for (uint32_t u = begin; u < end; ++u) {
+                shard_scored[shard] += scoreRow(u, scratch[slot], shard_edges[shard]);
+            }
+        });
+
+        size_t scored = 0;
+        for (size_t shard = 0; shard < num_shards; ++shard) {
+            scored += shard_scored[shard];
+            for (const auto& e : shard_edges[shard]) emit(e.u1, e.u2, e.weight);
+            vector<SimilarityEdge>().swap(shard_edges[shard]);
+        }
+        return scored;
+    }
+};
+
+/**
+ * Live LSH buckets for incremental rescoring of a MINHASH graph
+ *
+ * Keeps every user's signature and, per band, the users under each band
+ * key, singletons included since a bucket can grow. candidates() gives
+ * exactly the users MinHashSimilarityBuilder pairs a user with, so
+ * rescoring a user whose likes changed against them, with score(),
+ * yields the edges a full rebuild would.
+ *
+ * With max_bucket_size, a user joining or leaving a bucket can move it
+ * across the cap, which makes or breaks candidate pairs of the other
+ * members; update() reports those members so they are rescored too.
+ *
+ * Time Complexity: update O(likes * hashes + bands * bucket size);
+ * candidates O(bands * bucket size)
+ */
+class MinHashIndex {
+private:
+    MinHashOptions options;
+    MinHasher hasher;
+    vector<uint32_t> signatures; // user-major, hasher.size() per user
+    vector<bool> bucketed;       // users with likes, the only ones in buckets
+    vector<unordered_map<uint64_t, vector<uint32_t>>> buckets; // per band; members ascending
+    vector<uint32_t> scratch;
+
+    const uint32_t* signature(uint32_t u) const {
+        return &signatures[static_cast<size_t>(u) * hasher.size()];
+    }
+
+    // Buckets the build pairs members of
+    bool pairs(size_t size) const {
+        return size > 1 && (options.max_bucket_size == 0 || size <= options.max_bucket_size);
+    }
+
+public:
+    // Takes over the signatures of a full build
+    explicit MinHashIndex(const MinHashSimilarityBuilder& builder, const vector<vector<uint32_t>>& liked)
+        : options(builder.getOptions()), hasher(options), signatures(builder.getSignatures()),
+          bucketed(liked.size(), false), buckets(options.bands) {
+        for (uint32_t u = 0; u < liked.size(); ++u) {
+            if (liked[u].empty()) continue;
+            bucketed[u] = true;
+            for (int band = 0; band < options.bands; ++band) {
+                buckets[band][hasher.bandKey(signature(u), band)].push_back(u);
+            }
+        }
+    }
+
+    // An empty index to load() a saved one into
+    explicit MinHashIndex(const MinHashOptions& opts)
+        : options(MinHasher::normalized(opts)), hasher(options), buckets(options.bands) {}
+
+    const MinHashOptions& getOptions() const {
+        return options;
+    }
+
+    /**
+     * Re-signs u from its sorted liked songs and moves it to its new
+     * buckets (users first seen live are added). Appends to crossed the
+     * other members of every bucket u moved across the size cap.
+     */
+    void update(uint32_t u, const vector<uint32_t>& songs, vector<uint32_t>& crossed) {
+        size_t num_hashes = hasher.size();
+        if (u >= bucketed.size()) {
+            bucketed.resize(u + 1, false);
+            signatures.resize(bucketed.size() * num_hashes, 0);
+        }
+        vector<uint32_t> sig(num_hashes, 0);
+        if (!songs.empty()) hasher.sign(songs, scratch, sig.data());
+
+        auto moved = [&](vector<uint32_t>& members, size_t before) {
+            if (pairs(before) == pairs(members.size())) return;
+            for (uint32_t v : members) {
+                if (v != u) crossed.push_back(v);
+            }
+        };
+        for (int band = 0; band < options.bands; ++band) {
+            uint64_t old_key = hasher.bandKey(signature(u), band);
+            uint64_t new_key = hasher.bandKey(sig.data(), band);
+            if (bucketed[u] == !songs.empty() && old_key == new_key) continue;
+            if (bucketed[u]) {
+                auto it = buckets[band].find(old_key);
+                auto &members = it->second;
+                members.erase(lower_bound(members.begin(), members.end(), u));
+                moved(members, members.size() + 1);
+                if (members.empty()) buckets[band].erase(it);
+            }
+            if (!songs.empty()) {
+                auto &members = buckets[band][new_key];
+                members.insert(lower_bound(members.begin(), members.end(), u), u);
+                moved(members, members.size() - 1);
+            }
+        }
+        bucketed[u] = !songs.empty();
+        copy(sig.begin(), sig.end(), signatures.begin() + static_cast<size_t>(u) * num_hashes);
+    }
+
+    // Users sharing a paired bucket with u, ascending
+    void candidates(uint32_t u, vector<uint32_t>& out) const {
+        out.clear();
+        if (u >= bucketed.size() || !bucketed[u]) return;
+        for (int band = 0; band < options.bands; ++band) {
+            const auto &members = buckets[band].at(hasher.bandKey(signature(u), band));
+            if (!pairs(members.size())) continue;
+            for (uint32_t v : members) {
+                if (v != u) out.push_back(v);
+            }
+        }
+        sort(out.begin(), out.end());
+        out.erase(unique(out.begin(), out.end()), out.end());
+    }
+
+    // The build's similarity for a candidate pair
+    double score(uint32_t u, uint32_t v, const vector<vector<uint32_t>>& liked) const {
+        return options.verify ? WeightedGraph::jaccardSimilarity(liked[u], liked[v])
+                              : hasher.estimate(signature(u), signature(v));
+    }
+
+    size_t memoryUsage() const {
+        size_t bytes = signatures.capacity() * sizeof(uint32_t) + bucketed.capacity() / 8;
+        for (const auto &band : buckets) {
+            bytes += band.bucket_count() * sizeof(void*);
+            for (const auto &entry : band) {
+                bytes += sizeof(entry) + sizeof(void*) + entry.second.capacity() * sizeof(uint32_t);
+            }
+        }
+        return bytes;
+    }
+
+    // Signatures plus each band's buckets (keys ascending). The options
+    // are not saved: load() needs an index made with the same ones.
+    void save(SnapshotWriter& out, const string& prefix) const {
+        vector<uint8_t> flags(bucketed.begin(), bucketed.end());
+        vector<uint64_t> band_sizes, keys;
+        vector<vector<uint32_t>> members;
+        for (const auto &band : buckets) {
+            vector<uint64_t> band_keys;
+            for (const auto &entry : band) band_keys.push_back(entry.first);
+            sort(band_keys.begin(), band_keys.end());
+            band_sizes.push_back(band_keys.size());
+            for (uint64_t key : band_keys) {
+                keys.push_back(key);
+                members.push_back(band.at(key));
+            }
+        }
+        out.putArray(prefix + ".signatures", signatures);
+        out.putArrayCopy(prefix + ".bucketed", flags);
+        out.putArrayCopy(prefix + ".band_sizes", band_sizes);
+        out.putArrayCopy(prefix + ".keys", keys);
+        out.putLists(prefix + ".members", members);
+    }
+
+    /**
+     * Restores what save() wrote for num_users users. Returns false,
+     * leaving the index empty, if a section is missing or inconsistent:
+     * every user with likes must sit, once per band, in the bucket its
+     * signature hashes to, and no other user in any. O(users * hashes).
+     */
+    bool load(const SnapshotReader& in, const string& prefix, size_t num_users) {
+        vector<uint8_t> flags;
+        vector<uint64_t> band_sizes, keys;
+        vector<vector<uint32_t>> members;
+        bool ok = in.getArray(prefix + ".signatures", signatures) && in.getArray(prefix + ".bucketed", flags) &&
+                  in.getArray(prefix + ".band_sizes", band_sizes) && in.getArray(prefix + ".keys", keys) &&
+                  in.getLists(prefix + ".members", members) &&
+                  signatures.size() == num_users * hasher.size() && flags.size() == num_users &&
+                  band_sizes.size() == static_cast<size_t>(options.bands) && members.size() == keys.size();
+        size_t expected = 0;
+        for (size_t u = 0; ok && u < num_users; ++u) expected += flags[u] != 0;
+        bucketed.assign(flags.begin(), flags.end());
+        buckets.assign(options.bands, {});
+        size_t next = 0;
+        for (int band = 0; ok && band < options.bands; ++band) {
+            size_t placed = 0;
+            ok = band_sizes[band] <= keys.size() - next;
+            for (size_t b = 0; ok && b < band_sizes[band]; ++b, ++next) {
+                auto &bucket = members[next];
+                for (size_t i = 0; ok && i < bucket.size(); ++i) {
+                    uint32_t u = bucket[i];
+                    ok = u < num_users && bucketed[u] && (i == 0 || bucket[i - 1] < u) &&
+                         hasher.bandKey(signature(u), band) == keys[next];
+                }
+                ok = ok && !bucket.empty() && buckets[band].emplace(keys[next], move(bucket)).second;
+                placed += buckets[band][keys[next]].size();
+            }
+            ok = ok && placed == expected;
+        }
+        if (!ok || next != keys.size()) {
+            signatures.clear();
+            bucketed.clear();
+            buckets.assign(options.bands, {});
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif // MINHASH_SIMILARITY_BUILDER_H
@@ -7,90 +7,738 @@
 #include <set>
 #include <algorithm>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <chrono>
+#include <atomic>
+#include <functional>
 #include "../core/entities.h"
+#include "../core/id_registry.h"
+#include "../core/thread_pool.h"
+#include "../core/score_accumulator.h"
+#include "../core/request_context.h"
+#include "../core/snapshot.h"
+#include "../core/metrics.h"
 #include "../Data_Structures/union_find.h"
+#include "../Data_Structures/community_popularity.h"
+#include "../Data_Structures/exclusion_filter.h"
+#include "../Data_Structures/result_cache.h"
 #include "../Data_Structures/weighted_graph.h"
 #include "../Data_Structures/bipartite_graph.h"
 #include "../Data_Structures/tries.h"
-#include "../Data_Structures/kdtree.h"
+#include "../Data_Structures/compact_trie.h"
+#include "../Data_Structures/neighbor_backends.h"
+#include "user_similarity_builder.h"
+#include "minhash_similarity_builder.h"
+#include "cosine_similarity_builder.h"
 
 using namespace std;
 
 class RecommendationEngine {
 private:
     // Data structures for each pillar
-    KDTree kdtree;
+    unique_ptr<NearestNeighborIndex> content_index;
     WeightedGraph user_graph;
     BipartiteGraph bipartite_graph;
     UnionFind communities;
-    Trie search_trie;
+    CommunityPopularity community_songs; // liked-song counts per community
+    CompactTrie search_index; // frozen from a Trie at the end of initialize()
 
-    // Data storage
-    unordered_map<string, Song> song_map;
-    unordered_map<string, Artist> artist_map;
-    unordered_map<string, User> user_map;
-    unordered_map<string, vector<string>> artist_songs;
-    unordered_map<string, unordered_map<string, int>> user_song_plays;
-    unordered_map<string, set<string>> user_liked_songs;
+    // ID interning: external string IDs -> dense indices
+    IdRegistry user_ids;
+    IdRegistry song_ids;
+    IdRegistry artist_ids;
+
+    // Data storage, indexed by dense id. Catalog songs/artists occupy
+    // [0, songs.size()) / [0, artists.size()); ids beyond that were only
+    // seen in interaction files.
+    vector<Song> songs;
+    vector<Artist> artists;
+    vector<User> users;
+    vector<vector<uint32_t>> artist_songs;
+    vector<unordered_map<uint32_t, int>> user_song_plays;
+    vector<vector<uint32_t>> user_liked_songs; // sorted, duplicate-free
+    vector<vector<uint32_t>> song_likers;      // inverted user_liked_songs, sorted; for incremental rescoring
+    unique_ptr<MinHashIndex> minhash_index;     // LSH buckets of a MINHASH graph, for incremental rescoring
+    unique_ptr<CosineIndex> cosine_index;       // play rows and kept links of a COSINE graph, likewise
+    vector<vector<uint32_t>> user_blocked_artists; // sorted, see blockArtist()
+    ExclusionFilter exclusions; // songs never recommended to a user, see buildExclusions()
 
     // Configuration
     double similarity_threshold = 0.3;
     int k_nearest = 10;
     int k_similar_users = 5;
     int top_artists = 5;
+    int worker_threads = 0; // 0 = one per hardware thread
+    NeighborBackend neighbor_backend = NeighborBackend::KD_TREE;
+    NeighborBackend content_backend = NeighborBackend::KD_TREE; // backend content_index was built with
+    int max_user_neighbors = 0; // per-user edge cap in the user graph (0 = keep all)
+    SimilarityMode similarity_mode = SimilarityMode::EXACT;
+    MinHashOptions minhash_options; // used in SimilarityMode::MINHASH
+    int cosine_neighbors = 50;      // per-user top-k of SimilarityMode::COSINE (0 = keep all)
+    SimilarityMode graph_mode = SimilarityMode::EXACT; // mode user_graph was built with
+    int exclude_played_min = 0; // also exclude songs played this often (0 = only liked songs)
 
-    void buildUserSimilarities() {
-        vector<string> users;
-        for (const auto& it : user_map) {
-            auto & uid = it.first;
-            users.push_back(uid);
-            communities.makeSet(uid);
+    bool parallel_pillars = false;
+    int pillar_timeout_ms = 0; // 0 = wait for every pillar
+
+    int fuzzy_max_edits = 1;     // typo tolerance when exact prefixes run short
+    long fuzzy_budget_us = 1000; // per-query fuzzy search budget (0 = no limit)
+
+    // Created on first use; pillar tasks still running after a timeout keep
+    // using it, and its destructor (run first, it is declared last) drains them
+    mutable mutex pool_mutex;
+    mutable unique_ptr<ThreadPool> worker_pool;
+    mutable atomic<size_t> running_pillar_tasks{0}; // including ones abandoned at a timeout
+    mutable mutex pillar_tasks_mutex;
+    mutable condition_variable pillar_tasks_done;    // running_pillar_tasks reached 0
+
+    ThreadPool& workerPool() const {
+        lock_guard<mutex> lock(pool_mutex);
+        if (!worker_pool) worker_pool.reset(new ThreadPool(static_cast<size_t>(worker_threads)));
+        return *worker_pool;
+    }
+
+    // Fusion weights, indexed like scorePillar
+    static constexpr int NUM_PILLARS = 4;
+    double pillar_weights[NUM_PILLARS] = {1.0, 1.2, 0.9, 0.8};
+
+    // What a cached fused result depends on besides the user
+    struct FusionParams {
+        int num_recs;
+        double weights[NUM_PILLARS];
+
+        bool operator==(const FusionParams& other) const {
+            if (num_recs != other.num_recs) return false;
+            for (int p = 0; p < NUM_PILLARS; ++p) {
+                if (weights[p] != other.weights[p]) return false;
+            }
+            return true;
         }
+    };
+    // generateRecommendations results, see setResultCache(); disabled by default
+    mutable ResultCache<FusionParams, vector<Recommendation>> result_cache;
 
-        for (size_t i = 0; i < users.size(); ++i) {
-            for (size_t j = i + 1; j < users.size(); ++j) {
-                const string& u1 = users[i];
-                const string& u2 = users[j];
+    // Instrumentation, exported by getStats(); no-ops with REC_DISABLE_METRICS
+    struct PillarMetrics {
+        metrics::LatencyStat latency;
+        metrics::Counter candidates; // distinct songs scored
+    };
+    // Query-side metrics live behind a pointer so that engine copies
+    // serving the same traffic can report it together (shareQueryMetrics)
+    struct QueryMetrics {
+        PillarMetrics pillars[NUM_PILLARS];
+        metrics::LatencyStat fused;
+        metrics::LatencyStat batch; // per user of a batch
+        metrics::LatencyStat autocomplete;
+        atomic<uint64_t> pillar_timeouts{0};
+        atomic<uint64_t> fuzzy_timeouts{0};
+    };
+    shared_ptr<QueryMetrics> query_metrics = make_shared<QueryMetrics>();
+    metrics::LatencyStat build_search_latency;
+    metrics::LatencyStat build_content_latency;
+    metrics::LatencyStat build_similarity_latency;
+    metrics::LatencyStat build_bipartite_latency;
+    metrics::Counter similarity_pairs_scored;
+    metrics::Counter similarity_pairs_skipped; // pairs never scored (no shared like)
 
-                double similarity = WeightedGraph::jaccardSimilarity(
-                    user_liked_songs[u1],
-                    user_liked_songs[u2]
-                );
+    static constexpr RecommendationSource PILLAR_SOURCES[NUM_PILLARS] = {
+        RecommendationSource::CONTENT, RecommendationSource::USER_COLLAB,
+        RecommendationSource::ARTIST_COLLAB, RecommendationSource::COMMUNITY};
 
-                if (similarity > 0.0) {
-                    user_graph.addEdge(u1, u2, similarity);
+    // Best num_recs of one pillar for uid into out, score desc, ties by song_id
+    void scorePillar(int pillar, uint32_t uid, int num_recs, RequestContext& ctx, vector<ScoredSong>& out) const {
+        out.clear();
+        if (uid == INVALID_ID || num_recs <= 0) return;
+        switch (pillar) {
+            case 0: scoreContent(uid, num_recs, ctx, out); break;
+            case 1: scoreUserCollab(uid, num_recs, ctx, out); break;
+            case 2: scoreArtist(uid, num_recs, out); break;
+            default: scoreCommunity(uid, num_recs, out); break;
+        }
+    }
 
-                    if (similarity >= similarity_threshold) {
-                        communities.unionSets(u1, u2);
-                    }
+    // Bounded top-n of scores into out; the selection buffer is arena memory
+    void selectTop(RequestContext& ctx, const ScoreAccumulator& scores, int n, vector<ScoredSong>& out) const {
+        ArenaVector<uint32_t> order{ArenaAllocator<uint32_t>(ctx.arena)};
+        scores.topN(static_cast<size_t>(n), [this](uint32_t a, uint32_t b) { return songs[a].song_id < songs[b].song_id; },
+                    order);
+        out.clear();
+        for (uint32_t sid : order) out.push_back({sid, scores.score(sid)});
+    }
+
+    // Output step: the only place titles and ids are copied
+    void materialize(const vector<ScoredSong>& scored, RecommendationSource source, vector<Recommendation>& out) const {
+        out.clear();
+        out.reserve(scored.size());
+        for (const auto &s : scored) {
+            const Song &song = songs[s.song];
+            out.emplace_back(song.song_id, song.title, s.score, source);
+        }
+    }
+
+    vector<Recommendation> pillarRecommendations(int pillar, const string& user_id, int num_recs) const {
+        RequestContext &ctx = RequestContext::local();
+        ctx.reset();
+        vector<ScoredSong> top;
+        scorePillar(pillar, user_ids.find(user_id), num_recs, ctx, top);
+        vector<Recommendation> recommendations;
+        materialize(top, PILLAR_SOURCES[pillar], recommendations);
+        return recommendations;
+    }
+
+    void scoreContent(uint32_t uid, int num_recs, RequestContext& ctx, vector<ScoredSong>& out) const {
+        metrics::ScopedTimer timer(query_metrics->pillars[0].latency);
+        const auto &likes = user_liked_songs[uid];
+        if (likes.empty() || !content_index) return;
+
+        // One batched k-NN traversal for all of the user's liked songs
+        ctx.queries.clear();
+        for (uint32_t liked : likes) {
+            if (isCatalogSong(liked)) ctx.queries.push_back(liked);
+        }
+        content_index->findSimilarSongsBatch(ctx.queries, k_nearest, ctx.arena, ctx.neighbors, ctx.neighbor_offsets);
+
+        ScoreAccumulator &scores = ctx.scores;
+        scores.reset();
+        scores.resize(songs.size());
+        for (uint32_t nid : ctx.neighbors) {
+            if (!exclusions.excludes(uid, nid)) scores.add(nid, 1.0);
+        }
+        query_metrics->pillars[0].candidates.add(scores.size());
+        selectTop(ctx, scores, num_recs, out);
+    }
+
+    void scoreUserCollab(uint32_t uid, int num_recs, RequestContext& ctx, vector<ScoredSong>& out) const {
+        metrics::ScopedTimer timer(query_metrics->pillars[1].latency);
+        auto similar = user_graph.getTopKSimilarUsers(uid, k_similar_users);
+        if (similar.empty()) return;
+
+        ScoreAccumulator &scores = ctx.scores;
+        scores.reset();
+        scores.resize(songs.size());
+        for (const auto &p : similar) {
+            for (uint32_t sid : user_liked_songs[p.first]) {
+                if (isCatalogSong(sid) && !exclusions.excludes(uid, sid)) scores.add(sid, p.second);
+            }
+        }
+        query_metrics->pillars[1].candidates.add(scores.size());
+        selectTop(ctx, scores, num_recs, out);
+    }
+
+    void scoreArtist(uint32_t uid, int num_recs, vector<ScoredSong>& out) const {
+        metrics::ScopedTimer timer(query_metrics->pillars[2].latency);
+        // Already in Recommendation order: score desc, then song_id
+        auto song_scores = bipartite_graph.recommendFromTopArtists(
+            uid, top_artists, static_cast<size_t>(num_recs),
+            [&](uint32_t sid) { return isCatalogSong(sid) && !exclusions.excludes(uid, sid); },
+            [this](uint32_t a, uint32_t b) { return songs[a].song_id < songs[b].song_id; });
+        query_metrics->pillars[2].candidates.add(song_scores.size());
+        for (const auto &p : song_scores) out.push_back({p.first, p.second});
+    }
+
+    void scoreCommunity(uint32_t uid, int num_recs, vector<ScoredSong>& out) const {
+        metrics::ScopedTimer timer(query_metrics->pillars[3].latency);
+        if (communities.getCommunitySize(uid) <= 1) return;
+
+        // Already ranked; only the user's exclusions are skipped
+        size_t walked = 0;
+        for (const auto &entry : community_songs.getTable(communities.getCommunity(uid))) {
+            if (static_cast<int>(out.size()) >= num_recs) break;
+            walked++;
+            if (exclusions.excludes(uid, entry.song)) continue;
+            out.push_back({entry.song, static_cast<double>(entry.count)});
+        }
+        query_metrics->pillars[3].candidates.add(walked);
+    }
+
+    // Reusable per-worker buffers for fusing one request
+    struct FusionScratch {
+        vector<ScoredSong> pillar_scores[NUM_PILLARS];
+        bool completed[NUM_PILLARS];
+        vector<ScoredSong> fused_top;
+        vector<Recommendation> output;
+    };
+
+    // Weighted fusion of scratch.pillar_scores into out (top num_recs)
+    void fuse(RequestContext& ctx, FusionScratch& scratch, uint32_t uid, int num_recs, vector<Recommendation>& out) const {
+        ScoreAccumulator &fused = ctx.fused;
+        fused.reset();
+        fused.resize(song_ids.size());
+
+        // Fuse in fixed pillar order so results do not depend on timing
+        for (int p = 0; p < NUM_PILLARS; ++p) {
+            if (!scratch.completed[p]) continue;
+            for (const auto &s : scratch.pillar_scores[p]) {
+                if (!exclusions.excludes(uid, s.song)) fused.add(s.song, s.score * pillar_weights[p]);
+            }
+        }
+
+        // Top-N by partial selection; ties by song_id like Recommendation::operator<
+        selectTop(ctx, fused, num_recs < 0 ? 0 : num_recs, scratch.fused_top);
+        materialize(scratch.fused_top, RecommendationSource::COMBINED, out);
+    }
+
+    // Plain-data records for the snapshot's entity sections
+    struct SnapshotMeta {
+        uint32_t neighbor_backend;
+        uint32_t num_songs;
+        uint32_t num_artists;
+        uint32_t num_users;
+    };
+    struct SnapshotMinHash {
+        uint32_t bands;
+        uint32_t rows_per_band;
+        uint32_t verify;
+        uint32_t reserved;
+        uint64_t max_bucket_size;
+        uint64_t seed;
+    };
+    struct SongFeatures {
+        int32_t bpm;
+        double energy;
+        double danceability;
+        double valence;
+    };
+    struct PlayCount {
+        uint32_t song;
+        int32_t plays;
+    };
+
+    // Drops every built structure (before loading a snapshot)
+    void resetState() {
+        content_index.reset();
+        user_graph.clear();
+        bipartite_graph.clear();
+        communities.clear();
+        community_songs.clear();
+        search_index.clear();
+        user_ids.clear();
+        song_ids.clear();
+        artist_ids.clear();
+        songs.clear();
+        artists.clear();
+        users.clear();
+        artist_songs.clear();
+        user_song_plays.clear();
+        user_liked_songs.clear();
+        song_likers.clear();
+        minhash_index.reset();
+        cosine_index.reset();
+        graph_mode = SimilarityMode::EXACT;
+        user_blocked_artists.clear();
+        exclusions.clear();
+        result_cache.clear();
+    }
+
+    // Drops the cached results of every member of user's community
+    void invalidateCommunity(uint32_t user) {
+        if (!result_cache.isEnabled()) return;
+        communities.forEachMember(communities.find(user), [&](uint32_t member) { result_cache.invalidateUser(member); });
+    }
+
+    // Exclusion sets per user: liked songs, songs played at least
+    // exclude_played_min times and every song of a blocked artist
+    void buildExclusions() {
+        vector<vector<uint32_t>> lists(users.size());
+        for (uint32_t uid = 0; uid < users.size(); ++uid) {
+            auto &list = lists[uid];
+            list = user_liked_songs[uid];
+            if (exclude_played_min > 0) {
+                for (const auto &p : user_song_plays[uid]) {
+                    if (p.second >= exclude_played_min) list.push_back(p.first);
                 }
             }
+            if (uid < user_blocked_artists.size()) {
+                for (uint32_t aid : user_blocked_artists[uid]) {
+                    if (aid < artist_songs.size()) list.insert(list.end(), artist_songs[aid].begin(), artist_songs[aid].end());
+                }
+            }
+        }
+        exclusions.build(lists, songs.size());
+    }
+
+    void buildSongLikers() {
+        song_likers.assign(song_ids.size(), {});
+        for (uint32_t uid = 0; uid < user_liked_songs.size(); ++uid) {
+            for (uint32_t sid : user_liked_songs[uid]) song_likers[sid].push_back(uid);
+        }
+    }
+
+    /**
+     * A user's collaborative pillar reads the likes of its top-k
+     * neighbors: results of rankers holding uid there are stale. Called
+     * before and after uid's edges change, with every user that may rank
+     * it either way.
+     */
+    void invalidateRankers(uint32_t uid, const vector<uint32_t>& rankers) {
+        if (!result_cache.isEnabled()) return;
+        for (uint32_t v : rankers) {
+            for (auto edge : user_graph.getTopKSimilarUsers(v, k_similar_users)) {
+                if (edge.first == uid) {
+                    result_cache.invalidateUser(v);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Unites the communities of a and b and merges their song tables
+    void linkCommunities(uint32_t a, uint32_t b) {
+        uint32_t root_a = communities.find(a);
+        uint32_t root_b = communities.find(b);
+        if (root_a == root_b) return;
+        communities.unionSets(root_a, root_b);
+        community_songs.mergeCommunities(root_a, root_b, communities.find(root_a));
+    }
+
+    /**
+     * user lost a link at or above the threshold, so its community may
+     * have split: re-forms it from the links its members still hold and
+     * recounts the song tables, leaving what a rebuild would. (Under a
+     * setMaxUserNeighbors() cap, links the cap dropped no longer count.)
+     *
+     * Time Complexity: O(members' edges + members' likes)
+     */
+    void splitCommunity(uint32_t user) {
+        invalidateCommunity(user);
+        vector<uint32_t> members = communities.split(user);
+        for (uint32_t member : members) {
+            for (auto edge : user_graph.getNeighbors(member)) {
+                if (edge.second >= similarity_threshold) communities.unionSets(member, edge.first);
+            }
+        }
+        community_songs.recount(communities, user_liked_songs, members);
+    }
+
+    /**
+     * Recomputes uid's similarity edges after its likes changed. Only users
+     * sharing a liked song (found through song_likers) can have a nonzero
+     * Jaccard similarity, so just they are scored. Edges reaching the
+     * threshold unite communities; losing one splits uid's community
+     * again where its links no longer hold (splitCommunity).
+     * A MINHASH graph scores only uid's LSH candidates, as the build does
+     * (minhash_index must already hold uid's new signature).
+     * A COSINE graph is rescored after play count changes instead, by
+     * cosine_index, which also reports the links other rows stopped or
+     * started keeping.
+     */
+    void rescoreUser(uint32_t uid) {
+        const auto &likes = user_liked_songs[uid];
+        bool cosine = graph_mode == SimilarityMode::COSINE && cosine_index;
+        bool minhash = graph_mode == SimilarityMode::MINHASH && minhash_index;
+        vector<uint32_t> candidates;
+        vector<pair<uint32_t, double>> edges;
+        CosineIndex::Update reshaped;
+        if (cosine) {
+            cosine_index->update(uid, user_song_plays[uid], reshaped);
+            candidates = reshaped.candidates;
+            edges = move(reshaped.row);
+        } else if (minhash) {
+            minhash_index->candidates(uid, candidates);
+        } else {
+            for (uint32_t sid : likes) {
+                candidates.insert(candidates.end(), song_likers[sid].begin(), song_likers[sid].end());
+            }
+            sort(candidates.begin(), candidates.end());
+            candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+        }
+
+        size_t others = users.size() - 1;
+        size_t scored = candidates.size() - (binary_search(candidates.begin(), candidates.end(), uid) ? 1 : 0);
+        similarity_pairs_scored.add(scored);
+        similarity_pairs_skipped.add(others - scored);
+
+        if (!cosine) {
+            for (uint32_t v : candidates) {
+                if (v == uid) continue;
+                double similarity = minhash ? minhash_index->score(uid, v, user_liked_songs)
+                                  : WeightedGraph::jaccardSimilarity(likes, user_liked_songs[v]);
+                if (similarity > 0.0) edges.push_back({v, similarity});
+            }
+        }
+
+        unordered_set<uint32_t> linked; // old neighbors at or above the threshold
+        vector<uint32_t> rankers = candidates;
+        for (auto edge : user_graph.getNeighbors(uid)) {
+            if (edge.second >= similarity_threshold) linked.insert(edge.first);
+            rankers.push_back(edge.first);
+        }
+
+        // Every user ranking uid is a candidate or an old neighbor
+        // (MINHASH candidates can shrink)
+        invalidateRankers(uid, rankers);
+        user_graph.replaceEdges(uid, edges);
+        invalidateRankers(uid, rankers);
+        for (const auto &link : reshaped.unlinked) {
+            user_graph.removeEdge(link.first, link.second);
+            result_cache.invalidateUser(link.first);
+            result_cache.invalidateUser(link.second);
+        }
+        for (const auto &link : reshaped.linked) {
+            user_graph.insertEdge(link.u1, link.u2, link.weight);
+            result_cache.invalidateUser(link.u1);
+            result_cache.invalidateUser(link.u2);
+        }
+
+        for (const auto &e : edges) {
+            if (e.second >= similarity_threshold) {
+                linked.erase(e.first);
+                linkCommunities(uid, e.first);
+            }
+        }
+        if (!linked.empty()) splitCommunity(uid);
+    }
+
+    // Interns a user and gives it a community, for users first seen live
+    uint32_t internLiveUser(const string& user_id) {
+        uint32_t uid = internUser(user_id);
+        communities.makeSet(uid);
+        return uid;
+    }
+
+    bool isCatalogSong(uint32_t song_idx) const {
+        return song_idx < songs.size();
+    }
+
+    uint32_t internUser(const string& user_id) {
+        uint32_t uid = user_ids.intern(user_id);
+        if (uid == users.size()) {
+            users.emplace_back(user_id, "");
+            user_song_plays.emplace_back();
+            user_liked_songs.emplace_back();
+        }
+        return uid;
+    }
+
+    void buildUserSimilarities() {
+        uint32_t num_users = static_cast<uint32_t>(users.size());
+        for (uint32_t uid = 0; uid < num_users; ++uid) {
+            communities.makeSet(uid);
+        }
+
+        // Edges arrive in all-pairs order in both modes, so unions are
+        // applied deterministically on this thread after the merge.
+        auto emit = [&](uint32_t u1, uint32_t u2, double similarity) {
+            user_graph.addEdge(u1, u2, similarity);
+
+            if (similarity >= similarity_threshold) {
+                communities.unionSets(u1, u2);
+            }
+        };
+
+        user_graph.setMaxNeighbors(static_cast<size_t>(max_user_neighbors));
+        ThreadPool* pool = worker_threads == 1 ? nullptr : &workerPool();
+        size_t threads = pool ? pool->size() : 1;
+        size_t scored;
+        graph_mode = similarity_mode;
+        minhash_index.reset();
+        cosine_index.reset();
+        if (similarity_mode == SimilarityMode::COSINE) {
+            CosineSimilarityBuilder builder(user_song_plays, song_ids.size(), static_cast<size_t>(cosine_neighbors),
+                                            similarity_threshold);
+            cout << "Play-count cosine over " << builder.getNonZeros() << " user-song entries, ";
+            if (cosine_neighbors > 0) cout << "top " << cosine_neighbors << " neighbors per user." << endl;
+            else cout << "all neighbors kept." << endl;
+            CosineSimilarityBuilder::Retention kept;
+            scored = pool ? builder.buildParallel(*pool, emit, &kept) : builder.build(emit, &kept);
+            cosine_index.reset(new CosineIndex(user_song_plays, song_ids.size(), move(kept)));
+        } else if (similarity_mode == SimilarityMode::MINHASH) {
+            MinHashSimilarityBuilder builder(user_liked_songs, minhash_options, pool);
+            const MinHashOptions &used = builder.getOptions();
+            cout << "MinHash LSH with " << used.bands << " bands x " << used.rows_per_band << " rows ("
+                 << (used.verify ? "verified" : "estimated") << " similarity)." << endl;
+            scored = pool ? builder.buildParallel(*pool, emit) : builder.build(emit);
+            minhash_index.reset(new MinHashIndex(builder, user_liked_songs));
+        } else {
+            UserSimilarityBuilder builder(user_liked_songs, song_ids.size());
+            scored = pool ? builder.buildParallel(*pool, emit) : builder.build(emit);
         }
+        user_graph.freeze();
+        size_t possible = static_cast<size_t>(num_users) * (num_users > 0 ? num_users - 1 : 0) / 2;
+        similarity_pairs_scored.add(scored);
+        similarity_pairs_skipped.add(possible - scored);
+
+        cout << "Scored " << scored << " candidate pairs of " << possible << " possible on " << threads << " thread(s)." << endl;
 
         cout << "Built user similarity graph with "
              << user_graph.getEdgeCount()
-             << " edges across " << users.size() << " users." << endl;
+             << " edges across " << num_users << " users." << endl;
 
         cout << "Formed "
              << communities.getNumberOfCommunities()
              << " taste communities." << endl;
+
+        // Ties rank by song_id like Recommendation::operator<
+        community_songs.build(communities, user_liked_songs, songs.size(),
+            [this](uint32_t a, uint32_t b) { return songs[a].song_id < songs[b].song_id; });
+
+        buildSongLikers();
     }
 
 
 
 public:
     // ----- Accessors (read-only) -----
-    const unordered_map<string, User>& getUserMap() const { return user_map; }
-    const unordered_map<string, Song>& getSongMap() const { return song_map; }
+    const vector<User>& getUsers() const { return users; }
+    const vector<Song>& getSongs() const { return songs; }
+    const vector<Artist>& getArtists() const { return artists; }
+    const IdRegistry& getUserIds() const { return user_ids; }
+    const IdRegistry& getSongIds() const { return song_ids; }
+    const IdRegistry& getArtistIds() const { return artist_ids; }
     const WeightedGraph& getUserGraph() const { return user_graph; }
     const BipartiteGraph& getBipartiteGraph() const { return bipartite_graph; }
-    UnionFind& getCommunities() { return communities; }
+    const UnionFind& getCommunities() const { return communities; }
 
     int getKNearest() const { return k_nearest; }
+
+    // Worker threads for parallel build phases (0 = hardware concurrency,
+    // 1 = serial). Takes effect if set before initialize().
+    void setWorkerThreads(int threads) {
+        lock_guard<mutex> lock(pool_mutex);
+        worker_threads = threads < 0 ? 0 : threads;
+        worker_pool.reset();
+    }
+
+    // Run the four pillars of generateRecommendations concurrently on the
+    // worker pool. With a timeout, a pillar that has not finished by then
+    // is left out of the fusion instead of stalling the request.
+    void setParallelPillars(bool enabled, int timeout_ms = 0) {
+        parallel_pillars = enabled;
+        pillar_timeout_ms = timeout_ms < 0 ? 0 : timeout_ms;
+    }
+
+    // Pillars dropped from fused results because they missed the timeout
+    uint64_t getPillarTimeoutCount() const { return query_metrics->pillar_timeouts.load(); }
+
+    // Pillar tasks still reading the engine, possibly for requests that
+    // already returned; the engine may only be updated once this is 0
+    size_t getRunningPillarTasks() const { return running_pillar_tasks.load(memory_order_acquire); }
+
+    // Blocks until getRunningPillarTasks() is 0; the tasks' accesses happen-before return
+    void waitForPillarTasks() const {
+        unique_lock<mutex> lock(pillar_tasks_mutex);
+        pillar_tasks_done.wait(lock, [this] { return running_pillar_tasks.load(memory_order_acquire) == 0; });
+    }
+
+    // Typo tolerance for searchAutocomplete: up to max_edits edits (one per
+    // four typed characters), within budget_us microseconds per query
+    void setFuzzySearch(int max_edits, long budget_us = 1000) {
+        fuzzy_max_edits = max_edits < 0 ? 0 : max_edits;
+        fuzzy_budget_us = budget_us < 0 ? 0 : budget_us;
+    }
+
+    /**
+     * Caches generateRecommendations() results per (user, num_recs, pillar
+     * weights) in a sharded LRU of budget_bytes (0 = off, the default).
+     * Entries live ttl_ms (0 = until evicted); interaction updates evict
+     * exactly the users whose results they can change. Drops the current
+     * contents. Not safe to call concurrently with queries.
+     */
+    void setResultCache(size_t budget_bytes, int ttl_ms = 0) {
+        result_cache.configure(budget_bytes, ttl_ms);
+    }
+
+    const ResultCache<FusionParams, vector<Recommendation>>& getResultCache() const { return result_cache; }
+
+    // Fusion weight of each pillar's scores (defaults 1.0, 1.2, 0.9, 0.8)
+    void setPillarWeights(double content, double user_collab, double artist, double community) {
+        double weights[NUM_PILLARS] = {content, user_collab, artist, community};
+        for (int p = 0; p < NUM_PILLARS; ++p) pillar_weights[p] = weights[p] < 0.0 ? 0.0 : weights[p];
+    }
+
+    /**
+     * Also keep songs a user played at least min_plays times out of their
+     * recommendations (0 = exclude liked songs only). Rebuilds the
+     * exclusion filter if the engine is already built.
+     */
+    void setExcludePlayedSongs(int min_plays) {
+        exclude_played_min = min_plays < 0 ? 0 : min_plays;
+        if (content_index) buildExclusions();
+        result_cache.clear();
+    }
+
+    /**
+     * Never recommend songs by artist_id to user_id (e.g. a "don't play
+     * this artist" action). Unknown users are added; returns false if the
+     * artist is unknown. Not safe to call concurrently with queries.
+     */
+    bool blockArtist(const string& user_id, const string& artist_id) {
+        uint32_t aid = artist_ids.find(artist_id);
+        if (aid == INVALID_ID) return false;
+        uint32_t uid = internLiveUser(user_id);
+        if (uid >= user_blocked_artists.size()) user_blocked_artists.resize(uid + 1);
+        auto &blocked = user_blocked_artists[uid];
+        auto pos = lower_bound(blocked.begin(), blocked.end(), aid);
+        if (pos != blocked.end() && *pos == aid) return true;
+        blocked.insert(pos, aid);
+        if (aid < artist_songs.size()) {
+            for (uint32_t sid : artist_songs[aid]) exclusions.add(uid, sid);
+        }
+        result_cache.invalidateUser(uid);
+        return true;
+    }
+
+    const ExclusionFilter& getExclusionFilter() const { return exclusions; }
+
+    // Fuzzy searches cut short by their latency budget
+    uint64_t getFuzzyTimeoutCount() const { return query_metrics->fuzzy_timeouts.load(); }
+
+    // Nearest-neighbor backend for the content pillar. Takes effect if set
+    // before initialize().
+    void setNeighborBackend(NeighborBackend backend) {
+        neighbor_backend = backend;
+    }
+
+    const NearestNeighborIndex* getContentIndex() const { return content_index.get(); }
+
+    /**
+     * How the user similarity graph, and so the community threshold,
+     * scores pairs: Jaccard of liked songs over every pair sharing one
+     * (EXACT, the default) or over MinHash/LSH candidates (MINHASH, tuned
+     * by options), which may miss pairs to save build time; or play-count
+     * weighted cosine (COSINE, see setCosineNeighbors).
+     * Takes effect from the next initialize() or rebuildCommunities();
+     * incremental updates rescore with the graph's metric and, for
+     * MINHASH, its LSH candidates, so they match a full rebuild.
+     */
+    void setSimilarityMode(SimilarityMode mode, const MinHashOptions& options = MinHashOptions()) {
+        similarity_mode = mode;
+        minhash_options = options;
+    }
+
+    SimilarityMode getSimilarityMode() const { return similarity_mode; }
+
+    // Neighbors kept per user in COSINE mode besides those at or above the
+    // community threshold (default 50, 0 = keep all). Takes effect if set
+    // before the graph is built.
+    void setCosineNeighbors(int k) {
+        cosine_neighbors = k < 0 ? 0 : k;
+    }
+
+    // Keep only each user's top-m most similar neighbors in the user graph
+    // (0 = keep all). Communities still use every edge above the threshold.
+    // Takes effect if set before initialize().
+    void setMaxUserNeighbors(int m) {
+        max_user_neighbors = m < 0 ? 0 : m;
+    }
+
+    const User* findUser(const string& user_id) const {
+        uint32_t uid = user_ids.find(user_id);
+        return uid == INVALID_ID ? nullptr : &users[uid];
+    }
+
+    const Song* findSong(const string& song_id) const {
+        uint32_t sid = song_ids.find(song_id);
+        return (sid == INVALID_ID || !isCatalogSong(sid)) ? nullptr : &songs[sid];
+    }
+
     int getKSimilarUsers() const { return k_similar_users; }
 
 
-    void normalizePillarScores(std::vector<Recommendation>& recs, double pillarMax) {
+    void normalizePillarScores(std::vector<Recommendation>& recs, double pillarMax) const {
         if (recs.empty()) return;
 
         if (pillarMax <= 0.0) return;
@@ -102,61 +750,112 @@ public:
     }
 
     // initialize: populate maps, trie, interactions and build similarities
+    // Catalog vectors are taken by value: pass them with std::move to hand
+    // the loaded entities over without copying
     void initialize(
-        const vector<Song>& songs,
-        const vector<Artist>& artists,
-        const vector<User>& users,
+        vector<Song> song_list,
+        vector<Artist> artist_list,
+        vector<User> user_list,
         const vector<UserSongInteraction>& song_interactions,
         const vector<UserArtistInteraction>& artist_interactions
     ) {
         cout << "\n=== Initializing Recommendation Engine ===" << endl;
 
-        // build maps and trie
-        for (const auto &s : songs) {
-            song_map[s.song_id] = s;
-            artist_songs[s.artist_id].push_back(s.song_id);
-            search_trie.insert(s.title);
+        // intern catalog ids first so they occupy the low, dense ranges
+        songs.reserve(song_list.size());
+        for (auto &s : song_list) {
+            uint32_t sid = song_ids.intern(s.song_id);
+            if (sid == songs.size()) songs.push_back(move(s));
+            else songs[sid] = move(s);
+        }
+        artists.reserve(artist_list.size());
+        for (auto &a : artist_list) {
+            uint32_t aid = artist_ids.intern(a.artist_id);
+            if (aid == artists.size()) artists.push_back(move(a));
+            else artists[aid] = move(a);
+        }
+        for (auto &u : user_list) {
+            uint32_t uid = internUser(u.user_id);
+            users[uid] = move(u);
+        }
+
+        // build artist->songs and trie
+        Trie search_trie;
+        for (uint32_t sid = 0; sid < songs.size(); ++sid) {
+            uint32_t aid = artist_ids.intern(songs[sid].artist_id);
+            if (aid >= artist_songs.size()) artist_songs.resize(aid + 1);
+            artist_songs[aid].push_back(sid);
+            search_trie.insert(songs[sid].title);
+        }
+        // Songs of an artist in song_id order, the artist pillar's tie order
+        for (auto &list : artist_songs) {
+            sort(list.begin(), list.end(),
+                [this](uint32_t a, uint32_t b) { return songs[a].song_id < songs[b].song_id; });
         }
         for (const auto &a : artists) {
-            artist_map[a.artist_id] = a;
             search_trie.insert(a.artist_name);
         }
-        for (const auto &u : users) {
-            user_map[u.user_id] = u;
-        }
 
         // interactions
         for (const auto &it : song_interactions) {
-            user_song_plays[it.user_id][it.song_id] = it.play_count;
+            uint32_t uid = internUser(it.user_id);
+            uint32_t sid = song_ids.intern(it.song_id);
+            user_song_plays[uid][sid] = it.play_count;
             if (it.liked) {
-                user_liked_songs[it.user_id].insert(it.song_id);
-                user_map[it.user_id].liked_songs.push_back(it.song_id);
+                user_liked_songs[uid].push_back(sid);
+                users[uid].liked_songs.push_back(it.song_id);
             }
-            if (it.play_count > 10) {
-                auto sit = song_map.find(it.song_id);
-                if (sit != song_map.end()) search_trie.incrementFrequency(sit->second.title);
+            if (it.play_count > 10 && isCatalogSong(sid)) {
+                search_trie.incrementFrequency(songs[sid].title);
             }
         }
 
-        // PILLAR 1: Build K-D Tree for content-based filtering
-        std::cout << "\n[Pillar 1] Building K-D Tree for content-based filtering..." << std::endl;
-        kdtree.build(songs);
-        std::cout << "K-D Tree built with " << songs.size() << " songs." << std::endl;
+        for (auto &likes : user_liked_songs) {
+            sort(likes.begin(), likes.end());
+            likes.erase(unique(likes.begin(), likes.end()), likes.end());
+        }
+        buildExclusions();
+
+        // Freeze the search trie; the pointer trie is dropped on return
+        {
+            metrics::ScopedTimer timer(build_search_latency);
+            search_index.build(search_trie);
+        }
+        std::cout << "Search index frozen: " << search_index.size() << " entries, "
+                  << search_index.getNodeCount() << " nodes, "
+                  << search_index.memoryUsage() / 1024 << " KB." << std::endl;
+
+        // PILLAR 1: Build nearest-neighbor index for content-based filtering
+        content_index = makeNeighborIndex(neighbor_backend);
+        content_backend = neighbor_backend;
+        std::cout << "\n[Pillar 1] Building " << content_index->name()
+                  << " index for content-based filtering..." << std::endl;
+        {
+            metrics::ScopedTimer timer(build_content_latency);
+            content_index->build(songs);
+        }
+        std::cout << "Content index built with " << content_index->size() << " songs." << std::endl;
 
         // PILLAR 2 & 4: Build user-user graph and taste communities
         std::cout << "\n[Pillar 2 & 4] Building user similarity graph and taste communities..." << std::endl;
-        buildUserSimilarities();
+        {
+            metrics::ScopedTimer timer(build_similarity_latency);
+            buildUserSimilarities();
+        }
 
         // PILLAR 3: Build bipartite user-artist graph
         std::cout << "\n[Pillar 3] Building bipartite user-artist graph..." << std::endl;
-        for (const auto& interaction : artist_interactions) {
-            bipartite_graph.addEdge(
-                interaction.user_id,
-                interaction.artist_id,
-                interaction.play_count
-            );
-        }
-        bipartite_graph.normalizeWeights();
+        {
+            metrics::ScopedTimer timer(build_bipartite_latency);
+            for (const auto& interaction : artist_interactions) {
+                bipartite_graph.addEdge(
+                    internUser(interaction.user_id),
+                    artist_ids.intern(interaction.artist_id),
+                    interaction.play_count
+                );
+            }
+            bipartite_graph.freeze(artist_songs);
+        }
         std::cout << "Bipartite graph built with " << bipartite_graph.getUserCount()
                   << " users and " << bipartite_graph.getArtistCount() << " artists." << std::endl;
 
@@ -164,156 +863,617 @@ public:
     }
 
     // PILLAR 1: Content-based via KDTree
-    vector<Recommendation> getContentBasedRecommendations(const string& user_id, int num_recommendations = 10) {
-        vector<Recommendation> recommendations;
-        auto it = user_liked_songs.find(user_id);
-        if (it == user_liked_songs.end() || it->second.empty()) return recommendations;
-
-        unordered_map<string, double> scores;
-        for (const auto &liked : it->second) {
-            auto sit = song_map.find(liked);
-            if (sit == song_map.end()) continue;
-            vector<string> neighbors;
-            try {
-                neighbors = kdtree.findSimilarSongs(sit->second, k_nearest);
-            } catch(...) { continue; }
-            for (const auto &nid : neighbors) {
-                if (it->second.find(nid) == it->second.end()) scores[nid] += 1.0;
-            }
-        }
+    vector<Recommendation> getContentBasedRecommendations(const string& user_id, int num_recommendations = 10) const {
+        return pillarRecommendations(0, user_id, num_recommendations);
+    }
+
+    // PILLAR 2: User collaborative
+    vector<Recommendation> getUserCollaborativeRecommendations(const string& user_id, int num_recommendations = 10) const {
+        return pillarRecommendations(1, user_id, num_recommendations);
+    }
+
+    // PILLAR 3: Artist-based via bipartite graph
+    vector<Recommendation> getArtistBasedRecommendations(const string& user_id, int num_recommendations = 10) const {
+        return pillarRecommendations(2, user_id, num_recommendations);
+    }
+
+    // PILLAR 4: Community-based
+    vector<Recommendation> getCommunityBasedRecommendations(const string& user_id, int num_recommendations = 10) const {
+        return pillarRecommendations(3, user_id, num_recommendations);
+    }
 
-        for (const auto &p : scores) {
-            auto sit = song_map.find(p.first);
-            if (sit != song_map.end()) recommendations.emplace_back(p.first, sit->second.title, p.second, "content");
+    // community helpers
+    string getUserCommunity(const string& user_id) const {
+        uint32_t uid = user_ids.find(user_id);
+        if (uid == INVALID_ID) return string();
+        uint32_t root = communities.getCommunity(uid);
+        return root == INVALID_ID ? string() : user_ids.name(root);
+    }
+    int getCommunitySize(const string& user_id) const {
+        uint32_t uid = user_ids.find(user_id);
+        return uid == INVALID_ID ? 0 : communities.getCommunitySize(uid);
+    }
+
+    // Song titles and artist names starting with prefix, most played
+    // first; topped up with near-miss (typo) matches when there are fewer
+    // than limit
+    vector<string> searchAutocomplete(const string& prefix, int limit = 10) const {
+        if (prefix.empty()) return {};
+        metrics::ScopedTimer timer(query_metrics->autocomplete);
+        vector<string> results = search_index.autocomplete(prefix, limit);
+
+        int max_edits = min(fuzzy_max_edits, static_cast<int>(prefix.size() / 4));
+        if (max_edits == 0 || static_cast<int>(results.size()) >= limit) return results;
+
+        bool timed_out = false;
+        auto fuzzy = search_index.fuzzyAutocomplete(prefix, limit, max_edits, fuzzy_budget_us, &timed_out);
+        if (timed_out) query_metrics->fuzzy_timeouts++;
+
+        // Exact matches are also the 0-edit fuzzy matches, ranked first
+        unordered_set<string> seen(results.begin(), results.end());
+        for (auto &suggestion : fuzzy) {
+            if (static_cast<int>(results.size()) >= limit) break;
+            if (seen.insert(suggestion).second) results.push_back(move(suggestion));
         }
-        sort(recommendations.begin(), recommendations.end());
-        if ((int)recommendations.size() > num_recommendations) recommendations.resize(num_recommendations);
-        return recommendations;
+        return results;
     }
 
-    // PILLAR 2: User collaborative
-    vector<Recommendation> getUserCollaborativeRecommendations(const string& user_id, int num_recommendations = 10) {
-        vector<Recommendation> recommendations;
-        auto similar = user_graph.getTopKSimilarUsers(user_id, k_similar_users);
-        if (similar.empty()) return recommendations;
-        unordered_map<string, double> scores;
-        auto &cur = user_liked_songs[user_id];
-        for (const auto &p : similar) {
-            const string &other = p.first;
-            double sim = p.second;
-            for (const auto &sid : user_liked_songs[other]) {
-                if (cur.find(sid) == cur.end()) scores[sid] += sim;
-            }
+    // Persist / restore the frozen search index (e.g. to start a search
+    // node without rebuilding it). Return false on I/O or format errors.
+    bool saveSearchIndex(const string& filepath) const {
+        return search_index.save(filepath);
+    }
+    bool loadSearchIndex(const string& filepath) {
+        return search_index.load(filepath);
+    }
+    const CompactTrie& getSearchIndex() const { return search_index; }
+
+    /**
+     * Writes the fully built engine (entities, ID dictionaries and every
+     * pillar's frozen structure) to a binary snapshot, see core/snapshot.h.
+     * Returns false before initialize() or on I/O errors.
+     */
+    bool saveSnapshot(const string& filepath) const {
+        if (!content_index) return false;
+        SnapshotWriter out;
+
+        SnapshotMeta meta = {static_cast<uint32_t>(content_backend), static_cast<uint32_t>(songs.size()),
+                             static_cast<uint32_t>(artists.size()), static_cast<uint32_t>(users.size())};
+        out.putValue("engine.meta", meta);
+        out.putValue("engine.similarity_mode", static_cast<uint32_t>(graph_mode));
+        if (minhash_index) {
+            const MinHashOptions &used = minhash_index->getOptions();
+            SnapshotMinHash saved = {static_cast<uint32_t>(used.bands), static_cast<uint32_t>(used.rows_per_band),
+                                     used.verify ? 1U : 0U, 0, used.max_bucket_size, used.seed};
+            out.putValue("engine.minhash_options", saved);
+            minhash_index->save(out, "minhash");
         }
-        for (const auto &q : scores) {
-            auto sit = song_map.find(q.first);
-            if (sit != song_map.end()) recommendations.emplace_back(q.first, sit->second.title, q.second, "user-collab");
+        if (cosine_index) cosine_index->save(out, "cosine");
+
+        user_ids.save(out, "user_ids");
+        song_ids.save(out, "song_ids");
+        artist_ids.save(out, "artist_ids");
+
+        // Entity ids are the registry names; the rest is stored per field
+        vector<string> titles, song_artists, song_genres, moods;
+        vector<SongFeatures> features;
+        for (const auto &song : songs) {
+            titles.push_back(song.title);
+            song_artists.push_back(song.artist_id);
+            song_genres.push_back(song.genre);
+            moods.push_back(song.mood);
+            features.push_back({song.bpm, song.energy, song.danceability, song.valence});
         }
-        sort(recommendations.begin(), recommendations.end());
-        if ((int)recommendations.size() > num_recommendations) recommendations.resize(num_recommendations);
-        return recommendations;
+        out.putStrings("songs.title", titles);
+        out.putStrings("songs.artist_id", song_artists);
+        out.putStrings("songs.genre", song_genres);
+        out.putStrings("songs.mood", moods);
+        out.putArrayCopy("songs.features", features);
+
+        vector<string> artist_names, artist_genres;
+        for (const auto &artist : artists) {
+            artist_names.push_back(artist.artist_name);
+            artist_genres.push_back(artist.genre);
+        }
+        out.putStrings("artists.name", artist_names);
+        out.putStrings("artists.genre", artist_genres);
+
+        vector<string> usernames;
+        vector<int32_t> community_ids;
+        vector<vector<string>> liked, history;
+        for (const auto &user : users) {
+            usernames.push_back(user.username);
+            community_ids.push_back(user.community_id);
+            liked.push_back(user.liked_songs);
+            history.push_back(user.play_history);
+        }
+        out.putStrings("users.username", usernames);
+        out.putArrayCopy("users.community_id", community_ids);
+        out.putStringLists("users.liked_songs", liked);
+        out.putStringLists("users.play_history", history);
+
+        vector<vector<PlayCount>> plays(user_song_plays.size());
+        for (size_t uid = 0; uid < user_song_plays.size(); ++uid) {
+            for (const auto &p : user_song_plays[uid]) plays[uid].push_back({p.first, p.second});
+            sort(plays[uid].begin(), plays[uid].end(),
+                [](const PlayCount& a, const PlayCount& b) { return a.song < b.song; });
+        }
+        out.putLists("engine.user_song_plays", plays);
+        out.putLists("engine.user_liked_songs", user_liked_songs);
+        out.putLists("engine.artist_songs", artist_songs);
+        out.putLists("engine.user_blocked_artists", user_blocked_artists);
+
+        content_index->save(out, "content");
+        user_graph.save(out, "user_graph");
+        communities.save(out, "communities");
+        community_songs.save(out, "community_songs");
+        bipartite_graph.save(out, "bipartite");
+        search_index.save(out, "search");
+
+        return out.writeFile(filepath);
     }
 
-    // PILLAR 3: Artist-based via bipartite graph
-    vector<Recommendation> getArtistBasedRecommendations(const string& user_id, int num_recommendations = 10) {
-        vector<Recommendation> recommendations;
-        try {
-            auto song_scores = bipartite_graph.recommendFromTopArtists(user_id, artist_songs, top_artists);
-            auto &user_likes = user_liked_songs[user_id];
-            for (const auto &p : song_scores) {
-                if (user_likes.find(p.first) == user_likes.end()) {
-                    auto sit = song_map.find(p.first);
-                    if (sit != song_map.end()) recommendations.emplace_back(p.first, sit->second.title, p.second, "artist-collab");
+    /**
+     * Replaces the engine's state with a snapshot written by saveSnapshot(),
+     * instead of initialize(). Query-time settings (k, pillar timeouts,
+     * fuzzy search) keep their current values; the content backend and
+     * the user graph's similarity metric are the ones the snapshot was
+     * built with. Returns false, leaving the engine
+     * empty, if the file is missing, from another format version or
+     * inconsistent: every offset and id is checked against the array it
+     * indexes before it is used.
+     */
+    bool loadSnapshot(const string& filepath) {
+        resetState();
+        SnapshotReader in(filepath);
+        SnapshotMeta meta;
+        if (!in.isValid() || !in.getValue("engine.meta", meta) ||
+            meta.neighbor_backend > static_cast<uint32_t>(NeighborBackend::IVF)) {
+            return false;
+        }
+
+        vector<string> titles, song_artists, song_genres, moods, artist_names, artist_genres, usernames;
+        vector<SongFeatures> features;
+        vector<int32_t> community_ids;
+        vector<vector<string>> liked, history;
+        vector<vector<PlayCount>> plays;
+        content_backend = static_cast<NeighborBackend>(meta.neighbor_backend);
+        content_index = makeNeighborIndex(content_backend);
+        size_t num_songs = meta.num_songs, num_artists = meta.num_artists, num_users = meta.num_users;
+
+        bool ok = user_ids.load(in, "user_ids") && song_ids.load(in, "song_ids") && artist_ids.load(in, "artist_ids") &&
+            in.getStrings("songs.title", titles) && in.getStrings("songs.artist_id", song_artists) &&
+            in.getStrings("songs.genre", song_genres) && in.getStrings("songs.mood", moods) &&
+            in.getArray("songs.features", features) &&
+            in.getStrings("artists.name", artist_names) && in.getStrings("artists.genre", artist_genres) &&
+            in.getStrings("users.username", usernames) && in.getArray("users.community_id", community_ids) &&
+            in.getStringLists("users.liked_songs", liked) && in.getStringLists("users.play_history", history) &&
+            in.getLists("engine.user_song_plays", plays) &&
+            in.getLists("engine.user_liked_songs", user_liked_songs) &&
+            in.getLists("engine.artist_songs", artist_songs) &&
+            content_index->load(in, "content") && user_graph.load(in, "user_graph", num_users) &&
+            communities.load(in, "communities", num_users) &&
+            community_songs.load(in, "community_songs", num_songs, num_users) &&
+            bipartite_graph.load(in, "bipartite", num_songs) && search_index.load(in, "search");
+
+        ok = ok && song_ids.size() >= num_songs && artist_ids.size() >= num_artists && user_ids.size() == num_users &&
+            titles.size() == num_songs && song_artists.size() == num_songs && song_genres.size() == num_songs &&
+            moods.size() == num_songs && features.size() == num_songs &&
+            artist_names.size() == num_artists && artist_genres.size() == num_artists &&
+            usernames.size() == num_users && community_ids.size() == num_users && liked.size() == num_users &&
+            history.size() == num_users && plays.size() == num_users && user_liked_songs.size() == num_users &&
+            content_index->size() == num_songs && artist_songs.size() <= artist_ids.size();
+        // Likes are sorted and duplicate-free; plays and likes may name
+        // songs only seen in interactions, artists' songs are catalog songs
+        for (size_t uid = 0; ok && uid < num_users; ++uid) {
+            const auto &likes = user_liked_songs[uid];
+            ok = snapshot::allBelow(likes, song_ids.size()) && adjacent_find(likes.begin(), likes.end(),
+                [](uint32_t a, uint32_t b) { return a >= b; }) == likes.end();
+            for (const auto &p : plays[uid]) ok = ok && p.song < song_ids.size();
+        }
+        for (size_t aid = 0; ok && aid < artist_songs.size(); ++aid) ok = snapshot::allBelow(artist_songs[aid], num_songs);
+        if (!ok) {
+            resetState();
+            return false;
+        }
+
+        songs.reserve(num_songs);
+        for (uint32_t sid = 0; sid < num_songs; ++sid) {
+            const SongFeatures &f = features[sid];
+            songs.emplace_back(song_ids.name(sid), move(titles[sid]), move(song_artists[sid]), move(song_genres[sid]),
+                               f.bpm, f.energy, f.danceability, f.valence, move(moods[sid]));
+        }
+        artists.reserve(num_artists);
+        for (uint32_t aid = 0; aid < num_artists; ++aid) {
+            artists.emplace_back(artist_ids.name(aid), move(artist_names[aid]), move(artist_genres[aid]));
+        }
+        users.reserve(num_users);
+        user_song_plays.resize(num_users);
+        for (uint32_t uid = 0; uid < num_users; ++uid) {
+            users.emplace_back(user_ids.name(uid), move(usernames[uid]));
+            users[uid].community_id = community_ids[uid];
+            users[uid].liked_songs = move(liked[uid]);
+            users[uid].play_history = move(history[uid]);
+            user_song_plays[uid].reserve(plays[uid].size());
+            for (const auto &p : plays[uid]) user_song_plays[uid].emplace(p.song, p.plays);
+        }
+
+        community_songs.setTieOrder(
+            [this](uint32_t a, uint32_t b) { return songs[a].song_id < songs[b].song_id; });
+        // Optional: absent from snapshots written before similarity modes (EXACT)
+        uint32_t mode = 0;
+        if (in.getValue("engine.similarity_mode", mode) && mode <= static_cast<uint32_t>(SimilarityMode::COSINE)) {
+            graph_mode = static_cast<SimilarityMode>(mode);
+        }
+        // Optional: absent from snapshots written before incremental MinHash
+        // rescoring (the current setting is assumed, and the index rebuilt)
+        if (graph_mode == SimilarityMode::MINHASH) {
+            MinHashOptions used = minhash_options;
+            SnapshotMinHash saved;
+            if (in.getValue("engine.minhash_options", saved)) {
+                used.bands = static_cast<int>(saved.bands);
+                used.rows_per_band = static_cast<int>(saved.rows_per_band);
+                used.verify = saved.verify != 0;
+                used.max_bucket_size = static_cast<size_t>(saved.max_bucket_size);
+                used.seed = saved.seed;
+            }
+            minhash_index.reset(new MinHashIndex(used));
+            if (in.has("minhash.signatures")) {
+                if (!minhash_index->load(in, "minhash", users.size())) {
+                    resetState();
+                    return false;
                 }
+            } else {
+                cout << "Snapshot has no MinHash index, re-signing " << users.size() << " users." << endl;
+                MinHashSimilarityBuilder builder(user_liked_songs, used, worker_threads == 1 ? nullptr : &workerPool());
+                minhash_index.reset(new MinHashIndex(builder, user_liked_songs));
             }
-        } catch(...) {
-            // fallback empty
         }
-        sort(recommendations.begin(), recommendations.end());
-        if ((int)recommendations.size() > num_recommendations) recommendations.resize(num_recommendations);
-        return recommendations;
+        // Optional: absent from snapshots written before incremental cosine
+        // retention (rebuilt with the current setting)
+        if (graph_mode == SimilarityMode::COSINE) {
+            cosine_index.reset(new CosineIndex());
+            if (in.has("cosine.options")) {
+                if (!cosine_index->load(in, "cosine", user_song_plays, song_ids.size())) {
+                    resetState();
+                    return false;
+                }
+            } else {
+                cout << "Snapshot has no cosine retention, rescoring the play-count cosine graph." << endl;
+                CosineSimilarityBuilder builder(user_song_plays, song_ids.size(), static_cast<size_t>(cosine_neighbors),
+                                                similarity_threshold);
+                CosineSimilarityBuilder::Retention kept;
+                builder.build([](uint32_t, uint32_t, double) {}, &kept);
+                cosine_index.reset(new CosineIndex(user_song_plays, song_ids.size(), move(kept)));
+            }
+        }
+        buildSongLikers();
+        // Optional: absent from snapshots written before artist blocking
+        if (!in.getLists("engine.user_blocked_artists", user_blocked_artists)) user_blocked_artists.clear();
+        bool blocked_ok = user_blocked_artists.size() <= num_users;
+        for (const auto &blocked : user_blocked_artists) blocked_ok = blocked_ok && snapshot::allBelow(blocked, artist_ids.size());
+        if (!blocked_ok) {
+            resetState();
+            return false;
+        }
+        buildExclusions();
+
+        cout << "Loaded snapshot: " << songs.size() << " songs, " << artists.size() << " artists, "
+             << users.size() << " users, " << content_index->name() << " content index." << endl;
+        return true;
     }
 
-    // PILLAR 4: Community-based
-    vector<Recommendation> getCommunityBasedRecommendations(const string& user_id, int num_recommendations = 10) {
-        vector<Recommendation> recommendations;
-        auto members = communities.getCommunityMembers(user_id);
-        if (members.size() <= 1) return recommendations;
-        unordered_map<string, double> song_scores;
-        auto &cur = user_liked_songs[user_id];
-        for (const auto &m : members) {
-            if (m == user_id) continue;
-            for (const auto &sid : user_liked_songs[m]) {
-                if (cur.find(sid) == cur.end()) song_scores[sid] += 1.0;
-            }
+    // ----- Instrumentation -----
+
+    /**
+     * Per-operation latency (count, p50/p99, max), hot-path counters and
+     * the memory held by each data structure. Export with toJson() or
+     * toPrometheus(). Latencies and counters read 0 when built with
+     * REC_DISABLE_METRICS; memory is always reported.
+     */
+    metrics::Report getStats() const {
+        static const char* PILLAR_NAMES[NUM_PILLARS] = {"content", "user_collab", "artist", "community"};
+        metrics::Report report;
+
+        for (int p = 0; p < NUM_PILLARS; ++p) {
+            report.addLatency(string("pillar_") + PILLAR_NAMES[p], query_metrics->pillars[p].latency);
         }
-        for (const auto &p : song_scores) {
-            auto sit = song_map.find(p.first);
-            if (sit != song_map.end()) recommendations.emplace_back(p.first, sit->second.title, p.second, "community");
+        report.addLatency("generate_recommendations", query_metrics->fused);
+        report.addLatency("batch_recommendation", query_metrics->batch);
+        report.addLatency("autocomplete", query_metrics->autocomplete);
+        report.addLatency("build_search_index", build_search_latency);
+        report.addLatency("build_content_index", build_content_latency);
+        report.addLatency("build_user_similarity", build_similarity_latency);
+        report.addLatency("build_bipartite_graph", build_bipartite_latency);
+
+        for (int p = 0; p < NUM_PILLARS; ++p) {
+            report.addCounter(string("pillar_") + PILLAR_NAMES[p] + "_candidates", query_metrics->pillars[p].candidates.get());
         }
-        sort(recommendations.begin(), recommendations.end());
-        if ((int)recommendations.size() > num_recommendations) recommendations.resize(num_recommendations);
-        return recommendations;
+        report.addCounter("content_index_visits", content_index ? content_index->getVisitCount() : 0);
+        report.addCounter("similarity_pairs_scored", similarity_pairs_scored.get());
+        report.addCounter("similarity_pairs_skipped", similarity_pairs_skipped.get());
+        report.addCounter("pillar_timeouts", query_metrics->pillar_timeouts.load());
+        report.addCounter("fuzzy_search_timeouts", query_metrics->fuzzy_timeouts.load());
+        report.addCounter("result_cache_hits", result_cache.getHits());
+        report.addCounter("result_cache_misses", result_cache.getMisses());
+        report.addCounter("result_cache_evictions", result_cache.getEvictions());
+        report.addCounter("result_cache_expirations", result_cache.getExpirations());
+        report.addCounter("result_cache_invalidations", result_cache.getInvalidations());
+
+        uint64_t lookups = result_cache.getHits() + result_cache.getMisses();
+        report.addGauge("result_cache_hit_ratio", lookups ? static_cast<double>(result_cache.getHits()) / lookups : 0.0);
+        report.addGauge("result_cache_entries", static_cast<double>(result_cache.size()));
+
+        size_t likes = user_liked_songs.capacity() * sizeof(vector<uint32_t>) +
+                       song_likers.capacity() * sizeof(vector<uint32_t>);
+        for (const auto &l : user_liked_songs) likes += l.capacity() * sizeof(uint32_t);
+        for (const auto &l : song_likers) likes += l.capacity() * sizeof(uint32_t);
+        size_t plays = user_song_plays.capacity() * sizeof(unordered_map<uint32_t, int>);
+        for (const auto &m : user_song_plays) {
+            plays += m.bucket_count() * sizeof(void*) + m.size() * (sizeof(pair<const uint32_t, int>) + sizeof(void*));
+        }
+        report.addMemory("content_index", content_index ? content_index->memoryUsage() : 0);
+        report.addMemory("user_graph", user_graph.memoryUsage());
+        report.addMemory("bipartite_graph", bipartite_graph.memoryUsage());
+        report.addMemory("communities", communities.memoryUsage());
+        report.addMemory("community_songs", community_songs.memoryUsage());
+        report.addMemory("search_index", search_index.memoryUsage());
+        report.addMemory("id_registries", user_ids.memoryUsage() + song_ids.memoryUsage() + artist_ids.memoryUsage());
+        report.addMemory("user_likes", likes);
+        report.addMemory("exclusion_filter", exclusions.memoryUsage());
+        report.addMemory("result_cache", result_cache.memoryUsage());
+        report.addMemory("user_song_plays", plays);
+        report.addMemory("minhash_index", minhash_index ? minhash_index->memoryUsage() : 0);
+        report.addMemory("cosine_index", cosine_index ? cosine_index->memoryUsage() : 0);
+        return report;
     }
 
-    // community helpers
-    string getUserCommunity(const string& user_id) { return communities.getCommunity(user_id); }
-    int getCommunitySize(const string& user_id) { return communities.getCommunitySize(user_id); }
-
-    // safe search fallback
-    vector<string> searchAutocomplete(const string& prefix, int limit = 10) {
-        vector<string> results;
-        if (prefix.empty()) return results;
-        for (const auto &p : song_map) {
-            const auto &title = p.second.title;
-            if (title.size() >= prefix.size() &&
-                equal(prefix.begin(), prefix.end(), title.begin(),
-                      [](char a, char b){ return tolower(a) == tolower(b); })) {
-                results.push_back(title);
-                if ((int)results.size() >= limit) return results;
+    /**
+     * Makes this engine record its query latencies, candidate counts and
+     * timeouts into other's metrics, so that getStats() on either reports
+     * the queries of both (e.g. two copies taking turns serving, see
+     * ServingEngine). Counters of structures each engine owns, such as
+     * the result cache and content index visits, stay separate.
+     */
+    void shareQueryMetrics(const RecommendationEngine& other) {
+        query_metrics = other.query_metrics;
+    }
+
+    // Clears query-time latencies and counters (build phases are kept)
+    void resetStats() {
+        for (auto &p : query_metrics->pillars) {
+            p.latency.reset();
+            p.candidates.reset();
+        }
+        query_metrics->fused.reset();
+        query_metrics->batch.reset();
+        query_metrics->autocomplete.reset();
+        if (content_index) content_index->resetVisitCount();
+        query_metrics->pillar_timeouts = 0;
+        query_metrics->fuzzy_timeouts = 0;
+        result_cache.resetCounters();
+    }
+
+    // ----- Incremental updates -----
+
+    /**
+     * Applies one user-song interaction to the built engine, with the same
+     * effect as the row having been passed to initialize(): the play count
+     * is set, a title played more than 10 times gains search weight, and a
+     * new like is added to the user's likes, its community's song table
+     * and the user's similarity edges (recomputed for this user only).
+     * Liked songs, and songs reaching the setExcludePlayedSongs() count,
+     * join the user's exclusions.
+     * Unknown users and songs are interned as in initialize().
+     * Not safe to call concurrently with queries.
+     */
+    void applyInteraction(const UserSongInteraction& interaction) {
+        uint32_t uid = internLiveUser(interaction.user_id);
+        uint32_t sid = song_ids.intern(interaction.song_id);
+        if (sid >= song_likers.size()) song_likers.resize(sid + 1);
+
+        auto played = user_song_plays[uid].emplace(sid, interaction.play_count);
+        bool plays_changed = played.second || played.first->second != interaction.play_count;
+        played.first->second = interaction.play_count;
+        if (interaction.play_count > 10 && isCatalogSong(sid)) {
+            search_index.incrementFrequency(songs[sid].title);
+        }
+        if (exclude_played_min > 0 && interaction.play_count >= exclude_played_min) {
+            exclusions.add(uid, sid);
+            result_cache.invalidateUser(uid);
+        }
+
+        bool cosine = graph_mode == SimilarityMode::COSINE;
+        bool liked = false;
+        if (interaction.liked) {
+            users[uid].liked_songs.push_back(interaction.song_id);
+            auto &likes = user_liked_songs[uid];
+            auto pos = lower_bound(likes.begin(), likes.end(), sid);
+            if (pos == likes.end() || *pos != sid) {
+                likes.insert(pos, sid);
+                exclusions.add(uid, sid);
+                auto &likers = song_likers[sid];
+                likers.insert(lower_bound(likers.begin(), likers.end(), uid), uid);
+                community_songs.addLike(communities.find(uid), sid);
+                liked = true;
             }
         }
-        for (const auto &p : artist_map) {
-            const auto &name = p.second.artist_name;
-            if (name.size() >= prefix.size() &&
-                equal(prefix.begin(), prefix.end(), name.begin(),
-                      [](char a, char b){ return tolower(a) == tolower(b); })) {
-                results.push_back(name);
-                if ((int)results.size() >= limit) return results;
+        // Users whose LSH candidates changed because uid moved buckets
+        vector<uint32_t> crossed;
+        if (liked && minhash_index) {
+            minhash_index->update(uid, user_liked_songs[uid], crossed);
+            sort(crossed.begin(), crossed.end());
+            crossed.erase(unique(crossed.begin(), crossed.end()), crossed.end());
+        }
+        if (!(cosine ? plays_changed : liked)) {
+            if (liked) {
+                result_cache.invalidateUser(uid);
+                invalidateCommunity(uid);
             }
+            return;
         }
-        return results;
+
+        rescoreUser(uid);
+        // uid's own results and its (possibly merged) community's tables
+        result_cache.invalidateUser(uid);
+        invalidateCommunity(uid);
+        for (uint32_t v : crossed) {
+            rescoreUser(v);
+            result_cache.invalidateUser(v);
+            invalidateCommunity(v);
+        }
+    }
+
+    /**
+     * Applies one user-artist interaction: the plays are added to the
+     * pair in the frozen bipartite graph and the user's artist weights are
+     * renormalized by its new largest play count.
+     * Not safe to call concurrently with queries.
+     */
+    void applyArtistInteraction(const UserArtistInteraction& interaction) {
+        uint32_t uid = internLiveUser(interaction.user_id);
+        uint32_t aid = artist_ids.intern(interaction.artist_id);
+        bipartite_graph.addPlays(uid, aid, interaction.play_count);
+        result_cache.invalidateUser(uid); // artist scores read only the user's own weights
+    }
+
+    // Rebuilds the user graph, communities and community song tables from
+    // the current likes (periodic recompaction after live updates)
+    void rebuildCommunities() {
+        user_graph.clear();
+        communities.clear();
+        buildUserSimilarities();
+        result_cache.clear();
     }
 
     // fused recommendations (keeps same semantics)
-    vector<Recommendation> generateRecommendations(const string& user_id, int num_recs = 10) {
-        unordered_map<string,double> score_map;
-        auto addWeighted = [&](const vector<Recommendation>& recs, double w){
-            for (const auto &r : recs) {
-                // resolve id via title
-                string found;
-                for (const auto &kv : song_map) {
-                    if (kv.second.title == r.title) { found = kv.first; break; }
-                }
-                if (!found.empty()) score_map[found] += r.score * w;
+    vector<Recommendation> generateRecommendations(const string& user_id, int num_recs = 10) const {
+        metrics::ScopedTimer timer(query_metrics->fused);
+        // Per-thread scratch, reused across requests
+        static thread_local FusionScratch scratch;
+        RequestContext &ctx = RequestContext::local();
+        ctx.reset();
+        uint32_t uid = user_ids.find(user_id);
+
+        FusionParams params;
+        bool cacheable = result_cache.isEnabled() && uid != INVALID_ID;
+        if (cacheable) {
+            params.num_recs = num_recs;
+            copy(pillar_weights, pillar_weights + NUM_PILLARS, params.weights);
+            if (auto cached = result_cache.get(uid, params)) return *cached;
+        }
+
+        bool* completed = scratch.completed;
+        fill(completed, completed + NUM_PILLARS, true);
+
+        if (parallel_pillars) {
+            // Each task scores in its worker's own context and returns its
+            // list by value: a task abandoned at the deadline must not
+            // touch this request's scratch
+            ThreadPool &pool = workerPool();
+            future<vector<ScoredSong>> pending[NUM_PILLARS];
+            for (int p = 0; p < NUM_PILLARS; ++p) {
+                running_pillar_tasks.fetch_add(1, memory_order_relaxed);
+                pending[p] = pool.submit([this, p, uid, num_recs] {
+                    RequestContext &task_ctx = RequestContext::local();
+                    task_ctx.reset();
+                    vector<ScoredSong> top;
+                    scorePillar(p, uid, num_recs, task_ctx, top);
+                    if (running_pillar_tasks.fetch_sub(1, memory_order_acq_rel) == 1) {
+                        lock_guard<mutex> lock(pillar_tasks_mutex);
+                        pillar_tasks_done.notify_all();
+                    }
+                    return top;
+                });
             }
-        };
 
-        addWeighted(getContentBasedRecommendations(user_id,num_recs), 1.0);
-        addWeighted(getUserCollaborativeRecommendations(user_id,num_recs), 1.2);
-        addWeighted(getArtistBasedRecommendations(user_id,num_recs), 0.9);
-        addWeighted(getCommunityBasedRecommendations(user_id,num_recs), 0.8);
+            auto deadline = chrono::steady_clock::now() + chrono::milliseconds(pillar_timeout_ms);
+            for (int p = 0; p < NUM_PILLARS; ++p) {
+                if (pillar_timeout_ms > 0 &&
+                    pending[p].wait_until(deadline) != future_status::ready) {
+                    completed[p] = false;
+                    scratch.pillar_scores[p].clear();
+                    query_metrics->pillar_timeouts++;
+                    continue;
+                }
+                scratch.pillar_scores[p] = pending[p].get();
+            }
+        } else {
+            for (int p = 0; p < NUM_PILLARS; ++p) {
+                scorePillar(p, uid, num_recs, ctx, scratch.pillar_scores[p]);
+            }
+        }
 
         vector<Recommendation> out;
-        for (const auto &p : score_map) {
-            auto it = song_map.find(p.first);
-            string title = (it != song_map.end()) ? it->second.title : string("<unknown>");
-            out.emplace_back(p.first, title, p.second, "combined");
+        fuse(ctx, scratch, uid, num_recs, out);
+
+        // Results missing a timed-out pillar are not kept
+        if (cacheable && all_of(completed, completed + NUM_PILLARS, [](bool done) { return done; })) {
+            size_t bytes = out.capacity() * sizeof(Recommendation);
+            for (const auto &r : out) bytes += r.song_id.size() + r.title.size();
+            result_cache.put(uid, params, out, bytes);
         }
-        sort(out.begin(), out.end());
-        if ((int)out.size() > num_recs) out.resize(num_recs);
         return out;
     }
+
+    // Receives one user's fused recommendations from the batch API
+    using RecommendationSink = function<void(const string& user_id, const vector<Recommendation>& recs)>;
+    // Asked just before a user is scored; true skips the user (no sink call)
+    using SkipUserFn = function<bool(const string& user_id)>;
+
+    /**
+     * Fused recommendations for many users, e.g. a nightly precompute of
+     * the whole user base. Users are claimed in chunks by the worker pool;
+     * each worker reuses one scratch (its thread's RequestContext plus
+     * pillar and output buffers) for all its users, and results are streamed to sink as they
+     * finish instead of being collected. sink is called from worker threads
+     * but never concurrently, in completion order. Pillars run serially
+     * inside each worker (the pool is already saturated with users).
+     * skip, if given, is called from the workers concurrently, e.g. to
+     * drop requests whose deadline passed while the batch ran.
+     */
+    void generateRecommendationsBatch(
+        const vector<string>& batch_user_ids,
+        int num_recs,
+        const RecommendationSink& sink,
+        const SkipUserFn& skip = SkipUserFn()
+    ) const {
+        const size_t chunk = 64;
+        size_t num_chunks = (batch_user_ids.size() + chunk - 1) / chunk;
+
+        mutex sink_mutex;
+        auto runChunk = [&](size_t c, FusionScratch& scratch) {
+            RequestContext &ctx = RequestContext::local();
+            size_t end = min(batch_user_ids.size(), (c + 1) * chunk);
+            for (size_t i = c * chunk; i < end; ++i) {
+                const string &user_id = batch_user_ids[i];
+                if (skip && skip(user_id)) continue;
+                metrics::ScopedTimer timer(query_metrics->batch);
+                ctx.reset();
+                uint32_t uid = user_ids.find(user_id);
+                fill(scratch.completed, scratch.completed + NUM_PILLARS, true);
+                for (int p = 0; p < NUM_PILLARS; ++p) {
+                    scorePillar(p, uid, num_recs, ctx, scratch.pillar_scores[p]);
+                }
+                fuse(ctx, scratch, uid, num_recs, scratch.output);
+
+                lock_guard<mutex> lock(sink_mutex);
+                sink(user_id, scratch.output);
+            }
+        };
+
+        if (worker_threads == 1) {
+            FusionScratch scratch;
+            for (size_t c = 0; c < num_chunks; ++c) runChunk(c, scratch);
+            return;
+        }
+
+        ThreadPool &pool = workerPool();
+        vector<FusionScratch> scratches(pool.size());
+        pool.parallelFor(num_chunks, [&](size_t c, size_t slot) {
+            runChunk(c, scratches[slot]);
+        });
+    }
 };
 
 #endif
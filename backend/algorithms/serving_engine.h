@@ -0,0 +1,291 @@
+#ifndef SERVING_ENGINE_H
+#define SERVING_ENGINE_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include "recommendation_engine.h"
+#include "../core/metrics.h"
+
+using namespace std;
+
+/**
+ * Read-copy-update front end for a continuously updated engine
+ *
+ * RecommendationEngine updates (applyInteraction, rebuildCommunities, ...)
+ * must not run concurrently with queries. ServingEngine keeps two
+ * identically built copies instead: readers acquire() the published one
+ * while one writer thread applies queued updates to the other. acquire()
+ * is an atomic_load of a shared_ptr; libstdc++ guards that with a pool
+ * of spinlocks, so it is short and never waits for an update, but it is
+ * not lock-free.
+ *
+ * The writer collects updates until max_batch are waiting or the oldest
+ * has waited publish_interval_us, applies the batch to the standby copy
+ * and publishes it. Requests in flight finish on the version they
+ * started with: the published pointer's deleter, run when its last
+ * holder lets go, releases the copy's lease and wakes the writer, which
+ * then waits for pillar tasks still reading the copy and replays the
+ * same batch there, so that copy is the up-to-date standby for the next
+ * batch. Each update therefore runs twice and must be deterministic,
+ * touch nothing but the engine and not throw. Updates are applied one
+ * batch at a time in submission order, and a batch becomes visible all
+ * at once.
+ *
+ * Costs: the Builder runs twice (two initialize or loadSnapshot calls),
+ * the engine's memory doubles, and every update batch is applied twice,
+ * off the read path. Readers must drop the acquired pointer at the end
+ * of each request; the writer cannot reuse a copy while it is held.
+ *
+ * Query metrics of both copies are shared (shareQueryMetrics), so
+ * getStats() covers all queries; result cache and index counters are the
+ * published copy's.
+ */
+class ServingEngine {
+public:
+    // A change to apply to an engine copy, e.g. a captured interaction
+    using Update = function<void(RecommendationEngine&)>;
+    // Builds one copy (initialize or loadSnapshot plus settings); called twice
+    using Builder = function<void(RecommendationEngine&)>;
+
+    struct Options {
+        size_t max_batch = 4096;        // updates per published version
+        long publish_interval_us = 1000; // longest an update waits for company
+        size_t max_pending = 1 << 16;   // queued updates before submit() blocks
+    };
+
+private:
+    using Clock = chrono::steady_clock;
+
+    struct Pending {
+        Update update;
+        Clock::time_point enqueued;
+    };
+
+    // Held by a copy from its publication until the last reader of that
+    // version released it
+    struct Lease {
+        mutex lease_mutex;
+        condition_variable released_cv;
+        bool held = false;
+    };
+
+    Options options;
+
+    // copies[live] is published; only the writer touches copies[1 - live]
+    shared_ptr<RecommendationEngine> copies[2];
+    shared_ptr<Lease> leases[2];
+    int live = 0;
+    shared_ptr<const RecommendationEngine> published; // atomic_load / atomic_store only
+    atomic<uint64_t> version{0};
+
+    mutex queue_mutex;
+    condition_variable queue_cv;     // writer: updates arrived or stopping
+    condition_variable space_cv;     // submitters: the queue has room
+    condition_variable published_cv; // sync(): a batch was published
+    deque<Pending> queue;
+    uint64_t submitted = 0;        // updates ever queued
+    uint64_t applied = 0;          // updates ever published
+    bool stopping = false;
+    thread writer;
+
+    metrics::Counter updates;
+    metrics::Counter publishes;
+    metrics::LatencyStat apply_latency;   // applying one batch to the standby copy
+    metrics::LatencyStat reclaim_latency; // waiting for readers of the retired copy
+    metrics::LatencyStat staleness;       // submit until the update is visible
+
+    void applyBatch(RecommendationEngine& engine, const vector<Pending>& batch) {
+        for (const auto &pending : batch) pending.update(engine);
+    }
+
+    // Publishes copies[index] under a fresh lease, released by the
+    // deleter once neither published nor any reader holds the pointer
+    void publish(int index) {
+        shared_ptr<RecommendationEngine> copy = copies[index];
+        shared_ptr<Lease> lease = leases[index];
+        {
+            lock_guard<mutex> lock(lease->lease_mutex);
+            lease->held = true;
+        }
+        atomic_store(&published, shared_ptr<const RecommendationEngine>(copy.get(),
+            [copy, lease](const RecommendationEngine*) {
+                {
+                    lock_guard<mutex> lock(lease->lease_mutex);
+                    lease->held = false;
+                }
+                lease->released_cv.notify_all();
+            }));
+    }
+
+    // Blocks until no reader holds copies[index] and no pillar task
+    // abandoned at a timeout still reads it; their last accesses
+    // happen-before return
+    void waitForReaders(int index) {
+        metrics::ScopedTimer timer(reclaim_latency);
+        Lease &lease = *leases[index];
+        {
+            unique_lock<mutex> lock(lease.lease_mutex);
+            lease.released_cv.wait(lock, [&lease] { return !lease.held; });
+        }
+        copies[index]->waitForPillarTasks();
+    }
+
+    void run() {
+        vector<Pending> batch;
+        unique_lock<mutex> lock(queue_mutex);
+        for (;;) {
+            queue_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) break; // stopping, everything applied
+
+            // Hold the batch open until it is full or its oldest update's window ends
+            auto flush_at = queue.front().enqueued + chrono::microseconds(options.publish_interval_us);
+            queue_cv.wait_until(lock, flush_at, [this] { return stopping || queue.size() >= options.max_batch; });
+
+            size_t take = min(queue.size(), options.max_batch);
+            for (size_t i = 0; i < take; ++i) {
+                batch.push_back(move(queue.front()));
+                queue.pop_front();
+            }
+            lock.unlock();
+            space_cv.notify_all();
+
+            int standby = 1 - live;
+            {
+                metrics::ScopedTimer timer(apply_latency);
+                applyBatch(*copies[standby], batch);
+            }
+            publish(standby);
+            live = standby;
+            version++;
+            publishes.add();
+            updates.add(batch.size());
+            auto now = Clock::now();
+            for (const auto &pending : batch) {
+                staleness.record(static_cast<uint64_t>(
+                    chrono::duration_cast<chrono::nanoseconds>(now - pending.enqueued).count()));
+            }
+
+            lock.lock();
+            applied += batch.size();
+            lock.unlock();
+            published_cv.notify_all();
+
+            // Bring the retired copy level once its readers are gone
+            waitForReaders(1 - live);
+            applyBatch(*copies[1 - live], batch);
+            batch.clear();
+            lock.lock();
+        }
+    }
+
+public:
+    explicit ServingEngine(const Builder& build) : ServingEngine(build, Options()) {}
+
+    ServingEngine(const Builder& build, Options opts) : options(opts) {
+        if (options.max_batch == 0) options.max_batch = 1;
+        if (options.max_pending == 0) options.max_pending = 1;
+        for (int i = 0; i < 2; ++i) {
+            copies[i] = make_shared<RecommendationEngine>();
+            leases[i] = make_shared<Lease>();
+            build(*copies[i]);
+        }
+        copies[1]->shareQueryMetrics(*copies[0]);
+        publish(live);
+        writer = thread([this] { run(); });
+    }
+
+    ~ServingEngine() {
+        stop();
+    }
+
+    ServingEngine(const ServingEngine&) = delete;
+    ServingEngine& operator=(const ServingEngine&) = delete;
+
+    // The current version; hold it for one request, then drop it
+    shared_ptr<const RecommendationEngine> acquire() const {
+        return atomic_load(&published);
+    }
+
+    // Versions published since construction
+    uint64_t getVersion() const {
+        return version.load();
+    }
+
+    /**
+     * Queues update for the next version. Blocks while max_pending
+     * updates are waiting (ingestion backpressure); returns false, without
+     * queueing, once stop() was called.
+     */
+    bool submit(Update update) {
+        {
+            unique_lock<mutex> lock(queue_mutex);
+            space_cv.wait(lock, [this] { return stopping || queue.size() < options.max_pending; });
+            if (stopping) return false;
+            queue.push_back({move(update), Clock::now()});
+            submitted++;
+        }
+        queue_cv.notify_one();
+        return true;
+    }
+
+    bool applyInteraction(const UserSongInteraction& interaction) {
+        return submit([interaction](RecommendationEngine& engine) { engine.applyInteraction(interaction); });
+    }
+
+    bool applyArtistInteraction(const UserArtistInteraction& interaction) {
+        return submit([interaction](RecommendationEngine& engine) { engine.applyArtistInteraction(interaction); });
+    }
+
+    bool blockArtist(const string& user_id, const string& artist_id) {
+        return submit([user_id, artist_id](RecommendationEngine& engine) { engine.blockArtist(user_id, artist_id); });
+    }
+
+    // Recomputes the user graph and communities off the read path
+    bool rebuildCommunities() {
+        return submit([](RecommendationEngine& engine) { engine.rebuildCommunities(); });
+    }
+
+    // Waits until every update submitted before the call is visible to acquire()
+    void sync() {
+        unique_lock<mutex> lock(queue_mutex);
+        uint64_t target = submitted;
+        published_cv.wait(lock, [&] { return applied >= target; });
+    }
+
+    // Applies and publishes what is queued, then stops the writer
+    void stop() {
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        queue_cv.notify_all();
+        space_cv.notify_all();
+        if (writer.joinable()) writer.join();
+    }
+
+    size_t pendingUpdates() {
+        lock_guard<mutex> lock(queue_mutex);
+        return queue.size();
+    }
+
+    // Published copy's engine stats plus update-pipeline metrics
+    metrics::Report getStats() const {
+        metrics::Report report = acquire()->getStats();
+        report.addLatency("serving_apply_batch", apply_latency);
+        report.addLatency("serving_reclaim_wait", reclaim_latency);
+        report.addLatency("serving_update_staleness", staleness);
+        report.addCounter("serving_updates", updates.get());
+        report.addCounter("serving_publishes", publishes.get());
+        report.addGauge("serving_version", static_cast<double>(getVersion()));
+        return report;
+    }
+};
+
+#endif // SERVING_ENGINE_H
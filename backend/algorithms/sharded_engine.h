@@ -0,0 +1,398 @@
+#ifndef SHARDED_ENGINE_H
+#define SHARDED_ENGINE_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include "../core/entities.h"
+#include "../core/id_registry.h"
+#include "../core/thread_pool.h"
+#include "../core/request_context.h"
+#include "../core/metrics.h"
+#include "../Data_Structures/neighbor_backends.h"
+#include "user_shard.h"
+
+using namespace std;
+
+/**
+ * Accounting for shard-to-shard calls
+ *
+ * The shards of a ShardedEngine live in one process and answer each
+ * other's requests by direct calls. Every call between two different
+ * shards is recorded here, with the request and response payload it
+ * would put on the wire, so the traffic a multi-process deployment would
+ * see (which would put an RPC layer behind the same calls) is measured.
+ * Calls a shard makes to itself are free and not counted.
+ */
+class ShardTransport {
+public:
+    enum Rpc { POSTINGS, LABELS, COMMUNITY_PARTIALS, LIKES, COMMUNITY_TOP, NUM_RPCS };
+
+private:
+    struct Channel {
+        metrics::Counter calls;
+        metrics::Counter bytes;
+    };
+    Channel channels[NUM_RPCS];
+
+public:
+    static const char* rpcName(Rpc rpc) {
+        static const char* NAMES[NUM_RPCS] = {"postings", "labels", "community_partials", "likes", "community_top"};
+        return NAMES[rpc];
+    }
+
+    // Records one round trip; returns whether it crossed shards
+    bool call(Rpc rpc, size_t from, size_t to, size_t request_bytes, size_t response_bytes) {
+        if (from == to) return false;
+        channels[rpc].calls.add();
+        channels[rpc].bytes.add(request_bytes + response_bytes);
+        return true;
+    }
+
+    uint64_t getCalls(Rpc rpc) const { return channels[rpc].calls.get(); }
+    uint64_t getBytes(Rpc rpc) const { return channels[rpc].bytes.get(); }
+
+    void reset() {
+        for (auto &c : channels) {
+            c.calls.reset();
+            c.bytes.reset();
+        }
+    }
+};
+
+/**
+ * User-sharded recommendation engine
+ *
+ * Users are hash-partitioned over num_shards UserShards by user id; song
+ * and artist data and the content index are replicated (one ShardCatalog
+ * shared in process). The fused results equal RecommendationEngine's for
+ * the same input, with these build steps:
+ *
+ * - Similarity: every shard requests, from every shard, the likers of
+ *   each song its users like (inverted-index postings, with each liker's
+ *   like count), which is enough to score exact Jaccard similarity
+ *   against users anywhere. Each shard keeps its users' top-k neighbors.
+ * - Communities: connected components over above-threshold links by
+ *   min-label propagation. Shards relax their local links and exchange
+ *   the labels of linked remote users until no label changes. Each shard
+ *   then sends its members' liked-song counts to the community's home
+ *   shard (label % num_shards).
+ *
+ * The coordinator routes a request to the user's shard. Content and
+ * artist pillars are answered there. The collaborative pillar fetches the
+ * likes of neighbors owned by other shards, and the community pillar asks
+ * the community's home shard; each only when that data is remote.
+ *
+ * Global user ids follow first appearance in the load (users, then song
+ * and artist interactions), the order a single engine interns them, so
+ * neighbor ties break identically. Not supported here: live updates,
+ * artist blocking, autocomplete and snapshots.
+ */
+class ShardedEngine {
+private:
+    ShardConfig config;
+    NeighborBackend neighbor_backend = NeighborBackend::KD_TREE;
+    int worker_threads = 0; // shard builds run concurrently, like nodes
+
+    shared_ptr<ShardCatalog> catalog;
+    vector<unique_ptr<UserShard>> shards;
+    mutable ShardTransport transport;
+
+    size_t label_rounds = 0;
+    size_t pairs_scored = 0;
+    mutable metrics::LatencyStat fused_latency;
+    mutable metrics::Counter remote_collab;    // requests fetching remote likes
+    mutable metrics::Counter remote_community; // requests asking a remote home shard
+
+    static size_t postingsBytes(const SongPostings& p) {
+        return p.offsets.size() * sizeof(uint32_t) + p.entries.size() * sizeof(Posting);
+    }
+
+    // Runs fn(shard index) for every shard, concurrently unless serial
+    template <typename Fn>
+    void forEachShard(Fn fn) {
+        if (worker_threads == 1 || shards.size() == 1) {
+            for (size_t s = 0; s < shards.size(); ++s) fn(s);
+            return;
+        }
+        size_t threads = worker_threads == 0 ? shards.size() : min(shards.size(), static_cast<size_t>(worker_threads));
+        ThreadPool pool(threads);
+        pool.parallelFor(shards.size(), [&](size_t s, size_t) { fn(s); });
+    }
+
+    void buildCatalog(vector<Song>& song_list, vector<Artist>& artist_list,
+                      const vector<UserSongInteraction>& song_interactions,
+                      const vector<UserArtistInteraction>& artist_interactions) {
+        catalog = make_shared<ShardCatalog>();
+        ShardCatalog &c = *catalog;
+        for (auto &s : song_list) {
+            uint32_t sid = c.song_ids.intern(s.song_id);
+            if (sid == c.songs.size()) c.songs.push_back(move(s));
+            else c.songs[sid] = move(s);
+        }
+        for (auto &a : artist_list) {
+            uint32_t aid = c.artist_ids.intern(a.artist_id);
+            if (aid == c.artists.size()) c.artists.push_back(move(a));
+            else c.artists[aid] = move(a);
+        }
+        for (uint32_t sid = 0; sid < c.songs.size(); ++sid) {
+            uint32_t aid = c.artist_ids.intern(c.songs[sid].artist_id);
+            if (aid >= c.artist_songs.size()) c.artist_songs.resize(aid + 1);
+            c.artist_songs[aid].push_back(sid);
+        }
+        for (auto &list : c.artist_songs) {
+            sort(list.begin(), list.end(), [&c](uint32_t a, uint32_t b) { return c.songLess(a, b); });
+        }
+        // Ids only seen in interactions, in the order a single engine interns them
+        for (const auto &it : song_interactions) c.song_ids.intern(it.song_id);
+        for (const auto &it : artist_interactions) c.artist_ids.intern(it.artist_id);
+
+        c.content_index = makeNeighborIndex(neighbor_backend);
+        c.content_index->build(c.songs);
+    }
+
+    // Postings exchange and per-shard neighbor scoring
+    void buildSimilarities() {
+        vector<size_t> scored(shards.size(), 0);
+        forEachShard([&](size_t a) {
+            vector<uint32_t> songs = shards[a]->likedSongs();
+            vector<SongPostings> by_shard(shards.size());
+            for (size_t b = 0; b < shards.size(); ++b) {
+                by_shard[b] = shards[b]->postings(songs);
+                transport.call(ShardTransport::POSTINGS, a, b, songs.size() * sizeof(uint32_t), postingsBytes(by_shard[b]));
+            }
+            scored[a] = shards[a]->buildNeighbors(songs, by_shard);
+        });
+        pairs_scored = 0;
+        for (size_t s : scored) pairs_scored += s;
+    }
+
+    // Min-label propagation in rounds: relax locally, then exchange remote labels
+    void buildCommunities() {
+        for (auto &shard : shards) shard->initLabels();
+        size_t n = shards.size();
+        label_rounds = 0;
+        for (bool changed = true; changed;) {
+            label_rounds++;
+            for (auto &shard : shards) shard->relaxLocal();
+
+            // Read every label before applying any: all shards see the same round
+            vector<vector<uint32_t>> users(n * n), labels(n * n);
+            for (size_t a = 0; a < n; ++a) {
+                for (size_t b = 0; b < n; ++b) {
+                    if (a == b) continue;
+                    users[a * n + b] = shards[a]->linkedUsers(static_cast<uint32_t>(b));
+                    if (users[a * n + b].empty()) continue;
+                    labels[a * n + b] = shards[b]->labelsOf(users[a * n + b]);
+                    size_t bytes = users[a * n + b].size() * sizeof(uint32_t);
+                    transport.call(ShardTransport::LABELS, a, b, bytes, bytes);
+                }
+            }
+            changed = false;
+            for (size_t a = 0; a < n; ++a) {
+                for (size_t b = 0; b < n; ++b) {
+                    if (a == b || users[a * n + b].empty()) continue;
+                    if (shards[a]->applyRemoteLabels(static_cast<uint32_t>(b), users[a * n + b], labels[a * n + b])) {
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        for (size_t a = 0; a < n; ++a) {
+            for (const auto &partial : shards[a]->communityPartials()) {
+                size_t home = partial.label % n;
+                transport.call(ShardTransport::COMMUNITY_PARTIALS, a, home,
+                               2 * sizeof(uint32_t) + partial.counts.size() * sizeof(CommunityPopularity::Entry), 0);
+                shards[home]->mergeCommunityPartial(partial);
+            }
+        }
+        for (auto &shard : shards) shard->finishCommunities();
+    }
+
+public:
+    explicit ShardedEngine(size_t num_shards = 4) {
+        if (num_shards == 0) num_shards = 1;
+        shards.resize(num_shards);
+    }
+
+    // Shards keep a reference to config
+    ShardedEngine(const ShardedEngine&) = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+
+    // ----- Configuration (before initialize) -----
+
+    void setNeighborBackend(NeighborBackend backend) {
+        neighbor_backend = backend;
+    }
+
+    // Threads running shard build steps (0 = one per shard, 1 = serial)
+    void setWorkerThreads(int threads) {
+        worker_threads = threads < 0 ? 0 : threads;
+    }
+
+    void setPillarWeights(double content, double user_collab, double artist, double community) {
+        double weights[4] = {content, user_collab, artist, community};
+        for (int p = 0; p < 4; ++p) config.pillar_weights[p] = weights[p] < 0.0 ? 0.0 : weights[p];
+    }
+
+    void setExcludePlayedSongs(int min_plays) {
+        config.exclude_played_min = min_plays < 0 ? 0 : min_plays;
+    }
+
+    size_t getShardCount() const { return shards.size(); }
+
+    // Owning shard of a user id (FNV-1a, stable across processes)
+    size_t shardOf(const string& user_id) const {
+        uint32_t h = 2166136261u;
+        for (unsigned char ch : user_id) h = (h ^ ch) * 16777619u;
+        return h % shards.size();
+    }
+
+    const UserShard& getShard(size_t index) const { return *shards[index]; }
+    const ShardCatalog& getCatalog() const { return *catalog; }
+    const ShardTransport& getTransport() const { return transport; }
+
+    // Same input as RecommendationEngine::initialize
+    void initialize(
+        vector<Song> song_list,
+        vector<Artist> artist_list,
+        const vector<User>& user_list,
+        const vector<UserSongInteraction>& song_interactions,
+        const vector<UserArtistInteraction>& artist_interactions
+    ) {
+        cout << "\n=== Initializing Sharded Engine (" << shards.size() << " shards) ===" << endl;
+        buildCatalog(song_list, artist_list, song_interactions, artist_interactions);
+        cout << "Replicated catalog: " << catalog->songs.size() << " songs, " << catalog->artists.size()
+             << " artists, " << catalog->content_index->name() << " content index." << endl;
+
+        for (size_t s = 0; s < shards.size(); ++s) {
+            shards[s].reset(new UserShard(static_cast<uint32_t>(s), catalog, config));
+        }
+
+        // Partition; the global id registry only lives for the load
+        IdRegistry global_ids;
+        auto route = [&](const string& user_id, UserShard*& shard) {
+            uint32_t gid = global_ids.intern(user_id);
+            shard = shards[shardOf(user_id)].get();
+            return shard->addUser(gid, user_id);
+        };
+        UserShard* shard;
+        for (const auto &u : user_list) route(u.user_id, shard);
+        for (const auto &it : song_interactions) {
+            uint32_t local = route(it.user_id, shard);
+            shard->addSongInteraction(local, catalog->song_ids.find(it.song_id), it.liked, it.play_count);
+        }
+        for (const auto &it : artist_interactions) {
+            uint32_t local = route(it.user_id, shard);
+            shard->addArtistPlays(local, catalog->artist_ids.find(it.artist_id), it.play_count);
+        }
+        forEachShard([&](size_t s) { shards[s]->finishLoading(); });
+
+        cout << "Partitioned " << global_ids.size() << " users:";
+        for (const auto &s : shards) cout << " " << s->getUserCount();
+        cout << endl;
+
+        buildSimilarities();
+        buildCommunities();
+        size_t communities = 0;
+        for (const auto &s : shards) communities += s->getCommunityCount();
+        cout << "Scored " << pairs_scored << " directed candidate pairs; " << communities
+             << " multi-user communities after " << label_rounds << " label propagation round(s)." << endl;
+        cout << "=== Initialization Complete ===" << endl;
+    }
+
+    // Fused recommendations, equal to RecommendationEngine::generateRecommendations
+    vector<Recommendation> generateRecommendations(const string& user_id, int num_recs = 10) const {
+        metrics::ScopedTimer timer(fused_latency);
+        vector<Recommendation> out;
+        size_t home = shardOf(user_id);
+        const UserShard &shard = *shards[home];
+        uint32_t local = shard.findUser(user_id);
+        if (local == INVALID_ID || num_recs <= 0) return out;
+
+        static thread_local vector<ScoredSong> pillar_scores[4];
+        static thread_local vector<const vector<uint32_t>*> neighbor_likes;
+        RequestContext &ctx = RequestContext::local();
+        ctx.reset();
+
+        shard.scoreContent(local, num_recs, ctx, pillar_scores[0]);
+
+        // Collaborative: local neighbors' likes directly, remote ones in
+        // one call per owning shard
+        auto range = shard.topNeighbors(local);
+        size_t count = static_cast<size_t>(range.second - range.first);
+        neighbor_likes.assign(count, nullptr);
+        vector<vector<vector<uint32_t>>> remote; // keeps fetched lists alive
+        bool any_remote = false;
+        for (size_t i = 0; i < count; ++i) {
+            const ShardNeighbor &n = range.first[i];
+            if (n.shard == home) neighbor_likes[i] = &shard.likesOfLocal(n.user);
+            else any_remote = true;
+        }
+        if (any_remote) {
+            remote_collab.add();
+            remote.resize(shards.size());
+            for (size_t t = 0; t < shards.size(); ++t) {
+                if (t == home) continue;
+                vector<uint32_t> users;
+                for (size_t i = 0; i < count; ++i) {
+                    if (range.first[i].shard == t) users.push_back(range.first[i].user);
+                }
+                if (users.empty()) continue;
+                remote[t] = shards[t]->likesOf(users);
+                size_t bytes = 0;
+                for (const auto &l : remote[t]) bytes += (l.size() + 1) * sizeof(uint32_t);
+                transport.call(ShardTransport::LIKES, home, t, users.size() * sizeof(uint32_t), bytes);
+                size_t j = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    if (range.first[i].shard == t) neighbor_likes[i] = &remote[t][j++];
+                }
+            }
+        }
+        shard.scoreUserCollab(local, num_recs, neighbor_likes, ctx, pillar_scores[1]);
+
+        shard.scoreArtist(local, num_recs, pillar_scores[2]);
+
+        // Community: the table lives on the community's home shard
+        pillar_scores[3].clear();
+        uint32_t label = shard.communityOf(local);
+        if (label != INVALID_ID) {
+            size_t owner = label % shards.size();
+            vector<uint32_t> excluded = shard.exclusionList(local);
+            pillar_scores[3] = shards[owner]->communityTop(label, excluded, num_recs);
+            if (transport.call(ShardTransport::COMMUNITY_TOP, home, owner, (excluded.size() + 2) * sizeof(uint32_t),
+                               pillar_scores[3].size() * sizeof(ScoredSong))) {
+                remote_community.add();
+            }
+        }
+
+        shard.fuse(local, pillar_scores, num_recs, ctx, out);
+        return out;
+    }
+
+    // Query latency, cross-shard traffic per call type and memory per shard
+    metrics::Report getStats() const {
+        metrics::Report report;
+        report.addLatency("sharded_generate_recommendations", fused_latency);
+        for (int r = 0; r < ShardTransport::NUM_RPCS; ++r) {
+            auto rpc = static_cast<ShardTransport::Rpc>(r);
+            report.addCounter(string("shard_rpc_") + ShardTransport::rpcName(rpc) + "_calls", transport.getCalls(rpc));
+            report.addCounter(string("shard_rpc_") + ShardTransport::rpcName(rpc) + "_bytes", transport.getBytes(rpc));
+        }
+        report.addCounter("sharded_remote_collab_requests", remote_collab.get());
+        report.addCounter("sharded_remote_community_requests", remote_community.get());
+        report.addCounter("sharded_similarity_pairs_scored", pairs_scored);
+        report.addGauge("sharded_label_rounds", static_cast<double>(label_rounds));
+        report.addMemory("catalog", catalog ? catalog->memoryUsage() : 0);
+        for (size_t s = 0; s < shards.size(); ++s) {
+            report.addMemory("shard_" + to_string(s), shards[s] ? shards[s]->memoryUsage() : 0);
+        }
+        return report;
+    }
+};
+
+#endif // SHARDED_ENGINE_H
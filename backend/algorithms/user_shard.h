@@ -0,0 +1,557 @@
+#ifndef USER_SHARD_H
+#define USER_SHARD_H
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include "../core/entities.h"
+#include "../core/id_registry.h"
+#include "../core/score_accumulator.h"
+#include "../core/request_context.h"
+#include "../Data_Structures/bipartite_graph.h"
+#include "../Data_Structures/community_popularity.h"
+#include "../Data_Structures/exclusion_filter.h"
+#include "../Data_Structures/nearest_neighbor_index.h"
+
+using namespace std;
+
+// Song and artist data every shard holds a copy of
+struct ShardCatalog {
+    vector<Song> songs;
+    vector<Artist> artists;
+    IdRegistry song_ids;   // catalog songs first, then songs only seen in interactions
+    IdRegistry artist_ids; // catalog artists first
+    vector<vector<uint32_t>> artist_songs; // in song_id order
+    unique_ptr<NearestNeighborIndex> content_index;
+
+    bool isCatalogSong(uint32_t sid) const {
+        return sid < songs.size();
+    }
+
+    bool songLess(uint32_t a, uint32_t b) const {
+        return songs[a].song_id < songs[b].song_id;
+    }
+
+    size_t memoryUsage() const {
+        size_t bytes = song_ids.memoryUsage() + artist_ids.memoryUsage() +
+                       songs.capacity() * sizeof(Song) + artists.capacity() * sizeof(Artist) +
+                       artist_songs.capacity() * sizeof(vector<uint32_t>);
+        for (const auto &list : artist_songs) bytes += list.capacity() * sizeof(uint32_t);
+        return bytes + (content_index ? content_index->memoryUsage() : 0);
+    }
+};
+
+// Tuning shared by every shard; the defaults are RecommendationEngine's
+struct ShardConfig {
+    double similarity_threshold = 0.3;
+    int k_nearest = 10;
+    int k_similar_users = 5;
+    int top_artists = 5;
+    int exclude_played_min = 0;
+    double pillar_weights[4] = {1.0, 1.2, 0.9, 0.8};
+};
+
+// Messages exchanged between shards, see ShardedEngine
+
+// One liker of a song: its global user id and how many songs it likes
+struct Posting {
+    uint32_t user;
+    uint32_t likes;
+};
+
+// Likers of each requested song (CSR, aligned with the request)
+struct SongPostings {
+    vector<uint32_t> offsets;
+    vector<Posting> entries;
+};
+
+// A user's similar user, possibly owned by another shard
+struct ShardNeighbor {
+    uint32_t user; // global id
+    uint32_t shard;
+    double weight;
+};
+
+// One shard's members of a community and their liked-song counts
+struct CommunityPartial {
+    uint32_t label;
+    uint32_t members;
+    vector<CommunityPopularity::Entry> counts; // catalog songs only
+};
+
+/**
+ * The users of one partition, with everything the pillars need locally
+ *
+ * A shard owns its users' likes, plays, artist weights and exclusions,
+ * and the top-k similarity neighbors of each, which may live on other
+ * shards. Users are known to other shards by their global id only.
+ * Communities are labeled by their smallest global user id, and each
+ * community's song table lives on the shard label % num_shards. Song data
+ * and the content index are in the shared ShardCatalog.
+ *
+ * The shard answers requests but never sends any: exchanges between
+ * shards (postings, labels, community partials, likes) are driven by the
+ * caller, which owns the transport.
+ */
+class UserShard {
+private:
+    uint32_t shard_index;
+    shared_ptr<const ShardCatalog> catalog;
+    const ShardConfig& config;
+
+    IdRegistry user_ids;                        // external id -> local id
+    vector<uint32_t> global_ids;                // local id -> global id
+    unordered_map<uint32_t, uint32_t> local_ids; // global id -> local id
+    vector<vector<uint32_t>> liked;             // sorted, duplicate-free
+    vector<unordered_map<uint32_t, int>> plays;
+    BipartiteGraph artist_graph;
+    ExclusionFilter exclusions;
+
+    // Inverted likes: song -> local likers (CSR)
+    vector<uint32_t> liker_offsets;
+    vector<uint32_t> likers;
+
+    // Top-k neighbors of each local user (CSR), weight descending, ties
+    // to the higher global id like WeightedGraph
+    vector<uint32_t> neighbor_offsets;
+    vector<ShardNeighbor> neighbors;
+
+    // Community build state: above-threshold links and current labels
+    vector<vector<ShardNeighbor>> links;
+    vector<uint32_t> labels;
+
+    struct HomedCommunity {
+        uint32_t members = 0;
+        vector<CommunityPopularity::Entry> table; // count desc, then song_id
+    };
+    unordered_map<uint32_t, HomedCommunity> homed;
+
+    static bool ranksAbove(const ShardNeighbor& a, const ShardNeighbor& b) {
+        if (a.weight != b.weight) return a.weight > b.weight;
+        return a.user > b.user;
+    }
+
+    // Bounded top-n of scores into out, ties by song_id
+    void selectTop(RequestContext& ctx, const ScoreAccumulator& scores, int n, vector<ScoredSong>& out) const {
+        ArenaVector<uint32_t> order{ArenaAllocator<uint32_t>(ctx.arena)};
+        scores.topN(static_cast<size_t>(n), [this](uint32_t a, uint32_t b) { return catalog->songLess(a, b); }, order);
+        out.clear();
+        for (uint32_t sid : order) out.push_back({sid, scores.score(sid)});
+    }
+
+public:
+    UserShard(uint32_t index, shared_ptr<const ShardCatalog> songs, const ShardConfig& settings)
+        : shard_index(index), catalog(move(songs)), config(settings) {}
+
+    uint32_t getIndex() const { return shard_index; }
+    size_t getUserCount() const { return global_ids.size(); }
+
+    // ----- Loading -----
+
+    // Adds a user owned by this shard (no-op if known); returns its local id
+    uint32_t addUser(uint32_t global_id, const string& user_id) {
+        uint32_t local = user_ids.intern(user_id);
+        if (local == global_ids.size()) {
+            global_ids.push_back(global_id);
+            local_ids.emplace(global_id, local);
+            liked.emplace_back();
+            plays.emplace_back();
+        }
+        return local;
+    }
+
+    void addSongInteraction(uint32_t local, uint32_t sid, bool is_liked, int play_count) {
+        plays[local][sid] = play_count;
+        if (is_liked) liked[local].push_back(sid);
+    }
+
+    void addArtistPlays(uint32_t local, uint32_t aid, int play_count) {
+        artist_graph.addEdge(local, aid, play_count);
+    }
+
+    // Freezes the loaded interactions; call once, after the last add
+    void finishLoading() {
+        for (auto &likes : liked) {
+            sort(likes.begin(), likes.end());
+            likes.erase(unique(likes.begin(), likes.end()), likes.end());
+        }
+        artist_graph.freeze(catalog->artist_songs);
+
+        vector<vector<uint32_t>> excluded(liked.size());
+        for (uint32_t u = 0; u < liked.size(); ++u) {
+            excluded[u] = liked[u];
+            if (config.exclude_played_min > 0) {
+                for (const auto &p : plays[u]) {
+                    if (p.second >= config.exclude_played_min) excluded[u].push_back(p.first);
+                }
+            }
+        }
+        exclusions.build(excluded, catalog->songs.size());
+
+        size_t num_songs = catalog->song_ids.size();
+        liker_offsets.assign(num_songs + 1, 0);
+        for (const auto &likes : liked) {
+            for (uint32_t sid : likes) liker_offsets[sid + 1]++;
+        }
+        for (size_t s = 0; s < num_songs; ++s) liker_offsets[s + 1] += liker_offsets[s];
+        likers.resize(liker_offsets[num_songs]);
+        vector<uint32_t> cursor(liker_offsets.begin(), liker_offsets.end() - 1);
+        for (uint32_t u = 0; u < liked.size(); ++u) {
+            for (uint32_t sid : liked[u]) likers[cursor[sid]++] = u;
+        }
+    }
+
+    // ----- Similarity exchange -----
+
+    // Distinct songs liked here, ascending: the postings to request
+    vector<uint32_t> likedSongs() const {
+        vector<uint32_t> songs;
+        for (uint32_t s = 0; s + 1 < liker_offsets.size(); ++s) {
+            if (liker_offsets[s + 1] > liker_offsets[s]) songs.push_back(s);
+        }
+        return songs;
+    }
+
+    // Handler: this shard's likers of each of songs
+    SongPostings postings(const vector<uint32_t>& songs) const {
+        SongPostings out;
+        out.offsets.reserve(songs.size() + 1);
+        out.offsets.push_back(0);
+        for (uint32_t sid : songs) {
+            if (sid + 1 < liker_offsets.size()) {
+                for (uint32_t i = liker_offsets[sid]; i < liker_offsets[sid + 1]; ++i) {
+                    uint32_t u = likers[i];
+                    out.entries.push_back({global_ids[u], static_cast<uint32_t>(liked[u].size())});
+                }
+            }
+            out.offsets.push_back(static_cast<uint32_t>(out.entries.size()));
+        }
+        return out;
+    }
+
+    /**
+     * Scores every local user against every user sharing a liked song,
+     * given by_shard[t] = shard t's postings for likedSongs(). Keeps each
+     * user's top-k neighbors and its above-threshold links. Jaccard is
+     * |A and B| / (|A| + |B| - |A and B|), with the intersection counted
+     * from the postings. Returns the number of (directed) pairs scored.
+     */
+    size_t buildNeighbors(const vector<uint32_t>& songs, const vector<SongPostings>& by_shard) {
+        struct Candidate {
+            uint32_t shared;
+            uint32_t likes;
+            uint32_t shard;
+        };
+        unordered_map<uint32_t, Candidate> candidates;
+        vector<ShardNeighbor> row;
+        size_t k = static_cast<size_t>(max(config.k_similar_users, 0));
+        size_t scored = 0;
+
+        neighbor_offsets.assign(1, 0);
+        neighbors.clear();
+        links.assign(liked.size(), {});
+        for (uint32_t u = 0; u < liked.size(); ++u) {
+            candidates.clear();
+            for (uint32_t sid : liked[u]) {
+                size_t i = lower_bound(songs.begin(), songs.end(), sid) - songs.begin();
+                for (uint32_t t = 0; t < by_shard.size(); ++t) {
+                    const auto &p = by_shard[t];
+                    for (uint32_t e = p.offsets[i]; e < p.offsets[i + 1]; ++e) {
+                        const Posting &liker = p.entries[e];
+                        if (liker.user == global_ids[u]) continue;
+                        auto &c = candidates.emplace(liker.user, Candidate{0, liker.likes, t}).first->second;
+                        c.shared++;
+                    }
+                }
+            }
+            scored += candidates.size();
+
+            row.clear();
+            for (const auto &entry : candidates) {
+                const Candidate &c = entry.second;
+                int union_size = static_cast<int>(liked[u].size() + c.likes - c.shared);
+                double similarity = static_cast<double>(c.shared) / union_size;
+                row.push_back({entry.first, c.shard, similarity});
+                if (similarity >= config.similarity_threshold) links[u].push_back(row.back());
+            }
+            size_t keep = min(k, row.size());
+            partial_sort(row.begin(), row.begin() + keep, row.end(), ranksAbove);
+            neighbors.insert(neighbors.end(), row.begin(), row.begin() + keep);
+            neighbor_offsets.push_back(static_cast<uint32_t>(neighbors.size()));
+        }
+        return scored;
+    }
+
+    // ----- Communities: min-label propagation -----
+
+    void initLabels() {
+        labels = global_ids;
+    }
+
+    // Relaxes links between local users to a fixpoint; true if any label fell
+    bool relaxLocal() {
+        bool changed = false;
+        for (bool again = true; again;) {
+            again = false;
+            for (uint32_t u = 0; u < links.size(); ++u) {
+                for (const auto &link : links[u]) {
+                    if (link.shard != shard_index) continue;
+                    uint32_t v = local_ids.at(link.user);
+                    if (labels[v] < labels[u]) {
+                        labels[u] = labels[v];
+                        again = changed = true;
+                    }
+                }
+            }
+        }
+        return changed;
+    }
+
+    // Users of shard that local users link to, ascending
+    vector<uint32_t> linkedUsers(uint32_t shard) const {
+        vector<uint32_t> users;
+        for (const auto &row : links) {
+            for (const auto &link : row) {
+                if (link.shard == shard) users.push_back(link.user);
+            }
+        }
+        sort(users.begin(), users.end());
+        users.erase(unique(users.begin(), users.end()), users.end());
+        return users;
+    }
+
+    // Handler: current labels of local users given by global id
+    vector<uint32_t> labelsOf(const vector<uint32_t>& users) const {
+        vector<uint32_t> out;
+        out.reserve(users.size());
+        for (uint32_t gid : users) out.push_back(labels[local_ids.at(gid)]);
+        return out;
+    }
+
+    // Lowers labels across links to shard's users; true if any label fell
+    bool applyRemoteLabels(uint32_t shard, const vector<uint32_t>& users, const vector<uint32_t>& remote_labels) {
+        bool changed = false;
+        for (uint32_t u = 0; u < links.size(); ++u) {
+            for (const auto &link : links[u]) {
+                if (link.shard != shard) continue;
+                size_t i = lower_bound(users.begin(), users.end(), link.user) - users.begin();
+                if (remote_labels[i] < labels[u]) {
+                    labels[u] = remote_labels[i];
+                    changed = true;
+                }
+            }
+        }
+        return changed;
+    }
+
+    /**
+     * Local members and liked-song counts of each community (label).
+     * Users without links are alone in their community and are left out.
+     */
+    vector<CommunityPartial> communityPartials() const {
+        unordered_map<uint32_t, size_t> slot;
+        vector<CommunityPartial> partials;
+        vector<ScoreAccumulator> counts;
+        for (uint32_t u = 0; u < liked.size(); ++u) {
+            if (links[u].empty()) continue;
+            auto it = slot.emplace(labels[u], partials.size()).first;
+            if (it->second == partials.size()) {
+                partials.push_back({labels[u], 0, {}});
+                counts.emplace_back();
+                counts.back().resize(catalog->songs.size());
+            }
+            partials[it->second].members++;
+            for (uint32_t sid : liked[u]) {
+                if (catalog->isCatalogSong(sid)) counts[it->second].add(sid, 1.0);
+            }
+        }
+        for (size_t i = 0; i < partials.size(); ++i) {
+            for (uint32_t sid : counts[i].touchedIds()) {
+                partials[i].counts.push_back({sid, static_cast<int>(counts[i].score(sid))});
+            }
+        }
+        return partials;
+    }
+
+    // Handler: adds another shard's (or this one's) part of a community homed here
+    void mergeCommunityPartial(const CommunityPartial& partial) {
+        auto &community = homed[partial.label];
+        community.members += partial.members;
+        community.table.insert(community.table.end(), partial.counts.begin(), partial.counts.end());
+    }
+
+    // Ranks the homed tables, summing counts merged from several shards
+    void finishCommunities() {
+        for (auto &entry : homed) {
+            auto &table = entry.second.table;
+            sort(table.begin(), table.end(),
+                [](const CommunityPopularity::Entry& a, const CommunityPopularity::Entry& b) { return a.song < b.song; });
+            size_t out = 0;
+            for (size_t i = 0; i < table.size(); ++i) {
+                if (out > 0 && table[out - 1].song == table[i].song) table[out - 1].count += table[i].count;
+                else table[out++] = table[i];
+            }
+            table.resize(out);
+            sort(table.begin(), table.end(), [this](const CommunityPopularity::Entry& a, const CommunityPopularity::Entry& b) {
+                if (a.count != b.count) return a.count > b.count;
+                return catalog->songLess(a.song, b.song);
+            });
+        }
+        for (uint32_t u = 0; u < links.size(); ++u) {
+            if (links[u].empty()) labels[u] = INVALID_ID;
+        }
+        vector<vector<ShardNeighbor>>().swap(links);
+    }
+
+    size_t getCommunityCount() const { return homed.size(); }
+
+    // ----- Queries -----
+
+    uint32_t findUser(const string& user_id) const {
+        return user_ids.find(user_id);
+    }
+
+    void scoreContent(uint32_t local, int num_recs, RequestContext& ctx, vector<ScoredSong>& out) const {
+        out.clear();
+        const auto &likes = liked[local];
+        if (likes.empty() || !catalog->content_index) return;
+
+        ctx.queries.clear();
+        for (uint32_t sid : likes) {
+            if (catalog->isCatalogSong(sid)) ctx.queries.push_back(sid);
+        }
+        catalog->content_index->findSimilarSongsBatch(ctx.queries, config.k_nearest, ctx.arena, ctx.neighbors,
+                                                      ctx.neighbor_offsets);
+
+        ScoreAccumulator &scores = ctx.scores;
+        scores.reset();
+        scores.resize(catalog->songs.size());
+        for (uint32_t nid : ctx.neighbors) {
+            if (!exclusions.excludes(local, nid)) scores.add(nid, 1.0);
+        }
+        selectTop(ctx, scores, num_recs, out);
+    }
+
+    // Top-k similar users of local; [first, last) into the neighbor array
+    pair<const ShardNeighbor*, const ShardNeighbor*> topNeighbors(uint32_t local) const {
+        const ShardNeighbor* base = neighbors.data();
+        return {base + neighbor_offsets[local], base + neighbor_offsets[local + 1]};
+    }
+
+    // Handler: liked songs of local users given by global id
+    vector<vector<uint32_t>> likesOf(const vector<uint32_t>& users) const {
+        vector<vector<uint32_t>> out;
+        out.reserve(users.size());
+        for (uint32_t gid : users) out.push_back(liked[local_ids.at(gid)]);
+        return out;
+    }
+
+    const vector<uint32_t>& likesOfLocal(uint32_t gid) const {
+        return liked[local_ids.at(gid)];
+    }
+
+    // neighbor_likes[i]: liked songs of the i-th of topNeighbors(local)
+    void scoreUserCollab(uint32_t local, int num_recs, const vector<const vector<uint32_t>*>& neighbor_likes,
+                         RequestContext& ctx, vector<ScoredSong>& out) const {
+        out.clear();
+        auto range = topNeighbors(local);
+        if (range.first == range.second) return;
+
+        ScoreAccumulator &scores = ctx.scores;
+        scores.reset();
+        scores.resize(catalog->songs.size());
+        size_t i = 0;
+        for (auto it = range.first; it != range.second; ++it, ++i) {
+            for (uint32_t sid : *neighbor_likes[i]) {
+                if (catalog->isCatalogSong(sid) && !exclusions.excludes(local, sid)) scores.add(sid, it->weight);
+            }
+        }
+        selectTop(ctx, scores, num_recs, out);
+    }
+
+    void scoreArtist(uint32_t local, int num_recs, vector<ScoredSong>& out) const {
+        out.clear();
+        auto song_scores = artist_graph.recommendFromTopArtists(
+            local, config.top_artists, static_cast<size_t>(num_recs),
+            [&](uint32_t sid) { return catalog->isCatalogSong(sid) && !exclusions.excludes(local, sid); },
+            [this](uint32_t a, uint32_t b) { return catalog->songLess(a, b); });
+        for (const auto &p : song_scores) out.push_back({p.first, p.second});
+    }
+
+    // Community label of local, INVALID_ID if it is alone
+    uint32_t communityOf(uint32_t local) const {
+        return labels[local];
+    }
+
+    // Catalog songs never recommended to local, ascending
+    vector<uint32_t> exclusionList(uint32_t local) const {
+        vector<uint32_t> out;
+        for (uint32_t sid : liked[local]) {
+            if (catalog->isCatalogSong(sid)) out.push_back(sid);
+        }
+        if (config.exclude_played_min > 0) {
+            for (const auto &p : plays[local]) {
+                if (p.second >= config.exclude_played_min && catalog->isCatalogSong(p.first)) out.push_back(p.first);
+            }
+        }
+        sort(out.begin(), out.end());
+        out.erase(unique(out.begin(), out.end()), out.end());
+        return out;
+    }
+
+    // Handler: top num_recs songs of a community homed here, skipping excluded
+    vector<ScoredSong> communityTop(uint32_t label, const vector<uint32_t>& excluded, int num_recs) const {
+        vector<ScoredSong> out;
+        auto it = homed.find(label);
+        if (it == homed.end() || it->second.members <= 1) return out;
+        for (const auto &entry : it->second.table) {
+            if (static_cast<int>(out.size()) >= num_recs) break;
+            if (binary_search(excluded.begin(), excluded.end(), entry.song)) continue;
+            out.push_back({entry.song, static_cast<double>(entry.count)});
+        }
+        return out;
+    }
+
+    // Weighted fusion of the four pillar lists, like RecommendationEngine
+    void fuse(uint32_t local, const vector<ScoredSong> (&pillar_scores)[4], int num_recs, RequestContext& ctx,
+              vector<Recommendation>& out) const {
+        ScoreAccumulator &fused = ctx.fused;
+        fused.reset();
+        fused.resize(catalog->song_ids.size());
+        for (int p = 0; p < 4; ++p) {
+            for (const auto &s : pillar_scores[p]) {
+                if (!exclusions.excludes(local, s.song)) fused.add(s.song, s.score * config.pillar_weights[p]);
+            }
+        }
+        vector<ScoredSong> top;
+        selectTop(ctx, fused, num_recs < 0 ? 0 : num_recs, top);
+        out.clear();
+        out.reserve(top.size());
+        for (const auto &s : top) {
+            const Song &song = catalog->songs[s.song];
+            out.emplace_back(song.song_id, song.title, s.score, RecommendationSource::COMBINED);
+        }
+    }
+
+    // Bytes held by this shard's users and communities (not the catalog)
+    size_t memoryUsage() const {
+        size_t bytes = user_ids.memoryUsage() + global_ids.capacity() * sizeof(uint32_t) +
+                       local_ids.size() * (sizeof(pair<const uint32_t, uint32_t>) + sizeof(void*)) +
+                       liked.capacity() * sizeof(vector<uint32_t>) +
+                       plays.capacity() * sizeof(unordered_map<uint32_t, int>) +
+                       artist_graph.memoryUsage() + exclusions.memoryUsage() +
+                       (liker_offsets.capacity() + likers.capacity() + neighbor_offsets.capacity() +
+                        labels.capacity()) * sizeof(uint32_t) +
+                       neighbors.capacity() * sizeof(ShardNeighbor);
+        for (const auto &l : liked) bytes += l.capacity() * sizeof(uint32_t);
+        for (const auto &m : plays) {
+            bytes += m.bucket_count() * sizeof(void*) + m.size() * (sizeof(pair<const uint32_t, int>) + sizeof(void*));
+        }
+        for (const auto &c : homed) bytes += sizeof(c) + c.second.table.capacity() * sizeof(CommunityPopularity::Entry);
+        return bytes;
+    }
+};
+
+#endif // USER_SHARD_H
@@ -0,0 +1,161 @@
+#ifndef USER_SIMILARITY_BUILDER_H
+#define USER_SIMILARITY_BUILDER_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "../Data_Structures/weighted_graph.h"
+#include "../core/thread_pool.h"
+
+using namespace std;
+
+// How buildUserSimilarities finds and scores user pairs
+enum class SimilarityMode {
+    EXACT,   // Jaccard of every pair sharing a liked song (UserSimilarityBuilder)
+    MINHASH, // Jaccard of LSH candidates from MinHash signatures (MinHashSimilarityBuilder)
+    COSINE   // play-count cosine as a sparse matrix product (CosineSimilarityBuilder)
+};
+
+struct SimilarityEdge {
+    uint32_t u1;
+    uint32_t u2;
+    double weight;
+
+    SimilarityEdge(uint32_t a, uint32_t b, double w) : u1(a), u2(b), weight(w) {}
+};
+
+/**
+ * Candidate-pruned Jaccard similarity build over users' liked songs
+ *
+ * An inverted song -> likers index means only pairs sharing at least one
+ * liked song are ever scored; everything else has similarity 0 and never
+ * produced an edge anyway. Each candidate pair is then scored with the
+ * SIMD intersection kernel on sorted id vectors.
+ *
+ * Time Complexity: O(sum over users of postings touched + scored pairs * set size)
+ * instead of O(U^2 * set size)
+ *
+ * Rows are emitted in (u1 asc, u2 asc) order for u1 < u2, which is exactly
+ * the order of the all-pairs loop, so the resulting graph and union order
+ * are identical to it.
+ */
+class UserSimilarityBuilder {
+private:
+    const vector<vector<uint32_t>>& liked; // sorted, duplicate-free per user
+
+    // Inverted index (CSR): song -> users who liked it, ascending
+    vector<uint32_t> posting_offsets;
+    vector<uint32_t> postings;
+
+public:
+    // Per-worker scratch reused across rows
+    struct RowScratch {
+        vector<uint32_t> stamp; // stamp[v] == u + 1 once v is a candidate of u
+        vector<uint32_t> candidates;
+    };
+
+    UserSimilarityBuilder(const vector<vector<uint32_t>>& liked_songs, size_t num_songs)
+        : liked(liked_songs) {
+        posting_offsets.assign(num_songs + 1, 0);
+        for (const auto& songs : liked) {
+            for (uint32_t sid : songs) posting_offsets[sid + 1]++;
+        }
+        for (size_t s = 0; s < num_songs; ++s) {
+            posting_offsets[s + 1] += posting_offsets[s];
+        }
+
+        postings.resize(posting_offsets[num_songs]);
+        vector<uint32_t> cursor(posting_offsets.begin(), posting_offsets.end() - 1);
+        for (uint32_t u = 0; u < liked.size(); ++u) {
+            for (uint32_t sid : liked[u]) postings[cursor[sid]++] = u;
+        }
+    }
+
+    uint32_t getUserCount() const {
+        return static_cast<uint32_t>(liked.size());
+    }
+
+    /**
+     * Scores every pair (u, v) with v > u that shares a liked song,
+     * appending edges with similarity > 0 in ascending v order.
+     * Returns the number of pairs scored.
+     */
+    size_t scoreRow(uint32_t u, RowScratch& scratch, vector<SimilarityEdge>& out) const {
+        if (scratch.stamp.size() < liked.size()) scratch.stamp.assign(liked.size(), 0);
+        scratch.candidates.clear();
+
+        for (uint32_t sid : liked[u]) {
+            auto first = postings.begin() + posting_offsets[sid];
+            auto last = postings.begin() + posting_offsets[sid + 1];
+            for (auto it = upper_bound(first, last, u); it != last; ++it) {
+                if (scratch.stamp[*it] != u + 1) {
+                    scratch.stamp[*it] = u + 1;
+                    scratch.candidates.push_back(*it);
+                }
+            }
+        }
+
+        sort(scratch.candidates.begin(), scratch.candidates.end());
+        for (uint32_t v : scratch.candidates) {
+            double similarity = WeightedGraph::jaccardSimilarity(liked[u], liked[v]);
+            if (similarity > 0.0) out.emplace_back(u, v, similarity);
+        }
+        return scratch.candidates.size();
+    }
+
+    /**
+     * Serial build; emit(u1, u2, similarity) is called in all-pairs order.
+     * Returns the number of pairs scored.
+     */
+    template <typename EmitFn>
+    size_t build(EmitFn&& emit) const {
+        RowScratch scratch;
+        vector<SimilarityEdge> row;
+        size_t scored = 0;
+        for (uint32_t u = 0; u < liked.size(); ++u) {
+            row.clear();
+            scored += scoreRow(u, scratch, row);
+            for (const auto& e : row) emit(e.u1, e.u2, e.weight);
+        }
+        return scored;
+    }
+
+    /**
+     * Parallel build: rows are split into shards claimed by the pool's
+     * workers, each shard collects its edges into its own buffer, and the
+     * buffers are merged in shard order on the calling thread. emit() is
+     * therefore called in exactly the serial order, so graph edges and
+     * union-find unions are bit-identical to build().
+     * Returns the number of pairs scored.
+     */
+    template <typename EmitFn>
+    size_t buildParallel(ThreadPool& pool, EmitFn&& emit) const {
+        size_t num_users = liked.size();
+        if (num_users == 0) return 0;
+
+        // Row cost falls with u (only v > u is scored), so use many more
+        // shards than workers and let dynamic claiming balance them.
+        size_t num_shards = min(num_users, pool.size() * 8);
+        vector<vector<SimilarityEdge>> shard_edges(num_shards);
+        vector<size_t> shard_scored(num_shards, 0);
+        vector<RowScratch> scratch(pool.size());
+
+        pool.parallelFor(num_shards, [&](size_t shard, size_t slot) {
+            uint32_t begin = static_cast<uint32_t>(shard * num_users / num_shards);
+            uint32_t end = static_cast<uint32_t>((shard + 1) * num_users / num_shards);
+            for (uint32_t u = begin; u < end; ++u) {
+                shard_scored[shard] += scoreRow(u, scratch[slot], shard_edges[shard]);
+            }
+        });
+
+        size_t scored = 0;
+        for (size_t shard = 0; shard < num_shards; ++shard) {
+            scored += shard_scored[shard];
+            for (const auto& e : shard_edges[shard]) emit(e.u1, e.u2, e.weight);
+            vector<SimilarityEdge>().swap(shard_edges[shard]);
+        }
+        return scored;
+    }
+};
+
+#endif // USER_SIMILARITY_BUILDER_H
@@ -0,0 +1,542 @@
+/**
+ * Benchmark harness
+ *
+ * Times each build phase of RecommendationEngine::initialize() on its own
+ * (dataset load, KD-tree, user similarity graph + communities, bipartite
+ * graph, search trie) and then the whole initialize(), followed by per-call
+ * latency of every pillar, generateRecommendations, batched
+ * recommendations, autocomplete and Zipf-skewed traffic without and
+ * through a warmed result cache (hits and misses timed separately, with
+ * the hit ratio). Prints a table and writes the same numbers as JSON for
+ * regression tracking between releases.
+ *
+ * The user similarity build is also timed in MinHash/LSH mode at a few
+ * settings, each with its recall of the exact build's edges and
+ * communities, and as a play-count cosine sparse matrix product.
+ *
+ * With --shards N it also builds a ShardedEngine over N shards, times its
+ * recommendations, checks them against the single engine's and reports
+ * the shard-to-shard traffic.
+ *
+ * Usage: benchmark [--data DIR] [--queries N] [--threads N] [--shards N] [--out FILE]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../core/data_loader.h"
+#include "../algorithms/recommendation_engine.h"
+#include "../algorithms/sharded_engine.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct BuildResult {
+    std::string phase;
+    double seconds;
+    size_t items;      // rows, points, pairs, edges or entries processed
+    const char* unit;
+};
+
+// An approximate user similarity build measured against the exact one
+struct MinHashResult {
+    std::string phase;
+    MinHashOptions options;
+    double seconds;
+    size_t candidates;
+    int edges;
+    double edge_recall;          // exact edges found
+    double strong_edge_recall;   // exact edges >= threshold found at >= threshold
+    double strong_edge_precision;
+    double top_neighbor_recall;  // exact top-k neighbors among the approximate top-k
+    int communities;
+    double community_pair_recall;    // co-clustered user pairs kept together
+    double community_pair_precision; // co-clustered pairs that are so exactly
+};
+
+constexpr double COMMUNITY_THRESHOLD = 0.3;
+constexpr size_t TOP_NEIGHBORS = 5; // neighbors the collaborative pillar reads
+
+// Co-clustered user pairs: sum over clusters of size * (size - 1) / 2
+double coClusteredPairs(const std::unordered_map<uint64_t, size_t>& sizes) {
+    double pairs = 0.0;
+    for (const auto& entry : sizes) pairs += 0.5 * entry.second * (entry.second - 1.0);
+    return pairs;
+}
+
+MinHashResult compareToExact(const std::string& phase, const MinHashOptions& options, double seconds, size_t candidates,
+                             const WeightedGraph& graph, UnionFind& communities, const WeightedGraph& exact_graph,
+                             UnionFind& exact_communities, const std::vector<std::vector<uint32_t>>& liked) {
+    MinHashResult r{phase, options, seconds, candidates, graph.getEdgeCount(), 0.0, 0.0, 0.0, 0.0,
+                    communities.getNumberOfCommunities(), 0.0, 0.0};
+    size_t exact_strong = 0;
+    for (uint32_t u = 0; u < liked.size(); ++u) {
+        for (const auto& edge : exact_graph.getNeighbors(u)) {
+            if (u < edge.first && edge.second >= COMMUNITY_THRESHOLD) exact_strong++;
+        }
+    }
+    size_t found = 0, strong = 0, strong_found = 0;
+    for (uint32_t u = 0; u < liked.size(); ++u) {
+        for (const auto& edge : graph.getNeighbors(u)) {
+            if (u > edge.first) continue;
+            double exact = WeightedGraph::jaccardSimilarity(liked[u], liked[edge.first]);
+            if (exact > 0.0) found++;
+            if (edge.second >= COMMUNITY_THRESHOLD) {
+                strong++;
+                if (exact >= COMMUNITY_THRESHOLD) strong_found++;
+            }
+        }
+    }
+    int exact_edges = exact_graph.getEdgeCount();
+    r.edge_recall = exact_edges > 0 ? static_cast<double>(found) / exact_edges : 1.0;
+    r.strong_edge_recall = exact_strong > 0 ? static_cast<double>(strong_found) / exact_strong : 1.0;
+    r.strong_edge_precision = strong > 0 ? static_cast<double>(strong_found) / strong : 1.0;
+
+    // Neighbor lists are ranked by weight, best first
+    size_t top_exact = 0, top_found = 0;
+    for (uint32_t u = 0; u < liked.size(); ++u) {
+        auto exact = exact_graph.getNeighbors(u), approx = graph.getNeighbors(u);
+        size_t k = std::min(TOP_NEIGHBORS, exact.size());
+        top_exact += k;
+        for (size_t i = 0; i < k; ++i) {
+            for (size_t j = 0; j < std::min(TOP_NEIGHBORS, approx.size()); ++j) {
+                if (approx.id(j) == exact.id(i)) top_found++;
+            }
+        }
+    }
+    r.top_neighbor_recall = top_exact > 0 ? static_cast<double>(top_found) / top_exact : 1.0;
+
+    std::unordered_map<uint64_t, size_t> exact_sizes, sizes, both;
+    for (uint32_t u = 0; u < liked.size(); ++u) {
+        uint64_t e = exact_communities.find(u), a = communities.find(u);
+        exact_sizes[e]++;
+        sizes[a]++;
+        both[(e << 32) | a]++;
+    }
+    double together = coClusteredPairs(both);
+    double exact_pairs = coClusteredPairs(exact_sizes), pairs = coClusteredPairs(sizes);
+    r.community_pair_recall = exact_pairs > 0 ? together / exact_pairs : 1.0;
+    r.community_pair_precision = pairs > 0 ? together / pairs : 1.0;
+    return r;
+}
+
+struct QueryResult {
+    std::string name;
+    size_t count;
+    double total_seconds;
+    double mean_us;
+    double p50_us;
+    double p99_us;
+    double max_us;
+};
+
+// Latency summary of samples (microseconds)
+QueryResult summarize(const std::string& name, std::vector<double> samples) {
+    QueryResult r{name, samples.size(), 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (samples.empty()) return r;
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+    auto at = [&](double q) { return samples[std::min(samples.size() - 1, static_cast<size_t>(q * samples.size()))]; };
+    r.total_seconds = sum / 1e6;
+    r.mean_us = sum / samples.size();
+    r.p50_us = at(0.50);
+    r.p99_us = at(0.99);
+    r.max_us = samples.back();
+    return r;
+}
+
+// Runs call(i) for each i and records its latency
+template <typename Fn>
+QueryResult timeCalls(const std::string& name, size_t n, Fn call) {
+    std::vector<double> samples;
+    samples.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        auto start = Clock::now();
+        call(i);
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    return summarize(name, std::move(samples));
+}
+
+// Discards engine progress output while timing
+class QuietCout {
+private:
+    std::streambuf* saved;
+
+public:
+    QuietCout() : saved(std::cout.rdbuf(nullptr)) {}
+    ~QuietCout() {
+        std::cout.rdbuf(saved);
+        std::cout.clear();
+    }
+};
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') out += '\\';
+        out += ch;
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string data_dir = "bench_data";
+    std::string out_file = "bench_results.json";
+    size_t num_queries = 1000;
+    int threads = 0;
+    size_t num_shards = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--data") data_dir = argv[i + 1];
+        else if (flag == "--out") out_file = argv[i + 1];
+        else if (flag == "--queries") num_queries = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--threads") threads = std::atoi(argv[i + 1]);
+        else if (flag == "--shards") num_shards = std::strtoull(argv[i + 1], nullptr, 10);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--data DIR] [--queries N] [--threads N] [--shards N] [--out FILE]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<BuildResult> builds;
+
+    // ----- Build phases -----
+    auto start = Clock::now();
+    DataLoader::Datasets data;
+    {
+        QuietCout quiet;
+        data = DataLoader::loadAll(data_dir + "/songs.csv", data_dir + "/artists.csv", data_dir + "/users.csv",
+                                   data_dir + "/user_song_interactions.csv",
+                                   data_dir + "/user_artist_interactions.csv", static_cast<size_t>(threads));
+    }
+    size_t rows = 0;
+    for (const auto& s : data.stats) rows += s.rows;
+    builds.push_back({"load", secondsSince(start), rows, "rows"});
+    if (data.songs.empty() || data.users.empty()) {
+        std::cerr << "No dataset in " << data_dir << "/ (run generate_dataset first)" << std::endl;
+        return 1;
+    }
+
+    start = Clock::now();
+    KDTree kdtree;
+    kdtree.build(data.songs);
+    builds.push_back({"kdtree_build", secondsSince(start), data.songs.size(), "points"});
+
+    // Dense ids and liked lists as initialize() prepares them
+    IdRegistry user_ids, song_ids, artist_ids;
+    for (const auto& s : data.songs) song_ids.intern(s.song_id);
+    for (const auto& u : data.users) user_ids.intern(u.user_id);
+    std::vector<std::vector<uint32_t>> liked(user_ids.size());
+    std::vector<std::unordered_map<uint32_t, int>> plays(user_ids.size());
+    for (const auto& it : data.song_interactions) {
+        uint32_t uid = user_ids.intern(it.user_id);
+        if (uid >= liked.size()) {
+            liked.resize(uid + 1);
+            plays.resize(uid + 1);
+        }
+        uint32_t sid = song_ids.intern(it.song_id);
+        plays[uid][sid] = it.play_count;
+        if (it.liked) liked[uid].push_back(sid);
+    }
+    for (auto& likes : liked) {
+        std::sort(likes.begin(), likes.end());
+        likes.erase(std::unique(likes.begin(), likes.end()), likes.end());
+    }
+
+    std::vector<MinHashResult> minhash_results;
+    {
+        ThreadPool pool(static_cast<size_t>(threads));
+        start = Clock::now();
+        WeightedGraph exact_graph;
+        UnionFind exact_communities;
+        for (uint32_t uid = 0; uid < liked.size(); ++uid) exact_communities.makeSet(uid);
+        UserSimilarityBuilder builder(liked, song_ids.size());
+        size_t scored = builder.buildParallel(pool, [&](uint32_t u1, uint32_t u2, double similarity) {
+            exact_graph.addEdge(u1, u2, similarity);
+            if (similarity >= COMMUNITY_THRESHOLD) exact_communities.unionSets(u1, u2);
+        });
+        exact_graph.freeze();
+        builds.push_back({"user_similarity_build", secondsSince(start), scored, "pairs"});
+
+        // Bands x rows per band, verified or estimated
+        const MinHashOptions settings[] = {{16, 2, true, 0, 0x5eed}, {32, 2, true, 0, 0x5eed},
+                                           {64, 2, true, 0, 0x5eed}, {32, 2, false, 0, 0x5eed}};
+        for (const auto& options : settings) {
+            start = Clock::now();
+            WeightedGraph graph;
+            UnionFind communities;
+            for (uint32_t uid = 0; uid < liked.size(); ++uid) communities.makeSet(uid);
+            MinHashSimilarityBuilder minhash(liked, options, &pool);
+            size_t candidates = minhash.buildParallel(pool, [&](uint32_t u1, uint32_t u2, double similarity) {
+                graph.addEdge(u1, u2, similarity);
+                if (similarity >= COMMUNITY_THRESHOLD) communities.unionSets(u1, u2);
+            });
+            graph.freeze();
+            double seconds = secondsSince(start);
+            std::string phase = "minhash_b" + std::to_string(options.bands) + "_r" + std::to_string(options.rows_per_band)
+                              + (options.verify ? "" : "_estimated");
+            builds.push_back({phase, seconds, candidates, "pairs"});
+            minhash_results.push_back(compareToExact(phase, options, seconds, candidates, graph, communities, exact_graph,
+                                                     exact_communities, liked));
+        }
+
+        // Play-count cosine, top 50 per user plus every above-threshold link
+        start = Clock::now();
+        WeightedGraph cosine_graph;
+        UnionFind cosine_communities;
+        for (uint32_t uid = 0; uid < plays.size(); ++uid) cosine_communities.makeSet(uid);
+        CosineSimilarityBuilder cosine(plays, song_ids.size(), 50, COMMUNITY_THRESHOLD);
+        size_t cosine_pairs = cosine.buildParallel(pool, [&](uint32_t u1, uint32_t u2, double similarity) {
+            cosine_graph.addEdge(u1, u2, similarity);
+            if (similarity >= COMMUNITY_THRESHOLD) cosine_communities.unionSets(u1, u2);
+        });
+        cosine_graph.freeze();
+        builds.push_back({"cosine_similarity_build", secondsSince(start), cosine_pairs, "pairs"});
+    }
+
+    start = Clock::now();
+    BipartiteGraph bipartite;
+    for (const auto& it : data.artist_interactions) {
+        bipartite.addEdge(user_ids.intern(it.user_id), artist_ids.intern(it.artist_id), it.play_count);
+    }
+    bipartite.freeze();
+    builds.push_back({"bipartite_build", secondsSince(start), data.artist_interactions.size(), "edges"});
+
+    start = Clock::now();
+    {
+        Trie trie;
+        for (const auto& s : data.songs) trie.insert(s.title);
+        for (const auto& a : data.artists) trie.insert(a.artist_name);
+        for (const auto& it : data.song_interactions) {
+            uint32_t sid = song_ids.find(it.song_id);
+            if (it.play_count > 10 && sid < data.songs.size()) trie.incrementFrequency(data.songs[sid].title);
+        }
+        CompactTrie compact(trie);
+    }
+    builds.push_back({"trie_build", secondsSince(start), data.songs.size() + data.artists.size(), "entries"});
+
+    RecommendationEngine engine;
+    engine.setWorkerThreads(threads);
+    start = Clock::now();
+    {
+        QuietCout quiet;
+        engine.initialize(data.songs, data.artists, data.users, data.song_interactions, data.artist_interactions);
+    }
+    builds.push_back({"initialize", secondsSince(start), rows, "rows"});
+
+    std::unique_ptr<ShardedEngine> sharded;
+    if (num_shards > 0) {
+        sharded.reset(new ShardedEngine(num_shards));
+        sharded->setWorkerThreads(threads);
+        start = Clock::now();
+        {
+            QuietCout quiet;
+            sharded->initialize(data.songs, data.artists, data.users, data.song_interactions, data.artist_interactions);
+        }
+        builds.push_back({"sharded_initialize", secondsSince(start), rows, "rows"});
+    }
+
+    // ----- Queries -----
+    std::vector<std::string> query_users;
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<size_t> pick_user(0, engine.getUsers().size() - 1);
+    for (size_t i = 0; i < num_queries; ++i) query_users.push_back(engine.getUsers()[pick_user(rng)].user_id);
+
+    std::vector<std::string> prefixes;
+    std::uniform_int_distribution<size_t> pick_song(0, engine.getSongs().size() - 1);
+    std::uniform_int_distribution<size_t> prefix_length(1, 5);
+    for (size_t i = 0; i < num_queries; ++i) {
+        const std::string& title = engine.getSongs()[pick_song(rng)].title;
+        prefixes.push_back(title.substr(0, std::min(title.size(), prefix_length(rng))));
+    }
+
+    size_t sink = 0; // keeps results observable
+    std::vector<QueryResult> queries;
+    queries.push_back(timeCalls("content_pillar", num_queries, [&](size_t i) {
+        sink += engine.getContentBasedRecommendations(query_users[i], 10).size();
+    }));
+    queries.push_back(timeCalls("user_collab_pillar", num_queries, [&](size_t i) {
+        sink += engine.getUserCollaborativeRecommendations(query_users[i], 10).size();
+    }));
+    queries.push_back(timeCalls("artist_pillar", num_queries, [&](size_t i) {
+        sink += engine.getArtistBasedRecommendations(query_users[i], 10).size();
+    }));
+    queries.push_back(timeCalls("community_pillar", num_queries, [&](size_t i) {
+        sink += engine.getCommunityBasedRecommendations(query_users[i], 10).size();
+    }));
+    queries.push_back(timeCalls("generate_recommendations", num_queries, [&](size_t i) {
+        sink += engine.generateRecommendations(query_users[i], 10).size();
+    }));
+    queries.push_back(timeCalls("autocomplete", num_queries, [&](size_t i) {
+        sink += engine.searchAutocomplete(prefixes[i]).size();
+    }));
+
+    // Batched: one sample for the whole batch, reported per user
+    start = Clock::now();
+    engine.generateRecommendationsBatch(query_users, 10,
+        [&](const std::string&, const std::vector<Recommendation>& recs) { sink += recs.size(); });
+    double batch_seconds = secondsSince(start);
+    double per_user_us = num_queries > 0 ? batch_seconds * 1e6 / num_queries : 0.0;
+    queries.push_back({"batch_recommendations", num_queries, batch_seconds, per_user_us, per_user_us, per_user_us,
+                       per_user_us});
+
+    // Same users through the sharded engine; results must equal the single engine's
+    size_t shard_mismatches = 0;
+    if (sharded) {
+        queries.push_back(timeCalls("sharded_recommendations", num_queries, [&](size_t i) {
+            sink += sharded->generateRecommendations(query_users[i], 10).size();
+        }));
+        for (const auto& user : query_users) {
+            auto expected = engine.generateRecommendations(user, 10);
+            auto actual = sharded->generateRecommendations(user, 10);
+            bool same = expected.size() == actual.size();
+            for (size_t r = 0; same && r < actual.size(); ++r) {
+                same = expected[r].song_id == actual[r].song_id && expected[r].score == actual[r].score;
+            }
+            if (!same) shard_mismatches++;
+        }
+    }
+
+    // Skewed session traffic (Zipf over users): uncached, then through a
+    // cache warmed by an earlier session, with hits and misses timed apart
+    std::vector<double> user_weights(engine.getUsers().size());
+    for (size_t r = 0; r < user_weights.size(); ++r) user_weights[r] = 1.0 / (r + 1);
+    std::discrete_distribution<size_t> pick_active(user_weights.begin(), user_weights.end());
+    std::vector<std::string> warmup_users, session_users;
+    for (size_t i = 0; i < num_queries; ++i) warmup_users.push_back(engine.getUsers()[pick_active(rng)].user_id);
+    for (size_t i = 0; i < num_queries; ++i) session_users.push_back(engine.getUsers()[pick_active(rng)].user_id);
+    queries.push_back(timeCalls("uncached_sessions", num_queries, [&](size_t i) {
+        sink += engine.generateRecommendations(session_users[i], 10).size();
+    }));
+
+    engine.setResultCache(size_t(64) << 20);
+    for (const auto& user : warmup_users) sink += engine.generateRecommendations(user, 10).size();
+    const auto& cache = engine.getResultCache();
+    uint64_t warm_hits = cache.getHits(), warm_misses = cache.getMisses();
+    std::vector<double> session_samples, hit_samples, miss_samples;
+    for (const auto& user : session_users) {
+        uint64_t hits = cache.getHits();
+        auto start = Clock::now();
+        sink += engine.generateRecommendations(user, 10).size();
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        session_samples.push_back(us);
+        (cache.getHits() > hits ? hit_samples : miss_samples).push_back(us);
+    }
+    uint64_t cache_hits = cache.getHits() - warm_hits, cache_misses = cache.getMisses() - warm_misses;
+    double cache_hit_ratio = cache_hits + cache_misses ? static_cast<double>(cache_hits) / (cache_hits + cache_misses) : 0.0;
+    queries.push_back(summarize("cached_recommendations", std::move(session_samples)));
+    queries.push_back(summarize("cached_hits", std::move(hit_samples)));
+    queries.push_back(summarize("cached_misses", std::move(miss_samples)));
+
+    // ----- Report -----
+    std::cout << "Dataset: " << engine.getSongs().size() << " songs, " << engine.getArtists().size() << " artists, "
+              << engine.getUsers().size() << " users, " << data.song_interactions.size() << " user-song and "
+              << data.artist_interactions.size() << " user-artist interactions\n\n";
+    std::cout << std::left << std::setw(26) << "Build phase" << std::right << std::setw(12) << "seconds"
+              << std::setw(24) << "throughput" << "\n";
+    for (const auto& b : builds) {
+        std::ostringstream rate;
+        rate << std::fixed << std::setprecision(0) << (b.seconds > 0 ? b.items / b.seconds : 0.0) << " " << b.unit << "/s";
+        std::cout << std::left << std::setw(26) << b.phase << std::right << std::fixed << std::setprecision(4)
+                  << std::setw(12) << b.seconds << std::setw(24) << rate.str() << "\n";
+    }
+    std::cout << "\n" << std::left << std::setw(26) << "MinHash vs exact" << std::right << std::setw(12) << "edges"
+              << std::setw(12) << "recall" << std::setw(12) << "strong rec" << std::setw(12) << "strong prec"
+              << std::setw(12) << "top5 rec" << std::setw(12) << "comm rec" << std::setw(12) << "comm prec" << "\n";
+    for (const auto& m : minhash_results) {
+        std::cout << std::left << std::setw(26) << m.phase
+                  << std::right << std::fixed << std::setprecision(4) << std::setw(12) << m.edges << std::setw(12)
+                  << m.edge_recall << std::setw(12) << m.strong_edge_recall << std::setw(12) << m.strong_edge_precision
+                  << std::setw(12) << m.top_neighbor_recall << std::setw(12) << m.community_pair_recall << std::setw(12) << m.community_pair_precision << "\n";
+    }
+    std::cout << "\n" << std::left << std::setw(26) << "Query" << std::right << std::setw(12) << "qps"
+              << std::setw(12) << "mean us" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << "\n";
+    for (const auto& q : queries) {
+        double qps = q.total_seconds > 0 ? q.count / q.total_seconds : 0.0;
+        std::cout << std::left << std::setw(26) << q.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << qps << std::setw(12) << q.mean_us << std::setw(12) << q.p50_us
+                  << std::setw(12) << q.p99_us << "\n";
+    }
+
+    std::ofstream json(out_file);
+    json << std::setprecision(9);
+    json << "{\n  \"dataset\": {\"songs\": " << engine.getSongs().size() << ", \"artists\": " << engine.getArtists().size()
+         << ", \"users\": " << engine.getUsers().size() << ", \"song_interactions\": " << data.song_interactions.size()
+         << ", \"artist_interactions\": " << data.artist_interactions.size() << ", \"threads\": " << threads << "},\n";
+    json << "  \"build\": [\n";
+    for (size_t i = 0; i < builds.size(); ++i) {
+        const auto& b = builds[i];
+        json << "    {\"phase\": \"" << jsonEscape(b.phase) << "\", \"seconds\": " << b.seconds << ", \"items\": " << b.items
+             << ", \"unit\": \"" << b.unit << "\", \"items_per_second\": " << (b.seconds > 0 ? b.items / b.seconds : 0.0)
+             << "}" << (i + 1 < builds.size() ? "," : "") << "\n";
+    }
+    json << "  ],\n  \"minhash\": [\n";
+    for (size_t i = 0; i < minhash_results.size(); ++i) {
+        const auto& m = minhash_results[i];
+        json << "    {\"phase\": \"" << jsonEscape(m.phase) << "\", \"bands\": " << m.options.bands
+             << ", \"rows_per_band\": " << m.options.rows_per_band << ", \"verify\": " << (m.options.verify ? "true" : "false")
+             << ", \"seconds\": " << m.seconds << ", \"candidates\": " << m.candidates << ", \"edges\": " << m.edges
+             << ", \"edge_recall\": " << m.edge_recall << ", \"strong_edge_recall\": " << m.strong_edge_recall
+             << ", \"strong_edge_precision\": " << m.strong_edge_precision
+             << ", \"top_neighbor_recall\": " << m.top_neighbor_recall << ", \"communities\": " << m.communities
+             << ", \"community_pair_recall\": " << m.community_pair_recall
+             << ", \"community_pair_precision\": " << m.community_pair_precision << "}"
+             << (i + 1 < minhash_results.size() ? "," : "") << "\n";
+    }
+    json << "  ],\n  \"queries\": [\n";
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto& q = queries[i];
+        json << "    {\"name\": \"" << jsonEscape(q.name) << "\", \"count\": " << q.count << ", \"throughput_qps\": "
+             << (q.total_seconds > 0 ? q.count / q.total_seconds : 0.0) << ", \"mean_us\": " << q.mean_us
+             << ", \"p50_us\": " << q.p50_us << ", \"p99_us\": " << q.p99_us << ", \"max_us\": " << q.max_us << "}"
+             << (i + 1 < queries.size() ? "," : "") << "\n";
+    }
+    // Engine-side instrumentation accumulated over the whole run
+    std::string stats = engine.getStats().toJson();
+    stats.pop_back(); // trailing newline
+    size_t at = 0;
+    while ((at = stats.find('\n', at)) != std::string::npos) stats.insert(++at, "  ");
+    json << "  ],\n  \"result_cache\": {\"warmup_requests\": " << warmup_users.size() << ", \"hits\": " << cache_hits
+         << ", \"misses\": " << cache_misses << ", \"hit_ratio\": " << cache_hit_ratio << "},\n";
+    json << "  \"engine_stats\": " << stats;
+    if (sharded) {
+        std::string shard_stats = sharded->getStats().toJson();
+        shard_stats.pop_back();
+        at = 0;
+        while ((at = shard_stats.find('\n', at)) != std::string::npos) shard_stats.insert(++at, "  ");
+        json << ",\n  \"sharded\": {\"shards\": " << num_shards << ", \"mismatches\": " << shard_mismatches
+             << ", \"stats\": " << shard_stats << "}";
+    }
+    json << "\n}\n";
+    if (!json) {
+        std::cerr << "Cannot write " << out_file << std::endl;
+        return 1;
+    }
+    std::cout << "\nResult cache: " << std::setprecision(1) << 100.0 * cache_hit_ratio << "% hits over "
+              << session_users.size() << " session requests, warmed by " << warmup_users.size() << "\n";
+    if (sharded) {
+        std::cout << "\n" << num_shards << " shards: " << shard_mismatches << " of " << query_users.size()
+                  << " users differ from the single engine\n";
+    }
+    std::cout << "\nResults written to " << out_file << " (" << sink << " results)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,245 @@
+/**
+ * Synthetic dataset generator for benchmarks
+ *
+ * Writes songs.csv, artists.csv, users.csv, user_song_interactions.csv and
+ * user_artist_interactions.csv in the DataLoader schemas. Song popularity,
+ * user activity and play counts follow power laws, like real listening
+ * data: a few hits and heavy listeners, a long tail of both. Output is
+ * deterministic for a given seed.
+ *
+ * Usage: generate_dataset [--users N] [--songs N] [--artists N]
+ *                         [--interactions N] [--like-rate P] [--seed N]
+ *                         [--out DIR]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sys/stat.h>
+
+namespace {
+
+struct Options {
+    size_t users = 5000;
+    size_t songs = 20000;
+    size_t artists = 2000;
+    size_t interactions = 200000; // user-song rows; up to 10M
+    double like_rate = 0.3;
+    unsigned long long seed = 42;
+    std::string out = "bench_data";
+};
+
+// Samples ranks 0..n-1 with P(r) proportional to 1 / (r + 1)^exponent
+class ZipfSampler {
+private:
+    std::vector<double> cdf;
+
+public:
+    ZipfSampler(size_t n, double exponent) : cdf(n) {
+        double total = 0.0;
+        for (size_t r = 0; r < n; ++r) {
+            total += 1.0 / std::pow(static_cast<double>(r + 1), exponent);
+            cdf[r] = total;
+        }
+        for (auto& c : cdf) c /= total;
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        size_t r = static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+        return std::min(r, cdf.size() - 1);
+    }
+};
+
+// Buffered CSV file writer
+class CsvFile {
+private:
+    FILE* file;
+    std::string buffer;
+
+public:
+    explicit CsvFile(const std::string& path) : file(std::fopen(path.c_str(), "wb")) {
+        if (!file) {
+            std::cerr << "Cannot write " << path << std::endl;
+            std::exit(1);
+        }
+    }
+
+    ~CsvFile() {
+        flush();
+        std::fclose(file);
+    }
+
+    CsvFile& operator<<(const std::string& text) {
+        buffer += text;
+        if (buffer.size() >= (1 << 20)) flush();
+        return *this;
+    }
+
+    void flush() {
+        std::fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+    }
+};
+
+// Zero-padded ids keep file order equal to id order
+std::string makeId(char prefix, size_t index, size_t count) {
+    std::string digits = std::to_string(index + 1);
+    size_t width = std::max<size_t>(3, std::to_string(count).size());
+    return prefix + std::string(width - digits.size(), '0') + digits;
+}
+
+// Pronounceable pseudo-words, so titles share prefixes like real ones
+std::string makeWord(std::mt19937_64& rng) {
+    static const char* syllables[] = {"ba", "lo", "mi", "ra", "sun", "ne", "ko", "ta", "vi", "star",
+                                      "lu", "da", "re", "mo", "shi", "an", "el", "or", "ki", "zo"};
+    std::uniform_int_distribution<int> count(1, 3), pick(0, 19);
+    std::string word;
+    for (int i = count(rng); i > 0; --i) word += syllables[pick(rng)];
+    word[0] = static_cast<char>(word[0] - 'a' + 'A');
+    return word;
+}
+
+bool parseArgs(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--users") opt.users = std::strtoull(value, nullptr, 10);
+        else if (flag == "--songs") opt.songs = std::strtoull(value, nullptr, 10);
+        else if (flag == "--artists") opt.artists = std::strtoull(value, nullptr, 10);
+        else if (flag == "--interactions") opt.interactions = std::strtoull(value, nullptr, 10);
+        else if (flag == "--like-rate") opt.like_rate = std::strtod(value, nullptr);
+        else if (flag == "--seed") opt.seed = std::strtoull(value, nullptr, 10);
+        else if (flag == "--out") opt.out = value;
+        else return false;
+    }
+    return argc % 2 == 1 && opt.users > 0 && opt.songs > 0 && opt.artists > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        std::cerr << "Usage: " << argv[0] << " [--users N] [--songs N] [--artists N] [--interactions N]"
+                  << " [--like-rate P] [--seed N] [--out DIR]" << std::endl;
+        return 1;
+    }
+    mkdir(opt.out.c_str(), 0755);
+    std::mt19937_64 rng(opt.seed);
+
+    static const char* genres[] = {"Pop", "Hip Hop", "RnB", "Rock", "Electronic", "Jazz", "Indie", "Latin"};
+    static const char* moods[] = {"energetic", "chill", "happy", "sad", "romantic", "dark"};
+    std::uniform_int_distribution<int> genre_pick(0, 7), mood_pick(0, 5), bpm_pick(60, 200);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    {
+        CsvFile artists(opt.out + "/artists.csv");
+        artists << "artist_id,artist_name,genre\n";
+        for (size_t a = 0; a < opt.artists; ++a) {
+            artists << makeId('A', a, opt.artists) << "," << makeWord(rng) << " " << makeWord(rng) << ","
+                    << genres[genre_pick(rng)] << "\n";
+        }
+    }
+
+    // Prolific artists own more songs
+    ZipfSampler artist_of_song(opt.artists, 0.8);
+    std::vector<size_t> song_artist(opt.songs);
+    {
+        CsvFile songs(opt.out + "/songs.csv");
+        songs << "song_id,title,artist_id,genre,bpm,energy,danceability,valence,mood\n";
+        char features[64];
+        for (size_t s = 0; s < opt.songs; ++s) {
+            song_artist[s] = artist_of_song(rng);
+            std::snprintf(features, sizeof(features), "%d,%.2f,%.2f,%.2f", bpm_pick(rng), unit(rng), unit(rng), unit(rng));
+            songs << makeId('S', s, opt.songs) << "," << makeWord(rng) << " " << makeWord(rng) << ","
+                  << makeId('A', song_artist[s], opt.artists) << "," << genres[genre_pick(rng)] << ","
+                  << features << "," << moods[mood_pick(rng)] << "\n";
+        }
+    }
+
+    {
+        CsvFile users(opt.out + "/users.csv");
+        users << "user_id,username\n";
+        for (size_t u = 0; u < opt.users; ++u) {
+            users << makeId('U', u, opt.users) << ",user_" << std::to_string(u + 1) << "\n";
+        }
+    }
+
+    // Rows per user: power-law activity, at most one row per (user, song)
+    ZipfSampler user_activity(opt.users, 0.7);
+    std::vector<size_t> rows_of(opt.users, 0);
+    size_t target = std::min(opt.interactions, opt.users * opt.songs);
+    for (size_t i = 0; i < target; ++i) {
+        size_t u = user_activity(rng);
+        while (rows_of[u] >= opt.songs) u = (u + 1) % opt.users;
+        rows_of[u]++;
+    }
+
+    // Hits shuffled across the catalog, so popularity is not id order
+    std::vector<size_t> song_rank(opt.songs);
+    for (size_t s = 0; s < opt.songs; ++s) song_rank[s] = s;
+    std::shuffle(song_rank.begin(), song_rank.end(), rng);
+    ZipfSampler song_popularity(opt.songs, 1.0);
+    std::uniform_real_distribution<double> pareto_u(0.0, 1.0);
+    auto plays = [&]() {
+        // Pareto (alpha 1.2) play counts, capped
+        double p = 1.0 / std::pow(1.0 - pareto_u(rng), 1.0 / 1.2);
+        return static_cast<int>(std::min(p, 500.0));
+    };
+
+    CsvFile song_rows(opt.out + "/user_song_interactions.csv");
+    CsvFile artist_rows(opt.out + "/user_artist_interactions.csv");
+    song_rows << "user_id,song_id,liked,play_count\n";
+    artist_rows << "user_id,artist_id,play_count\n";
+    size_t written = 0, artist_written = 0;
+    std::unordered_set<size_t> picked;
+    std::unordered_map<size_t, int> artist_plays;
+    std::vector<size_t> songs_of_user;
+    for (size_t u = 0; u < opt.users; ++u) {
+        if (rows_of[u] == 0) continue;
+        std::string user_id = makeId('U', u, opt.users);
+
+        // Distinct songs; fall back to a uniform pick once the head is taken
+        picked.clear();
+        songs_of_user.clear();
+        while (songs_of_user.size() < rows_of[u]) {
+            size_t s = song_rank[song_popularity(rng)];
+            if (!picked.insert(s).second) {
+                s = std::uniform_int_distribution<size_t>(0, opt.songs - 1)(rng);
+                if (!picked.insert(s).second) continue;
+            }
+            songs_of_user.push_back(s);
+        }
+
+        artist_plays.clear();
+        for (size_t s : songs_of_user) {
+            int count = plays();
+            bool liked = unit(rng) < opt.like_rate;
+            song_rows << user_id << "," << makeId('S', s, opt.songs) << "," << (liked ? "true" : "false") << ","
+                      << std::to_string(count) << "\n";
+            artist_plays[song_artist[s]] += count;
+            written++;
+        }
+        std::vector<std::pair<size_t, int>> rows(artist_plays.begin(), artist_plays.end());
+        std::sort(rows.begin(), rows.end());
+        for (const auto& row : rows) {
+            artist_rows << user_id << "," << makeId('A', row.first, opt.artists) << "," << std::to_string(row.second) << "\n";
+            artist_written++;
+        }
+    }
+
+    std::cout << "Wrote " << opt.songs << " songs, " << opt.artists << " artists, " << opt.users << " users, "
+              << written << " user-song and " << artist_written << " user-artist interactions to "
+              << opt.out << "/" << std::endl;
+    return 0;
+}
@@ -0,0 +1,110 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Monotonic bump allocator for request-lifetime scratch memory
+ *
+ * allocate() bumps a pointer inside the current block; individual frees
+ * are no-ops and everything is released at once by reset(). When a
+ * request outgrows the arena, reset() replaces the blocks with a single
+ * block of the high-water size, so after warm-up a reused arena serves
+ * every request from one block without touching the system allocator.
+ */
+class Arena {
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    static constexpr size_t MIN_BLOCK = 16 * 1024;
+
+    std::vector<Block> blocks;
+    size_t used = 0;       // bytes used in blocks.back()
+    size_t allocated = 0;  // bytes handed out since reset(), for sizing
+
+    void addBlock(size_t min_size) {
+        size_t size = blocks.empty() ? MIN_BLOCK : blocks.back().size * 2;
+        if (size < min_size) size = min_size;
+        blocks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+        used = 0;
+    }
+
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        if (blocks.empty()) addBlock(bytes + align);
+        uintptr_t base = reinterpret_cast<uintptr_t>(blocks.back().data.get());
+        size_t offset = (base + used + align - 1) / align * align - base;
+        if (offset + bytes > blocks.back().size) {
+            addBlock(bytes + align);
+            base = reinterpret_cast<uintptr_t>(blocks.back().data.get());
+            offset = (base + align - 1) / align * align - base;
+        }
+        used = offset + bytes;
+        allocated += bytes + align;
+        return blocks.back().data.get() + offset;
+    }
+
+    // Releases every allocation; keeps (and if needed coalesces) the memory
+    void reset() {
+        if (blocks.size() > 1) {
+            size_t total = 0;
+            for (const auto& block : blocks) total += block.size;
+            if (total < allocated) total = allocated;
+            blocks.clear();
+            addBlock(total);
+        }
+        used = 0;
+        allocated = 0;
+    }
+
+    // Bytes reserved from the system allocator
+    size_t capacity() const {
+        size_t total = 0;
+        for (const auto& block : blocks) total += block.size;
+        return total;
+    }
+};
+
+// STL allocator over an Arena; deallocate() is a no-op
+template <typename T>
+class ArenaAllocator {
+private:
+    Arena* arena;
+
+    template <typename U> friend class ArenaAllocator;
+
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena& target) : arena(&target) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // ARENA_H
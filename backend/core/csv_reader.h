@@ -0,0 +1,164 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <cstring>
+#include <charconv>
+#include <system_error>
+#include "mapped_file.h"
+
+/**
+ * Zero-copy CSV tokenizer over an in-memory buffer
+ *
+ * Fields are string_views into the buffer, trimmed of surrounding
+ * whitespace. Quoted fields (RFC 4180) may contain commas, newlines and
+ * doubled quotes; only fields with doubled quotes are copied (into storage
+ * owned by the reader, valid until the next row). Unquoted rows are split
+ * with memchr, which libc implements with SIMD.
+ */
+class CsvReader {
+private:
+    std::string_view text;
+    size_t pos = 0;
+    std::deque<std::string> unescaped; // stable storage for this row's escaped fields
+
+    static bool isSpace(char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+    }
+
+    // Parses a quoted field starting at the opening quote; pos ends after
+    // the closing quote
+    std::string_view quotedField(size_t& at) {
+        size_t start = ++at;
+        bool escaped = false;
+        while (at < text.size()) {
+            const char* quote = static_cast<const char*>(std::memchr(text.data() + at, '"', text.size() - at));
+            if (!quote) {
+                at = text.size();
+                break;
+            }
+            at = static_cast<size_t>(quote - text.data());
+            if (at + 1 < text.size() && text[at + 1] == '"') {
+                escaped = true;
+                at += 2;
+                continue;
+            }
+            break;
+        }
+
+        std::string_view raw = text.substr(start, at - start);
+        if (at < text.size()) ++at; // closing quote
+        if (!escaped) return raw;
+
+        std::string value;
+        value.reserve(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i) {
+            value.push_back(raw[i]);
+            if (raw[i] == '"') ++i; // "" -> "
+        }
+        unescaped.push_back(std::move(value));
+        return unescaped.back();
+    }
+
+public:
+    explicit CsvReader(std::string_view csv_text) : text(csv_text) {
+        // UTF-8 byte order mark
+        if (text.size() >= 3 && text.compare(0, 3, "\xEF\xBB\xBF") == 0) pos = 3;
+    }
+
+    static std::string_view trim(std::string_view field) {
+        size_t start = 0, end = field.size();
+        while (start < end && isSpace(field[start])) ++start;
+        while (end > start && isSpace(field[end - 1])) --end;
+        return field.substr(start, end - start);
+    }
+
+    /**
+     * Reads the next non-blank row into fields.
+     * Returns false at end of input.
+     */
+    bool nextRow(std::vector<std::string_view>& fields) {
+        fields.clear();
+        unescaped.clear();
+
+        while (pos < text.size()) {
+            const char* begin = text.data() + pos;
+            size_t remaining = text.size() - pos;
+            const char* newline = static_cast<const char*>(std::memchr(begin, '\n', remaining));
+            size_t line_end = newline ? static_cast<size_t>(newline - text.data()) : text.size();
+            std::string_view line = text.substr(pos, line_end - pos);
+
+            if (trim(line).empty()) {
+                pos = line_end + 1;
+                continue;
+            }
+
+            // Fast path: no quotes, split on commas
+            if (line.find('"') == std::string_view::npos) {
+                size_t at = 0;
+                while (true) {
+                    const char* comma = static_cast<const char*>(std::memchr(line.data() + at, ',', line.size() - at));
+                    size_t field_end = comma ? static_cast<size_t>(comma - line.data()) : line.size();
+                    fields.push_back(trim(line.substr(at, field_end - at)));
+                    if (!comma) break;
+                    at = field_end + 1;
+                }
+                pos = line_end + 1;
+                return true;
+            }
+
+            // Quoted fields may span lines
+            size_t at = pos;
+            while (true) {
+                while (at < text.size() && (text[at] == ' ' || text[at] == '\t')) ++at;
+                if (at < text.size() && text[at] == '"') {
+                    fields.push_back(quotedField(at));
+                    while (at < text.size() && text[at] != ',' && text[at] != '\n') ++at; // junk after quote
+                } else {
+                    size_t start = at;
+                    while (at < text.size() && text[at] != ',' && text[at] != '\n') ++at;
+                    fields.push_back(trim(text.substr(start, at - start)));
+                }
+                if (at < text.size() && text[at] == ',') {
+                    ++at;
+                    continue;
+                }
+                break;
+            }
+            pos = at + 1;
+            return true;
+        }
+        return false;
+    }
+
+    // Byte offset of the next unread row
+    size_t position() const {
+        return pos;
+    }
+};
+
+// Number and flag parsing for CSV fields without exceptions or copies
+namespace csv {
+
+inline bool parseInt(std::string_view field, int& out) {
+    if (!field.empty() && field.front() == '+') field.remove_prefix(1);
+    auto result = std::from_chars(field.data(), field.data() + field.size(), out);
+    return result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+inline bool parseDouble(std::string_view field, double& out) {
+    if (!field.empty() && field.front() == '+') field.remove_prefix(1);
+    auto result = std::from_chars(field.data(), field.data() + field.size(), out);
+    return result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+inline bool parseBool(std::string_view field) {
+    return field == "true" || field == "True" || field == "1";
+}
+
+} // namespace csv
+
+#endif // CSV_READER_H
@@ -1,205 +1,308 @@
 #ifndef DATA_LOADER_H
 #define DATA_LOADER_H
 
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <unordered_map>
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <future>
+#include <thread>
 #include "entities.h"
+#include "csv_reader.h"
+#include "thread_pool.h"
+
+// Outcome of loading one file
+struct LoadStats {
+    const char* what = "";
+    bool opened = false;
+    size_t rows = 0;
+    size_t skipped = 0;
+    size_t bytes = 0;
+    double seconds = 0.0;
+
+    double rowsPerSecond() const { return seconds > 0 ? rows / seconds : 0.0; }
+    double megabytesPerSecond() const { return seconds > 0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0; }
+};
 
+/**
+ * CSV dataset loaders
+ *
+ * Files are memory-mapped and tokenized in place (see CsvReader); numbers
+ * are parsed with from_chars, and string fields are copied exactly once,
+ * into the returned entities. Rows with missing fields or unparsable
+ * numbers are skipped and counted.
+ *
+ * Interaction files can be parsed in parallel: the body is cut into
+ * chunks at newline boundaries, each chunk is parsed into its own vector,
+ * and the vectors are concatenated in file order (so results match the
+ * serial loader). A body containing any quote is parsed serially, since a
+ * quoted field may hide a newline a cut would split the record at.
+ * loadAll() additionally loads the five datasets concurrently.
+ */
 class DataLoader {
 private:
-
-    static std::vector<std::string> splitCSV(const std::string& line) {
-        std::vector<std::string> result;
-        std::stringstream ss(line);
-        std::string cell;
-
-        while (std::getline(ss, cell, ',')) {
-            // Trim whitespace
-            size_t start = cell.find_first_not_of(" \t\r\n");
-            size_t end = cell.find_last_not_of(" \t\r\n");
-            if (start != std::string::npos) {
-                result.push_back(cell.substr(start, end - start + 1));
-            } else {
-                result.push_back("");
-            }
+    static constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+    using Fields = std::vector<std::string_view>;
+
+    /**
+     * Calls parse(fields, out) for every data row (header skipped) with at
+     * least min_fields fields; parse returns false for malformed rows.
+     * threads > 1 parses newline-aligned chunks concurrently, unless the
+     * body has quoted fields.
+     */
+    template <typename T, typename ParseRow>
+    static std::vector<T> readRows(const std::string& filepath, size_t min_fields, size_t threads,
+                                   LoadStats& stats, ParseRow parse) {
+        auto started = std::chrono::steady_clock::now();
+        std::vector<T> out;
+
+        MappedFile file(filepath);
+        if (!file.isOpen()) {
+            std::cerr << "Error: Could not open " << filepath << std::endl;
+            return out;
         }
+        stats.opened = true;
 
-        return result;
-    }
+        std::string_view text = file.view();
+        stats.bytes = text.size();
 
-    static bool stringToBool(const std::string& str) {
-        return str == "true" || str == "True" || str == "1";
-    }
+        CsvReader header(text);
+        Fields fields;
+        header.nextRow(fields); // Skip header
+        std::string_view body = text.substr(std::min(header.position(), text.size()));
 
-public:
+        if (threads == 0) threads = ThreadPool::defaultThreadCount();
+        size_t num_chunks = std::min(threads * 4, std::max<size_t>(1, body.size() / MIN_CHUNK_BYTES));
+        if (num_chunks > 1 && body.find('"') != std::string_view::npos) num_chunks = 1;
 
-    static std::vector<Song> loadSongs(const std::string& filepath) {
-        std::vector<Song> songs;
-        std::ifstream file(filepath);
-
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open " << filepath << std::endl;
-            return songs;
-        }
+        if (threads <= 1 || num_chunks <= 1) {
+            CsvReader reader(body);
+            while (reader.nextRow(fields)) {
+                if (fields.size() < min_fields || !parse(fields, out)) stats.skipped++;
+            }
+        } else {
+            // Chunk c is [bounds[c], bounds[c + 1]), each bound just past a newline
+            std::vector<size_t> bounds(num_chunks + 1, body.size());
+            bounds[0] = 0;
+            for (size_t c = 1; c < num_chunks; ++c) {
+                size_t at = std::max(bounds[c - 1], body.size() / num_chunks * c);
+                size_t newline = body.find('\n', at);
+                bounds[c] = newline == std::string_view::npos ? body.size() : newline + 1;
+            }
 
-        std::string line;
-        std::getline(file, line); // Skip header
-
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
-
-            auto fields = splitCSV(line);
-            if (fields.size() >= 9) {
-                Song song(
-                    fields[0],                    // song_id
-                    fields[1],                    // title
-                    fields[2],                    // artist_id
-                    fields[3],                    // genre
-                    std::stoi(fields[4]),         // bpm
-                    std::stod(fields[5]),         // energy
-                    std::stod(fields[6]),         // danceability
-                    std::stod(fields[7]),         // valence
-                    fields[8]                     // mood
-                );
-                songs.push_back(song);
+            std::vector<std::vector<T>> parts(num_chunks);
+            std::vector<size_t> skipped(num_chunks, 0);
+            ThreadPool pool(std::min(threads, num_chunks));
+            pool.parallelFor(num_chunks, [&](size_t c, size_t) {
+                CsvReader reader(body.substr(bounds[c], bounds[c + 1] - bounds[c]));
+                Fields chunk_fields;
+                while (reader.nextRow(chunk_fields)) {
+                    if (chunk_fields.size() < min_fields || !parse(chunk_fields, parts[c])) skipped[c]++;
+                }
+            });
+
+            size_t total = 0;
+            for (const auto& part : parts) total += part.size();
+            out.reserve(total);
+            for (size_t c = 0; c < num_chunks; ++c) {
+                std::move(parts[c].begin(), parts[c].end(), std::back_inserter(out));
+                stats.skipped += skipped[c];
             }
         }
 
-        file.close();
-        std::cout << "Loaded " << songs.size() << " songs." << std::endl;
-        return songs;
+        stats.rows = out.size();
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return out;
     }
 
+    // "Loaded N <what> (R rows/s, M MB/s)." as one write
+    static void report(const LoadStats& stats) {
+        if (!stats.opened) return;
+        std::ostringstream line;
+        line << "Loaded " << stats.rows << " " << stats.what << " ("
+             << std::fixed << std::setprecision(0) << stats.rowsPerSecond() << " rows/s, "
+             << std::setprecision(1) << stats.megabytesPerSecond() << " MB/s).";
+        if (stats.skipped > 0) line << " (skipped " << stats.skipped << " malformed rows)";
+        line << "\n";
+        std::cout << line.str() << std::flush;
+    }
 
-    static std::vector<Artist> loadArtists(const std::string& filepath) {
-        std::vector<Artist> artists;
-        std::ifstream file(filepath);
-
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open " << filepath << std::endl;
-            return artists;
-        }
-
-        std::string line;
-        std::getline(file, line); // Skip header
-
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
-
-            auto fields = splitCSV(line);
-            if (fields.size() >= 3) {
-                Artist artist(
-                    fields[0],  // artist_id
-                    fields[1],  // artist_name
-                    fields[2]   // genre
-                );
-                artists.push_back(artist);
-            }
+    static bool parseSong(const Fields& f, std::vector<Song>& out) {
+        int bpm;
+        double energy, danceability, valence;
+        if (!csv::parseInt(f[4], bpm) || !csv::parseDouble(f[5], energy) ||
+            !csv::parseDouble(f[6], danceability) || !csv::parseDouble(f[7], valence)) {
+            return false;
         }
-
-        file.close();
-        std::cout << "Loaded " << artists.size() << " artists." << std::endl;
-        return artists;
+        out.emplace_back(
+            std::string(f[0]),            // song_id
+            std::string(f[1]),            // title
+            std::string(f[2]),            // artist_id
+            std::string(f[3]),            // genre
+            bpm, energy, danceability, valence,
+            std::string(f[8])             // mood
+        );
+        return true;
     }
 
+    static bool parseArtist(const Fields& f, std::vector<Artist>& out) {
+        out.emplace_back(
+            std::string(f[0]),  // artist_id
+            std::string(f[1]),  // artist_name
+            std::string(f[2])   // genre
+        );
+        return true;
+    }
 
-    static std::vector<User> loadUsers(const std::string& filepath) {
-        std::vector<User> users;
-        std::ifstream file(filepath);
-
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open " << filepath << std::endl;
-            return users;
-        }
-
-        std::string line;
-        std::getline(file, line); // Skip header
+    static bool parseUser(const Fields& f, std::vector<User>& out) {
+        out.emplace_back(
+            std::string(f[0]),  // user_id
+            std::string(f[1])   // username
+        );
+        return true;
+    }
 
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
+    static bool parseUserSongInteraction(const Fields& f, std::vector<UserSongInteraction>& out) {
+        int play_count;
+        if (!csv::parseInt(f[3], play_count)) return false;
+        out.emplace_back(
+            std::string(f[0]),      // user_id
+            std::string(f[1]),      // song_id
+            csv::parseBool(f[2]),   // liked
+            play_count
+        );
+        return true;
+    }
 
-            auto fields = splitCSV(line);
-            if (fields.size() >= 2) {
-                User user(
-                    fields[0],  // user_id
-                    fields[1]   // username
-                );
-                users.push_back(user);
-            }
-        }
+    static bool parseUserArtistInteraction(const Fields& f, std::vector<UserArtistInteraction>& out) {
+        int play_count;
+        if (!csv::parseInt(f[2], play_count)) return false;
+        out.emplace_back(
+            std::string(f[0]),  // user_id
+            std::string(f[1]),  // artist_id
+            play_count
+        );
+        return true;
+    }
 
-        file.close();
-        std::cout << "Loaded " << users.size() << " users." << std::endl;
-        return users;
+    // Loaders that fill stats instead of printing
+    static std::vector<Song> readSongs(const std::string& filepath, LoadStats& stats) {
+        stats.what = "songs";
+        return readRows<Song>(filepath, 9, 1, stats, parseSong);
     }
 
-    static std::vector<UserSongInteraction> loadUserSongInteractions(const std::string& filepath) {
-        std::vector<UserSongInteraction> interactions;
-        std::ifstream file(filepath);
+    static std::vector<Artist> readArtists(const std::string& filepath, LoadStats& stats) {
+        stats.what = "artists";
+        return readRows<Artist>(filepath, 3, 1, stats, parseArtist);
+    }
 
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open " << filepath << std::endl;
-            return interactions;
-        }
+    static std::vector<User> readUsers(const std::string& filepath, LoadStats& stats) {
+        stats.what = "users";
+        return readRows<User>(filepath, 2, 1, stats, parseUser);
+    }
 
-        std::string line;
-        std::getline(file, line); // Skip header
-
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
-
-            auto fields = splitCSV(line);
-            if (fields.size() >= 4) {
-                UserSongInteraction interaction(
-                    fields[0],                  // user_id
-                    fields[1],                  // song_id
-                    stringToBool(fields[2]),    // liked
-                    std::stoi(fields[3])        // play_count
-                );
-                interactions.push_back(interaction);
-            }
-        }
+    static std::vector<UserSongInteraction> readUserSongInteractions(
+        const std::string& filepath, size_t threads, LoadStats& stats
+    ) {
+        stats.what = "user-song interactions";
+        return readRows<UserSongInteraction>(filepath, 4, threads, stats, parseUserSongInteraction);
+    }
 
-        file.close();
-        std::cout << "Loaded " << interactions.size() << " user-song interactions." << std::endl;
-        return interactions;
+    static std::vector<UserArtistInteraction> readUserArtistInteractions(
+        const std::string& filepath, size_t threads, LoadStats& stats
+    ) {
+        stats.what = "user-artist interactions";
+        return readRows<UserArtistInteraction>(filepath, 3, threads, stats, parseUserArtistInteraction);
     }
 
+public:
 
-    static std::vector<UserArtistInteraction> loadUserArtistInteractions(const std::string& filepath) {
-        std::vector<UserArtistInteraction> interactions;
-        std::ifstream file(filepath);
+    // Everything loadAll() reads, with per-file stats
+    struct Datasets {
+        std::vector<Song> songs;
+        std::vector<Artist> artists;
+        std::vector<User> users;
+        std::vector<UserSongInteraction> song_interactions;
+        std::vector<UserArtistInteraction> artist_interactions;
+        LoadStats stats[5];
+    };
 
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open " << filepath << std::endl;
-            return interactions;
-        }
+    static std::vector<Song> loadSongs(const std::string& filepath) {
+        LoadStats stats;
+        auto songs = readSongs(filepath, stats);
+        report(stats);
+        return songs;
+    }
 
-        std::string line;
-        std::getline(file, line); // Skip header
+    static std::vector<Artist> loadArtists(const std::string& filepath) {
+        LoadStats stats;
+        auto artists = readArtists(filepath, stats);
+        report(stats);
+        return artists;
+    }
 
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
+    static std::vector<User> loadUsers(const std::string& filepath) {
+        LoadStats stats;
+        auto users = readUsers(filepath, stats);
+        report(stats);
+        return users;
+    }
 
-            auto fields = splitCSV(line);
-            if (fields.size() >= 3) {
-                UserArtistInteraction interaction(
-                    fields[0],           // user_id
-                    fields[1],           // artist_id
-                    std::stoi(fields[2]) // play_count
-                );
-                interactions.push_back(interaction);
-            }
-        }
+    // threads == 0 uses one per hardware thread; small files stay serial
+    static std::vector<UserSongInteraction> loadUserSongInteractions(const std::string& filepath, size_t threads = 1) {
+        LoadStats stats;
+        auto interactions = readUserSongInteractions(filepath, threads, stats);
+        report(stats);
+        return interactions;
+    }
 
-        file.close();
-        std::cout << "Loaded " << interactions.size() << " user-artist interactions." << std::endl;
+    static std::vector<UserArtistInteraction> loadUserArtistInteractions(const std::string& filepath, size_t threads = 1) {
+        LoadStats stats;
+        auto interactions = readUserArtistInteractions(filepath, threads, stats);
+        report(stats);
         return interactions;
     }
 
+    /**
+     * Loads the five datasets concurrently, interaction files chunked over
+     * threads workers each (0 = one per hardware thread). Prints one line
+     * per file, in argument order, once all are done.
+     */
+    static Datasets loadAll(
+        const std::string& songs_file,
+        const std::string& artists_file,
+        const std::string& users_file,
+        const std::string& user_song_interactions_file,
+        const std::string& user_artist_interactions_file,
+        size_t threads = 0
+    ) {
+        Datasets data;
+        LoadStats* stats = data.stats;
+        auto songs = std::async(std::launch::async, [&] { return readSongs(songs_file, stats[0]); });
+        auto artists = std::async(std::launch::async, [&] { return readArtists(artists_file, stats[1]); });
+        auto users = std::async(std::launch::async, [&] { return readUsers(users_file, stats[2]); });
+        auto song_interactions = std::async(std::launch::async, [&] {
+            return readUserSongInteractions(user_song_interactions_file, threads, stats[3]);
+        });
+        auto artist_interactions = std::async(std::launch::async, [&] {
+            return readUserArtistInteractions(user_artist_interactions_file, threads, stats[4]);
+        });
+
+        data.songs = songs.get();
+        data.artists = artists.get();
+        data.users = users.get();
+        data.song_interactions = song_interactions.get();
+        data.artist_interactions = artist_interactions.get();
+
+        for (const auto& s : data.stats) report(s);
+        return data;
+    }
+
     static std::unordered_map<std::string, Song> createSongMap(const std::vector<Song>& songs) {
         std::unordered_map<std::string, Song> song_map;
         for (const auto& song : songs) {
@@ -1,8 +1,11 @@
 #ifndef ENTITIES_H
 #define ENTITIES_H
 
+#include <cstdint>
+#include <ostream>
 #include <string>
 #include <vector>
+#include <utility>
 
 // Song entity with metadata
 struct Song {
@@ -25,8 +28,8 @@ struct Song {
 
     Song(std::string id, std::string t, std::string aid, std::string g,
          int b, double e, double d, double v, std::string m)
-        : song_id(id), title(t), artist_id(aid), genre(g),
-          bpm(b), energy(e), danceability(d), valence(v), mood(m) {}
+        : song_id(std::move(id)), title(std::move(t)), artist_id(std::move(aid)), genre(std::move(g)),
+          bpm(b), energy(e), danceability(d), valence(v), mood(std::move(m)) {}
 };
 
 //Artist entity
@@ -38,7 +41,7 @@ struct Artist {
     Artist() {}
 
     Artist(std::string id, std::string name, std::string g)
-        : artist_id(id), artist_name(name), genre(g) {}
+        : artist_id(std::move(id)), artist_name(std::move(name)), genre(std::move(g)) {}
 };
 
 // User entity with metadata
@@ -52,7 +55,7 @@ struct User {
     User() : community_id(-1) {}
 
     User(std::string id, std::string name)
-        : user_id(id), username(name), community_id(-1) {}
+        : user_id(std::move(id)), username(std::move(name)), community_id(-1) {}
 };
 
 struct UserSongInteraction {
@@ -64,7 +67,7 @@ struct UserSongInteraction {
     UserSongInteraction() : liked(false), play_count(0) {}
 
     UserSongInteraction(std::string uid, std::string sid, bool l, int pc)
-        : user_id(uid), song_id(sid), liked(l), play_count(pc) {}
+        : user_id(std::move(uid)), song_id(std::move(sid)), liked(l), play_count(pc) {}
 };
 
 struct UserArtistInteraction {
@@ -75,23 +78,47 @@ struct UserArtistInteraction {
     UserArtistInteraction() : play_count(0) {}
 
     UserArtistInteraction(std::string uid, std::string aid, int pc)
-        : user_id(uid), artist_id(aid), play_count(pc) {}
+        : user_id(std::move(uid)), artist_id(std::move(aid)), play_count(pc) {}
 };
 
+// Pillar that produced a recommendation (COMBINED for fused results)
+enum class RecommendationSource : uint8_t {
+    CONTENT,
+    USER_COLLAB,
+    ARTIST_COLLAB,
+    COMMUNITY,
+    COMBINED
+};
+
+inline const char* sourceName(RecommendationSource source) {
+    switch (source) {
+        case RecommendationSource::CONTENT: return "content";
+        case RecommendationSource::USER_COLLAB: return "user-collab";
+        case RecommendationSource::ARTIST_COLLAB: return "artist-collab";
+        case RecommendationSource::COMMUNITY: return "community";
+        default: return "combined";
+    }
+}
+
+inline std::ostream& operator<<(std::ostream& out, RecommendationSource source) {
+    return out << sourceName(source);
+}
+
 struct Recommendation {
     std::string song_id;
     std::string title;
     double score;
-    std::string source; // Pillar name
+    RecommendationSource source;
 
-    Recommendation() : score(0.0) {}
+    Recommendation() : score(0.0), source(RecommendationSource::COMBINED) {}
 
-    Recommendation(std::string sid, std::string t, double s, std::string src)
-        : song_id(sid), title(t), score(s), source(src) {}
+    Recommendation(std::string sid, std::string t, double s, RecommendationSource src)
+        : song_id(std::move(sid)), title(std::move(t)), score(s), source(src) {}
 
-    // Sorting by max score
+    // Sorting by max score; ties broken by song id so rankings are deterministic
     bool operator<(const Recommendation& other) const {
-        return score > other.score;
+        if (score != other.score) return score > other.score;
+        return song_id < other.song_id;
     }
 };
 
@@ -0,0 +1,97 @@
+#ifndef ID_REGISTRY_H
+#define ID_REGISTRY_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "snapshot.h"
+
+// Sentinel for "no such entity"
+constexpr uint32_t INVALID_ID = UINT32_MAX;
+
+/**
+ * Interning registry mapping external string IDs ("U001", "S042", ...)
+ * to dense uint32_t indices in first-seen order.
+ *
+ * Time Complexities:
+ * - intern / find: O(m) average where m is key length (one hash)
+ * - name: O(1)
+ *
+ * Built once at engine initialization; every data structure then keys on
+ * the dense index and strings are only resolved back at the API boundary.
+ */
+class IdRegistry {
+private:
+    std::unordered_map<std::string, uint32_t> index;
+    std::vector<std::string> names;
+
+public:
+    /**
+     * Returns the index for key, assigning the next free one if unseen
+     */
+    uint32_t intern(const std::string& key) {
+        auto it = index.find(key);
+        if (it != index.end()) return it->second;
+
+        uint32_t id = static_cast<uint32_t>(names.size());
+        index.emplace(key, id);
+        names.push_back(key);
+        return id;
+    }
+
+    /**
+     * Returns the index for key, or INVALID_ID if it was never interned
+     */
+    uint32_t find(const std::string& key) const {
+        auto it = index.find(key);
+        return it == index.end() ? INVALID_ID : it->second;
+    }
+
+    bool contains(const std::string& key) const {
+        return index.find(key) != index.end();
+    }
+
+    const std::string& name(uint32_t id) const {
+        return names[id];
+    }
+
+    size_t size() const {
+        return names.size();
+    }
+
+    void reserve(size_t n) {
+        index.reserve(n);
+        names.reserve(n);
+    }
+
+    void clear() {
+        index.clear();
+        names.clear();
+    }
+
+    // Approximate bytes held: names plus hash nodes and buckets
+    size_t memoryUsage() const {
+        size_t bytes = names.capacity() * sizeof(std::string) + index.bucket_count() * sizeof(void*) +
+                       index.size() * (sizeof(std::string) + sizeof(uint32_t) + 2 * sizeof(void*));
+        for (const auto& name : names) {
+            if (name.capacity() > 15) bytes += 2 * (name.capacity() + 1); // heap copy in names and index
+        }
+        return bytes;
+    }
+
+    // Names in id order; the hash index is rebuilt on load
+    void save(SnapshotWriter& out, const std::string& prefix) const {
+        out.putStrings(prefix + ".names", names);
+    }
+
+    bool load(const SnapshotReader& in, const std::string& prefix) {
+        clear();
+        if (!in.getStrings(prefix + ".names", names)) return false;
+        index.reserve(names.size());
+        for (uint32_t id = 0; id < names.size(); ++id) index.emplace(names[id], id);
+        return index.size() == names.size();
+    }
+};
+
+#endif // ID_REGISTRY_H
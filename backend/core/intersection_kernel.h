@@ -0,0 +1,89 @@
+#ifndef INTERSECTION_KERNEL_H
+#define INTERSECTION_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REC_INTERSECT_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define REC_INTERSECT_NEON 1
+#endif
+
+/**
+ * Intersection-count kernel for sorted, duplicate-free uint32_t sets
+ *
+ * Time Complexity: O(n + m)
+ *
+ * The vector path compares 4x4 blocks (every lane of one block against
+ * every rotation of the other) and advances whichever block has the
+ * smaller maximum, so it needs no branches per element. Inputs MUST be
+ * strictly increasing; duplicates would be double counted.
+ */
+namespace intersection_kernel {
+
+inline size_t scalarCount(const uint32_t* a, size_t na, const uint32_t* b, size_t nb) {
+    size_t i = 0, j = 0, count = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            ++count;
+            ++i;
+            ++j;
+        }
+    }
+    return count;
+}
+
+inline size_t count(const uint32_t* a, size_t na, const uint32_t* b, size_t nb) {
+    size_t i = 0, j = 0, total = 0;
+
+#if defined(REC_INTERSECT_SSE2)
+    // Popcount of a 4-bit movemask
+    static const uint8_t bits4[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+
+        __m128i m0 = _mm_cmpeq_epi32(va, vb);
+        __m128i m1 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)));
+        __m128i m2 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)));
+        __m128i m3 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)));
+        __m128i any = _mm_or_si128(_mm_or_si128(m0, m1), _mm_or_si128(m2, m3));
+        total += bits4[_mm_movemask_ps(_mm_castsi128_ps(any))];
+
+        uint32_t a_max = a[i + 3];
+        uint32_t b_max = b[j + 3];
+        if (a_max <= b_max) i += 4;
+        if (b_max <= a_max) j += 4;
+    }
+#elif defined(REC_INTERSECT_NEON)
+    while (i + 4 <= na && j + 4 <= nb) {
+        uint32x4_t va = vld1q_u32(a + i);
+        uint32x4_t vb = vld1q_u32(b + j);
+
+        uint32x4_t any = vceqq_u32(va, vb);
+        any = vorrq_u32(any, vceqq_u32(va, vextq_u32(vb, vb, 1)));
+        any = vorrq_u32(any, vceqq_u32(va, vextq_u32(vb, vb, 2)));
+        any = vorrq_u32(any, vceqq_u32(va, vextq_u32(vb, vb, 3)));
+        total += vaddvq_u32(vshrq_n_u32(any, 31));
+
+        uint32_t a_max = a[i + 3];
+        uint32_t b_max = b[j + 3];
+        if (a_max <= b_max) i += 4;
+        if (b_max <= a_max) j += 4;
+    }
+#endif
+
+    return total + scalarCount(a + i, na - i, b + j, nb - j);
+}
+
+} // namespace intersection_kernel
+
+#endif // INTERSECTION_KERNEL_H
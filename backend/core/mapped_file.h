@@ -0,0 +1,80 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define REC_HAVE_MMAP 1
+#endif
+
+/**
+ * Read-only view of a whole file: memory-mapped where available, read into
+ * one buffer otherwise. Not copyable; the view lives as long as the object.
+ */
+class MappedFile {
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    bool open = false;
+    std::string buffer; // fallback storage
+
+public:
+    explicit MappedFile(const std::string& filepath) {
+#if defined(REC_HAVE_MMAP)
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat st;
+            if (fstat(fd, &st) == 0) {
+                open = true;
+                length = static_cast<size_t>(st.st_size);
+                if (length > 0) {
+                    void* addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (addr != MAP_FAILED) {
+                        madvise(addr, length, MADV_SEQUENTIAL);
+                        data = static_cast<const char*>(addr);
+                        mapped = true;
+                    }
+                }
+            }
+            ::close(fd);
+            if (mapped || (open && length == 0)) return;
+            open = false;
+        }
+#endif
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file.is_open()) return;
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        buffer = contents.str();
+        data = buffer.data();
+        length = buffer.size();
+        open = true;
+    }
+
+    ~MappedFile() {
+#if defined(REC_HAVE_MMAP)
+        if (mapped) munmap(const_cast<char*>(data), length);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const {
+        return open;
+    }
+
+    std::string_view view() const {
+        return std::string_view(data, length);
+    }
+};
+
+#endif // MAPPED_FILE_H
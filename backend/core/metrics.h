@@ -0,0 +1,269 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Hot-path instrumentation: counters, latency distributions, scoped timers
+ *
+ * Counters and latency stats are relaxed atomics, safe to update from any
+ * thread; a ScopedTimer costs two steady_clock reads. Building with
+ * -DREC_DISABLE_METRICS turns every type here into an empty no-op, so
+ * instrumented code compiles to nothing.
+ *
+ * Latencies go into a log-linear histogram (4 sub-buckets per power of
+ * two nanoseconds), so percentiles are within ~12% of the true value
+ * (and never above the recorded maximum).
+ */
+namespace metrics {
+
+#ifndef REC_DISABLE_METRICS
+
+constexpr bool ENABLED = true;
+
+class Counter {
+private:
+    std::atomic<uint64_t> value{0};
+
+public:
+    void add(uint64_t n = 1) {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    void reset() {
+        value.store(0, std::memory_order_relaxed);
+    }
+};
+
+class LatencyStat {
+private:
+    static constexpr int SUB_BUCKETS = 4;
+    static constexpr int NUM_BUCKETS = 64 * SUB_BUCKETS;
+
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+
+    static int bucketOf(uint64_t ns) {
+        if (ns < SUB_BUCKETS) return static_cast<int>(ns);
+        int log2 = 63 - __builtin_clzll(ns);
+        int sub = static_cast<int>((ns >> (log2 - 2)) & (SUB_BUCKETS - 1));
+        return (log2 - 1) * SUB_BUCKETS + sub;
+    }
+
+    // Midpoint of a bucket's range
+    static double bucketValue(int bucket) {
+        if (bucket < SUB_BUCKETS) return bucket;
+        int log2 = bucket / SUB_BUCKETS + 1;
+        int sub = bucket % SUB_BUCKETS;
+        double low = static_cast<double>((static_cast<uint64_t>(SUB_BUCKETS + sub)) << (log2 - 2));
+        double width = static_cast<double>(uint64_t(1) << (log2 - 2));
+        return low + width / 2;
+    }
+
+public:
+    void record(uint64_t ns) {
+        count.fetch_add(1, std::memory_order_relaxed);
+        total_ns.fetch_add(ns, std::memory_order_relaxed);
+        buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t seen = max_ns.load(std::memory_order_relaxed);
+        while (ns > seen && !max_ns.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+    uint64_t getTotalNs() const { return total_ns.load(std::memory_order_relaxed); }
+    uint64_t getMaxNs() const { return max_ns.load(std::memory_order_relaxed); }
+
+    // Approximate q-quantile (0 < q <= 1) in nanoseconds; 0 if empty
+    double quantileNs(double q) const {
+        uint64_t n = getCount();
+        if (n == 0) return 0.0;
+        uint64_t rank = static_cast<uint64_t>(q * n);
+        if (rank >= n) rank = n - 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < NUM_BUCKETS; ++b) {
+            seen += buckets[b].load(std::memory_order_relaxed);
+            if (seen > rank) return std::min(bucketValue(b), static_cast<double>(getMaxNs()));
+        }
+        return static_cast<double>(getMaxNs());
+    }
+
+    void reset() {
+        count.store(0, std::memory_order_relaxed);
+        total_ns.store(0, std::memory_order_relaxed);
+        max_ns.store(0, std::memory_order_relaxed);
+        for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+    }
+};
+
+// Records the lifetime of the enclosing scope into a LatencyStat
+class ScopedTimer {
+private:
+    LatencyStat& stat;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedTimer(LatencyStat& target) : stat(target), start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        stat.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#else
+
+constexpr bool ENABLED = false;
+
+class Counter {
+public:
+    void add(uint64_t = 1) {}
+    uint64_t get() const { return 0; }
+    void reset() {}
+};
+
+class LatencyStat {
+public:
+    void record(uint64_t) {}
+    uint64_t getCount() const { return 0; }
+    uint64_t getTotalNs() const { return 0; }
+    uint64_t getMaxNs() const { return 0; }
+    double quantileNs(double) const { return 0.0; }
+    void reset() {}
+};
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(LatencyStat&) {}
+};
+
+#endif // REC_DISABLE_METRICS
+
+/**
+ * Point-in-time copy of a set of metrics, for export
+ *
+ * Names are snake_case; toPrometheus() prefixes them with "rec_".
+ */
+struct Report {
+    struct Latency {
+        std::string name;
+        uint64_t count;
+        double total_seconds;
+        double p50_seconds;
+        double p99_seconds;
+        double max_seconds;
+    };
+
+    std::vector<Latency> latencies;
+    std::vector<std::pair<std::string, uint64_t>> counters;
+    std::vector<std::pair<std::string, double>> gauges; // ratios and other point values
+    std::vector<std::pair<std::string, uint64_t>> memory_bytes; // per data structure
+
+    void addLatency(const std::string& name, const LatencyStat& stat) {
+        latencies.push_back({name, stat.getCount(), stat.getTotalNs() / 1e9, stat.quantileNs(0.50) / 1e9,
+                             stat.quantileNs(0.99) / 1e9, stat.getMaxNs() / 1e9});
+    }
+
+    void addCounter(const std::string& name, uint64_t value) {
+        counters.push_back({name, value});
+    }
+
+    void addGauge(const std::string& name, double value) {
+        gauges.push_back({name, value});
+    }
+
+    void addMemory(const std::string& structure, uint64_t bytes) {
+        memory_bytes.push_back({structure, bytes});
+    }
+
+    uint64_t totalMemory() const {
+        uint64_t total = 0;
+        for (const auto& m : memory_bytes) total += m.second;
+        return total;
+    }
+
+    std::string toJson() const {
+        std::string out = "{\n  \"enabled\": ";
+        out += ENABLED ? "true" : "false";
+        out += ",\n  \"latencies\": {";
+        for (size_t i = 0; i < latencies.size(); ++i) {
+            const auto& l = latencies[i];
+            out += i == 0 ? "\n" : ",\n";
+            out += "    \"" + l.name + "\": {\"count\": " + std::to_string(l.count) +
+                   ", \"total_seconds\": " + number(l.total_seconds) +
+                   ", \"mean_seconds\": " + number(l.count ? l.total_seconds / l.count : 0.0) +
+                   ", \"p50_seconds\": " + number(l.p50_seconds) + ", \"p99_seconds\": " + number(l.p99_seconds) +
+                   ", \"max_seconds\": " + number(l.max_seconds) + "}";
+        }
+        out += latencies.empty() ? "},\n" : "\n  },\n";
+        out += "  \"counters\": " + object(counters, "  ") + ",\n";
+        out += "  \"gauges\": {";
+        for (size_t i = 0; i < gauges.size(); ++i) {
+            out += (i == 0 ? "\n" : ",\n") + std::string("    \"") + gauges[i].first + "\": " + number(gauges[i].second);
+        }
+        out += gauges.empty() ? "},\n" : "\n  },\n";
+        out += "  \"memory_bytes\": " + object(memory_bytes, "  ") + "\n}\n";
+        return out;
+    }
+
+    // Prometheus text exposition format
+    std::string toPrometheus() const {
+        std::string out = "# TYPE rec_latency_seconds summary\n";
+        for (const auto& l : latencies) {
+            std::string label = "{op=\"" + l.name + "\"";
+            out += "rec_latency_seconds" + label + ",quantile=\"0.5\"} " + number(l.p50_seconds) + "\n";
+            out += "rec_latency_seconds" + label + ",quantile=\"0.99\"} " + number(l.p99_seconds) + "\n";
+            out += "rec_latency_seconds_sum" + label + "} " + number(l.total_seconds) + "\n";
+            out += "rec_latency_seconds_count" + label + "} " + std::to_string(l.count) + "\n";
+        }
+        for (const auto& c : counters) {
+            out += "# TYPE rec_" + c.first + "_total counter\n";
+            out += "rec_" + c.first + "_total " + std::to_string(c.second) + "\n";
+        }
+        for (const auto& g : gauges) {
+            out += "# TYPE rec_" + g.first + " gauge\n";
+            out += "rec_" + g.first + " " + number(g.second) + "\n";
+        }
+        out += "# TYPE rec_memory_bytes gauge\n";
+        for (const auto& m : memory_bytes) {
+            out += "rec_memory_bytes{structure=\"" + m.first + "\"} " + std::to_string(m.second) + "\n";
+        }
+        return out;
+    }
+
+private:
+    static std::string number(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return buffer;
+    }
+
+    static std::string object(const std::vector<std::pair<std::string, uint64_t>>& values, const std::string& indent) {
+        if (values.empty()) return "{}";
+        std::string out = "{";
+        for (size_t i = 0; i < values.size(); ++i) {
+            out += (i == 0 ? "\n" : ",\n") + indent + "  \"" + values[i].first + "\": " + std::to_string(values[i].second);
+        }
+        return out + "\n" + indent + "}";
+    }
+};
+
+} // namespace metrics
+
+#endif // METRICS_H
@@ -0,0 +1,50 @@
+#ifndef REQUEST_CONTEXT_H
+#define REQUEST_CONTEXT_H
+
+#include <cstdint>
+#include <vector>
+#include "arena.h"
+#include "score_accumulator.h"
+
+// A scored song by dense index; pillars rank these and titles are looked
+// up only when the final Recommendation list is built
+struct ScoredSong {
+    uint32_t song;
+    double score;
+};
+
+/**
+ * Per-thread scratch for serving one request
+ *
+ * Holds the dense score tables, the content pillar's query and neighbor
+ * buffers and a monotonic arena for variable-size temporaries (candidate,
+ * selection and k-NN search buffers). Everything is reset in
+ * O(touched) between requests and keeps its capacity, so a warm context
+ * serves a request without heap allocations of its own. One context is
+ * used by one thread at a time: get it from RequestContext::local().
+ */
+struct RequestContext {
+    Arena arena;
+    ScoreAccumulator scores; // one pillar's candidate scores
+    ScoreAccumulator fused;  // weighted sum across pillars
+    std::vector<uint32_t> queries;
+    std::vector<uint32_t> neighbors;        // content k-NN lists of queries, flat
+    std::vector<uint32_t> neighbor_offsets; // query q's list is [offsets[q], offsets[q + 1])
+
+    // Start of a request: drops the previous request's temporaries
+    void reset() {
+        arena.reset();
+        scores.reset();
+        fused.reset();
+        queries.clear();
+        neighbors.clear();
+        neighbor_offsets.clear();
+    }
+
+    static RequestContext& local() {
+        static thread_local RequestContext context;
+        return context;
+    }
+};
+
+#endif // REQUEST_CONTEXT_H
@@ -0,0 +1,86 @@
+#ifndef SCORE_ACCUMULATOR_H
+#define SCORE_ACCUMULATOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Reusable dense score table indexed by song id
+ *
+ * add() is O(1); the list of touched ids makes iteration and reset()
+ * proportional to the number of scored songs rather than the catalog, so a
+ * single instance can be reused across requests without clearing it.
+ */
+class ScoreAccumulator {
+private:
+    std::vector<double> scores;
+    std::vector<char> seen;
+    std::vector<uint32_t> touched;
+
+public:
+    // Ensures ids in [0, n) can be scored
+    void resize(size_t n) {
+        if (scores.size() < n) {
+            scores.resize(n, 0.0);
+            seen.resize(n, 0);
+        }
+    }
+
+    void add(uint32_t id, double value) {
+        if (!seen[id]) {
+            seen[id] = 1;
+            touched.push_back(id);
+        }
+        scores[id] += value;
+    }
+
+    double score(uint32_t id) const {
+        return scores[id];
+    }
+
+    const std::vector<uint32_t>& touchedIds() const {
+        return touched;
+    }
+
+    size_t size() const {
+        return touched.size();
+    }
+
+    /**
+     * Best n touched ids by score descending, ties ordered by tie_less,
+     * written to order (any vector-like container, e.g. an ArenaVector).
+     * Partial selection: O(t + n log n) for t touched ids.
+     */
+    template <typename TieLess, typename Order>
+    void topN(size_t n, TieLess tie_less, Order& order) const {
+        order.assign(touched.begin(), touched.end());
+        auto better = [&](uint32_t a, uint32_t b) {
+            if (scores[a] != scores[b]) return scores[a] > scores[b];
+            return tie_less(a, b);
+        };
+        if (order.size() > n) {
+            std::nth_element(order.begin(), order.begin() + n, order.end(), better);
+            order.resize(n);
+        }
+        std::sort(order.begin(), order.end(), better);
+    }
+
+    template <typename TieLess>
+    std::vector<uint32_t> topN(size_t n, TieLess tie_less) const {
+        std::vector<uint32_t> order;
+        topN(n, tie_less, order);
+        return order;
+    }
+
+    // O(touched) reset
+    void reset() {
+        for (uint32_t id : touched) {
+            scores[id] = 0.0;
+            seen[id] = 0;
+        }
+        touched.clear();
+    }
+};
+
+#endif // SCORE_ACCUMULATOR_H
@@ -0,0 +1,315 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "mapped_file.h"
+
+/**
+ * Binary snapshot container: named, flat sections of plain data
+ *
+ * Layout (native byte order):
+ *   Header       magic "RECSNAP", format version, section count
+ *   Table        one SectionEntry per section: name, offset, size
+ *   Sections     raw bytes, each starting on a SECTION_ALIGN boundary
+ *
+ * Every section is an array of a trivially copyable type, so a reader
+ * maps the file and either copies a section out with one memcpy or views
+ * it in place (view()). Variable-length data is stored CSR style: an
+ * offsets section plus a flat values section. Structures write their own
+ * sections under a name prefix, e.g. "user_graph.row_offsets".
+ */
+namespace snapshot {
+
+constexpr char MAGIC[8] = {'R', 'E', 'C', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t FORMAT_VERSION = 1;
+constexpr size_t SECTION_ALIGN = 64;
+constexpr size_t NAME_LENGTH = 48;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+};
+
+struct SectionEntry {
+    char name[NAME_LENGTH];
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Checks for loaded CSR sections: snapshots are not trusted, so a
+// structure checks every offset and id before it dereferences one
+
+// offsets has one entry per row plus one (or none for no rows), starts
+// at 0, never decreases and ends at num_values
+template <typename T>
+inline bool validOffsets(const std::vector<T>& offsets, size_t num_values) {
+    if (offsets.empty()) return num_values == 0;
+    if (offsets.front() != 0 || offsets.back() != num_values) return false;
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        if (offsets[i] < offsets[i - 1]) return false;
+    }
+    return true;
+}
+
+// Every id is below bound
+template <typename T>
+inline bool allBelow(const std::vector<T>& ids, size_t bound) {
+    for (const T& id : ids) {
+        if (static_cast<size_t>(id) >= bound) return false;
+    }
+    return true;
+}
+
+} // namespace snapshot
+
+class SnapshotWriter {
+private:
+    struct Section {
+        std::string name;
+        const char* data;
+        size_t size;
+        std::string owned; // set when the writer holds a temporary copy
+    };
+    std::vector<Section> sections;
+
+    void add(const std::string& name, const void* data, size_t size) {
+        sections.push_back({name, static_cast<const char*>(data), size, std::string()});
+    }
+
+    void addOwned(const std::string& name, std::string bytes) {
+        sections.push_back({name, nullptr, 0, std::move(bytes)});
+    }
+
+public:
+    /**
+     * Array section. The data is referenced, not copied: it must stay
+     * alive and unchanged until writeFile().
+     */
+    template <typename T>
+    void putArray(const std::string& name, const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot sections hold plain data");
+        add(name, values.data(), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    void putValue(const std::string& name, const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot sections hold plain data");
+        addOwned(name, std::string(reinterpret_cast<const char*>(&value), sizeof(T)));
+    }
+
+    // Copies into the writer (for temporaries)
+    template <typename T>
+    void putArrayCopy(const std::string& name, const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot sections hold plain data");
+        addOwned(name, std::string(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T)));
+    }
+
+    // name.off (count + 1 offsets) and name.chr (concatenated characters)
+    void putStrings(const std::string& name, const std::vector<std::string>& values) {
+        std::vector<uint64_t> offsets(1, 0);
+        std::string chars;
+        for (const auto& value : values) {
+            chars += value;
+            offsets.push_back(chars.size());
+        }
+        putArrayCopy(name + ".off", offsets);
+        addOwned(name + ".chr", std::move(chars));
+    }
+
+    // name.lists (count + 1 offsets into the strings) plus putStrings(name)
+    void putStringLists(const std::string& name, const std::vector<std::vector<std::string>>& lists) {
+        std::vector<uint64_t> offsets(1, 0);
+        std::vector<std::string> flat;
+        for (const auto& list : lists) {
+            flat.insert(flat.end(), list.begin(), list.end());
+            offsets.push_back(flat.size());
+        }
+        putArrayCopy(name + ".lists", offsets);
+        putStrings(name, flat);
+    }
+
+    // name.off (count + 1 offsets) and name.val (concatenated lists)
+    template <typename T>
+    void putLists(const std::string& name, const std::vector<std::vector<T>>& lists) {
+        std::vector<uint64_t> offsets(1, 0);
+        std::vector<T> flat;
+        for (const auto& list : lists) {
+            flat.insert(flat.end(), list.begin(), list.end());
+            offsets.push_back(flat.size());
+        }
+        putArrayCopy(name + ".off", offsets);
+        putArrayCopy(name + ".val", flat);
+    }
+
+    bool writeFile(const std::string& filepath) const {
+        std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+
+        snapshot::Header header;
+        std::memcpy(header.magic, snapshot::MAGIC, sizeof(header.magic));
+        header.version = snapshot::FORMAT_VERSION;
+        header.section_count = static_cast<uint32_t>(sections.size());
+
+        auto align = [](uint64_t at) {
+            return (at + snapshot::SECTION_ALIGN - 1) / snapshot::SECTION_ALIGN * snapshot::SECTION_ALIGN;
+        };
+
+        std::vector<snapshot::SectionEntry> table(sections.size());
+        uint64_t at = align(sizeof(header) + table.size() * sizeof(snapshot::SectionEntry));
+        for (size_t i = 0; i < sections.size(); ++i) {
+            std::memset(table[i].name, 0, snapshot::NAME_LENGTH);
+            std::strncpy(table[i].name, sections[i].name.c_str(), snapshot::NAME_LENGTH - 1);
+            table[i].offset = at;
+            table[i].size = sections[i].data ? sections[i].size : sections[i].owned.size();
+            at = align(at + table[i].size);
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(table.data()),
+                  static_cast<std::streamsize>(table.size() * sizeof(snapshot::SectionEntry)));
+
+        static const char padding[snapshot::SECTION_ALIGN] = {};
+        uint64_t written = sizeof(header) + table.size() * sizeof(snapshot::SectionEntry);
+        for (size_t i = 0; i < sections.size(); ++i) {
+            out.write(padding, static_cast<std::streamsize>(table[i].offset - written));
+            const char* bytes = sections[i].data ? sections[i].data : sections[i].owned.data();
+            out.write(bytes, static_cast<std::streamsize>(table[i].size));
+            written = table[i].offset + table[i].size;
+        }
+        return static_cast<bool>(out);
+    }
+};
+
+class SnapshotReader {
+private:
+    MappedFile file;
+    std::unordered_map<std::string, std::string_view> sections;
+    bool valid = false;
+
+public:
+    explicit SnapshotReader(const std::string& filepath) : file(filepath) {
+        if (!file.isOpen()) return;
+        std::string_view bytes = file.view();
+
+        snapshot::Header header;
+        if (bytes.size() < sizeof(header)) return;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, snapshot::MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != snapshot::FORMAT_VERSION) {
+            return;
+        }
+
+        size_t table_end = sizeof(header) + static_cast<size_t>(header.section_count) * sizeof(snapshot::SectionEntry);
+        if (bytes.size() < table_end) return;
+        for (uint32_t i = 0; i < header.section_count; ++i) {
+            snapshot::SectionEntry entry;
+            std::memcpy(&entry, bytes.data() + sizeof(header) + i * sizeof(entry), sizeof(entry));
+            entry.name[snapshot::NAME_LENGTH - 1] = '\0';
+            if (entry.offset > bytes.size() || entry.size > bytes.size() - entry.offset) return;
+            sections[entry.name] = bytes.substr(entry.offset, entry.size);
+        }
+        valid = true;
+    }
+
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    bool isValid() const {
+        return valid;
+    }
+
+    bool has(const std::string& name) const {
+        return sections.count(name) > 0;
+    }
+
+    /**
+     * In-place view of an array section (no copy); valid while the reader
+     * lives. count is 0 and the result null if the section is missing or
+     * not a whole number of T.
+     */
+    template <typename T>
+    const T* view(const std::string& name, size_t& count) const {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot sections hold plain data");
+        count = 0;
+        auto it = sections.find(name);
+        if (it == sections.end() || it->second.size() % sizeof(T) != 0) return nullptr;
+        count = it->second.size() / sizeof(T);
+        return reinterpret_cast<const T*>(it->second.data());
+    }
+
+    template <typename T>
+    bool getArray(const std::string& name, std::vector<T>& out) const {
+        auto it = sections.find(name);
+        if (it == sections.end() || it->second.size() % sizeof(T) != 0) return false;
+        out.resize(it->second.size() / sizeof(T));
+        if (!out.empty()) std::memcpy(out.data(), it->second.data(), it->second.size());
+        return true;
+    }
+
+    template <typename T>
+    bool getValue(const std::string& name, T& out) const {
+        auto it = sections.find(name);
+        if (it == sections.end() || it->second.size() != sizeof(T)) return false;
+        std::memcpy(&out, it->second.data(), sizeof(T));
+        return true;
+    }
+
+    bool getStrings(const std::string& name, std::vector<std::string>& out) const {
+        std::vector<uint64_t> offsets;
+        auto chars = sections.find(name + ".chr");
+        if (!getArray(name + ".off", offsets) || offsets.empty() || chars == sections.end() ||
+            offsets.back() != chars->second.size()) {
+            return false;
+        }
+        out.clear();
+        out.reserve(offsets.size() - 1);
+        for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+            if (offsets[i] > offsets[i + 1]) return false;
+            out.emplace_back(chars->second.substr(offsets[i], offsets[i + 1] - offsets[i]));
+        }
+        return true;
+    }
+
+    bool getStringLists(const std::string& name, std::vector<std::vector<std::string>>& out) const {
+        std::vector<uint64_t> offsets;
+        std::vector<std::string> flat;
+        if (!getArray(name + ".lists", offsets) || !getStrings(name, flat) ||
+            offsets.empty() || offsets.back() != flat.size()) {
+            return false;
+        }
+        out.assign(offsets.size() - 1, {});
+        for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+            if (offsets[i] > offsets[i + 1]) return false;
+            out[i].assign(std::make_move_iterator(flat.begin() + offsets[i]),
+                          std::make_move_iterator(flat.begin() + offsets[i + 1]));
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool getLists(const std::string& name, std::vector<std::vector<T>>& out) const {
+        std::vector<uint64_t> offsets;
+        std::vector<T> flat;
+        if (!getArray(name + ".off", offsets) || !getArray(name + ".val", flat) ||
+            offsets.empty() || offsets.back() != flat.size()) {
+            return false;
+        }
+        out.assign(offsets.size() - 1, {});
+        for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+            if (offsets[i] > offsets[i + 1]) return false;
+            out[i].assign(flat.begin() + offsets[i], flat.begin() + offsets[i + 1]);
+        }
+        return true;
+    }
+};
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,112 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Fixed-size worker pool with a FIFO task queue
+ *
+ * submit() returns a std::future for the task's result. Destruction waits
+ * for queued tasks to finish.
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    bool stopping = false;
+
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+public:
+    // threads == 0 uses one worker per hardware thread
+    explicit ThreadPool(size_t threads = 0) {
+        if (threads == 0) threads = defaultThreadCount();
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        queue_cv.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static size_t defaultThreadCount() {
+        unsigned hw = std::thread::hardware_concurrency();
+        return hw == 0 ? 1 : hw;
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    template <typename Fn>
+    std::future<typename std::invoke_result<Fn>::type> submit(Fn&& fn) {
+        using Result = typename std::invoke_result<Fn>::type;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            tasks.emplace([task] { (*task)(); });
+        }
+        queue_cv.notify_one();
+        return result;
+    }
+
+    /**
+     * Runs body(i, slot) for i in [0, n) across the pool and waits for
+     * completion. Indices are claimed dynamically, so uneven per-index cost
+     * balances out; slot in [0, size()) identifies the job so callers can
+     * keep per-slot scratch. Must not be called from inside a pool task.
+     */
+    template <typename Body>
+    void parallelFor(size_t n, Body&& body) {
+        if (n == 0) return;
+        std::atomic<size_t> next(0);
+        size_t jobs = std::min(n, workers.size());
+        std::vector<std::future<void>> pending;
+        pending.reserve(jobs);
+        for (size_t slot = 0; slot < jobs; ++slot) {
+            pending.push_back(submit([&next, n, slot, &body] {
+                for (size_t i = next.fetch_add(1); i < n; i = next.fetch_add(1)) {
+                    body(i, slot);
+                }
+            }));
+        }
+        for (auto& f : pending) f.get();
+    }
+};
+
+#endif // THREAD_POOL_H
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <string>
 #include <iomanip>
+#include <fstream>
 #include "core/entities.h"
 #include "core/data_loader.h"
 #include "algorithms/recommendation_engine.h"
@@ -62,15 +63,14 @@ void printPillarRecommendations(
 }
 
 void demonstrateForUser(RecommendationEngine& engine, const std::string& user_id) {
-    const auto& user_map = engine.getUserMap();
-    auto user_it = user_map.find(user_id);
+    const User* user_ptr = engine.findUser(user_id);
 
-    if (user_it == user_map.end()) {
+    if (!user_ptr) {
         std::cout << "User not found: " << user_id << std::endl;
         return;
     }
 
-    const User& user = user_it->second;
+    const User& user = *user_ptr;
 
     std::cout << "\n\n";
     std::cout << "═══════════════════════════════════════════════════════════════" << std::endl;
@@ -85,13 +85,12 @@ void demonstrateForUser(RecommendationEngine& engine, const std::string& user_id
 
     // Show some liked songs
     std::cout << "\nLiked Songs (sample):" << std::endl;
-    const auto& song_map = engine.getSongMap();
     int shown = 0;
     for (const auto& song_id : user.liked_songs) {
         if (shown >= 5) break;
-        auto it = song_map.find(song_id);
-        if (it != song_map.end()) {
-            std::cout << "  • " << it->second.title << " [" << it->second.genre << "]" << std::endl;
+        const Song* song = engine.findSong(song_id);
+        if (song) {
+            std::cout << "  • " << song->title << " [" << song->genre << "]" << std::endl;
             shown++;
         }
     }
@@ -136,7 +135,7 @@ void demonstrateSearch(RecommendationEngine& engine) {
     std::cout << " SEARCH AUTOCOMPLETE DEMONSTRATION (TRIE)" << std::endl;
     std::cout << "═══════════════════════════════════════════════════════════════" << std::endl;
 
-    std::vector<std::string> queries = {"bl", "star", "love", "sun", "bad"};
+    std::vector<std::string> queries = {"bl", "star", "love", "sun", "bad", "blindng", "sicko mod"};
 
     for (const auto& query : queries) {
         std::cout << "\nQuery: \"" << query << "\"\nResults:\n";
@@ -149,36 +148,70 @@ void demonstrateSearch(RecommendationEngine& engine) {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     printHeader();
 
-    // Dataset paths
-    std::string base_path = "datasets/";
-    std::string songs_file = base_path + "songs.csv";
-    std::string artists_file = base_path + "artists.csv";
-    std::string users_file = base_path + "users.csv";
-    std::string user_song_interactions_file = base_path + "user_song_interactions.csv";
-    std::string user_artist_interactions_file = base_path + "user_artist_interactions.csv";
-
-    // Load data
-    std::cout << "Loading datasets..." << std::endl;
-    std::cout << "──────────────────────────────────────────────────────────────" << std::endl;
-
-    auto songs = DataLoader::loadSongs(songs_file);
-    auto artists = DataLoader::loadArtists(artists_file);
-    auto users = DataLoader::loadUsers(users_file);
-    auto song_interactions = DataLoader::loadUserSongInteractions(user_song_interactions_file);
-    auto artist_interactions = DataLoader::loadUserArtistInteractions(user_artist_interactions_file);
-
-    if (songs.empty() || artists.empty() || users.empty()) {
-        std::cerr << "\nError: Failed to load datasets. Please check file paths." << std::endl;
-        std::cerr << "Expected location: ./datasets/" << std::endl;
-        return 1;
+    // --load-snapshot FILE starts from a saved engine instead of the CSVs;
+    // --save-snapshot FILE writes the engine after it is built;
+    // --stats-json / --stats-prometheus FILE export getStats() at exit
+    std::string load_snapshot, save_snapshot, stats_json, stats_prometheus;
+    for (int i = 1; i < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--load-snapshot" && i + 1 < argc) load_snapshot = argv[i + 1];
+        else if (flag == "--save-snapshot" && i + 1 < argc) save_snapshot = argv[i + 1];
+        else if (flag == "--stats-json" && i + 1 < argc) stats_json = argv[i + 1];
+        else if (flag == "--stats-prometheus" && i + 1 < argc) stats_prometheus = argv[i + 1];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--load-snapshot FILE] [--save-snapshot FILE]"
+                      << " [--stats-json FILE] [--stats-prometheus FILE]" << std::endl;
+            return 1;
+        }
     }
 
-    // Initialize recommendation engine
     RecommendationEngine engine;
-    engine.initialize(songs, artists, users, song_interactions, artist_interactions);
+    if (!load_snapshot.empty()) {
+        if (!engine.loadSnapshot(load_snapshot)) {
+            std::cerr << "\nError: Failed to load snapshot " << load_snapshot << std::endl;
+            return 1;
+        }
+    } else {
+        // Dataset paths
+        std::string base_path = "datasets/";
+        std::string songs_file = base_path + "songs.csv";
+        std::string artists_file = base_path + "artists.csv";
+        std::string users_file = base_path + "users.csv";
+        std::string user_song_interactions_file = base_path + "user_song_interactions.csv";
+        std::string user_artist_interactions_file = base_path + "user_artist_interactions.csv";
+
+        // Load data
+        std::cout << "Loading datasets..." << std::endl;
+        std::cout << "──────────────────────────────────────────────────────────────" << std::endl;
+
+        auto data = DataLoader::loadAll(songs_file, artists_file, users_file,
+                                        user_song_interactions_file, user_artist_interactions_file);
+        auto& songs = data.songs;
+        auto& artists = data.artists;
+        auto& users = data.users;
+        auto& song_interactions = data.song_interactions;
+        auto& artist_interactions = data.artist_interactions;
+
+        if (songs.empty() || artists.empty() || users.empty()) {
+            std::cerr << "\nError: Failed to load datasets. Please check file paths." << std::endl;
+            std::cerr << "Expected location: ./datasets/" << std::endl;
+            return 1;
+        }
+
+        engine.initialize(std::move(songs), std::move(artists), std::move(users),
+                          song_interactions, artist_interactions);
+    }
+
+    if (!save_snapshot.empty()) {
+        if (!engine.saveSnapshot(save_snapshot)) {
+            std::cerr << "\nError: Failed to write snapshot " << save_snapshot << std::endl;
+            return 1;
+        }
+        std::cout << "Snapshot written to " << save_snapshot << std::endl;
+    }
 
     // Demonstrate for multiple users
     std::vector<std::string> demo_users = {"U001", "U004", "U009", "U012"};
@@ -196,14 +229,31 @@ int main() {
     std::cout << " SYSTEM STATISTICS" << std::endl;
     std::cout << "═══════════════════════════════════════════════════════════════" << std::endl;
     std::cout << "\nData Structures Performance:" << std::endl;
-    std::cout << "  • K-D Tree: " << songs.size() << " songs indexed in 4D space" << std::endl;
+    std::cout << "  • K-D Tree: " << engine.getSongs().size() << " songs indexed in 4D space" << std::endl;
     std::cout << "  • Weighted Graph: " << engine.getUserGraph().getVertexCount()
               << " users, " << engine.getUserGraph().getEdgeCount() << " similarity edges" << std::endl;
     std::cout << "  • Bipartite Graph: " << engine.getBipartiteGraph().getUserCount()
               << " users × " << engine.getBipartiteGraph().getArtistCount() << " artists" << std::endl;
     std::cout << "  • Union-Find: " << engine.getCommunities().getNumberOfCommunities()
               << " taste communities formed" << std::endl;
-    std::cout << "  • Trie: Autocomplete enabled for " << (songs.size() + artists.size()) << " entries" << std::endl;
+    std::cout << "  • Trie: Autocomplete enabled for " << (engine.getSongs().size() + engine.getArtists().size()) << " entries" << std::endl;
+
+    if (!stats_json.empty() || !stats_prometheus.empty()) {
+        metrics::Report stats = engine.getStats();
+        std::cout << "\nMemory in use: " << std::fixed << std::setprecision(1)
+                  << stats.totalMemory() / (1024.0 * 1024.0) << " MiB" << std::endl;
+        for (const auto& target : {std::make_pair(stats_json, stats.toJson()),
+                                   std::make_pair(stats_prometheus, stats.toPrometheus())}) {
+            if (target.first.empty()) continue;
+            std::ofstream out(target.first);
+            out << target.second;
+            if (!out) {
+                std::cerr << "\nError: Failed to write stats " << target.first << std::endl;
+                return 1;
+            }
+            std::cout << "Stats written to " << target.first << std::endl;
+        }
+    }
 
     std::cout << "\n\n";
     std::cout << "╔═══════════════════════════════════════════════════════════════╗\n";
@@ -0,0 +1,57 @@
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <cerrno>
+#include <string>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+/**
+ * Output buffer over a socket
+ *
+ * Responses are appended without being sent. flush() writes everything
+ * in as few send() calls as the kernel allows. The owner flushes when
+ * it has no more output ready, so responses produced together leave in
+ * one packet. A full buffer flushes itself.
+ */
+class BufferedWriter {
+private:
+    static constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    int fd;
+    std::string buffer;
+    bool failed = false;
+
+public:
+    explicit BufferedWriter(int socket_fd) : fd(socket_fd) {
+        buffer.reserve(FLUSH_THRESHOLD);
+    }
+
+    void append(const std::string& text) {
+        buffer += text;
+        if (buffer.size() >= FLUSH_THRESHOLD) flush();
+    }
+
+    // false once the peer is gone; later output is dropped
+    bool flush() {
+        size_t sent = 0;
+        while (!failed && sent < buffer.size()) {
+            ssize_t n = ::send(fd, buffer.data() + sent, buffer.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) failed = true;
+            else sent += static_cast<size_t>(n);
+        }
+        buffer.clear();
+        return !failed;
+    }
+
+    bool hasFailed() const {
+        return failed;
+    }
+
+    size_t pending() const {
+        return buffer.size();
+    }
+};
+
+#endif // BUFFERED_WRITER_H
@@ -0,0 +1,234 @@
+#ifndef REQUEST_BATCHER_H
+#define REQUEST_BATCHER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../algorithms/serving_engine.h"
+#include "../core/metrics.h"
+
+/**
+ * Micro-batching front end for a ServingEngine
+ *
+ * Any thread may submit() a single-user request and get a future for its
+ * response. One dispatcher thread collects requests until max_batch are
+ * waiting or the oldest has waited window_us. It then runs them as one
+ * generateRecommendationsBatch() call per distinct result count, on the
+ * engine's worker pool. Responses are fulfilled from the batch sink as
+ * each user finishes, not at the end of the batch. A batch runs on the
+ * engine version current when it starts. While a batch runs, new
+ * requests queue up, so batches grow with load.
+ *
+ * Backpressure: the queue is bounded, and submit() fails fast with
+ * OVERLOADED instead of growing it. Deadlines: a request is answered
+ * DEADLINE_EXCEEDED, and not computed, if its deadline has passed when
+ * its batch starts or when its user comes up for scoring; one that
+ * expires while being scored gets DEADLINE_EXCEEDED instead of its
+ * results, too. Deadlines are read off Options::clock, so tests can step
+ * time explicitly; the batching window always runs on steady_clock.
+ */
+class RequestBatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Status {
+        OK,
+        OVERLOADED,
+        DEADLINE_EXCEEDED,
+        SHUTTING_DOWN
+    };
+
+    struct Response {
+        Status status;
+        std::vector<Recommendation> recommendations;
+    };
+
+    struct Options {
+        size_t max_batch = 64;
+        long window_us = 500;    // longest a request waits for company
+        size_t max_queue = 4096; // queued requests before OVERLOADED
+        std::function<Clock::time_point()> clock; // deadline time source; empty = Clock::now
+    };
+
+private:
+    struct Pending {
+        std::string user_id;
+        int num_recs;
+        Clock::time_point deadline;
+        Clock::time_point enqueued;
+        std::promise<Response> promise;
+    };
+
+    const ServingEngine& serving;
+    Options options;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<Pending> queue;
+    bool stopping = false;
+    std::thread dispatcher;
+
+    metrics::Counter batches;
+    metrics::Counter batched_requests;
+    metrics::Counter rejected;
+    metrics::Counter expired;
+    metrics::LatencyStat queue_wait;
+
+    Clock::time_point now() const {
+        return options.clock ? options.clock() : Clock::now();
+    }
+
+    static std::future<Response> ready(Status status) {
+        std::promise<Response> promise;
+        promise.set_value({status, {}});
+        return promise.get_future();
+    }
+
+    void run() {
+        std::vector<Pending> batch;
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        for (;;) {
+            queue_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) break;
+
+            // Hold the batch open until it is full or its oldest request's window ends
+            auto flush_at = queue.front().enqueued + std::chrono::microseconds(options.window_us);
+            queue_cv.wait_until(lock, flush_at, [this] { return stopping || queue.size() >= options.max_batch; });
+            if (stopping) break;
+
+            size_t take = std::min(queue.size(), options.max_batch);
+            for (size_t i = 0; i < take; ++i) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            lock.unlock();
+            process(batch);
+            batch.clear();
+            lock.lock();
+        }
+
+        for (auto& pending : queue) pending.promise.set_value({Status::SHUTTING_DOWN, {}});
+        queue.clear();
+    }
+
+    void expire(Pending& pending) {
+        expired.add();
+        pending.promise.set_value({Status::DEADLINE_EXCEEDED, {}});
+    }
+
+    void process(std::vector<Pending>& batch) {
+        batches.add();
+        batched_requests.add(batch.size());
+
+        // Live requests grouped by result count, then by user (a user asked
+        // for twice in one batch is computed once)
+        auto started = Clock::now();
+        auto checked = now();
+        std::map<int, std::unordered_map<std::string, std::vector<size_t>>> groups;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            queue_wait.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(started - batch[i].enqueued).count()));
+            if (checked >= batch[i].deadline) {
+                expire(batch[i]);
+                continue;
+            }
+            groups[batch[i].num_recs][batch[i].user_id].push_back(i);
+        }
+
+        std::shared_ptr<const RecommendationEngine> engine = serving.acquire();
+        std::vector<std::string> user_ids;
+        for (auto& group : groups) {
+            auto& by_user = group.second;
+            user_ids.clear();
+            for (const auto& entry : by_user) user_ids.push_back(entry.first);
+            // A user's requests are touched only by the worker scoring it
+            engine->generateRecommendationsBatch(user_ids, group.first,
+                [&](const std::string& user_id, const std::vector<Recommendation>& recs) {
+                    auto done = now();
+                    for (size_t i : by_user.at(user_id)) {
+                        if (done >= batch[i].deadline) {
+                            expire(batch[i]);
+                        } else {
+                            batch[i].promise.set_value({Status::OK, recs});
+                        }
+                    }
+                },
+                [&](const std::string& user_id) {
+                    auto& requests = by_user.at(user_id);
+                    auto start = now();
+                    for (size_t i : requests) {
+                        if (start < batch[i].deadline) return false;
+                    }
+                    for (size_t i : requests) expire(batch[i]);
+                    return true;
+                });
+        }
+    }
+
+public:
+    RequestBatcher(const ServingEngine& target, Options opts) : serving(target), options(opts) {
+        if (options.max_batch == 0) options.max_batch = 1;
+        dispatcher = std::thread([this] { run(); });
+    }
+
+    ~RequestBatcher() {
+        stop();
+    }
+
+    RequestBatcher(const RequestBatcher&) = delete;
+    RequestBatcher& operator=(const RequestBatcher&) = delete;
+
+    // Queues a request; the future is always fulfilled, with OVERLOADED
+    // at once if the queue is full
+    std::future<Response> submit(std::string user_id, int num_recs, Clock::time_point deadline) {
+        std::future<Response> result;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (stopping) return ready(Status::SHUTTING_DOWN);
+            if (queue.size() >= options.max_queue) {
+                rejected.add();
+                return ready(Status::OVERLOADED);
+            }
+            queue.push_back({std::move(user_id), num_recs, deadline, Clock::now(), std::promise<Response>()});
+            result = queue.back().promise.get_future();
+        }
+        queue_cv.notify_one();
+        return result;
+    }
+
+    // Finishes the running batch; still-queued requests get SHUTTING_DOWN
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        queue_cv.notify_all();
+        if (dispatcher.joinable()) dispatcher.join();
+    }
+
+    size_t queueLength() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return queue.size();
+    }
+
+    // Batching counters and queue wait, e.g. merged into engine stats
+    void addStats(metrics::Report& report) const {
+        report.addLatency("server_queue_wait", queue_wait);
+        report.addCounter("server_batches", batches.get());
+        report.addCounter("server_batched_requests", batched_requests.get());
+        report.addCounter("server_rejected_requests", rejected.get());
+        report.addCounter("server_expired_requests", expired.get());
+        uint64_t n = batches.get();
+        report.addGauge("server_mean_batch_size", n ? static_cast<double>(batched_requests.get()) / n : 0.0);
+    }
+};
+
+#endif // REQUEST_BATCHER_H
@@ -0,0 +1,524 @@
+/**
+ * Recommendation server
+ *
+ * Loads the engine once, from the CSV datasets or a snapshot, and then
+ * answers newline-delimited requests over TCP. Each request gets one
+ * JSON line in reply, in request order per connection. Clients may
+ * pipeline requests.
+ *
+ *   REC <user_id> [count] [deadline_ms]   fused recommendations
+ *   SEARCH <prefix>                       autocomplete
+ *   PLAY <user_id> <song_id> <plays> [0|1]      queue a song interaction (1 = liked)
+ *   ARTIST <user_id> <artist_id> <plays>        queue an artist interaction
+ *   BLOCK <user_id> <artist_id>           queue an artist block
+ *   REBUILD                               queue a community rebuild
+ *   SYNC                                  wait until queued updates are visible
+ *   STATS                                 engine and server metrics
+ *   PING
+ *
+ * Queries read the engine through a ServingEngine, so updates are applied
+ * in the background and never stall them. An update reply means the
+ * update is queued; it becomes visible with the next published version
+ * (within --publish-interval-us), or after SYNC.
+ *
+ * REC requests from all connections are micro-batched (RequestBatcher)
+ * onto the engine's worker pool. Each connection has a reader thread
+ * that parses and submits, and a writer thread that sends replies in
+ * order through a BufferedWriter, flushing only when no further reply
+ * is ready.
+ *
+ * Backpressure works at three levels:
+ * - a full batch queue answers {"status":"overloaded"};
+ * - a connection with too many replies in flight stops reading, so TCP
+ *   pushes back on the client;
+ * - connections past --max-connections are refused.
+ *
+ * Usage: rec_server [--host ADDR] [--port N] [--data DIR | --load-snapshot FILE]
+ *                   [--threads N] [--max-batch N] [--batch-window-us N] [--queue N]
+ *                   [--deadline-ms N] [--max-connections N] [--publish-interval-us N]
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../core/data_loader.h"
+#include "../algorithms/serving_engine.h"
+#include "buffered_writer.h"
+#include "request_batcher.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t MAX_LINE = 4096;
+constexpr size_t MAX_IN_FLIGHT = 256; // replies pending per connection
+constexpr int MAX_RECOMMENDATIONS = 100;
+constexpr int MAX_DEADLINE_MS = 60 * 60 * 1000;
+
+std::atomic<bool> shutdown_requested{false};
+
+void onSignal(int) {
+    shutdown_requested = true;
+}
+
+struct ServerOptions {
+    std::string host = "127.0.0.1";
+    int port = 7070;
+    std::string data_dir = "datasets";
+    std::string snapshot;
+    int threads = 0;
+    int deadline_ms = 100;
+    size_t max_connections = 256;
+    RequestBatcher::Options batching;
+    ServingEngine::Options serving;
+};
+
+// Parses all of text as an integer in [lo, hi]; junk, trailing
+// characters and out-of-range values fail
+template <typename T>
+bool parseNumber(const std::string& text, T lo, T hi, T& out) {
+    T value{};
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    if (result.ec != std::errc() || result.ptr != end || value < lo || value > hi) return false;
+    out = value;
+    return true;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", ch);
+            out += code;
+        } else {
+            out += ch;
+        }
+    }
+    return out;
+}
+
+std::string number(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+    return buffer;
+}
+
+const char* statusName(RequestBatcher::Status status) {
+    switch (status) {
+        case RequestBatcher::Status::OK: return "ok";
+        case RequestBatcher::Status::OVERLOADED: return "overloaded";
+        case RequestBatcher::Status::DEADLINE_EXCEEDED: return "deadline_exceeded";
+        default: return "shutting_down";
+    }
+}
+
+std::string errorLine(const std::string& message) {
+    return "{\"status\":\"error\",\"message\":\"" + jsonEscape(message) + "\"}\n";
+}
+
+std::string recommendationLine(const std::string& user_id, const RequestBatcher::Response& response) {
+    std::string out = "{\"status\":\"";
+    out += statusName(response.status);
+    out += "\",\"user_id\":\"" + jsonEscape(user_id) + "\"";
+    if (response.status == RequestBatcher::Status::OK) {
+        out += ",\"recommendations\":[";
+        for (size_t i = 0; i < response.recommendations.size(); ++i) {
+            const auto& r = response.recommendations[i];
+            if (i > 0) out += ',';
+            out += "{\"song_id\":\"" + jsonEscape(r.song_id) + "\",\"title\":\"" + jsonEscape(r.title) +
+                   "\",\"score\":" + number(r.score) + ",\"source\":\"" + sourceName(r.source) + "\"}";
+        }
+        out += ']';
+    }
+    return out + "}\n";
+}
+
+// Report::toJson() without its line breaks and indentation
+std::string singleLine(const std::string& json) {
+    std::string out;
+    out.reserve(json.size());
+    for (size_t i = 0; i < json.size(); ++i) {
+        if (json[i] != '\n') {
+            out += json[i];
+            continue;
+        }
+        while (i + 1 < json.size() && json[i + 1] == ' ') ++i;
+    }
+    return out;
+}
+
+std::vector<std::string> splitWords(const std::string& line) {
+    std::vector<std::string> words;
+    std::istringstream in(line);
+    for (std::string word; in >> word;) words.push_back(word);
+    return words;
+}
+
+class Server;
+
+/**
+ * One client: the reader thread parses lines into replies (ready text or
+ * a pending batch response), the writer thread emits them in order
+ */
+class Connection {
+private:
+    struct Reply {
+        std::string text;                                 // set when ready
+        std::string user_id;                              // for pending replies
+        std::future<RequestBatcher::Response> pending;    // valid for REC
+    };
+
+    int fd;
+    Server& server;
+    std::mutex reply_mutex;
+    std::condition_variable reply_cv;
+    std::deque<Reply> replies;
+    bool reading_done = false;
+
+    void push(Reply reply) {
+        std::unique_lock<std::mutex> lock(reply_mutex);
+        reply_cv.wait(lock, [this] { return replies.size() < MAX_IN_FLIGHT; });
+        replies.push_back(std::move(reply));
+        lock.unlock();
+        reply_cv.notify_all();
+    }
+
+    void handle(const std::string& line);
+    void readLoop();
+    void writeLoop();
+
+public:
+    Connection(int socket_fd, Server& owner) : fd(socket_fd), server(owner) {}
+
+    // Serves the connection until the peer closes it or the server stops
+    void serve() {
+        std::thread writer([this] { writeLoop(); });
+        readLoop();
+        {
+            std::lock_guard<std::mutex> lock(reply_mutex);
+            reading_done = true;
+        }
+        reply_cv.notify_all();
+        writer.join();
+    }
+};
+
+class Server {
+private:
+    ServingEngine& serving;
+    RequestBatcher& batcher;
+    ServerOptions options;
+
+    std::mutex connections_mutex;
+    std::condition_variable connections_cv;
+    std::set<int> open_fds;
+
+    metrics::Counter accepted;
+    metrics::Counter refused;
+
+    friend class Connection;
+
+    void runConnection(int fd) {
+        {
+            Connection connection(fd, *this);
+            connection.serve();
+        }
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        open_fds.erase(fd);
+        ::close(fd);
+        connections_cv.notify_all();
+    }
+
+public:
+    Server(ServingEngine& target, RequestBatcher& requests, ServerOptions opts)
+        : serving(target), batcher(requests), options(std::move(opts)) {}
+
+    std::string statsLine() {
+        metrics::Report report = serving.getStats();
+        batcher.addStats(report);
+        report.addCounter("server_connections_accepted", accepted.get());
+        report.addCounter("server_connections_refused", refused.get());
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            report.addGauge("server_open_connections", static_cast<double>(open_fds.size()));
+        }
+        report.addGauge("server_queue_length", static_cast<double>(batcher.queueLength()));
+        report.addGauge("server_pending_updates", static_cast<double>(serving.pendingUpdates()));
+        return "{\"status\":\"ok\",\"stats\":" + singleLine(report.toJson()) + "}\n";
+    }
+
+    int run() {
+        int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd < 0) {
+            std::perror("socket");
+            return 1;
+        }
+        int yes = 1;
+        ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(options.port));
+        if (::inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr) != 1) {
+            std::cerr << "Invalid --host " << options.host << std::endl;
+            ::close(listen_fd);
+            return 1;
+        }
+        if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd, 128) < 0) {
+            std::perror("bind/listen");
+            ::close(listen_fd);
+            return 1;
+        }
+        std::cout << "Listening on " << options.host << ":" << options.port << std::endl;
+
+        // Poll with a timeout so a signal is noticed promptly
+        while (!shutdown_requested) {
+            pollfd listener{listen_fd, POLLIN, 0};
+            if (::poll(&listener, 1, 200) <= 0) continue;
+            int fd = ::accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) continue;
+
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            if (open_fds.size() >= options.max_connections) {
+                refused.add();
+                std::string line = errorLine("too many connections");
+                ::send(fd, line.data(), line.size(), MSG_NOSIGNAL);
+                ::close(fd);
+                continue;
+            }
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+            accepted.add();
+            open_fds.insert(fd);
+            std::thread([this, fd] { runConnection(fd); }).detach();
+        }
+
+        // Stop accepting, end every reader, let the writers drain
+        ::close(listen_fd);
+        std::cout << "Shutting down..." << std::endl;
+        std::unique_lock<std::mutex> lock(connections_mutex);
+        for (int fd : open_fds) ::shutdown(fd, SHUT_RD);
+        connections_cv.wait(lock, [this] { return open_fds.empty(); });
+        return 0;
+    }
+};
+
+void Connection::handle(const std::string& line) {
+    std::vector<std::string> words = splitWords(line);
+    if (words.empty()) return;
+    const std::string& command = words[0];
+
+    if (command == "REC") {
+        if (words.size() < 2 || words.size() > 4) {
+            push({errorLine("usage: REC <user_id> [count] [deadline_ms]"), "", {}});
+            return;
+        }
+        int count = 10;
+        int deadline_ms = server.options.deadline_ms;
+        if ((words.size() > 2 && !parseNumber(words[2], 1, MAX_RECOMMENDATIONS, count)) ||
+            (words.size() > 3 && !parseNumber(words[3], 1, MAX_DEADLINE_MS, deadline_ms))) {
+            push({errorLine("count must be 1-100 and deadline_ms 1-" + std::to_string(MAX_DEADLINE_MS)), "", {}});
+            return;
+        }
+        auto deadline = Clock::now() + std::chrono::milliseconds(deadline_ms);
+        push({"", words[1], server.batcher.submit(words[1], count, deadline)});
+    } else if (command == "SEARCH") {
+        std::string prefix = line.substr(line.find("SEARCH") + 6);
+        size_t start = prefix.find_first_not_of(' ');
+        prefix = start == std::string::npos ? "" : prefix.substr(start);
+        std::string out = "{\"status\":\"ok\",\"results\":[";
+        auto results = server.serving.acquire()->searchAutocomplete(prefix);
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (i > 0) out += ',';
+            out += "\"" + jsonEscape(results[i]) + "\"";
+        }
+        push({out + "]}\n", "", {}});
+    } else if (command == "PLAY" || command == "ARTIST" || command == "BLOCK" || command == "REBUILD") {
+        bool queued;
+        int plays = 0;
+        bool counted = (command == "PLAY" || command == "ARTIST") && words.size() >= 4 &&
+                       parseNumber(words[3], 0, std::numeric_limits<int>::max(), plays);
+        bool flag_ok = words.size() == 4 || (words.size() == 5 && (words[4] == "0" || words[4] == "1"));
+        if (command == "PLAY" && counted && flag_ok) {
+            bool liked = words.size() == 5 && words[4] == "1";
+            queued = server.serving.applyInteraction({words[1], words[2], liked, plays});
+        } else if (command == "ARTIST" && counted && words.size() == 4) {
+            queued = server.serving.applyArtistInteraction({words[1], words[2], plays});
+        } else if (command == "BLOCK" && words.size() == 3) {
+            queued = server.serving.blockArtist(words[1], words[2]);
+        } else if (command == "REBUILD" && words.size() == 1) {
+            queued = server.serving.rebuildCommunities();
+        } else {
+            push({errorLine("usage: PLAY <user_id> <song_id> <plays> [0|1], ARTIST <user_id> <artist_id> <plays>,"
+                            " BLOCK <user_id> <artist_id> or REBUILD; plays is a non-negative integer"), "", {}});
+            return;
+        }
+        push({queued ? "{\"status\":\"ok\"}\n" : "{\"status\":\"shutting_down\"}\n", "", {}});
+    } else if (command == "SYNC") {
+        server.serving.sync();
+        push({"{\"status\":\"ok\",\"version\":" + std::to_string(server.serving.getVersion()) + "}\n", "", {}});
+    } else if (command == "STATS") {
+        push({server.statsLine(), "", {}});
+    } else if (command == "PING") {
+        push({"{\"status\":\"ok\"}\n", "", {}});
+    } else {
+        push({errorLine("unknown command " + command), "", {}});
+    }
+}
+
+void Connection::readLoop() {
+    std::string buffer;
+    char chunk[4096];
+    for (;;) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        buffer.append(chunk, static_cast<size_t>(n));
+
+        size_t start = 0;
+        for (size_t end; (end = buffer.find('\n', start)) != std::string::npos; start = end + 1) {
+            std::string line = buffer.substr(start, end - start);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            handle(line);
+        }
+        buffer.erase(0, start);
+        if (buffer.size() > MAX_LINE) {
+            push({errorLine("request line too long"), "", {}});
+            return;
+        }
+    }
+}
+
+void Connection::writeLoop() {
+    BufferedWriter out(fd);
+    for (;;) {
+        Reply reply;
+        {
+            std::unique_lock<std::mutex> lock(reply_mutex);
+            reply_cv.wait(lock, [this] { return !replies.empty() || reading_done; });
+            if (replies.empty()) break;
+            reply = std::move(replies.front());
+            replies.pop_front();
+        }
+        reply_cv.notify_all();
+
+        if (reply.pending.valid()) reply.text = recommendationLine(reply.user_id, reply.pending.get());
+        out.append(reply.text);
+
+        // Flush once nothing else is ready to go out with this reply
+        bool more;
+        {
+            std::lock_guard<std::mutex> lock(reply_mutex);
+            more = !replies.empty() &&
+                   (!replies.front().pending.valid() ||
+                    replies.front().pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+        }
+        if (!more && !out.flush()) ::shutdown(fd, SHUT_RD); // peer gone: stop reading too
+    }
+    out.flush();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ServerOptions options;
+    const size_t max_size = std::numeric_limits<size_t>::max();
+    const long max_us = 60L * 1000 * 1000;
+    for (int i = 1; i < argc; i += 2) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) flag = "";
+        std::string value = i + 1 < argc ? argv[i + 1] : "";
+        bool valid = true;
+        if (flag == "--host") options.host = value;
+        else if (flag == "--port") valid = parseNumber(value, 0, 65535, options.port);
+        else if (flag == "--data") options.data_dir = value;
+        else if (flag == "--load-snapshot") options.snapshot = value;
+        else if (flag == "--threads") valid = parseNumber(value, 0, 1024, options.threads);
+        else if (flag == "--max-batch") valid = parseNumber(value, size_t(1), max_size, options.batching.max_batch);
+        else if (flag == "--batch-window-us") valid = parseNumber(value, 0L, max_us, options.batching.window_us);
+        else if (flag == "--queue") valid = parseNumber(value, size_t(1), max_size, options.batching.max_queue);
+        else if (flag == "--deadline-ms") valid = parseNumber(value, 1, MAX_DEADLINE_MS, options.deadline_ms);
+        else if (flag == "--max-connections") valid = parseNumber(value, size_t(1), max_size, options.max_connections);
+        else if (flag == "--publish-interval-us") valid = parseNumber(value, 0L, max_us, options.serving.publish_interval_us);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--host ADDR] [--port N] [--data DIR | --load-snapshot FILE]"
+                      << " [--threads N] [--max-batch N] [--batch-window-us N] [--queue N]"
+                      << " [--deadline-ms N] [--max-connections N] [--publish-interval-us N]" << std::endl;
+            return 1;
+        }
+        if (!valid) {
+            std::cerr << "Error: invalid value for " << flag << ": " << value << std::endl;
+            return 1;
+        }
+    }
+
+    DataLoader::Datasets data;
+    if (options.snapshot.empty()) {
+        const std::string& dir = options.data_dir;
+        data = DataLoader::loadAll(dir + "/songs.csv", dir + "/artists.csv", dir + "/users.csv",
+                                   dir + "/user_song_interactions.csv", dir + "/user_artist_interactions.csv",
+                                   static_cast<size_t>(options.threads));
+        if (data.songs.empty() || data.artists.empty() || data.users.empty()) {
+            std::cerr << "Error: Failed to load datasets from " << dir << "/" << std::endl;
+            return 1;
+        }
+    }
+
+    // Both serving copies are built the same way; the second takes the data
+    int builds = 0;
+    bool loaded = true;
+    ServingEngine serving([&](RecommendationEngine& engine) {
+        engine.setWorkerThreads(options.threads);
+        if (!options.snapshot.empty()) {
+            loaded = loaded && engine.loadSnapshot(options.snapshot);
+        } else if (++builds == 1) {
+            engine.initialize(data.songs, data.artists, data.users, data.song_interactions, data.artist_interactions);
+        } else {
+            engine.initialize(std::move(data.songs), std::move(data.artists), std::move(data.users),
+                              data.song_interactions, data.artist_interactions);
+        }
+    }, options.serving);
+    if (!loaded) {
+        std::cerr << "Error: Failed to load snapshot " << options.snapshot << std::endl;
+        return 1;
+    }
+
+    struct sigaction action{};
+    action.sa_handler = onSignal;
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+    ::signal(SIGPIPE, SIG_IGN);
+
+    RequestBatcher batcher(serving, options.batching);
+    Server server(serving, batcher, options);
+    int status = server.run();
+    batcher.stop();
+    serving.stop();
+    return status;
+}
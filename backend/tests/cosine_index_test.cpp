@@ -0,0 +1,128 @@
+/**
+ * CosineIndex updates versus CosineSimilarityBuilder
+ *
+ * A graph built from part of a random play-count log and kept up to date
+ * from the changes CosineIndex::update() reports must equal the build
+ * over the whole log, bit for bit, for several retention rules; and a
+ * saved index must load only into a matching user set.
+ *
+ * Usage: cosine_index_test
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../algorithms/cosine_similarity_builder.h"
+
+namespace {
+
+constexpr uint32_t NUM_USERS = 120;
+constexpr uint32_t NUM_SONGS = 64;
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✓ " : "✗ ") << what << std::endl;
+    if (!ok) failures++;
+}
+
+using Plays = std::vector<std::unordered_map<uint32_t, int>>;
+using Graph = std::map<std::pair<uint32_t, uint32_t>, double>;
+using Event = std::tuple<uint32_t, uint32_t, int>; // user, song, plays
+
+Graph build(const Plays& plays, size_t top_k, double threshold, CosineSimilarityBuilder::Retention* kept) {
+    Graph graph;
+    CosineSimilarityBuilder builder(plays, NUM_SONGS, top_k, threshold);
+    builder.build([&](uint32_t u1, uint32_t u2, double w) { graph[{u1, u2}] = w; }, kept);
+    return graph;
+}
+
+// Applies an update's changes the way the engine applies them to its graph
+void apply(Graph& graph, uint32_t u, const CosineIndex::Update& update) {
+    for (auto it = graph.begin(); it != graph.end();) {
+        if (it->first.first == u || it->first.second == u) it = graph.erase(it);
+        else ++it;
+    }
+    for (const auto& l : update.row) graph[{std::min(u, l.first), std::max(u, l.first)}] = l.second;
+    for (const auto& l : update.unlinked) graph.erase(l);
+    for (const auto& e : update.linked) graph[{e.u1, e.u2}] = e.weight;
+}
+
+void checkRule(const std::vector<Event>& log, size_t top_k, double threshold) {
+    std::string name = "top " + std::to_string(top_k) + ", threshold " + std::to_string(threshold).substr(0, 4);
+    size_t built = log.size() / 2;
+    Plays plays(NUM_USERS);
+    for (size_t i = 0; i < built; ++i) plays[std::get<0>(log[i])][std::get<1>(log[i])] = std::get<2>(log[i]);
+
+    CosineSimilarityBuilder::Retention kept;
+    Graph live = build(plays, top_k, threshold, &kept);
+    CosineIndex index(plays, NUM_SONGS, std::move(kept));
+    CosineIndex::Update update;
+    for (size_t i = built; i < log.size(); ++i) {
+        uint32_t u = std::get<0>(log[i]);
+        plays[u][std::get<1>(log[i])] = std::get<2>(log[i]);
+        index.update(u, plays[u], update);
+        apply(live, u, update);
+    }
+
+    Graph expected = build(plays, top_k, threshold, nullptr);
+    check(!expected.empty(), name + ": the build has edges");
+    check(live == expected, name + ": updates match a rebuild (" + std::to_string(live.size()) + " vs " +
+                                std::to_string(expected.size()) + " edges)");
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<uint32_t> user(0, NUM_USERS - 1), song(0, NUM_SONGS - 1);
+    std::uniform_int_distribution<int> plays(-1, 30);
+    std::vector<Event> log;
+    for (int i = 0; i < 3000; ++i) {
+        uint32_t u = user(rng);
+        log.emplace_back(u, (u % 6) * 10 + song(rng) % 12, plays(rng)); // overlapping taste groups
+    }
+
+    checkRule(log, 0, 0.3);
+    checkRule(log, 1, 0.3);
+    checkRule(log, 3, 0.3);
+    checkRule(log, 8, 1.0);
+    checkRule(log, 20, 0.5);
+
+    // Round trip, and a snapshot for another user set is rejected
+    Plays initial(NUM_USERS);
+    for (size_t i = 0; i < log.size() / 2; ++i) initial[std::get<0>(log[i])][std::get<1>(log[i])] = std::get<2>(log[i]);
+    CosineSimilarityBuilder::Retention kept;
+    build(initial, 5, 0.3, &kept);
+    CosineIndex index(initial, NUM_SONGS, std::move(kept));
+    std::string path = "tests/cosine_index_test.snap";
+    SnapshotWriter out;
+    index.save(out, "cosine");
+    bool written = out.writeFile(path);
+    CosineIndex restored, mismatched;
+    bool loaded = false, rejected = false;
+    {
+        SnapshotReader in(path);
+        loaded = written && restored.load(in, "cosine", initial, NUM_SONGS);
+        rejected = !mismatched.load(in, "cosine", Plays(NUM_USERS / 2), NUM_SONGS);
+    }
+    std::remove(path.c_str());
+    check(loaded, "a saved index loads");
+    check(rejected, "an index for other users is rejected");
+
+    CosineIndex::Update a, b;
+    uint32_t u = std::get<0>(log.back());
+    initial[u][0] = 17;
+    index.update(u, initial[u], a);
+    restored.update(u, initial[u], b);
+    check(a.row == b.row && a.unlinked == b.unlinked && a.candidates == b.candidates,
+          "a loaded index updates like the original");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+/**
+ * Chunked CSV loading versus the serial loader
+ *
+ * An interaction file large enough to be cut into chunks must load to the
+ * same rows with several threads as with one, including when a quoted
+ * field holding newlines straddles the points the body would be cut at.
+ *
+ * Usage: data_loader_test
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../core/data_loader.h"
+
+namespace {
+
+const std::string PATH = "tests/data_loader_test.csv";
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✓ " : "✗ ") << what << std::endl;
+    if (!ok) failures++;
+}
+
+bool same(const std::vector<UserSongInteraction>& a, const std::vector<UserSongInteraction>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].user_id != b[i].user_id || a[i].song_id != b[i].song_id ||
+            a[i].liked != b[i].liked || a[i].play_count != b[i].play_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rows around one record whose quoted song_id spans most of the file
+std::string quotedFile(std::string& long_field) {
+    long_field.clear();
+    for (int line = 0; line < 100000; ++line) {
+        long_field += "liner notes, verse " + std::to_string(line) + "\n";
+    }
+    std::string csv = "user_id,song_id,liked,play_count\n";
+    for (int i = 0; i < 1000; ++i) csv += "user" + std::to_string(i) + ",song" + std::to_string(i) + ",true,3\n";
+    csv += "user_long,\"" + long_field + "\",false,7\n";
+    for (int i = 0; i < 1000; ++i) csv += "user" + std::to_string(i) + ",song" + std::to_string(i) + ",false,1\n";
+    return csv;
+}
+
+std::string plainFile() {
+    std::string csv = "user_id,song_id,liked,play_count\n";
+    for (int i = 0; i < 120000; ++i) {
+        csv += "user" + std::to_string(i % 997) + ",song" + std::to_string(i) + "," + (i % 3 ? "true" : "false") +
+               "," + std::to_string(i % 50) + "\n";
+    }
+    return csv;
+}
+
+bool write(const std::string& csv) {
+    std::ofstream out(PATH, std::ios::binary);
+    out << csv;
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+int main() {
+    std::string long_field;
+    std::string csv = quotedFile(long_field);
+    check(csv.size() > 2 * (1 << 20), "the quoted file is large enough to be chunked");
+    check(write(csv), "the quoted file is written");
+    auto serial = DataLoader::loadUserSongInteractions(PATH, 1);
+    auto chunked = DataLoader::loadUserSongInteractions(PATH, 4);
+    check(serial.size() == 2001, "the serial loader reads every record");
+    check(serial.size() > 1000 && serial[1000].song_id == long_field && serial[1000].play_count == 7,
+          "the serial loader keeps the quoted newlines in one field");
+    check(same(serial, chunked), "a quoted newline across a chunk boundary loads like the serial loader");
+
+    check(write(plainFile()), "the unquoted file is written");
+    serial = DataLoader::loadUserSongInteractions(PATH, 1);
+    chunked = DataLoader::loadUserSongInteractions(PATH, 4);
+    check(serial.size() == 120000, "the serial loader reads every unquoted record");
+    check(same(serial, chunked), "unquoted chunks load like the serial loader");
+
+    std::remove(PATH.c_str());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+/**
+ * Incremental similarity updates versus a full rebuild
+ *
+ * An engine built from part of a synthetic interaction log, with the rest
+ * replayed through applyInteraction(), must end up with the same user
+ * graph as an engine built from the whole log, for every similarity
+ * mode, and the same communities with the same community songs. The
+ * replay is split by a snapshot round trip, so the live rescoring state
+ * is also checked after loadSnapshot().
+ *
+ * Usage: incremental_similarity_test
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../algorithms/recommendation_engine.h"
+
+namespace {
+
+constexpr int NUM_USERS = 300;
+constexpr int NUM_SONGS = 400;
+constexpr int NUM_TASTES = 12;
+
+int failures = 0;
+std::ostream* console = &std::cout; // while engine output goes to std::cout
+std::ostringstream engine_output;    // ... which is captured here
+
+void check(bool ok, const std::string& what) {
+    *console << (ok ? "✓ " : "✗ ") << what << std::endl;
+    if (!ok) failures++;
+}
+
+struct Dataset {
+    std::vector<Song> songs;
+    std::vector<Artist> artists;
+    std::vector<User> users;
+    std::vector<UserSongInteraction> interactions; // shuffled
+};
+
+// Users draw most songs from one taste group, so graphs have real structure
+Dataset makeDataset() {
+    std::mt19937 rng(20240611);
+    Dataset data;
+    for (int a = 0; a < NUM_TASTES; ++a) {
+        data.artists.emplace_back("A" + std::to_string(a), "Artist " + std::to_string(a), "pop");
+    }
+    for (int s = 0; s < NUM_SONGS; ++s) {
+        data.songs.emplace_back("S" + std::to_string(s), "Song " + std::to_string(s), "A" + std::to_string(s % NUM_TASTES),
+                                "pop", 80 + s % 80, (s % 10) / 10.0, (s % 7) / 7.0, (s % 5) / 5.0, "happy");
+    }
+    std::uniform_int_distribution<int> any_song(0, NUM_SONGS - 1), plays(1, 40), coin(0, 1);
+    std::uniform_int_distribution<int> picks(8, 30), taste_song(0, NUM_SONGS / NUM_TASTES - 1);
+    for (int u = 0; u < NUM_USERS; ++u) {
+        std::string uid = "U" + std::to_string(u);
+        data.users.emplace_back(uid, "user" + std::to_string(u));
+        int taste = u % NUM_TASTES;
+        std::map<int, bool> chosen;
+        int n = picks(rng);
+        while (static_cast<int>(chosen.size()) < n) {
+            int s = coin(rng) || coin(rng) ? taste_song(rng) * NUM_TASTES + taste : any_song(rng);
+            chosen[s] = coin(rng) == 1;
+        }
+        for (const auto& c : chosen) {
+            data.interactions.emplace_back(uid, "S" + std::to_string(c.first), c.second, plays(rng));
+        }
+    }
+    std::shuffle(data.interactions.begin(), data.interactions.end(), rng);
+    return data;
+}
+
+using EdgeSet = std::map<std::pair<std::string, std::string>, double>;
+
+EdgeSet edgeSet(const RecommendationEngine& engine) {
+    EdgeSet edges;
+    const auto& ids = engine.getUserIds();
+    for (uint32_t u = 0; u < engine.getUsers().size(); ++u) {
+        for (auto edge : engine.getUserGraph().getNeighbors(u)) {
+            edges[{ids.name(u), ids.name(edge.first)}] = edge.second;
+        }
+    }
+    return edges;
+}
+
+// Same pairs, weights equal up to summation order
+bool sameEdges(const EdgeSet& a, const EdgeSet& b, std::string& diff) {
+    auto ia = a.begin();
+    auto ib = b.begin();
+    size_t differing = 0;
+    while (ia != a.end() || ib != b.end()) {
+        if (ib == b.end() || (ia != a.end() && ia->first < ib->first)) {
+            differing++;
+            ++ia;
+        } else if (ia == a.end() || ib->first < ia->first) {
+            differing++;
+            ++ib;
+        } else {
+            if (std::fabs(ia->second - ib->second) > 1e-9) differing++;
+            ++ia;
+            ++ib;
+        }
+    }
+    diff = std::to_string(a.size()) + " vs " + std::to_string(b.size()) + " entries, " +
+           std::to_string(differing) + " differing";
+    return differing == 0;
+}
+
+// Every user's community members, plus its community pillar's ranking
+using Communities = std::map<std::string, std::pair<std::set<std::string>, std::vector<std::string>>>;
+
+Communities communities(const RecommendationEngine& engine) {
+    Communities out;
+    const auto& ids = engine.getUserIds();
+    for (uint32_t u = 0; u < engine.getUsers().size(); ++u) {
+        auto& entry = out[ids.name(u)];
+        for (uint32_t member : engine.getCommunities().getCommunityMembers(u)) entry.first.insert(ids.name(member));
+        for (const auto& rec : engine.getCommunityBasedRecommendations(ids.name(u), 20)) {
+            entry.second.push_back(rec.song_id + "@" + std::to_string(rec.score));
+        }
+    }
+    return out;
+}
+
+bool sameCommunities(const Communities& a, const Communities& b, std::string& diff) {
+    size_t differing = 0;
+    for (const auto& entry : a) {
+        auto other = b.find(entry.first);
+        if (other == b.end() || other->second != entry.second) differing++;
+    }
+    diff = std::to_string(differing) + " of " + std::to_string(a.size()) + " users differing";
+    return differing == 0 && a.size() == b.size();
+}
+
+using Configure = std::function<void(RecommendationEngine&)>;
+
+void checkMode(const Dataset& data, const std::string& name, const Configure& configure) {
+    size_t built = data.interactions.size() * 7 / 10;
+    size_t halfway = built + (data.interactions.size() - built) / 2;
+    std::vector<UserSongInteraction> head(data.interactions.begin(), data.interactions.begin() + built);
+    std::string snapshot = "tests/incremental_similarity_test.snap";
+
+    // restored takes its settings from the snapshot
+    RecommendationEngine full, live, restored;
+    for (auto* engine : {&full, &live, &restored}) engine->setWorkerThreads(2);
+    configure(full);
+    configure(live);
+    full.initialize(data.songs, data.artists, data.users, data.interactions, {});
+    live.initialize(data.songs, data.artists, data.users, head, {});
+    for (size_t i = built; i < halfway; ++i) live.applyInteraction(data.interactions[i]);
+    engine_output.str("");
+    bool saved = live.saveSnapshot(snapshot) && restored.loadSnapshot(snapshot);
+    check(saved && engine_output.str().find("Snapshot has no") == std::string::npos,
+          name + ": loadSnapshot restores the saved index instead of rebuilding it");
+    std::remove(snapshot.c_str());
+    for (size_t i = halfway; i < data.interactions.size(); ++i) {
+        live.applyInteraction(data.interactions[i]);
+        restored.applyInteraction(data.interactions[i]);
+    }
+
+    EdgeSet expected = edgeSet(full);
+    std::string diff;
+    check(!expected.empty(), name + ": the full build has edges");
+    bool same = sameEdges(edgeSet(live), expected, diff);
+    check(same, name + ": incremental updates match a full rebuild (" + diff + ")");
+    same = saved && sameEdges(edgeSet(restored), expected, diff);
+    check(same, name + ": updates after loadSnapshot match a full rebuild (" + diff + ")");
+
+    Communities expected_communities = communities(full);
+    same = sameCommunities(communities(live), expected_communities, diff);
+    check(same, name + ": incremental communities match a full rebuild (" + diff + ")");
+    same = saved && sameCommunities(communities(restored), expected_communities, diff);
+    check(same, name + ": communities after loadSnapshot match a full rebuild (" + diff + ")");
+}
+
+} // namespace
+
+int main() {
+    Dataset data = makeDataset();
+
+    // Engine build output is not part of the check
+    std::ostream out(std::cout.rdbuf());
+    console = &out;
+    std::streambuf* stdout_buf = std::cout.rdbuf(engine_output.rdbuf());
+
+    checkMode(data, "EXACT", [](RecommendationEngine& engine) { engine.setSimilarityMode(SimilarityMode::EXACT); });
+    checkMode(data, "MINHASH", [](RecommendationEngine& engine) { engine.setSimilarityMode(SimilarityMode::MINHASH); });
+    checkMode(data, "MINHASH, capped buckets, estimated", [](RecommendationEngine& engine) {
+        MinHashOptions options;
+        options.bands = 16;
+        options.rows_per_band = 1;
+        options.max_bucket_size = 12;
+        options.verify = false;
+        engine.setSimilarityMode(SimilarityMode::MINHASH, options);
+    });
+    checkMode(data, "COSINE, pruned to 5 neighbors", [](RecommendationEngine& engine) {
+        engine.setSimilarityMode(SimilarityMode::COSINE);
+        engine.setCosineNeighbors(5);
+    });
+
+    std::cout.rdbuf(stdout_buf);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+/**
+ * Flat batch k-NN versus single queries, for every backend
+ *
+ * findSimilarSongsBatch() must return, for each query song, the same
+ * neighbors as findKNearest() over the song's stored features with the
+ * song itself dropped, and a call with warm buffers must not allocate.
+ *
+ * Usage: nearest_neighbor_test
+ */
+
+// The counting operator new below pairs malloc with free, which GCC
+// cannot see through once library code is inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Data_Structures/brute_force_index.h"
+#include "../Data_Structures/ivf_index.h"
+#include "../Data_Structures/kdtree.h"
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✓ " : "✗ ") << what << std::endl;
+    if (!ok) failures++;
+}
+
+// Neighbors of idx through the single-query API
+std::vector<uint32_t> reference(const NearestNeighborIndex& index, uint32_t idx, int k) {
+    std::vector<uint32_t> similar;
+    for (const auto& it : index.findKNearest(index.getFeatures(idx), k + 1)) {
+        if (it.second == idx) continue;
+        if (similar.size() < static_cast<size_t>(k)) similar.push_back(it.second);
+    }
+    return similar;
+}
+
+void checkBackend(NearestNeighborIndex& index, const std::vector<Song>& songs) {
+    std::string name = index.name();
+    index.build(songs);
+
+    std::vector<uint32_t> queries;
+    for (uint32_t idx = 0; idx < songs.size(); idx += 7) queries.push_back(idx);
+    queries.push_back(3);  // repeated query
+    Arena arena;
+    std::vector<uint32_t> neighbors, offsets;
+
+    for (int k : {1, 10, 25}) {
+        index.findSimilarSongsBatch(queries, k, arena, neighbors, offsets);
+        bool same = offsets.size() == queries.size() + 1 && offsets.back() == neighbors.size();
+        for (size_t q = 0; same && q < queries.size(); ++q) {
+            std::vector<uint32_t> list(neighbors.begin() + offsets[q], neighbors.begin() + offsets[q + 1]);
+            same = list == reference(index, queries[q], k);
+        }
+        check(same, name + ": batch lists match single queries for k = " + std::to_string(k));
+    }
+
+    arena.reset();
+    size_t before = allocations.load();
+    index.findSimilarSongsBatch(queries, 25, arena, neighbors, offsets);
+    bool allocated = allocations.load() != before;
+    check(!allocated, name + ": a warm call makes no heap allocations");
+
+    index.findSimilarSongsBatch({}, 10, arena, neighbors, offsets);
+    check(neighbors.empty() && offsets.size() == 1 && offsets[0] == 0, name + ": no queries give no lists");
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<int> bpm(60, 180);
+    std::vector<Song> songs;
+    for (int i = 0; i < 600; ++i) {
+        // Coarse energy values produce exact distance ties
+        songs.emplace_back("s" + std::to_string(i), "t", "a", "g", bpm(rng), (i % 10) / 10.0, unit(rng), unit(rng),
+                           "m");
+    }
+
+    KDTree kdtree;
+    BruteForceIndex brute_force;
+    IvfIndex ivf(16, 3);
+    checkBackend(kdtree, songs);
+    checkBackend(brute_force, songs);
+    checkBackend(ivf, songs);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/**
+ * RequestBatcher deadline checks
+ *
+ * Deadlines are read off a stepping clock that advances one tick each time
+ * the batcher looks at it: once when a batch starts, then once when each
+ * user comes up for scoring and once when it finishes. Expiry is therefore
+ * decided by the order requests are checked in, not by how long scoring
+ * takes, and every batch is flushed only once it is full. Each request
+ * must be answered DEADLINE_EXCEEDED at the check after its deadline, and
+ * every other request with exactly its group's results.
+ *
+ * Usage: request_batcher_test [DATA_DIR]   (default: datasets)
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../core/data_loader.h"
+#include "../algorithms/serving_engine.h"
+#include "../server/request_batcher.h"
+
+using Clock = std::chrono::steady_clock;
+using Status = RequestBatcher::Status;
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✓ " : "✗ ") << what << std::endl;
+    if (!ok) failures++;
+}
+
+static Clock::time_point tick(int64_t t) {
+    return Clock::time_point(Clock::duration(t));
+}
+
+static const Clock::time_point FAR = Clock::time_point::max();
+
+struct Request {
+    std::string user_id;
+    int num_recs;
+    Clock::time_point deadline;
+};
+
+// Submits requests as one batch on a stepping clock starting at tick 0
+static std::vector<RequestBatcher::Response> runBatch(const ServingEngine& serving,
+                                                      const std::vector<Request>& requests) {
+    auto ticks = std::make_shared<std::atomic<int64_t>>(0);
+    RequestBatcher::Options options;
+    options.max_batch = requests.size();
+    options.max_queue = requests.size();
+    options.window_us = 60L * 1000 * 1000; // flush only once full
+    options.clock = [ticks] { return tick(ticks->fetch_add(1)); };
+    RequestBatcher batcher(serving, options);
+
+    std::vector<std::future<RequestBatcher::Response>> replies;
+    for (const auto& r : requests) replies.push_back(batcher.submit(r.user_id, r.num_recs, r.deadline));
+    std::vector<RequestBatcher::Response> responses;
+    for (auto& reply : replies) responses.push_back(reply.get());
+    return responses;
+}
+
+// Every request but those at the listed positions is OK with the engine's
+// own results for its user and result count
+static bool answeredWithResults(const ServingEngine& serving, const std::vector<Request>& requests,
+                                const std::vector<RequestBatcher::Response>& responses,
+                                const std::vector<size_t>& expired = {}) {
+    auto engine = serving.acquire();
+    for (size_t i = 0; i < requests.size(); ++i) {
+        bool expected_expired = false;
+        for (size_t e : expired) expected_expired = expected_expired || e == i;
+        if (expected_expired) continue;
+        if (responses[i].status != Status::OK) return false;
+        auto expected = engine->generateRecommendations(requests[i].user_id, requests[i].num_recs);
+        const auto& actual = responses[i].recommendations;
+        if (expected.size() != actual.size()) return false;
+        for (size_t r = 0; r < actual.size(); ++r) {
+            if (expected[r].song_id != actual[r].song_id || expected[r].score != actual[r].score) return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::string dir = argc > 1 ? argv[1] : "datasets";
+    auto data = DataLoader::loadAll(dir + "/songs.csv", dir + "/artists.csv", dir + "/users.csv",
+                                    dir + "/user_song_interactions.csv", dir + "/user_artist_interactions.csv");
+    if (data.users.empty()) {
+        std::cerr << "Error: Failed to load datasets from " << dir << "/" << std::endl;
+        return 1;
+    }
+    std::vector<std::string> users;
+    for (const auto& user : data.users) users.push_back(user.user_id);
+
+    // Engine build output is not part of the check
+    std::ostringstream quiet;
+    std::streambuf* console = std::cout.rdbuf(quiet.rdbuf());
+    ServingEngine serving([&](RecommendationEngine& engine) {
+        engine.setWorkerThreads(1);
+        engine.initialize(data.songs, data.artists, data.users, data.song_interactions, data.artist_interactions);
+    });
+    std::cout.rdbuf(console);
+
+    // Three result-count groups over every user, plus a repeated request
+    std::vector<Request> requests;
+    for (int g = 1; g <= 3; ++g) {
+        for (const auto& user : users) requests.push_back({user, g, FAR});
+    }
+    requests.push_back({users.front(), 2, FAR});
+    auto responses = runBatch(serving, requests);
+    check(answeredWithResults(serving, requests, responses),
+          "requests with a far deadline get their own group's results");
+
+    // Batch start reads tick 0; the first group's users then read ticks
+    // 1..2n, so a last-group request due at tick 2 expires before its turn
+    requests.clear();
+    for (const auto& user : users) requests.push_back({user, 1, FAR});
+    requests.push_back({users.front(), 2, tick(2)});
+    responses = runBatch(serving, requests);
+    check(answeredWithResults(serving, requests, responses, {requests.size() - 1}),
+          "requests ahead of the expiring one are answered OK");
+    check(responses.back().status == Status::DEADLINE_EXCEEDED && responses.back().recommendations.empty(),
+          "a request that expires while the requests ahead of it are scored is answered DEADLINE_EXCEEDED");
+
+    requests.back().deadline = FAR;
+    responses = runBatch(serving, requests);
+    check(answeredWithResults(serving, requests, responses), "the same batch without the deadline is answered OK");
+
+    // Alone in its batch: live at the start (tick 0) and when its turn
+    // comes (tick 1), past due when scoring finishes (tick 2)
+    responses = runBatch(serving, {{users.front(), 3, tick(2)}});
+    check(responses[0].status == Status::DEADLINE_EXCEEDED,
+          "a request that expires while being scored is answered DEADLINE_EXCEEDED");
+    responses = runBatch(serving, {{users.front(), 3, tick(3)}});
+    check(responses[0].status == Status::OK, "a request due just after scoring finishes is answered OK");
+
+    // Due at the batch start; the others in the batch are unaffected
+    requests = {{users.front(), 1, FAR}, {users.back(), 1, tick(0)}, {users.back(), 2, FAR}};
+    responses = runBatch(serving, requests);
+    check(responses[1].status == Status::DEADLINE_EXCEEDED,
+          "a request expired before its batch starts is answered DEADLINE_EXCEEDED");
+    check(answeredWithResults(serving, requests, responses, {1}), "the rest of that batch is answered OK");
+
+    serving.stop();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+/**
+ * Snapshot loading rejects out-of-range offsets and ids
+ *
+ * Each structure is saved, then one of its sections is replaced by data
+ * pointing outside the arrays it indexes: load() must return false
+ * instead of keeping ids that would be dereferenced later. The
+ * unmodified snapshot must still load.
+ *
+ * Usage: snapshot_load_test
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../Data_Structures/bipartite_graph.h"
+#include "../Data_Structures/community_popularity.h"
+#include "../Data_Structures/compact_trie.h"
+#include "../Data_Structures/union_find.h"
+#include "../Data_Structures/weighted_graph.h"
+
+namespace {
+
+const std::string SAVED = "tests/snapshot_load_test.snap";
+const std::string CORRUPT = "tests/snapshot_load_test.bad.snap";
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✓ " : "✗ ") << what << std::endl;
+    if (!ok) failures++;
+}
+
+// Copies sections of SAVED to CORRUPT, with target's contents replaced
+template <typename T>
+bool corrupt(const std::vector<std::string>& sections, const std::string& target, const std::vector<T>& data) {
+    SnapshotReader in(SAVED);
+    SnapshotWriter out;
+    for (const auto& name : sections) {
+        std::vector<char> bytes;
+        if (!in.getArray(name, bytes)) return false;
+        if (name == target) {
+            bytes.assign(reinterpret_cast<const char*>(data.data()),
+                         reinterpret_cast<const char*>(data.data()) + data.size() * sizeof(T));
+        }
+        out.putArrayCopy(name, bytes);
+    }
+    return out.writeFile(CORRUPT);
+}
+
+template <typename LoadFn>
+bool loads(const std::string& path, LoadFn load) {
+    SnapshotReader in(path);
+    return in.isValid() && load(in);
+}
+
+void checkWeightedGraph() {
+    WeightedGraph graph;
+    graph.addEdge(0, 1, 0.5);
+    graph.addEdge(1, 2, 0.25);
+    graph.freeze();
+    SnapshotWriter out;
+    graph.save(out, "g");
+    out.writeFile(SAVED);
+
+    std::vector<std::string> sections = {"g.present", "g.max_neighbors", "g.row_offsets", "g.neighbor_ids",
+                                         "g.neighbor_weights"};
+    auto load = [](size_t users) {
+        return [users](const SnapshotReader& in) { WeightedGraph loaded; return loaded.load(in, "g", users); };
+    };
+    check(loads(SAVED, load(3)), "WeightedGraph: a saved graph loads");
+    check(!loads(SAVED, load(2)), "WeightedGraph: vertices beyond the user count are rejected");
+    check(corrupt(sections, "g.neighbor_ids", std::vector<uint32_t>{1, 0, 7, 1}) && !loads(CORRUPT, load(3)),
+          "WeightedGraph: a neighbor id out of range is rejected");
+    check(corrupt(sections, "g.row_offsets", std::vector<uint32_t>{0, 3, 1, 4}) && !loads(CORRUPT, load(3)),
+          "WeightedGraph: decreasing row offsets are rejected");
+    check(corrupt(sections, "g.row_offsets", std::vector<uint32_t>{0, 1, 3, 9}) && !loads(CORRUPT, load(3)),
+          "WeightedGraph: offsets past the neighbor count are rejected");
+}
+
+void checkUnionFind() {
+    UnionFind sets;
+    for (uint32_t u = 0; u < 4; ++u) sets.makeSet(u);
+    sets.unionSets(0, 1);
+    SnapshotWriter out;
+    sets.save(out, "c");
+    out.writeFile(SAVED);
+
+    std::vector<std::string> sections = {"c.parent", "c.rank", "c.set_size", "c.next_member", "c.num_sets"};
+    auto load = [](const SnapshotReader& in) { UnionFind loaded; return loaded.load(in, "c", 4); };
+    check(loads(SAVED, load), "UnionFind: saved sets load");
+    check(!loads(SAVED, [](const SnapshotReader& in) { UnionFind loaded; return loaded.load(in, "c", 5); }),
+          "UnionFind: sets for another user count are rejected");
+    check(corrupt(sections, "c.parent", std::vector<uint32_t>{0, 9, 2, 3}) && !loads(CORRUPT, load),
+          "UnionFind: a parent out of range is rejected");
+    check(corrupt(sections, "c.parent", std::vector<uint32_t>{1, 0, 2, 3}) && !loads(CORRUPT, load),
+          "UnionFind: a parent cycle is rejected");
+    check(corrupt(sections, "c.next_member", std::vector<uint32_t>{1, 0, 3, 2}) && !loads(CORRUPT, load),
+          "UnionFind: a member circle crossing sets is rejected");
+    check(corrupt(sections, "c.next_member", std::vector<uint32_t>{0, 1, 2, 3}) && !loads(CORRUPT, load),
+          "UnionFind: a set split over two circles is rejected");
+    check(corrupt(sections, "c.num_sets", std::vector<int64_t>{4}) && !loads(CORRUPT, load),
+          "UnionFind: a wrong set count is rejected");
+}
+
+void checkCommunityPopularity() {
+    UnionFind sets;
+    for (uint32_t u = 0; u < 3; ++u) sets.makeSet(u);
+    sets.unionSets(0, 1);
+    CommunityPopularity tables;
+    tables.build(sets, {{0, 2}, {2}, {1}}, 3, std::less<uint32_t>());
+    SnapshotWriter out;
+    tables.save(out, "p");
+    out.writeFile(SAVED);
+
+    auto load = [](size_t songs, size_t users) {
+        return [=](const SnapshotReader& in) { CommunityPopularity loaded; return loaded.load(in, "p", songs, users); };
+    };
+    check(loads(SAVED, load(3, 3)), "CommunityPopularity: saved tables load");
+    check(!loads(SAVED, load(2, 3)), "CommunityPopularity: songs beyond the catalog are rejected");
+    check(!loads(SAVED, load(3, 2)), "CommunityPopularity: tables beyond the user count are rejected");
+    std::vector<CommunityPopularity::Entry> entries = {{2, 2}, {0, 1}, {7, 1}};
+    check(corrupt({"p.num_songs", "p.tables.off", "p.tables.val"}, "p.tables.val", entries) &&
+          !loads(CORRUPT, load(3, 3)), "CommunityPopularity: a song beyond the table's count is rejected");
+}
+
+void checkBipartiteGraph() {
+    BipartiteGraph graph;
+    graph.addEdge(0, 0, 5);
+    graph.addEdge(0, 1, 2);
+    graph.addEdge(1, 1, 3);
+    graph.freeze({{0, 1}, {2}});
+    SnapshotWriter out;
+    graph.save(out, "b");
+    out.writeFile(SAVED);
+
+    std::vector<std::string> sections = {"b.counts", "b.user_offsets", "b.user_artists", "b.user_plays",
+                                         "b.user_weights", "b.artist_offsets", "b.artist_users",
+                                         "b.artist_weights", "b.song_offsets", "b.artist_song_ids"};
+    auto load = [](size_t songs) {
+        return [songs](const SnapshotReader& in) { BipartiteGraph loaded; return loaded.load(in, "b", songs); };
+    };
+    check(loads(SAVED, load(3)), "BipartiteGraph: a saved graph loads");
+    check(!loads(SAVED, load(2)), "BipartiteGraph: artist songs beyond the catalog are rejected");
+    check(corrupt(sections, "b.user_artists", std::vector<uint32_t>{0, 5, 1}) && !loads(CORRUPT, load(3)),
+          "BipartiteGraph: an artist id out of range is rejected");
+    check(corrupt(sections, "b.artist_offsets", std::vector<uint32_t>{0, 2, 1}) && !loads(CORRUPT, load(3)),
+          "BipartiteGraph: listener offsets that do not add up are rejected");
+}
+
+void checkCompactTrie() {
+    Trie trie;
+    for (const char* word : {"alpha", "alps", "beta"}) trie.insert(word);
+    CompactTrie index(trie);
+    SnapshotWriter out;
+    index.save(out, "t");
+    out.writeFile(SAVED);
+
+    std::vector<std::string> sections = {"t.cache_size", "t.nodes", "t.labels", "t.value_offsets", "t.values",
+                                         "t.frequencies", "t.top_ids"};
+    auto load = [](const SnapshotReader& in) { CompactTrie loaded; return loaded.load(in, "t"); };
+    check(loads(SAVED, load), "CompactTrie: a saved index loads");
+    SnapshotReader in(SAVED);
+    std::vector<uint32_t> top_ids;
+    in.getArray("t.top_ids", top_ids);
+    top_ids.back() = 3;
+    check(corrupt(sections, "t.top_ids", top_ids) && !loads(CORRUPT, load),
+          "CompactTrie: a cached value id out of range is rejected");
+    check(corrupt(sections, "t.value_offsets", std::vector<uint32_t>{0, 5, 4, 13}) && !loads(CORRUPT, load),
+          "CompactTrie: decreasing value offsets are rejected");
+}
+
+} // namespace
+
+int main() {
+    checkWeightedGraph();
+    checkUnionFind();
+    checkCommunityPopularity();
+    checkBipartiteGraph();
+    checkCompactTrie();
+    std::remove(SAVED.c_str());
+    std::remove(CORRUPT.c_str());
+    return failures == 0 ? 0 : 1;
+}